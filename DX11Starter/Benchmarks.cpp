@@ -0,0 +1,44 @@
+#include "Benchmarks.h"
+#include "ObjLoader.h"
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "MeshPrimitives.h"
+#include "MeshBvh.h"
+#include "ProgressiveMesh.h"
+#include "VertexStreams.h"
+#include "RangeAllocator.h"
+#include "TransformStore.h"
+#include "Components.h"
+#include "SystemScheduler.h"
+#include "StaticBatch.h"
+#include <cstdio>
+
+void RunBenchmarks(const char* modelDirectory)
+{
+	printf("Running benchmarks on the models in %s", modelDirectory);
+
+	// The checks each print what they found, and whether it was right
+	unsigned int failed = 0;
+	if (!CheckObjWelding(modelDirectory)) failed++;
+	if (!CheckObjStreaming(modelDirectory)) failed++;
+	if (!CheckIndexFormats()) failed++;
+	if (!CheckVertexStreams(modelDirectory)) failed++;
+	if (!CheckRangeAllocator()) failed++;
+	if (!CheckProgressiveMeshes(modelDirectory)) failed++;
+	if (!CheckStaticBatches()) failed++;
+
+	// Meshes
+	BenchmarkObjParsing(modelDirectory);
+	BenchmarkObjThreads();
+	BenchmarkMeshOptimizer(modelDirectory);
+	BenchmarkPrimitives(modelDirectory);
+	if (!BenchmarkRaycasts(modelDirectory)) failed++;
+
+	// Transforms and entities
+	BenchmarkTransforms();
+	BenchmarkHierarchy();
+	BenchmarkEntities();
+	BenchmarkScheduler();
+
+	printf("\n\nDone, %u checks failed\n", failed);
+}
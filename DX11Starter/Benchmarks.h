@@ -0,0 +1,14 @@
+#pragma once
+
+// --------------------------------------------------------
+// Runs every benchmark, and every check of the mesh and
+// entity code, printing the results to the console
+//
+// - Only run when asked for (with -benchmark on the command
+//    line, see Main.cpp), not on every launch, since most of
+//    them take a while, and their timings only mean anything
+//    in an optimized build
+// - Models are loaded from "modelDirectory"
+// - Any checks that fail are counted at the end
+// --------------------------------------------------------
+void RunBenchmarks(const char* modelDirectory);
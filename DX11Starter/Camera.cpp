@@ -17,6 +17,10 @@ Camera::Camera()
 	rotationY = +0.0f;
 
 	speed = 5;
+
+	// Make sure the first Update builds the View Matrix
+	version = 1;
+	viewVersion = 0;
 }
 
 
@@ -29,7 +33,8 @@ void Camera::Update(float deltaTime)
 {
 	ProcessInput(deltaTime);
 
-	if (!IsViewMatrixDirty()) {
+	// Only recalculate the View Matrix if the Camera has moved or turned since it was last made
+	if (viewVersion == version) {
 		return;
 	}
 
@@ -49,9 +54,7 @@ void Camera::Update(float deltaTime)
 	XMStoreFloat3(&forward, dir);
 
 	// Update variables to be accurate to change
-	lastPosition = position;
-	lastRotationX = rotationX;
-	lastRotationY = rotationY;
+	viewVersion = version;
 }
 
 void Camera::UpdateProjectionMatrix(unsigned int width, unsigned int height)
@@ -71,6 +74,7 @@ void Camera::MouseLook(float rotX, float rotY)
 {
 	rotationX += rotX*.001f;
 	rotationY += rotY*.001f;
+	version++;
 
 	// If Y Rotation exceeds 360 degrees, reset it so we aren't dealing with massive numbers
 	if (rotationY > XM_2PI) {
@@ -89,42 +93,41 @@ void Camera::MouseLook(float rotX, float rotY)
 	}
 }
 
-bool Camera::IsViewMatrixDirty()
-{
-	if (lastPosition.x == position.x && lastPosition.y == position.y && lastPosition.z == position.z
-		&& lastRotationX == rotationX && lastRotationY == rotationY) {
-		return false;
-	}
-	return true;
-}
-
 void Camera::ProcessInput(float deltaTime)
 {
 	// Load the member variables over into temp types for calculations
 	XMVECTOR pos = XMLoadFloat3(&position);
 	XMVECTOR dir = XMLoadFloat3(&forward);
 	XMVECTOR right = XMVector3Cross(dir, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	unsigned int lastVersion = version;
 
 	if (GetAsyncKeyState('W') & 0x8000) {
 		pos += dir * speed * deltaTime;
+		version++;
 	}
 	if (GetAsyncKeyState('S') & 0x8000) {
 		pos += (-1)* dir * speed * deltaTime;
+		version++;
 	}
 	if (GetAsyncKeyState('A') & 0x8000) {
 		pos += right * speed * deltaTime;
+		version++;
 	}
 	if (GetAsyncKeyState('D') & 0x8000) {
 		pos += (-1) * right * speed * deltaTime;
+		version++;
 	}
 	if (GetAsyncKeyState('X') & 0x8000) {
 		pos -= XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f) * speed * deltaTime;
+		version++;
 	}
 	if (GetAsyncKeyState(VK_SPACE) & 0x8000) {
 		pos += XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f) * speed * deltaTime;
+		version++;
 	}
 
-	// Store result
-	XMStoreFloat3(&position, pos);
-	XMStoreFloat3(&forward, dir);
+	// Store result, if any key moved the Camera
+	if (version != lastVersion) {
+		XMStoreFloat3(&position, pos);
+	}
 }
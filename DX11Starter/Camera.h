@@ -22,6 +22,11 @@ public:
 	// Accessors to retrieve important info about the Camera
 	XMFLOAT4X4 GetViewMatrix() { return viewMatrix; };
 	XMFLOAT4X4 GetProjectionMatrix() { return projMatrix; };
+	XMFLOAT3 GetPosition() { return position; };
+
+	// Goes up every time the Camera moves or turns, so anything worked out from the view
+	// can be kept until it does
+	unsigned int GetVersion() { return version; };
 
 private:
 	// View Matrix for transforming the Camera and determining what is in the Camera's view
@@ -41,14 +46,9 @@ private:
 	// Float for determining camera move speed
 	float speed;
 
-	// Vectors and Floats of the transforms from last frame 
-	XMFLOAT3 lastPosition;
-	float lastRotationX;
-	float lastRotationY;
-
-	// Determines if the View Matrix is dirty and needs to be recalculated
-	// Checks if the position or rotation on any axis of the Camera has changed since last frame
-	bool IsViewMatrixDirty();
+	// Bumped whenever the position or rotation changes, and the version the View Matrix was last made from
+	unsigned int version;
+	unsigned int viewVersion;
 
 	// Checks for keyboard input and moves Camera appropriately 
 	// W, S - Move the Camera back and forth along its forward vector
@@ -0,0 +1,197 @@
+#include "Components.h"
+#include <chrono>
+#include <cmath>
+
+// --------------------------------------------------------
+// Works out the sphere around each entity's mesh in the world
+//
+// - Only entities whose transform version has moved on since
+//    their bounds were found are redone
+// - The scale is the longest of the world matrix's first
+//    three columns (the stored matrix's rows), so a parent's
+//    scale counts too
+// --------------------------------------------------------
+void UpdateEntityBounds(EntityWorld* world, TransformStore* transforms)
+{
+	world->ForEach<TransformComponent, MeshComponent, BoundsComponent>([&](Entity entity, TransformComponent& transform, MeshComponent& mesh, BoundsComponent& bounds)
+	{
+		unsigned int version = transforms->GetVersion(transform.Transform);
+		if (bounds.Version == version)
+			return;
+
+		XMFLOAT3 meshMin = mesh.Geometry->GetBoundsMin();
+		XMFLOAT3 meshMax = mesh.Geometry->GetBoundsMax();
+		XMVECTOR boundsMin = XMLoadFloat3(&meshMin);
+		XMVECTOR boundsMax = XMLoadFloat3(&meshMax);
+		XMMATRIX stored = XMLoadFloat4x4(&transforms->GetWorldMatrix(transform.Transform));
+		XMStoreFloat3(&bounds.Center, XMVector3TransformCoord((boundsMin + boundsMax) * 0.5f, XMMatrixTranspose(stored)));
+		bounds.MaxScale = XMVectorGetX(XMVectorMax(XMVector3Length(stored.r[0]), XMVectorMax(XMVector3Length(stored.r[1]), XMVector3Length(stored.r[2]))));
+		bounds.Radius = XMVectorGetX(XMVector3Length(boundsMax - boundsMin)) * 0.5f * bounds.MaxScale;
+		bounds.Version = version;
+	});
+}
+
+unsigned int SelectEntityLod(const MeshComponent& mesh, const BoundsComponent& bounds, XMFLOAT3 cameraPosition, XMFLOAT4X4 projMatrix, float screenHeight)
+{
+	if (mesh.Geometry->GetLodCount() <= 1)
+		return 0;
+
+	// Inside the sphere, always use the full detail
+	float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.Center) - XMLoadFloat3(&cameraPosition))) - bounds.Radius;
+	if (distance <= 0)
+		return 0;
+
+	// The projection matrix's Y scale is the same whether or not it's transposed
+	return SelectLod(mesh.Geometry->GetLods(), mesh.Geometry->GetLodCount(), distance, bounds.MaxScale, projMatrix._22, screenHeight, LOD_MAX_PIXEL_ERROR);
+}
+
+void CullEntityClusters(const MeshComponent& mesh, const XMFLOAT4X4& worldMatrix, unsigned int lod, XMFLOAT3 cameraPosition, XMFLOAT4X4 viewMatrix, XMFLOAT4X4 projMatrix, std::vector<IndexRange>& visible, ClusterCullStats& stats)
+{
+	// The stored matrices are transposed for HLSL, so undo that first
+	XMMATRIX world = XMMatrixTranspose(XMLoadFloat4x4(&worldMatrix));
+	XMMATRIX view = XMMatrixTranspose(XMLoadFloat4x4(&viewMatrix));
+	XMMATRIX proj = XMMatrixTranspose(XMLoadFloat4x4(&projMatrix));
+
+	// Clusters are tested in model space, so bring the frustum and camera there
+	XMFLOAT4X4 worldViewProj;
+	XMStoreFloat4x4(&worldViewProj, world * view * proj);
+	XMFLOAT3 localCamera;
+	XMStoreFloat3(&localCamera, XMVector3TransformCoord(XMLoadFloat3(&cameraPosition), XMMatrixInverse(0, world)));
+
+	CullClusters(mesh.Geometry->GetClusters(lod), mesh.Geometry->GetClusterCount(lod), worldViewProj, localCamera, visible, stats);
+}
+
+bool RaycastEntity(const MeshComponent& mesh, const XMFLOAT4X4& worldMatrix, XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, RayHit& hit)
+{
+	MeshBvh* bvh = mesh.Geometry->GetBvh();
+	if (!bvh)
+		return false;
+
+	// The tree is in model space, so bring the ray there
+	XMMATRIX inverseWorld = XMMatrixInverse(0, XMMatrixTranspose(XMLoadFloat4x4(&worldMatrix)));
+	XMFLOAT3 localOrigin;
+	XMFLOAT3 localDirection;
+	XMStoreFloat3(&localOrigin, XMVector3TransformCoord(XMLoadFloat3(&origin), inverseWorld));
+	XMStoreFloat3(&localDirection, XMVector3TransformNormal(XMLoadFloat3(&direction), inverseWorld));
+
+	return bvh->Intersect(localOrigin, localDirection, maxDistance, hit);
+}
+
+// --------------------------------------------------------
+// One entity, laid out the way GameEntity used to be, for
+// the benchmark to compare against
+// --------------------------------------------------------
+struct ObjectEntity
+{
+	TransformStore* Transforms;
+	unsigned int Transform;
+	std::shared_ptr<Mesh> Geometry;
+	std::vector<Material*> Materials;
+	bool IsStatic;
+	XMFLOAT3 WorldCenter;
+	float WorldRadius;
+	float WorldMaxScale;
+	unsigned int BoundsVersion;
+};
+
+// --------------------------------------------------------
+// Makes entities both ways, then goes through the bounds of
+// every one that isn't static, both ways
+//
+// - Every tenth entity is static, so each pass has to skip
+//    those: the objects by checking a flag on each one, and
+//    the world by not visiting their archetype at all
+// - The pass counts the entities within a distance of a point
+//    (the way picking a level of detail starts), which only
+//    needs the bounds, so the world reads 16 bytes per entity
+//    where the objects drag every other member through the
+//    cache along with them
+// - Both ways have to find the same entities
+// --------------------------------------------------------
+void BenchmarkEntities()
+{
+	const int frames = 5;
+	static const unsigned int counts[] = { 10000, 100000, 1000000 };
+	const XMFLOAT3 point(50.0f, 0.0f, 50.0f);
+	const float range = 30.0f;
+
+	printf("\nEntities (best of %d passes):", frames);
+	for (unsigned int c = 0; c < 3; c++)
+	{
+		unsigned int count = counts[c];
+		TransformStore transforms;
+		std::vector<Material*> materials(1, (Material*)0);
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		std::vector<ObjectEntity> objects;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			ObjectEntity object = {};
+			object.Transforms = &transforms;
+			object.Transform = i;
+			object.Materials = materials;
+			object.IsStatic = i % 10 == 0;
+			object.WorldCenter = XMFLOAT3((float)(i % 100), 0.0f, (float)(i / 100 % 100));
+			object.WorldRadius = 1.0f;
+			object.WorldMaxScale = 1.0f;
+			objects.push_back(object);
+		}
+		double objectCreateSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+		start = std::chrono::high_resolution_clock::now();
+		EntityWorld world;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			Entity entity = world.Create();
+			TransformComponent transform = { i };
+			MeshComponent mesh;
+			MaterialComponent material;
+			material.Submeshes = materials;
+			BoundsComponent bounds = { XMFLOAT3((float)(i % 100), 0.0f, (float)(i / 100 % 100)), 1.0f, 1.0f, 0 };
+			world.Add(entity, transform);
+			world.Add(entity, mesh);
+			world.Add(entity, material);
+			world.Add(entity, bounds);
+			if (i % 10 == 0)
+				world.Add(entity, StaticComponent());
+		}
+		world.ApplyChanges();
+		double worldCreateSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+		double objectSeconds = 1e30;
+		double worldSeconds = 1e30;
+		unsigned int objectFound = 0;
+		unsigned int worldFound = 0;
+		for (int f = 0; f < frames; f++)
+		{
+			start = std::chrono::high_resolution_clock::now();
+			objectFound = 0;
+			for (size_t i = 0; i < objects.size(); i++)
+			{
+				if (objects[i].IsStatic)
+					continue;
+				XMVECTOR offset = XMLoadFloat3(&objects[i].WorldCenter) - XMLoadFloat3(&point);
+				if (XMVectorGetX(XMVector3Length(offset)) - objects[i].WorldRadius < range)
+					objectFound++;
+			}
+			double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			objectSeconds = seconds < objectSeconds ? seconds : objectSeconds;
+
+			start = std::chrono::high_resolution_clock::now();
+			worldFound = 0;
+			world.ForEach<BoundsComponent>([&](Entity entity, BoundsComponent& bounds)
+			{
+				XMVECTOR offset = XMLoadFloat3(&bounds.Center) - XMLoadFloat3(&point);
+				if (XMVectorGetX(XMVector3Length(offset)) - bounds.Radius < range)
+					worldFound++;
+			}, MaskOf<StaticComponent>());
+			seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			worldSeconds = seconds < worldSeconds ? seconds : worldSeconds;
+		}
+
+		printf("\n  %u: making them %.3f ms as objects, %.3f ms in the world; going through them %.3f ms as objects, %.3f ms in the world (%.1fx), %u chunks, %s",
+			count, objectCreateSeconds * 1000.0, worldCreateSeconds * 1000.0,
+			objectSeconds * 1000.0, worldSeconds * 1000.0, worldSeconds > 0 ? objectSeconds / worldSeconds : 0.0,
+			world.GetChunkCount(), objectFound == worldFound ? "same entities found" : "DIFFERENT ENTITIES FOUND");
+	}
+}
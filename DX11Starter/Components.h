@@ -0,0 +1,84 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include "EntityWorld.h"
+#include "TransformStore.h"
+#include "Mesh.h"
+#include "Material.h"
+#include <memory>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// The components the game's entities are made of
+//
+// - Each entity's position, rotation and scale stay in the
+//    TransformStore (which already keeps them as arrays, and
+//    works out the world matrices), so the component is just
+//    the entity's handle there
+// --------------------------------------------------------
+
+// Where the entity's transform is in the TransformStore
+struct TransformComponent
+{
+	unsigned int Transform;
+};
+
+// The mesh the entity draws (shared with anything else that uses it)
+struct MeshComponent
+{
+	std::shared_ptr<Mesh> Geometry;
+};
+
+// The material each of the mesh's submeshes is drawn with
+struct MaterialComponent
+{
+	std::vector<Material*> Submeshes;
+};
+
+// Marks scenery that will never move, so it's merged into a static batch (see StaticBatch.h)
+// and drawn as part of that instead of on its own
+struct StaticComponent
+{
+};
+
+// Turns the entity around each axis, by this many radians a second
+struct SpinComponent
+{
+	XMFLOAT3 Speed;
+};
+
+// Moves the entity back and forth along a direction, following a sine wave
+struct BobComponent
+{
+	XMFLOAT3 Direction;
+};
+
+// The sphere around the mesh's bounds in the world, and which version of the transform it's for
+struct BoundsComponent
+{
+	XMFLOAT3 Center;
+	float Radius;
+	float MaxScale;
+	unsigned int Version;
+};
+
+// Refreshes the bounds of every entity whose transform has changed since they were found
+// This should be called after TransformStore::UpdateWorldMatrices
+void UpdateEntityBounds(EntityWorld* world, TransformStore* transforms);
+
+// Picks which of the entity's mesh's levels of detail to draw from the camera's point of view
+unsigned int SelectEntityLod(const MeshComponent& mesh, const BoundsComponent& bounds, XMFLOAT3 cameraPosition, XMFLOAT4X4 projMatrix, float screenHeight);
+
+// Culls the clusters of one of the entity's mesh's levels of detail that the camera can't see,
+// filling "visible" with the index ranges to draw and adding to "stats"
+void CullEntityClusters(const MeshComponent& mesh, const XMFLOAT4X4& worldMatrix, unsigned int lod, XMFLOAT3 cameraPosition, XMFLOAT4X4 viewMatrix, XMFLOAT4X4 projMatrix, std::vector<IndexRange>& visible, ClusterCullStats& stats);
+
+// Finds where a world space ray first hits the entity's mesh, if its tree has been built (see Mesh::BuildBvh())
+// - The distance is in multiples of "direction", like "maxDistance", which the world matrix doesn't change
+bool RaycastEntity(const MeshComponent& mesh, const XMFLOAT4X4& worldMatrix, XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, RayHit& hit);
+
+// Times making 10k, 100k and 1M entities, and going through their bounds, in an EntityWorld,
+// against a vector of objects laid out the way GameEntity used to be, and prints the results
+void BenchmarkEntities();
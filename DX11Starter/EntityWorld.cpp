@@ -0,0 +1,403 @@
+#include "EntityWorld.h"
+#include <mutex>
+#include <malloc.h>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+
+// Every component type, in id order (a fixed array, so looking one up never races with adding another)
+static ComponentInfo componentInfos[MAX_COMPONENT_TYPES];
+static unsigned int componentTypeCount = 0;
+static std::mutex componentTypeMutex;
+
+unsigned int RegisterComponentType(const ComponentInfo& info)
+{
+	std::lock_guard<std::mutex> lock(componentTypeMutex);
+
+	// Masks have a bit per type, so there's no way to carry on with one more
+	if (componentTypeCount >= MAX_COMPONENT_TYPES)
+	{
+		printf("\nToo many component types (at most %u), raise MAX_COMPONENT_TYPES and widen ComponentMask", MAX_COMPONENT_TYPES);
+		assert(false && "Too many component types");
+		abort();
+	}
+	componentInfos[componentTypeCount] = info;
+	return componentTypeCount++;
+}
+
+const ComponentInfo& GetComponentInfo(unsigned int id)
+{
+	return componentInfos[id];
+}
+
+EntityWorld::EntityWorld()
+{
+	pendingBlock = 0;
+	pendingOffset = 0;
+}
+
+EntityWorld::~EntityWorld()
+{
+	// Destroy every component still in a block, then the blocks themselves
+	for (size_t a = 0; a < archetypes.size(); a++)
+	{
+		Archetype* archetype = archetypes[a];
+		for (size_t c = 0; c < archetype->chunks.size(); c++)
+		{
+			EntityChunk* chunk = archetype->chunks[c];
+			for (size_t i = 0; i < archetype->components.size(); i++)
+			{
+				const ComponentInfo& info = GetComponentInfo(archetype->components[i]);
+				if (info.Size == 0)
+					continue;
+				for (unsigned int row = 0; row < chunk->count; row++)
+					info.Destroy(chunk->data + archetype->offsets[archetype->components[i]] + row * info.Size);
+			}
+			_aligned_free(chunk->data);
+			delete chunk;
+		}
+		delete archetype;
+	}
+
+	for (size_t i = 0; i < pendingAdds.size(); i++)
+	{
+		if (pendingAdds[i].Value)
+			GetComponentInfo(pendingAdds[i].Component).Destroy(pendingAdds[i].Value);
+	}
+	for (size_t i = 0; i < pendingBlocks.size(); i++)
+		_aligned_free(pendingBlocks[i]);
+	for (size_t i = 0; i < pendingLarge.size(); i++)
+		_aligned_free(pendingLarge[i]);
+}
+
+Entity EntityWorld::Create()
+{
+	unsigned int index;
+	if (!freeIndices.empty())
+	{
+		index = freeIndices.back();
+		freeIndices.pop_back();
+	}
+	else
+	{
+		index = (unsigned int)records.size();
+		records.push_back(EntityRecord());
+		records.back().Generation = 0;
+	}
+
+	// It goes in the archetype with no components on the next ApplyChanges(), unless it's given some first
+	EntityRecord& record = records[index];
+	record.Type = 0;
+	record.Chunk = 0;
+	record.Row = 0;
+	record.PendingMask = 0;
+	record.Alive = true;
+	record.Pending = false;
+	record.Destroying = false;
+	MarkPending(index);
+
+	Entity entity = { index, record.Generation };
+	return entity;
+}
+
+void EntityWorld::Destroy(Entity entity)
+{
+	if (!IsAlive(entity))
+		return;
+
+	MarkPending(entity.Index);
+	records[entity.Index].Destroying = true;
+}
+
+bool EntityWorld::IsAlive(Entity entity) const
+{
+	return entity.Index < records.size() && records[entity.Index].Alive && records[entity.Index].Generation == entity.Generation;
+}
+
+unsigned int EntityWorld::GetEntityCount() const
+{
+	unsigned int count = 0;
+	for (size_t a = 0; a < archetypes.size(); a++)
+		count += archetypes[a]->count;
+	return count;
+}
+
+unsigned int EntityWorld::GetChunkCount() const
+{
+	unsigned int count = 0;
+	for (size_t a = 0; a < archetypes.size(); a++)
+		count += (unsigned int)archetypes[a]->chunks.size();
+	return count;
+}
+
+// --------------------------------------------------------
+// Makes every change that's been put off
+//
+// - Each changed entity is moved once, straight into the
+//    archetype for the components it ends up with, however
+//    many were added or removed (its components that are in
+//    both archetypes are moved across, and the new ones start
+//    out default constructed)
+// - The added components are then moved into place, in the
+//    order they were added, so the last one added wins
+// --------------------------------------------------------
+void EntityWorld::ApplyChanges()
+{
+	for (size_t i = 0; i < pendingEntities.size(); i++)
+	{
+		unsigned int index = pendingEntities[i];
+		EntityRecord& record = records[index];
+		record.Pending = false;
+		Archetype* from = record.Type;
+
+		if (record.Destroying)
+		{
+			if (from)
+			{
+				for (size_t c = 0; c < from->components.size(); c++)
+				{
+					const ComponentInfo& info = GetComponentInfo(from->components[c]);
+					if (info.Size == 0)
+						continue;
+					info.Destroy(record.Chunk->data + from->offsets[from->components[c]] + record.Row * info.Size);
+				}
+				RemoveRow(from, record.Chunk, record.Row);
+			}
+
+			// The next entity to use this index gets a new generation, so old handles miss it
+			record.Type = 0;
+			record.Chunk = 0;
+			record.Alive = false;
+			record.Destroying = false;
+			record.Generation++;
+			freeIndices.push_back(index);
+			continue;
+		}
+
+		Archetype* to = FindArchetype(record.PendingMask);
+		if (to == from)
+			continue;
+
+		EntityChunk* chunk;
+		unsigned int row;
+		Entity entity = { index, record.Generation };
+		AppendRow(to, entity, chunk, row);
+		for (size_t c = 0; c < to->components.size(); c++)
+		{
+			unsigned int id = to->components[c];
+			const ComponentInfo& info = GetComponentInfo(id);
+			if (info.Size == 0)
+				continue;
+			unsigned char* slot = chunk->data + to->offsets[id] + row * info.Size;
+			if (from && (from->mask & (1u << id)))
+				info.MoveConstruct(slot, record.Chunk->data + from->offsets[id] + record.Row * info.Size);
+			else
+				info.Construct(slot);
+		}
+		if (from)
+		{
+			for (size_t c = 0; c < from->components.size(); c++)
+			{
+				const ComponentInfo& info = GetComponentInfo(from->components[c]);
+				if (info.Size == 0)
+					continue;
+				info.Destroy(record.Chunk->data + from->offsets[from->components[c]] + record.Row * info.Size);
+			}
+			RemoveRow(from, record.Chunk, record.Row);
+		}
+		record.Type = to;
+		record.Chunk = chunk;
+		record.Row = row;
+	}
+
+	for (size_t i = 0; i < pendingAdds.size(); i++)
+	{
+		const PendingAdd& add = pendingAdds[i];
+		if (!add.Value)
+			continue;
+
+		// Entities destroyed (or that had the component taken away again) just drop it
+		const ComponentInfo& info = GetComponentInfo(add.Component);
+		EntityRecord& record = records[add.Index];
+		if (record.Alive && record.Type && (record.Type->mask & (1u << add.Component)))
+			info.MoveAssign(record.Chunk->data + record.Type->offsets[add.Component] + record.Row * info.Size, add.Value);
+		info.Destroy(add.Value);
+	}
+
+	pendingEntities.clear();
+	pendingAdds.clear();
+	pendingBlock = 0;
+	pendingOffset = 0;
+	for (size_t i = 0; i < pendingLarge.size(); i++)
+		_aligned_free(pendingLarge[i]);
+	pendingLarge.clear();
+}
+
+void EntityWorld::MarkPending(unsigned int index)
+{
+	if (!records[index].Pending)
+	{
+		records[index].Pending = true;
+		pendingEntities.push_back(index);
+	}
+}
+
+// --------------------------------------------------------
+// Finds room for a component waiting to be added, at the end
+// of the current block of waiting components (the blocks are
+// kept between calls to ApplyChanges(), and reused)
+//
+// - A component bigger than a whole block gets memory of its
+//    own instead, freed once it's been applied
+// --------------------------------------------------------
+void* EntityWorld::AllocatePending(unsigned int component)
+{
+	const ComponentInfo& info = GetComponentInfo(component);
+	if (info.Size > ENTITY_CHUNK_BYTES)
+	{
+		unsigned char* value = (unsigned char*)_aligned_malloc(info.Size, ENTITY_CHUNK_ALIGNMENT);
+		pendingLarge.push_back(value);
+		return value;
+	}
+
+	pendingOffset = (unsigned int)((pendingOffset + info.Alignment - 1) / info.Alignment * info.Alignment);
+	if (pendingBlock < pendingBlocks.size() && pendingOffset + info.Size > ENTITY_CHUNK_BYTES)
+	{
+		pendingBlock++;
+		pendingOffset = 0;
+	}
+	if (pendingBlock == pendingBlocks.size())
+		pendingBlocks.push_back((unsigned char*)_aligned_malloc(ENTITY_CHUNK_BYTES, ENTITY_CHUNK_ALIGNMENT));
+
+	void* value = pendingBlocks[pendingBlock] + pendingOffset;
+	pendingOffset += (unsigned int)info.Size;
+	return value;
+}
+
+// --------------------------------------------------------
+// Finds (or makes) the archetype with exactly the components
+// in "mask", and works out how its blocks are laid out
+//
+// - Each block starts with its entities' handles, then has
+//    each component's array, each on a new cache line
+// - As many entities as fit go in each block: it starts from
+//    how many would fit without the padding, and backs off
+//    until the padding fits too
+// --------------------------------------------------------
+Archetype* EntityWorld::FindArchetype(ComponentMask mask)
+{
+	auto found = archetypesByMask.find(mask);
+	if (found != archetypesByMask.end())
+		return found->second;
+
+	Archetype* archetype = new Archetype();
+	archetype->mask = mask;
+	archetype->count = 0;
+	size_t rowBytes = sizeof(Entity);
+	for (unsigned int id = 0; id < MAX_COMPONENT_TYPES; id++)
+	{
+		archetype->offsets[id] = 0;
+		if (mask & (1u << id))
+		{
+			archetype->components.push_back(id);
+			rowBytes += GetComponentInfo(id).Size;
+		}
+	}
+
+	// A row too big for a whole block still gets a block of its own (see AppendRow())
+	unsigned int capacity = (unsigned int)(ENTITY_CHUNK_BYTES / rowBytes);
+	if (capacity < 1)
+		capacity = 1;
+	for (; capacity > 1; capacity--)
+	{
+		size_t bytes = sizeof(Entity) * capacity;
+		for (size_t c = 0; c < archetype->components.size(); c++)
+		{
+			size_t size = GetComponentInfo(archetype->components[c]).Size;
+			if (size > 0)
+				bytes = (bytes + ENTITY_CHUNK_ALIGNMENT - 1) / ENTITY_CHUNK_ALIGNMENT * ENTITY_CHUNK_ALIGNMENT + size * capacity;
+		}
+		if (bytes <= ENTITY_CHUNK_BYTES)
+			break;
+	}
+	archetype->capacity = capacity;
+
+	// Tags have no array, so they're left at 0
+	size_t offset = sizeof(Entity) * capacity;
+	for (size_t c = 0; c < archetype->components.size(); c++)
+	{
+		size_t size = GetComponentInfo(archetype->components[c]).Size;
+		if (size == 0)
+			continue;
+		offset = (offset + ENTITY_CHUNK_ALIGNMENT - 1) / ENTITY_CHUNK_ALIGNMENT * ENTITY_CHUNK_ALIGNMENT;
+		archetype->offsets[archetype->components[c]] = (unsigned int)offset;
+		offset += size * capacity;
+	}
+
+	archetypes.push_back(archetype);
+	archetypesByMask[mask] = archetype;
+	return archetype;
+}
+
+void EntityWorld::AppendRow(Archetype* archetype, Entity entity, EntityChunk*& chunk, unsigned int& row)
+{
+	if (archetype->chunks.empty() || archetype->chunks.back()->count == archetype->capacity)
+	{
+		// Big enough for the layout, even if one entity's components don't fit in a normal block
+		size_t bytes = ENTITY_CHUNK_BYTES;
+		for (size_t c = 0; c < archetype->components.size(); c++)
+		{
+			unsigned int id = archetype->components[c];
+			size_t end = archetype->offsets[id] + GetComponentInfo(id).Size * archetype->capacity;
+			bytes = end > bytes ? end : bytes;
+		}
+
+		EntityChunk* newChunk = new EntityChunk();
+		newChunk->archetype = archetype;
+		newChunk->data = (unsigned char*)_aligned_malloc(bytes, ENTITY_CHUNK_ALIGNMENT);
+		newChunk->count = 0;
+		archetype->chunks.push_back(newChunk);
+	}
+
+	chunk = archetype->chunks.back();
+	row = chunk->count++;
+	archetype->count++;
+	((Entity*)chunk->data)[row] = entity;
+}
+
+// --------------------------------------------------------
+// Fills the hole a departed entity left (its components are
+// already gone) with the archetype's last entity, so blocks
+// stay packed, and frees the last block once it's empty
+// --------------------------------------------------------
+void EntityWorld::RemoveRow(Archetype* archetype, EntityChunk* chunk, unsigned int row)
+{
+	EntityChunk* last = archetype->chunks.back();
+	unsigned int lastRow = last->count - 1;
+	if (last != chunk || lastRow != row)
+	{
+		Entity moved = ((Entity*)last->data)[lastRow];
+		((Entity*)chunk->data)[row] = moved;
+		for (size_t c = 0; c < archetype->components.size(); c++)
+		{
+			unsigned int id = archetype->components[c];
+			const ComponentInfo& info = GetComponentInfo(id);
+			if (info.Size == 0)
+				continue;
+			unsigned char* from = last->data + archetype->offsets[id] + lastRow * info.Size;
+			info.MoveConstruct(chunk->data + archetype->offsets[id] + row * info.Size, from);
+			info.Destroy(from);
+		}
+		records[moved.Index].Chunk = chunk;
+		records[moved.Index].Row = row;
+	}
+
+	last->count--;
+	archetype->count--;
+	if (last->count == 0)
+	{
+		_aligned_free(last->data);
+		delete last;
+		archetype->chunks.pop_back();
+	}
+}
@@ -0,0 +1,332 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <unordered_map>
+#include <type_traits>
+#include <new>
+#include <utility>
+#include <tuple>
+
+// How big each block of entities is, and what every component array in one is aligned to
+const unsigned int ENTITY_CHUNK_BYTES = 16384;
+const unsigned int ENTITY_CHUNK_ALIGNMENT = 64;
+
+// How many kinds of component there can be (one bit each in a ComponentMask)
+const unsigned int MAX_COMPONENT_TYPES = 32;
+typedef unsigned int ComponentMask;
+
+// --------------------------------------------------------
+// A handle to an entity
+//
+// - The generation goes up every time an index is reused, so
+//    a handle to a destroyed entity never finds its successor
+// --------------------------------------------------------
+struct Entity
+{
+	unsigned int Index;
+	unsigned int Generation;
+};
+
+// --------------------------------------------------------
+// How to handle one kind of component without knowing its
+// type: its size, and how to make, move and destroy one
+//
+// - Empty types (tags) have no size, so they only change
+//    which archetype an entity is in, and take no space
+// --------------------------------------------------------
+struct ComponentInfo
+{
+	size_t Size;
+	size_t Alignment;
+	void (*Construct)(void* component);
+	void (*MoveConstruct)(void* to, void* from);
+	void (*MoveAssign)(void* to, void* from);
+	void (*Destroy)(void* component);
+};
+
+// Adds a kind of component, returning its id (thread safe, since ids are handed out the first time each type is used)
+// - Stops the program if there are already MAX_COMPONENT_TYPES, since their masks wouldn't fit
+unsigned int RegisterComponentType(const ComponentInfo& info);
+const ComponentInfo& GetComponentInfo(unsigned int id);
+
+// --------------------------------------------------------
+// Gives each component type its id the first time it's used
+// --------------------------------------------------------
+template<typename T>
+struct ComponentType
+{
+	static unsigned int Id()
+	{
+		static const unsigned int id = RegisterComponentType(MakeInfo());
+		return id;
+	}
+
+	static ComponentMask Mask() { return 1u << Id(); }
+
+private:
+	static ComponentInfo MakeInfo()
+	{
+		ComponentInfo info;
+		info.Size = std::is_empty<T>::value ? 0 : sizeof(T);
+		info.Alignment = std::alignment_of<T>::value;
+		info.Construct = [](void* component) { new (component) T(); };
+		info.MoveConstruct = [](void* to, void* from) { new (to) T(std::move(*(T*)from)); };
+		info.MoveAssign = [](void* to, void* from) { *(T*)to = std::move(*(T*)from); };
+		info.Destroy = [](void* component) { ((T*)component)->~T(); };
+		return info;
+	}
+};
+
+// The combined mask of a list of component types
+template<typename... Ts>
+ComponentMask MaskOf()
+{
+	ComponentMask masks[] = { 0u, ComponentType<Ts>::Mask()... };
+	ComponentMask mask = 0;
+	for (ComponentMask m : masks)
+		mask |= m;
+	return mask;
+}
+
+class Archetype;
+
+// --------------------------------------------------------
+// One block of entities that all have the same components
+//
+// - The block holds an array of each component, one after
+//    another, each starting on a cache line, so going through
+//    one component of every entity in it reads memory in order
+// - Entities stay packed at the front of their archetype's
+//    blocks, so only the last block is ever partly full
+// --------------------------------------------------------
+class EntityChunk
+{
+public:
+	unsigned int GetCount() const { return count; }
+	Archetype* GetArchetype() const { return archetype; }
+
+	// The entities in the block
+	const Entity* GetEntities() const { return (const Entity*)data; }
+
+	// The array of one component, which the block's archetype must have
+	template<typename T>
+	T* Get() const;
+
+private:
+	friend class EntityWorld;
+	Archetype* archetype;
+	unsigned char* data;
+	unsigned int count;
+};
+
+// --------------------------------------------------------
+// Every entity with one particular set of components
+// --------------------------------------------------------
+class Archetype
+{
+public:
+	ComponentMask GetMask() const { return mask; }
+	unsigned int GetEntityCount() const { return count; }
+	unsigned int GetChunkCount() const { return (unsigned int)chunks.size(); }
+	EntityChunk* GetChunk(unsigned int chunk) const { return chunks[chunk]; }
+
+	// How many entities fit in one of its blocks
+	unsigned int GetChunkCapacity() const { return capacity; }
+
+	// Where a component's array is in each block
+	unsigned int GetOffset(unsigned int component) const { return offsets[component]; }
+
+private:
+	friend class EntityWorld;
+	ComponentMask mask;
+	std::vector<unsigned int> components;
+	unsigned int offsets[MAX_COMPONENT_TYPES];
+	unsigned int capacity;
+	unsigned int count;
+	std::vector<EntityChunk*> chunks;
+};
+
+template<typename T>
+T* EntityChunk::Get() const
+{
+	return (T*)(data + archetype->GetOffset(ComponentType<T>::Id()));
+}
+
+// --------------------------------------------------------
+// Every entity, grouped by which components they have
+//
+// - Entities with the same set of components (an archetype)
+//    share blocks of memory with an array of each component,
+//    so going through every entity with some components reads
+//    each array from start to end, with nothing else between
+// - Adding or removing components, and creating or destroying
+//    entities, are put off until ApplyChanges(), so they're
+//    safe while going through the entities, and an entity that
+//    has several components added at once only moves once
+// - New entities can be given components straight away, but
+//    don't have any (and aren't found by ForEach()) until then
+// - Components are kept in their blocks, so pointers to them
+//    only last until the next ApplyChanges()
+// --------------------------------------------------------
+class EntityWorld
+{
+public:
+	EntityWorld();
+	~EntityWorld();
+
+	// Makes a new entity, with no components
+	Entity Create();
+
+	// Destroys the entity and its components
+	void Destroy(Entity entity);
+
+	// Gives the entity a component (or replaces the one it has)
+	template<typename T>
+	void Add(Entity entity, T component);
+
+	// Takes a component away from the entity
+	template<typename T>
+	void Remove(Entity entity);
+
+	// Makes every change since the last call, creating and destroying, adding and removing
+	void ApplyChanges();
+
+	// Whether the handle is still for a living entity
+	bool IsAlive(Entity entity) const;
+
+	// The entity's component, or null if it doesn't have one (as of the last ApplyChanges())
+	template<typename T>
+	T* Get(Entity entity);
+
+	// Calls "func" with every block of entities that has all the "required" components, and none of the "excluded" ones
+	template<typename Func>
+	void ForEachChunk(ComponentMask required, ComponentMask excluded, Func func);
+
+	// Calls "func" with every entity that has all of "Ts", and none of the "excluded" components,
+	// along with its components: func(Entity, T1&, T2&...)
+	// (tags can be listed too, to only visit entities with them, but their references aren't to anything)
+	template<typename... Ts, typename Func>
+	void ForEach(Func func, ComponentMask excluded = 0);
+
+	// How many entities and archetypes there are, and how many blocks they're in
+	unsigned int GetEntityCount() const;
+	unsigned int GetArchetypeCount() const { return (unsigned int)archetypes.size(); }
+	unsigned int GetChunkCount() const;
+
+private:
+	// Where each entity is, and what it'll have after the next ApplyChanges()
+	struct EntityRecord
+	{
+		Archetype* Type;
+		EntityChunk* Chunk;
+		unsigned int Row;
+		unsigned int Generation;
+		ComponentMask PendingMask;
+		bool Alive;
+		bool Pending;
+		bool Destroying;
+	};
+
+	// A component waiting to be given to an entity
+	struct PendingAdd
+	{
+		unsigned int Index;
+		unsigned int Component;
+		void* Value;
+	};
+
+	std::vector<EntityRecord> records;
+	std::vector<unsigned int> freeIndices;
+
+	// Every archetype, in the order they were made, and by mask
+	std::vector<Archetype*> archetypes;
+	std::unordered_map<ComponentMask, Archetype*> archetypesByMask;
+
+	// The entities with changes waiting, and the components waiting to be added
+	// (which are kept in blocks that never move until they're applied, apart
+	// from any too big for a block, which are allocated on their own)
+	std::vector<unsigned int> pendingEntities;
+	std::vector<PendingAdd> pendingAdds;
+	std::vector<unsigned char*> pendingBlocks;
+	std::vector<unsigned char*> pendingLarge;
+	unsigned int pendingBlock;
+	unsigned int pendingOffset;
+
+	// Helper methods
+	void MarkPending(unsigned int index);
+	void* AllocatePending(unsigned int component);
+	Archetype* FindArchetype(ComponentMask mask);
+	void AppendRow(Archetype* archetype, Entity entity, EntityChunk*& chunk, unsigned int& row);
+	void RemoveRow(Archetype* archetype, EntityChunk* chunk, unsigned int row);
+};
+
+template<typename T>
+void EntityWorld::Add(Entity entity, T component)
+{
+	if (!IsAlive(entity))
+		return;
+
+	unsigned int id = ComponentType<T>::Id();
+	MarkPending(entity.Index);
+	records[entity.Index].PendingMask |= 1u << id;
+
+	// Tags have nothing to copy
+	PendingAdd add = { entity.Index, id, 0 };
+	if (GetComponentInfo(id).Size > 0)
+	{
+		add.Value = AllocatePending(id);
+		new (add.Value) T(std::move(component));
+	}
+	pendingAdds.push_back(add);
+}
+
+template<typename T>
+void EntityWorld::Remove(Entity entity)
+{
+	if (!IsAlive(entity))
+		return;
+
+	MarkPending(entity.Index);
+	records[entity.Index].PendingMask &= ~ComponentType<T>::Mask();
+}
+
+template<typename T>
+T* EntityWorld::Get(Entity entity)
+{
+	if (!IsAlive(entity))
+		return 0;
+
+	EntityRecord& record = records[entity.Index];
+	if (!record.Type || !(record.Type->GetMask() & ComponentType<T>::Mask()))
+		return 0;
+	return record.Chunk->Get<T>() + record.Row;
+}
+
+template<typename Func>
+void EntityWorld::ForEachChunk(ComponentMask required, ComponentMask excluded, Func func)
+{
+	for (size_t a = 0; a < archetypes.size(); a++)
+	{
+		Archetype* archetype = archetypes[a];
+		if ((archetype->mask & required) != required || (archetype->mask & excluded) != 0)
+			continue;
+		for (size_t c = 0; c < archetype->chunks.size(); c++)
+			func(*archetype->chunks[c]);
+	}
+}
+
+template<typename... Ts, typename Func>
+void EntityWorld::ForEach(Func func, ComponentMask excluded)
+{
+	ForEachChunk(MaskOf<Ts...>(), excluded, [&](EntityChunk& chunk)
+	{
+		const Entity* entities = chunk.GetEntities();
+		unsigned int count = chunk.GetCount();
+
+		// Look each array up once per block, not once per entity
+		std::tuple<Ts*...> arrays(chunk.Get<Ts>()...);
+		for (unsigned int i = 0; i < count; i++)
+			func(entities[i], std::get<Ts*>(arrays)[i]...);
+	});
+}
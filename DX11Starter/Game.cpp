@@ -1,5 +1,7 @@
 #include "Game.h"
 #include "Vertex.h"
+#include "VertexPacking.h"
+#include "MeshPrimitives.h"
 #include "WICTextureLoader.h"
 
 // For the DirectX Math library
@@ -22,10 +24,14 @@ Game::Game(HINSTANCE hInstance)
 		true)			   // Show extra stats (fps) in title bar?
 {
 	// Initialize fields
-	vertexBuffer = 0;
 	vertexShader = 0;
+	packedVertexShader = 0;
 	pixelShader = 0;
 
+	cullStats = {};
+	cullStatsReportTime = 0.0f;
+	scheduler = 0;
+
 	mainCamera = new Camera();
 
 #if defined(DEBUG) || defined(_DEBUG)
@@ -43,32 +49,39 @@ Game::Game(HINSTANCE hInstance)
 // --------------------------------------------------------
 Game::~Game()
 {
-	// Delete our Meshes, which will clean up their own buffers
+	// Delete our Meshes, which will give their space in the geometry pool back
 	delete triangle;
 	delete trapezoid;
 	delete square;
-	delete cone;
-	delete sphere;
-	delete helix;
 
 	// Delete our Materials
 	delete cobble;
 	delete ice;
 	delete tiles;
 
-	// Delete the game entities, they will clean up themselves
-	delete entities;
+	// Delete the static batches (their meshes are in the geometry pool too)
+	for (size_t i = 0; i < staticBatches.size(); i++)
+		delete staticBatches[i];
+
+	// Stop the systems' threads before anything they use goes
+	delete scheduler;
+
+	// Delete the game entities, along with their components
+	// (which let go of their meshes, so this has to happen before the cache goes)
+	delete world;
+	delete transforms;
+	delete meshCache;
+
+	// Every mesh is gone, so the buffers they were in can go too
+	delete geometryPool;
 
 	// Delete the Camera
 	delete mainCamera;
 
-	// Release any (and all!) DirectX objects
-	// we've made in the Game class
-	if (vertexBuffer) { vertexBuffer->Release(); }
-
 	// Delete our simple shader objects, which
 	// will clean up their own internal DirectX stuff
 	delete vertexShader;
+	delete packedVertexShader;
 	delete pixelShader;
 }
 
@@ -134,18 +147,61 @@ void Game::Init()
 	device->CreateSamplerState(&sd, &sample);
 
 	// Create a basic Material
-	ice = new Material(vertexShader, pixelShader, srvIce, sample);
-	cobble = new Material(vertexShader, pixelShader, srvCobble, sample);
-	tiles = new Material(vertexShader, pixelShader, srvTiles, sample);
+	ice = new Material(vertexShader, pixelShader, srvIce, sample, packedVertexShader);
+	cobble = new Material(vertexShader, pixelShader, srvCobble, sample, packedVertexShader);
+	tiles = new Material(vertexShader, pixelShader, srvTiles, sample, packedVertexShader);
 
 	// Create and add some entities to the game
-	entities = new std::vector<GameEntity>();
-	entities->push_back(GameEntity(cone, ice));
-	entities->push_back(GameEntity(helix, tiles));
-	entities->push_back(GameEntity(sphere, cobble));
+	// - Meshes from files come from the cache, so each model is only loaded once
+	//    no matter how many entities use it
+	// - Simple shapes are generated instead (at the same size and detail as the
+	//    models they replace), so there's no file to read at all
+	// - The larger ones use packed vertices, at half the memory, and are
+	//    split into clusters so the parts facing away can be skipped
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	world = new EntityWorld();
+	transforms = new TransformStore();
+	Entity cone;
+	Entity helix;
+	Entity sphere;
+	GenerateCone(0.5f, 1.0f, 20, 1, verts, indices);
+	unsigned int coneTransform = CreateEntity(std::make_shared<Mesh>(verts, indices, geometryPool), ice, false, &cone);
+	std::shared_ptr<Mesh> helixMesh = meshCache->Load("./Assets/Models/helix.obj", VERTEX_FORMAT_PACKED, true);
+	if (helixMesh) // Null if the model couldn't be loaded
+		CreateEntity(helixMesh, tiles, false, &helix);
+	GenerateUVSphere(0.5f, 40, 20, verts, indices);
+	unsigned int sphereTransform = CreateEntity(std::make_shared<Mesh>(verts, indices, geometryPool, VERTEX_FORMAT_PACKED, true), cobble, false, &sphere);
+
+#if defined(DEBUG) || defined(_DEBUG)
+	MeshCacheStats cacheStats = meshCache->GetStats();
+	printf("\nMesh cache: %llu hits, %llu misses, %u meshes (%llu bytes) resident",
+		cacheStats.Hits, cacheStats.Misses, cacheStats.ResidentMeshes, cacheStats.ResidentBytes);
+	GeometryPoolStats poolStats = geometryPool->GetStats();
+	printf("\nGeometry pool: %llu of %llu vertex bytes, %llu of %llu index bytes used",
+		poolStats.VertexBytesUsed, poolStats.VertexBytesCapacity, poolStats.IndexBytesUsed, poolStats.IndexBytesCapacity);
+#endif
+
+	transforms->Move(coneTransform, 3, 0, 0);
+	transforms->Move(sphereTransform, -3, 0, 0);
 
-	(*entities)[0].Move(3, 0, 0);
-	(*entities)[2].Move(-3, 0, 0);
+	// Set some of them moving: the helix turns around the y axis (counterclockwise), the sphere
+	// around the x axis (clockwise), and the cone bobs up and down along the y axis
+	SpinComponent helixSpin = { XMFLOAT3(0, 1.0f, 0) };
+	SpinComponent sphereSpin = { XMFLOAT3(-0.25f, 0, 0) };
+	BobComponent coneBob = { XMFLOAT3(0, 1.0f, 0) };
+	if (helixMesh)
+		world->Add(helix, helixSpin);
+	world->Add(sphere, sphereSpin);
+	world->Add(cone, coneBob);
+
+	// Put every new entity into the world at once
+	world->ApplyChanges();
+
+	// Merge any entities marked static into one batch per material (see StaticBatch.h)
+	BuildStaticBatches(world, transforms, geometryPool, staticBatches);
+
+	CreateSystems();
 
 	// Tell the input assembler stage of the pipeline what kind of
 	// geometric primitives (points, lines or triangles) we want to draw.  
@@ -155,6 +211,90 @@ void Game::Init()
 
 }
 
+// --------------------------------------------------------
+// Adds an entity that draws "mesh" with "material" (on every
+// submesh), with a transform of its own, and bounds that are
+// worked out once its world matrix is
+//
+// - The entity only joins the world on the next call to
+//    EntityWorld::ApplyChanges(), but its transform (which is
+//    returned) can be moved straight away, and the entity (put
+//    in "created", if it's wanted) can be given more components
+// --------------------------------------------------------
+unsigned int Game::CreateEntity(std::shared_ptr<Mesh> mesh, Material* material, bool isStatic, Entity* created)
+{
+	Entity entity = world->Create();
+	TransformComponent transform = { transforms->Add() };
+	MeshComponent meshComponent;
+	meshComponent.Geometry = mesh;
+	MaterialComponent materials;
+	materials.Submeshes.assign(mesh->GetSubmeshCount() > 0 ? mesh->GetSubmeshCount() : 1, material);
+	BoundsComponent bounds = {};
+
+	world->Add(entity, transform);
+	world->Add(entity, meshComponent);
+	world->Add(entity, materials);
+	world->Add(entity, bounds);
+	if (isStatic)
+		world->Add(entity, StaticComponent());
+	if (created)
+		*created = entity;
+	return transform.Transform;
+}
+
+// --------------------------------------------------------
+// Splits the work of each frame's update into systems, each
+// saying which components it reads and writes, so those that
+// don't share anything run at the same time
+//
+// - Everything that changes transforms writes the transform
+//    component, since they all share the TransformStore (and
+//    its list of changes), so those run one after another
+// - The camera doesn't touch any entity, so it runs alongside
+//    whatever else is running
+// --------------------------------------------------------
+void Game::CreateSystems()
+{
+	scheduler = new SystemScheduler(world);
+
+	// Runs every system on this thread, one after another, when set (for debugging)
+	const bool runSystemsInOrder = false;
+	scheduler->SetDeterministic(runSystemsInOrder);
+
+	scheduler->AddSystem("Camera", 0, 0, [this](float deltaTime, float totalTime)
+	{
+		mainCamera->Update(deltaTime);
+	});
+
+	scheduler->AddSystem("Spin", MaskOf<SpinComponent>(), MaskOf<TransformComponent>(), [this](float deltaTime, float totalTime)
+	{
+		world->ForEach<TransformComponent, SpinComponent>([&](Entity entity, TransformComponent& transform, SpinComponent& spin)
+		{
+			transforms->Rotate(transform.Transform, spin.Speed.x * deltaTime, spin.Speed.y * deltaTime, spin.Speed.z * deltaTime);
+		});
+	});
+
+	scheduler->AddSystem("Bob", MaskOf<BobComponent>(), MaskOf<TransformComponent>(), [this](float deltaTime, float totalTime)
+	{
+		float amount = sinf(totalTime) * deltaTime;
+		world->ForEach<TransformComponent, BobComponent>([&](Entity entity, TransformComponent& transform, BobComponent& bob)
+		{
+			transforms->Move(transform.Transform, bob.Direction.x * amount, bob.Direction.y * amount, bob.Direction.z * amount);
+		});
+	});
+
+	// Calculate the world matrices (and bounds) of every entity that moved, all at once
+	scheduler->AddSystem("World matrices", 0, MaskOf<TransformComponent>(), [this](float deltaTime, float totalTime)
+	{
+		transforms->UpdateWorldMatrices();
+	});
+
+	scheduler->AddSystem("Bounds", MaskOf<TransformComponent, MeshComponent>(), MaskOf<BoundsComponent>(), [this](float deltaTime, float totalTime)
+	{
+		UpdateEntityBounds(world, transforms);
+	});
+}
+
 // --------------------------------------------------------
 // Loads shaders from compiled shader object (.cso) files using
 // my SimpleShader wrapper for DirectX shader manipulation.
@@ -163,9 +303,15 @@ void Game::Init()
 // --------------------------------------------------------
 void Game::LoadShaders()
 {
-	vertexShader = new SimpleVertexShader(device, context);
+	// Both vertex shaders get their input layouts from the vertex structs'
+	// compile-time descriptions (see VertexLayout.h), so neither has to be
+	// reflected, and the packed one's 16 bit inputs are described correctly
+	vertexShader = new SimpleVertexShader(device, context, VertexLayout<Vertex>::Elements.data(), VertexLayout<Vertex>::ElementCount);
 	vertexShader->LoadShaderFile(L"VertexShader.cso");
 
+	packedVertexShader = new SimpleVertexShader(device, context, VertexLayout<PackedVertex>::Elements.data(), VertexLayout<PackedVertex>::ElementCount);
+	packedVertexShader->LoadShaderFile(L"VertexShaderPacked.cso");
+
 	pixelShader = new SimplePixelShader(device, context);
 	pixelShader->LoadShaderFile(L"PixelShader.cso");
 }
@@ -220,63 +366,30 @@ void Game::CreateMatrices()
 // --------------------------------------------------------
 void Game::CreateBasicGeometry()
 {
-	// Create some temporary variables to represent uvs and normals
-	// - Not necessary, just makes things more readable
-	XMFLOAT2 uv = XMFLOAT2(0.0f, 0.0f);
-	XMFLOAT3 normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
-
-	// Set up the vertices of the triangle we would like to draw
-	// - We're going to copy this array, exactly as it exists in memory
-	//    over to a DirectX-controlled data structure (the vertex buffer)
-	Vertex vertices[] =
-	{
-		{ XMFLOAT3(+0.0f, +1.0f, +0.0f), normal, uv },
-		{ XMFLOAT3(+1.5f, -1.0f, +0.0f), normal, uv },
-		{ XMFLOAT3(-1.5f, -1.0f, +0.0f), normal, uv },
-	};
-
-	// Set up the indices, which tell us which vertices to use and in which order
-	// - This is somewhat redundant for just 3 vertices (it's a simple example)
-	// - Indices are technically not required if the vertices are in the buffer 
-	//    in the correct order and each one will be used exactly once
-	// - But just to see how it's done...
-	unsigned int indices[] = { 0, 1, 2 };
-
-	// Create a triangle Mesh using the vertices and indices specified earlier
-	triangle = new Mesh(vertices, 3, indices, 3, device);
-
-	//set vertices and indices for next Mesh
-	Vertex verticesTrap[] =
-	{
-		{ XMFLOAT3(+2.0f, -0.5f, +0.0f), normal, uv },
-		{ XMFLOAT3(+2.5f, -0.5f, +0.0f), normal, uv },
-		{ XMFLOAT3(+3.0f, +0.5f, +0.0f), normal, uv },
-		{ XMFLOAT3(+1.5f, +0.5f, +0.0f), normal, uv },
-	};
-
-	unsigned int indicesTrap[] = { 2, 1, 0, 0, 3, 2 };
-
-	// Create a trapezoid Mesh using the vertices and indices specified earlier
-	trapezoid = new Mesh(verticesTrap, 4, indicesTrap, 6, device);
-
-	//set vertices and indices for next Mesh
-	Vertex verticesSq[] =
-	{
-		{ XMFLOAT3(-3.5f, -0.5f, +0.0f), normal, uv },
-		{ XMFLOAT3(-2.0f, -0.5f, +0.0f), normal, uv },
-		{ XMFLOAT3(-2.0f, +0.5f, +0.0f), normal, uv },
-		{ XMFLOAT3(-3.5f, +0.5f, +0.0f), normal, uv },
-	};
-
-	unsigned int indicesSq[] = { 2, 1, 0, 0, 3, 2 };
-
-	// Create a square Mesh using the vertices and indices specified earlier
-	square = new Mesh(verticesSq, 4, indicesSq, 6, device);
-
-	// Create meshes from the data in obj files
-	cone = new Mesh("./Assets/Models/cone.obj", device);
-	helix = new Mesh("./Assets/Models/helix.obj", device);
-	sphere = new Mesh("./Assets/Models/sphere.obj", device);
+	// Every mesh's geometry goes in the same few big buffers
+	geometryPool = new GeometryPool(device, context);
+
+	// The flat shapes are generated from their corners, listed
+	// clockwise as seen from the camera so they face it
+	// - GeneratePolygon() works out the normal and UVs, and
+	//    indexes and orders the triangles for us
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+
+	XMFLOAT3 cornersTri[] = { XMFLOAT3(+0.0f, +1.0f, +0.0f), XMFLOAT3(+1.5f, -1.0f, +0.0f), XMFLOAT3(-1.5f, -1.0f, +0.0f) };
+	GeneratePolygon(cornersTri, 3, verts, indices);
+	triangle = new Mesh(&verts[0], (unsigned int)verts.size(), &indices[0], (unsigned int)indices.size(), geometryPool);
+
+	XMFLOAT3 cornersTrap[] = { XMFLOAT3(+1.5f, +0.5f, +0.0f), XMFLOAT3(+3.0f, +0.5f, +0.0f), XMFLOAT3(+2.5f, -0.5f, +0.0f), XMFLOAT3(+2.0f, -0.5f, +0.0f) };
+	GeneratePolygon(cornersTrap, 4, verts, indices);
+	trapezoid = new Mesh(&verts[0], (unsigned int)verts.size(), &indices[0], (unsigned int)indices.size(), geometryPool);
+
+	XMFLOAT3 cornersSq[] = { XMFLOAT3(-3.5f, +0.5f, +0.0f), XMFLOAT3(-2.0f, +0.5f, +0.0f), XMFLOAT3(-2.0f, -0.5f, +0.0f), XMFLOAT3(-3.5f, -0.5f, +0.0f) };
+	GeneratePolygon(cornersSq, 4, verts, indices);
+	square = new Mesh(&verts[0], (unsigned int)verts.size(), &indices[0], (unsigned int)indices.size(), geometryPool);
+
+	// Meshes from obj files are loaded through the cache when they're needed
+	meshCache = new MeshCache(geometryPool);
 	
 }
 
@@ -303,13 +416,37 @@ void Game::Update(float deltaTime, float totalTime)
 	if (GetAsyncKeyState(VK_ESCAPE))
 		Quit();
 
-	// Update the Camera
-	mainCamera->Update(deltaTime);
+	// Update the camera, move the entities around, and work out where they've ended up
+	scheduler->Run(deltaTime, totalTime);
+}
 
-	// Move some of the Game Entities around
-	(*entities)[1].Rotate(0, 1.0f * deltaTime, 0.0f);//rotates helix around y axis counterclockwise
-	(*entities)[2].Rotate(-0.25f * deltaTime, 0, 0);//rotates sphere around x axis clockwise
-	(*entities)[0].Move(0, sin(totalTime) * deltaTime, 0);//moves cone in sine curve along y axis
+// --------------------------------------------------------
+// Binds the mesh's vertex streams and index buffer, unless
+// they're the ones already bound (which are remembered in
+// "boundVertexBuffer" and "boundIndexBuffer")
+// - Every stream is bound here, but a depth-only pass would
+//    just bind VERTEX_STREAM_POSITION
+// --------------------------------------------------------
+void Game::BindMeshBuffers(Mesh* mesh, ID3D11Buffer*& boundVertexBuffer, ID3D11Buffer*& boundIndexBuffer)
+{
+	if (mesh->GetVertexBuffer(VERTEX_STREAM_POSITION) != boundVertexBuffer)
+	{
+		ID3D11Buffer* streams[VERTEX_STREAM_COUNT];
+		UINT strides[VERTEX_STREAM_COUNT];
+		UINT offsets[VERTEX_STREAM_COUNT] = {};
+		for (int s = 0; s < VERTEX_STREAM_COUNT; s++)
+		{
+			streams[s] = mesh->GetVertexBuffer((VertexStream)s);
+			strides[s] = mesh->GetVertexStride((VertexStream)s);
+		}
+		boundVertexBuffer = streams[VERTEX_STREAM_POSITION];
+		context->IASetVertexBuffers(0, VERTEX_STREAM_COUNT, streams, strides, offsets);
+	}
+	if (mesh->GetIndexBuffer() != boundIndexBuffer)
+	{
+		boundIndexBuffer = mesh->GetIndexBuffer();
+		context->IASetIndexBuffer(boundIndexBuffer, mesh->GetIndexFormat(), 0);
+	}
 }
 
 // --------------------------------------------------------
@@ -330,35 +467,115 @@ void Game::Draw(float deltaTime, float totalTime)
 		1.0f,
 		0);
 
-	for (int i = 0; i < entities->size(); i++) {
+	// Start counting culled clusters for this frame
+	cullStats = {};
 
-		// Calculate the world matrix of the entity
-		(*entities)[i].CalculateWorldMatrix();
+	// Every mesh shares the geometry pool's buffers, so they only
+	// need binding again when the next mesh is in different formats
+	// (the position stream's buffer stands for all of the vertex streams)
+	ID3D11Buffer* boundVertexBuffer = 0;
+	ID3D11Buffer* boundIndexBuffer = 0;
 
-		(*entities)[i].PrepareMaterial(mainCamera->GetViewMatrix(), mainCamera->GetProjectionMatrix());
+	// Static entities are drawn as part of their batches, below
+	world->ForEach<TransformComponent, MeshComponent, MaterialComponent, BoundsComponent>([&](Entity entity, TransformComponent& transform, MeshComponent& meshComponent, MaterialComponent& material, BoundsComponent& bounds)
+	{
+		// Models that couldn't be loaded have nothing to draw
+		Mesh* mesh = meshComponent.Geometry.get();
+		if (mesh->GetLodCount() == 0)
+			return;
 
 		// Set buffers in the input assembler
-		//  - Do this ONCE PER OBJECT you're drawing, since each object might
-		//    have different geometry.
-		UINT stride = sizeof(Vertex);
-		UINT offset = 0;
-		vertexBuffer = (*entities)[i].GetMesh()->GetVertexBuffer();
-		context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-		context->IASetIndexBuffer((*entities)[i].GetMesh()->GetIndexBuffer(), DXGI_FORMAT_R32_UINT, 0);
-
-		// Finally do the actual drawing
-		//  - Do this ONCE PER OBJECT you intend to draw
+		BindMeshBuffers(mesh, boundVertexBuffer, boundIndexBuffer);
+
+		// Pick the level of detail based on how far away the entity is,
+		// which tells us which range of the index buffer to draw
+		unsigned int lodLevel = SelectEntityLod(meshComponent, bounds, mainCamera->GetPosition(), mainCamera->GetProjectionMatrix(), (float)height);
+		const MeshSubmesh* submeshes = mesh->GetSubmeshes(lodLevel);
+
+		// Where this mesh's data starts in the shared buffers
+		UINT firstIndex = mesh->GetFirstIndex();
+		UINT baseVertex = mesh->GetBaseVertex();
+
+		// Meshes with clusters only draw the ranges that survive culling
+		if (mesh->HasClusters())
+			CullEntityClusters(meshComponent, transforms->GetWorldMatrix(transform.Transform), lodLevel, mainCamera->GetPosition(), mainCamera->GetViewMatrix(), mainCamera->GetProjectionMatrix(), visibleRanges, cullStats);
+
+		// Finally do the actual drawing, one submesh (material) at a time
+		//  - Every submesh shares the buffers bound above, so only the
+		//     material changes between them (and only if it's different)
 		//  - This will use all of the currently set DirectX "stuff" (shaders, buffers, etc)
 		//  - DrawIndexed() uses the currently set INDEX BUFFER to look up corresponding
 		//     vertices in the currently set VERTEX BUFFER
-		context->DrawIndexed(
-			(*entities)[i].GetMesh()->GetIndexCount(),     // The number of indices to use (we could draw a subset if we wanted)
-			0,     // Offset to the first index we want to use
-			0);    // Offset to add to each index when looking up vertices
+		Material* boundMaterial = 0;
+		for (unsigned int s = 0; s < mesh->GetSubmeshCount(); s++)
+		{
+			const MeshSubmesh& submesh = submeshes[s];
+			if (submesh.IndexCount == 0)
+				continue;
+
+			if (material.Submeshes[s] != boundMaterial)
+			{
+				boundMaterial = material.Submeshes[s];
+				boundMaterial->Prepare(transforms->GetWorldMatrix(transform.Transform), mainCamera->GetViewMatrix(), mainCamera->GetProjectionMatrix(), mesh);
+			}
+
+			if (mesh->HasClusters())
+			{
+				// Clusters never cross submeshes, but neighbouring visible ones
+				// may have been merged into a range that does
+				for (size_t r = 0; r < visibleRanges.size(); r++)
+				{
+					unsigned int rangeEnd = visibleRanges[r].FirstIndex + visibleRanges[r].IndexCount;
+					unsigned int submeshEnd = submesh.FirstIndex + submesh.IndexCount;
+					unsigned int start = visibleRanges[r].FirstIndex > submesh.FirstIndex ? visibleRanges[r].FirstIndex : submesh.FirstIndex;
+					unsigned int end = rangeEnd < submeshEnd ? rangeEnd : submeshEnd;
+					if (end > start)
+						context->DrawIndexed(end - start, firstIndex + start, baseVertex);
+				}
+			}
+			else
+			{
+				context->DrawIndexed(
+					submesh.IndexCount,     // The number of indices to use (just this submesh's, at this level of detail)
+					firstIndex + submesh.FirstIndex,     // Offset to the first index we want to use
+					baseVertex);    // Offset to add to each index when looking up vertices
+			}
+		}
+	}, MaskOf<StaticComponent>());
+
+	// Draw the static batches, each with its material set up just once
+	//  - Every part of a batch has its own clusters, so only the
+	//     ranges of the parts that survive culling are drawn
+	for (size_t b = 0; b < staticBatches.size(); b++)
+	{
+		Mesh* mesh = staticBatches[b]->GetMesh();
+		BindMeshBuffers(mesh, boundVertexBuffer, boundIndexBuffer);
+
+		staticBatches[b]->CullClusters(mainCamera->GetPosition(), mainCamera->GetViewMatrix(), mainCamera->GetProjectionMatrix(), visibleRanges, cullStats);
+		if (visibleRanges.empty())
+			continue;
+
+		staticBatches[b]->PrepareMaterial(mainCamera->GetViewMatrix(), mainCamera->GetProjectionMatrix());
+		for (size_t r = 0; r < visibleRanges.size(); r++)
+			context->DrawIndexed(visibleRanges[r].IndexCount, mesh->GetFirstIndex() + visibleRanges[r].FirstIndex, mesh->GetBaseVertex());
+	}
 
-		// Set the buffers back to defaults so they aren't constantly deleted
-		vertexBuffer = 0;
+	// Everything that follows the entities' changes has seen this frame's
+	transforms->ClearChanges();
+
+	// Report how much culling saved, once a second
+#if defined(DEBUG) || defined(_DEBUG)
+	if (totalTime - cullStatsReportTime >= 1.0f)
+	{
+		printf("\nClusters culled: %u of %u (%u frustum, %u backface), triangles culled: %u of %u, draws: %u",
+			cullStats.ClustersFrustumCulled + cullStats.ClustersBackfaceCulled, cullStats.ClustersTested,
+			cullStats.ClustersFrustumCulled, cullStats.ClustersBackfaceCulled,
+			cullStats.TrianglesCulled, cullStats.TrianglesTested,
+			cullStats.RangesDrawn);
+		scheduler->PrintTimings();
+		cullStatsReportTime = totalTime;
 	}
+#endif
 
 	// Present the back buffer to the user
 	//  - Puts the final frame we're drawing into the window so the user can see it
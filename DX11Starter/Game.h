@@ -3,7 +3,10 @@
 #include "DXCore.h"
 #include "SimpleShader.h"
 #include "Mesh.h"
-#include "GameEntity.h"
+#include "MeshCache.h"
+#include "Components.h"
+#include "StaticBatch.h"
+#include "SystemScheduler.h"
 #include "Camera.h"
 #include "Lights.h"
 #include <DirectXMath.h>
@@ -35,6 +38,15 @@ private:
 	void CreateMatrices();
 	void CreateBasicGeometry();
 
+	// Adds an entity that draws "mesh" with "material", returning its transform
+	unsigned int CreateEntity(std::shared_ptr<Mesh> mesh, Material* material, bool isStatic = false, Entity* created = 0);
+
+	// Adds the systems that update the entities every frame
+	void CreateSystems();
+
+	// Binds a mesh's buffers for drawing, if they aren't bound already
+	void BindMeshBuffers(Mesh* mesh, ID3D11Buffer*& boundVertexBuffer, ID3D11Buffer*& boundIndexBuffer);
+
 	// First Person Debug Camera
 	Camera* mainCamera;
 
@@ -42,27 +54,41 @@ private:
 	DirectionalLight dirLight;
 	DirectionalLight light2;
 
-	// Buffers to hold actual geometry data
-	ID3D11Buffer* vertexBuffer;
-
 	// Meshes to draw to the screen
 	Mesh* triangle;
 	Mesh* trapezoid;
 	Mesh* square;
-	Mesh* cone;
-	Mesh* sphere;
-	Mesh* helix;
 
-	// Materials to assign to GameEntities
+	// The shared buffers every mesh's geometry is in
+	GeometryPool* geometryPool;
+
+	// Loads and shares meshes from model files
+	MeshCache* meshCache;
+
+	// Materials to assign to entities
 	Material* ice;
 	Material* cobble;
 	Material* tiles;
 
-	// Vector of GameEntities in the Game
-	std::vector<GameEntity>* entities;
+	// The entities in the Game, and where their transforms are kept
+	EntityWorld* world;
+	TransformStore* transforms;
+
+	// Runs the systems that update the entities every frame
+	SystemScheduler* scheduler;
+
+	// The static entities, merged into one batch per material
+	std::vector<StaticBatch*> staticBatches;
+
+	// The index ranges left after culling an entity's clusters,
+	// how much was culled this frame, and when that was last printed
+	std::vector<IndexRange> visibleRanges;
+	ClusterCullStats cullStats;
+	float cullStatsReportTime;
 
 	// Wrappers for DirectX shaders to provide simplified functionality
 	SimpleVertexShader* vertexShader;
+	SimpleVertexShader* packedVertexShader;
 	SimplePixelShader* pixelShader;
 
 	// The matrices to go from model space to screen space
@@ -0,0 +1,377 @@
+#include "GeometryPool.h"
+#include <algorithm>
+#include <vector>
+
+GeometryPool::GeometryPool(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+	this->device = device;
+	this->context = context;
+	stats = {};
+
+	// Buffers are only created once something is put in them
+	for (int i = 0; i < 2; i++)
+	{
+		vertexPools[i] = {};
+		vertexPools[i].Allocator = new RangeAllocator(0);
+		vertexPools[i].BufferCount = VERTEX_STREAM_COUNT;
+		vertexPools[i].BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		for (int s = 0; s < VERTEX_STREAM_COUNT; s++)
+			vertexPools[i].Strides[s] = GetVertexStreamStride((VertexFormat)i, (VertexStream)s);
+
+		indexPools[i] = {};
+		indexPools[i].Allocator = new RangeAllocator(0);
+		indexPools[i].BufferCount = 1;
+		indexPools[i].Strides[0] = i == 0 ? sizeof(unsigned short) : sizeof(unsigned int);
+		indexPools[i].BindFlags = D3D11_BIND_INDEX_BUFFER;
+	}
+}
+
+GeometryPool::~GeometryPool()
+{
+	for (int i = 0; i < 2; i++)
+	{
+		delete vertexPools[i].Allocator;
+		delete indexPools[i].Allocator;
+		for (int s = 0; s < VERTEX_STREAM_COUNT; s++)
+		{
+			if (vertexPools[i].Buffers[s]) { vertexPools[i].Buffers[s]->Release(); }
+			if (indexPools[i].Buffers[s]) { indexPools[i].Buffers[s]->Release(); }
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Copies a mesh's geometry into the shared buffers
+//
+// vertexStreams - One array per VertexStream, in vertexFormat
+// indices       - The index array, in indexFormat, relative
+//                  to the first of these vertices
+//
+// Returns where the data ended up (check the handles against
+// RANGE_ALLOCATOR_INVALID if the mesh might be empty)
+// --------------------------------------------------------
+GeometryAllocation GeometryPool::Allocate(const void* const* vertexStreams, VertexFormat vertexFormat, unsigned int numVerts, const void* indices, DXGI_FORMAT indexFormat, unsigned int numIndices)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	GeometryAllocation allocation;
+	allocation.VertexFormat = vertexFormat;
+	allocation.IndexFormat = indexFormat;
+	allocation.VertexHandle = AllocateIn(vertexPools[vertexFormat], vertexStreams, numVerts);
+	allocation.IndexHandle = AllocateIn(GetIndexPool(indexFormat), &indices, numIndices);
+	return allocation;
+}
+
+// --------------------------------------------------------
+// Rewrites some of a mesh's indices in place
+//
+// - For meshes whose indices change after they're loaded
+//    (like progressive meshes), which only need to upload the
+//    part that changed
+//
+// first   - Which of the mesh's indices to start at
+// count   - How many to write, which must fit in the mesh
+// indices - The new values, in the allocation's index format
+// --------------------------------------------------------
+void GeometryPool::UpdateIndices(const GeometryAllocation& allocation, unsigned int first, unsigned int count, const void* indices)
+{
+	if (allocation.IndexHandle == RANGE_ALLOCATOR_INVALID || count == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	Pool& pool = GetIndexPool(allocation.IndexFormat);
+	D3D11_BOX box = {};
+	box.bottom = 1;
+	box.back = 1;
+	box.left = (pool.Allocator->GetOffset(allocation.IndexHandle) + first) * pool.Strides[0];
+	box.right = box.left + count * pool.Strides[0];
+	context->UpdateSubresource(pool.Buffers[0], 0, &box, indices, 0, 0);
+}
+
+void GeometryPool::Free(const GeometryAllocation& allocation)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	vertexPools[allocation.VertexFormat].Allocator->Free(allocation.VertexHandle);
+	GetIndexPool(allocation.IndexFormat).Allocator->Free(allocation.IndexHandle);
+}
+
+bool GeometryPool::ReadBack(const GeometryAllocation& allocation, std::vector<char> vertexStreams[VERTEX_STREAM_COUNT], std::vector<char>& indices)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	return
+		ReadFrom(vertexPools[allocation.VertexFormat], allocation.VertexHandle, vertexStreams) &&
+		ReadFrom(GetIndexPool(allocation.IndexFormat), allocation.IndexHandle, &indices);
+}
+
+ID3D11Buffer* GeometryPool::GetVertexBuffer(VertexFormat format, VertexStream stream)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return vertexPools[format].Buffers[stream];
+}
+
+ID3D11Buffer* GeometryPool::GetIndexBuffer(DXGI_FORMAT format)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return GetIndexPool(format).Buffers[0];
+}
+
+unsigned int GeometryPool::GetBaseVertex(const GeometryAllocation& allocation)
+{
+	if (allocation.VertexHandle == RANGE_ALLOCATOR_INVALID)
+		return 0;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	return vertexPools[allocation.VertexFormat].Allocator->GetOffset(allocation.VertexHandle);
+}
+
+unsigned int GeometryPool::GetFirstIndex(const GeometryAllocation& allocation)
+{
+	if (allocation.IndexHandle == RANGE_ALLOCATOR_INVALID)
+		return 0;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	return GetIndexPool(allocation.IndexFormat).Allocator->GetOffset(allocation.IndexHandle);
+}
+
+void GeometryPool::Defragment()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (int i = 0; i < 2; i++)
+	{
+		if (vertexPools[i].Buffers[0] && !vertexPools[i].Allocator->IsCompact())
+			Rebuild(vertexPools[i], vertexPools[i].Allocator->GetCapacity(), true);
+		if (indexPools[i].Buffers[0] && !indexPools[i].Allocator->IsCompact())
+			Rebuild(indexPools[i], indexPools[i].Allocator->GetCapacity(), true);
+	}
+}
+
+GeometryPoolStats GeometryPool::GetStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	stats.VertexBytesUsed = stats.VertexBytesCapacity = 0;
+	stats.IndexBytesUsed = stats.IndexBytesCapacity = 0;
+	for (int i = 0; i < 2; i++)
+	{
+		stats.VertexBytesUsed += (unsigned long long)vertexPools[i].Allocator->GetUsed() * GetTotalStride(vertexPools[i]);
+		stats.VertexBytesCapacity += (unsigned long long)vertexPools[i].Allocator->GetCapacity() * GetTotalStride(vertexPools[i]);
+		stats.IndexBytesUsed += (unsigned long long)indexPools[i].Allocator->GetUsed() * GetTotalStride(indexPools[i]);
+		stats.IndexBytesCapacity += (unsigned long long)indexPools[i].Allocator->GetCapacity() * GetTotalStride(indexPools[i]);
+	}
+	return stats;
+}
+
+unsigned int GeometryPool::GetTotalStride(const Pool& pool)
+{
+	unsigned int stride = 0;
+	for (unsigned int b = 0; b < pool.BufferCount; b++)
+		stride += pool.Strides[b];
+	return stride;
+}
+
+// --------------------------------------------------------
+// Finds room in a pool and copies data into it
+//
+// - If no free block is big enough, but there's enough free
+//    space in total, the pool is packed down first
+// - Otherwise the pool's buffers are doubled (or grown to fit)
+//
+// data - One array per buffer in the pool
+//
+// Returns the allocation's handle, or RANGE_ALLOCATOR_INVALID
+// --------------------------------------------------------
+unsigned int GeometryPool::AllocateIn(Pool& pool, const void* const* data, unsigned int count)
+{
+	if (count == 0)
+		return RANGE_ALLOCATOR_INVALID;
+
+	unsigned int handle = pool.Allocator->Allocate(count);
+	if (handle == RANGE_ALLOCATOR_INVALID)
+	{
+		bool made = false;
+		if (pool.Allocator->IsFragmentedFor(count))
+		{
+			made = Rebuild(pool, pool.Allocator->GetCapacity(), true);
+		}
+		else
+		{
+			unsigned int initial = pool.BindFlags == D3D11_BIND_VERTEX_BUFFER ? GEOMETRY_POOL_VERTEX_CAPACITY : GEOMETRY_POOL_INDEX_CAPACITY;
+			unsigned int capacity = (std::max)(pool.Allocator->GetCapacity() * 2, initial);
+			capacity = (std::max)(capacity, pool.Allocator->GetUsed() + count);
+			made = Rebuild(pool, capacity, false);
+		}
+
+		if (!made)
+			return RANGE_ALLOCATOR_INVALID;
+		handle = pool.Allocator->Allocate(count);
+		if (handle == RANGE_ALLOCATOR_INVALID)
+			return RANGE_ALLOCATOR_INVALID;
+	}
+
+	// Copy the data into its spot in each buffer
+	D3D11_BOX box = {};
+	box.bottom = 1;
+	box.back = 1;
+	for (unsigned int b = 0; b < pool.BufferCount; b++)
+	{
+		box.left = pool.Allocator->GetOffset(handle) * pool.Strides[b];
+		box.right = box.left + count * pool.Strides[b];
+		context->UpdateSubresource(pool.Buffers[b], 0, &box, data[b], 0, 0);
+	}
+
+	return handle;
+}
+
+// --------------------------------------------------------
+// Moves a pool into brand new buffers
+//
+// - Buffers can't safely copy onto themselves, so growing
+//    and packing both copy everything into new buffers
+// - Every buffer in the pool shares the same allocations,
+//    so they all get the same copies (scaled by their strides)
+//
+// newCapacity - How many elements the new buffers hold
+// compact     - Pack the allocations down on the way?
+//
+// Returns false if the new buffers couldn't be created
+// --------------------------------------------------------
+bool GeometryPool::Rebuild(Pool& pool, unsigned int newCapacity, bool compact)
+{
+	// Create the new buffers -------------------------------------------------
+	// - DEFAULT usage, so pieces can be updated and copied on the GPU
+	ID3D11Buffer* buffers[VERTEX_STREAM_COUNT] = {};
+	for (unsigned int b = 0; b < pool.BufferCount; b++)
+	{
+		D3D11_BUFFER_DESC desc;
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		desc.ByteWidth = newCapacity * pool.Strides[b];
+		desc.BindFlags = pool.BindFlags;
+		desc.CPUAccessFlags = 0;
+		desc.MiscFlags = 0;
+		desc.StructureByteStride = 0;
+
+		if (FAILED(device->CreateBuffer(&desc, 0, &buffers[b])))
+		{
+			for (unsigned int made = 0; made < b; made++)
+				buffers[made]->Release();
+			return false;
+		}
+	}
+
+	if (pool.Buffers[0])
+	{
+		// Work out which ranges of elements go where
+		std::vector<RangeMove> copies;
+		if (compact)
+		{
+			// Slide the allocations down, copying whatever moved to its new spot
+			// and everything in between (which didn't move) to where it already was
+			std::vector<RangeMove> moves;
+			pool.Allocator->Defragment(moves);
+
+			unsigned int cursor = 0;
+			for (size_t i = 0; i <= moves.size(); i++)
+			{
+				unsigned int stayEnd = i < moves.size() ? moves[i].To : pool.Allocator->GetUsed();
+				if (stayEnd > cursor)
+				{
+					RangeMove stay = { RANGE_ALLOCATOR_INVALID, cursor, cursor, stayEnd - cursor };
+					copies.push_back(stay);
+				}
+				if (i == moves.size())
+					break;
+
+				copies.push_back(moves[i]);
+				cursor = moves[i].To + moves[i].Size;
+			}
+			stats.Defragmentations++;
+		}
+		else
+		{
+			// Everything stays where it is, there's just more room after it
+			RangeMove all = { RANGE_ALLOCATOR_INVALID, 0, 0, pool.Allocator->GetCapacity() };
+			copies.push_back(all);
+			stats.Grows++;
+		}
+
+		// Do the same copies in every buffer
+		D3D11_BOX box = {};
+		box.bottom = 1;
+		box.back = 1;
+		for (unsigned int b = 0; b < pool.BufferCount; b++)
+		{
+			for (size_t i = 0; i < copies.size(); i++)
+			{
+				box.left = copies[i].From * pool.Strides[b];
+				box.right = (copies[i].From + copies[i].Size) * pool.Strides[b];
+				context->CopySubresourceRegion(buffers[b], 0, copies[i].To * pool.Strides[b], 0, 0, pool.Buffers[b], 0, &box);
+			}
+			pool.Buffers[b]->Release();
+		}
+	}
+
+	for (unsigned int b = 0; b < pool.BufferCount; b++)
+		pool.Buffers[b] = buffers[b];
+	pool.Allocator->Grow(newCapacity);
+	return true;
+}
+
+// --------------------------------------------------------
+// Copies one allocation's elements out of a pool's buffers
+//
+// - The pool's buffers can't be read by the CPU, so each
+//    range is copied into a STAGING buffer first, and that
+//    is mapped (which waits for the copy to finish)
+//
+// data - One array per buffer in the pool, resized to fit
+//
+// Returns false if a staging buffer couldn't be made or read
+// --------------------------------------------------------
+bool GeometryPool::ReadFrom(Pool& pool, unsigned int handle, std::vector<char>* data)
+{
+	for (unsigned int b = 0; b < pool.BufferCount; b++)
+		data[b].clear();
+	if (handle == RANGE_ALLOCATOR_INVALID)
+		return true;
+
+	unsigned int offset = pool.Allocator->GetOffset(handle);
+	unsigned int count = pool.Allocator->GetSize(handle);
+	for (unsigned int b = 0; b < pool.BufferCount; b++)
+	{
+		D3D11_BUFFER_DESC desc;
+		desc.Usage = D3D11_USAGE_STAGING;
+		desc.ByteWidth = count * pool.Strides[b];
+		desc.BindFlags = 0;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+		desc.MiscFlags = 0;
+		desc.StructureByteStride = 0;
+
+		ID3D11Buffer* staging = 0;
+		if (FAILED(device->CreateBuffer(&desc, 0, &staging)))
+			return false;
+
+		D3D11_BOX box = {};
+		box.left = offset * pool.Strides[b];
+		box.right = box.left + desc.ByteWidth;
+		box.bottom = 1;
+		box.back = 1;
+		context->CopySubresourceRegion(staging, 0, 0, 0, 0, pool.Buffers[b], 0, &box);
+
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		if (FAILED(context->Map(staging, 0, D3D11_MAP_READ, 0, &mapped)))
+		{
+			staging->Release();
+			return false;
+		}
+		const char* bytes = (const char*)mapped.pData;
+		data[b].assign(bytes, bytes + desc.ByteWidth);
+		context->Unmap(staging, 0);
+		staging->Release();
+	}
+
+	return true;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <d3d11.h>
+#include "Vertex.h"
+#include "RangeAllocator.h"
+#include <mutex>
+#include <vector>
+
+// How many vertices and indices each buffer starts out with room for
+// (they double whenever they run out)
+const unsigned int GEOMETRY_POOL_VERTEX_CAPACITY = 1 << 16;
+const unsigned int GEOMETRY_POOL_INDEX_CAPACITY = 1 << 18;
+
+// --------------------------------------------------------
+// Where one mesh's vertices and indices live in the pool
+// --------------------------------------------------------
+struct GeometryAllocation
+{
+	VertexFormat VertexFormat;
+	DXGI_FORMAT IndexFormat;
+	unsigned int VertexHandle;	// RangeAllocator handles (RANGE_ALLOCATOR_INVALID if empty)
+	unsigned int IndexHandle;
+};
+
+// --------------------------------------------------------
+// How full the pool's buffers are
+// --------------------------------------------------------
+struct GeometryPoolStats
+{
+	unsigned long long VertexBytesUsed;
+	unsigned long long VertexBytesCapacity;
+	unsigned long long IndexBytesUsed;
+	unsigned long long IndexBytesCapacity;
+	unsigned int Grows;				// Times a buffer was made bigger
+	unsigned int Defragmentations;	// Times a buffer was packed down
+};
+
+// --------------------------------------------------------
+// A few big vertex and index buffers that every static
+// mesh's geometry is sub-allocated from
+//
+// - There's one set of vertex buffers per VertexFormat and one
+//    index buffer per index format, so meshes in the same formats
+//    can be drawn one after another without rebinding anything
+// - Vertices are split into a buffer per VertexStream, which
+//    all share the same allocations (so one base vertex works
+//    for every stream)
+// - Each mesh's indices are relative to its own vertices, and
+//    are drawn with its base vertex and first index
+// - When a buffer runs out of room it's packed down if that
+//    would make enough space, otherwise it's doubled in size
+//    (either way it's a new buffer, so don't hold onto them)
+// - Allocate(), UpdateIndices() and Free() use the immediate
+//    context, so they can't overlap with drawing on another
+//    thread
+// --------------------------------------------------------
+class GeometryPool
+{
+public:
+	GeometryPool(ID3D11Device* device, ID3D11DeviceContext* context);
+	~GeometryPool();
+
+	// Copies a mesh's vertices (already split into one array per VertexStream) and indices into the pool
+	GeometryAllocation Allocate(const void* const* vertexStreams, VertexFormat vertexFormat, unsigned int numVerts, const void* indices, DXGI_FORMAT indexFormat, unsigned int numIndices);
+
+	// Overwrites part of a mesh's indices (in its index format), starting "first" indices in
+	void UpdateIndices(const GeometryAllocation& allocation, unsigned int first, unsigned int count, const void* indices);
+
+	// Gives a mesh's space back
+	void Free(const GeometryAllocation& allocation);
+
+	// Copies a mesh's vertices (one array per VertexStream) and indices back from the GPU
+	// (this waits for the GPU to catch up, so it's only for load time work, not every frame)
+	bool ReadBack(const GeometryAllocation& allocation, std::vector<char> vertexStreams[VERTEX_STREAM_COUNT], std::vector<char>& indices);
+
+	// The buffers to bind to draw meshes in the given formats
+	ID3D11Buffer* GetVertexBuffer(VertexFormat format, VertexStream stream);
+	ID3D11Buffer* GetIndexBuffer(DXGI_FORMAT format);
+
+	// Where a mesh's data currently starts, for DrawIndexed()
+	unsigned int GetBaseVertex(const GeometryAllocation& allocation);
+	unsigned int GetFirstIndex(const GeometryAllocation& allocation);
+
+	// Packs every buffer down, so all of the free space is in one block at the end
+	void Defragment();
+
+	// Gets a copy of how full the buffers are
+	GeometryPoolStats GetStats();
+
+private:
+	// One or more big buffers and what's been allocated from them
+	// (vertex pools have a buffer per stream, index pools just the one)
+	struct Pool
+	{
+		RangeAllocator* Allocator;
+		ID3D11Buffer* Buffers[VERTEX_STREAM_COUNT];
+		unsigned int Strides[VERTEX_STREAM_COUNT];
+		unsigned int BufferCount;
+		UINT BindFlags;
+	};
+
+	// Not copyable, since we own the buffers
+	GeometryPool(const GeometryPool&) = delete;
+	GeometryPool& operator=(const GeometryPool&) = delete;
+
+	ID3D11Device* device;
+	ID3D11DeviceContext* context;
+
+	// Indexed by VertexFormat, and by 16 then 32 bit indices
+	Pool vertexPools[2];
+	Pool indexPools[2];
+	Pool& GetIndexPool(DXGI_FORMAT format) { return indexPools[format == DXGI_FORMAT_R16_UINT ? 0 : 1]; }
+
+	// The size of one element across every buffer in a pool
+	unsigned int GetTotalStride(const Pool& pool);
+
+	// Guards everything above and below
+	std::mutex mutex;
+	GeometryPoolStats stats;
+
+	// Helper methods that find room for data in a pool (making room if needed),
+	// that move a pool into a new buffer, and that copy one allocation out of a pool's buffers
+	unsigned int AllocateIn(Pool& pool, const void* const* data, unsigned int count);
+	bool Rebuild(Pool& pool, unsigned int newCapacity, bool compact);
+	bool ReadFrom(Pool& pool, unsigned int handle, std::vector<char>* data);
+};
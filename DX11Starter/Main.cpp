@@ -1,6 +1,7 @@
 
 #include <Windows.h>
 #include "Game.h"
+#include "Benchmarks.h"
 
 // --------------------------------------------------------
 // Entry point for a graphical (non-console) Windows application
@@ -44,6 +45,23 @@ int WINAPI WinMain(
 		}
 	}
 
+	// With -benchmark on the command line, run the benchmarks in a
+	// console instead of the game, and wait for Enter before closing
+	// - Run them from a release build, or the times mean nothing
+	if (strstr(lpCmdLine, "-benchmark"))
+	{
+		AllocConsole();
+		FILE* stream;
+		freopen_s(&stream, "CONIN$", "r", stdin);
+		freopen_s(&stream, "CONOUT$", "w", stdout);
+		freopen_s(&stream, "CONOUT$", "w", stderr);
+
+		RunBenchmarks("./Assets/Models");
+		printf("Press Enter to close");
+		getchar();
+		return 0;
+	}
+
 	// Create the Game object using
 	// the app handle we got from WinMain
 	Game dxGame(hInstance);
@@ -0,0 +1,143 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#endif
+
+// --------------------------------------------------------
+// Opens the file and maps the whole thing for reading
+//
+// filename - Path to the file to map
+// --------------------------------------------------------
+MappedFile::MappedFile(const char* filename)
+{
+	open = false;
+	data = 0;
+	size = 0;
+
+#if defined(_WIN32)
+	mappingHandle = 0;
+
+	// Tell the OS we'll be reading from front to back, so it can read ahead
+	fileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		fileHandle = 0;
+		return;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize))
+		return;
+
+	open = true;
+	size = (size_t)fileSize.QuadPart;
+
+	// Empty files can't be mapped, but there's nothing to read anyway
+	if (size == 0)
+		return;
+
+	mappingHandle = CreateFileMappingA(fileHandle, 0, PAGE_READONLY, 0, 0, 0);
+	if (mappingHandle)
+		data = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+	fileDescriptor = ::open(filename, O_RDONLY);
+	if (fileDescriptor < 0)
+		return;
+
+	struct stat info;
+	if (fstat(fileDescriptor, &info) != 0)
+		return;
+
+	open = true;
+	size = (size_t)info.st_size;
+
+	// Empty files can't be mapped, but there's nothing to read anyway
+	if (size == 0)
+		return;
+
+	void* view = mmap(0, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (view != MAP_FAILED)
+	{
+		madvise(view, size, MADV_SEQUENTIAL);
+		data = (const char*)view;
+	}
+#endif
+
+	// The mapping itself failed
+	if (!data)
+	{
+		open = false;
+		size = 0;
+	}
+}
+
+// --------------------------------------------------------
+// Unmaps the view and closes the OS handles
+// --------------------------------------------------------
+MappedFile::~MappedFile()
+{
+#if defined(_WIN32)
+	if (data) { UnmapViewOfFile(data); }
+	if (mappingHandle) { CloseHandle(mappingHandle); }
+	if (fileHandle) { CloseHandle(fileHandle); }
+#else
+	if (data) { munmap((void*)data, size); }
+	if (fileDescriptor >= 0) { close(fileDescriptor); }
+#endif
+}
+
+// --------------------------------------------------------
+// Looks up the size and last-write time of a file
+//
+// filename - Path to the file
+// stamp    - Filled in with the file's details
+//
+// Returns false if the file couldn't be found
+// --------------------------------------------------------
+bool GetFileStamp(const char* filename, FileStamp& stamp)
+{
+#if defined(_WIN32)
+	WIN32_FILE_ATTRIBUTE_DATA info;
+	if (!GetFileAttributesExA(filename, GetFileExInfoStandard, &info))
+		return false;
+
+	stamp.Size = ((unsigned long long)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+	stamp.ModifiedTime = ((unsigned long long)info.ftLastWriteTime.dwHighDateTime << 32) | info.ftLastWriteTime.dwLowDateTime;
+#else
+	struct stat info;
+	if (stat(filename, &info) != 0)
+		return false;
+
+	stamp.Size = (unsigned long long)info.st_size;
+	stamp.ModifiedTime = (unsigned long long)info.st_mtime;
+#endif
+	return true;
+}
+
+// --------------------------------------------------------
+// Moves a file to a new name, replacing anything already
+// there in one step
+//
+// - Anyone opening "to" sees either the old file or the new
+//    one, never a half-written mix
+//
+// from - The file to move (usually a finished temporary file)
+// to   - Its new name
+//
+// Returns false if it couldn't be moved
+// --------------------------------------------------------
+bool MoveFileOver(const char* from, const char* to)
+{
+#if defined(_WIN32)
+	return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(from, to) == 0;
+#endif
+}
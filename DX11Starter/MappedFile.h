@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+
+// --------------------------------------------------------
+// Identifies one version of a file on disk, so we can tell
+// when something derived from it has gone out of date
+// --------------------------------------------------------
+struct FileStamp
+{
+	unsigned long long Size;
+	unsigned long long ModifiedTime;	// In whatever units the OS uses
+};
+
+// Looks up the file's size and last-write time.  Returns false if the file doesn't exist.
+bool GetFileStamp(const char* filename, FileStamp& stamp);
+
+// Moves "from" over "to" in one step, so "to" is never seen half-written.  Returns false if it couldn't be moved.
+bool MoveFileOver(const char* from, const char* to);
+
+// --------------------------------------------------------
+// A read-only view of an entire file, mapped into memory
+//
+// - The file's bytes can be read directly through GetData()
+//    without copying them into our own buffers first
+// - The view stays valid until this object is destroyed
+// --------------------------------------------------------
+class MappedFile
+{
+public:
+	MappedFile(const char* filename);
+	~MappedFile();
+
+	// Was the file found and mapped?  (Empty files are open, but have no data)
+	bool IsOpen() { return open; }
+
+	// Accessors for the mapped bytes
+	const char* GetData() { return data; }
+	size_t GetSize() { return size; }
+
+private:
+	// Not copyable, since we own the OS handles
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool open;
+	const char* data;
+	size_t size;
+
+	// OS handles for the file and its mapping
+#if defined(_WIN32)
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+};
+
@@ -2,10 +2,11 @@
 
 
 
-Material::Material(SimpleVertexShader* vShader, SimplePixelShader* pShader, ID3D11ShaderResourceView* srvPtr, ID3D11SamplerState* sampleState)
+Material::Material(SimpleVertexShader* vShader, SimplePixelShader* pShader, ID3D11ShaderResourceView* srvPtr, ID3D11SamplerState* sampleState, SimpleVertexShader* packedVShader)
 {
 	vertexShader = vShader;
 	pixelShader = pShader;
+	packedVertexShader = packedVShader;
 
 	srv = srvPtr;
 	sample = sampleState;
@@ -15,3 +16,42 @@ Material::Material(SimpleVertexShader* vShader, SimplePixelShader* pShader, ID3D
 Material::~Material()
 {
 }
+
+void Material::Prepare(XMFLOAT4X4 worldMatrix, XMFLOAT4X4 viewMatrix, XMFLOAT4X4 projMatrix, Mesh* mesh)
+{
+	// Send data to shader variables
+	//  - Do this ONCE PER OBJECT you're drawing
+	//  - This is actually a complex process of copying data to a local buffer
+	//    and then copying that entire buffer to the GPU.  
+	//  - The "SimpleShader" class handles all of that for you.
+	//  - Meshes with packed vertices need the shader that can unpack them
+	SimpleVertexShader* vertexShader = GetVertexShader(mesh->GetVertexFormat());
+	vertexShader->SetMatrix4x4("world", worldMatrix);
+	vertexShader->SetMatrix4x4("view", viewMatrix);
+	vertexShader->SetMatrix4x4("projection", projMatrix);
+
+	// Packed positions are relative to the mesh's bounding box
+	if (mesh->GetVertexFormat() == VERTEX_FORMAT_PACKED)
+	{
+		XMFLOAT3 boundsMin = mesh->GetBoundsMin();
+		XMFLOAT3 boundsMax = mesh->GetBoundsMax();
+		vertexShader->SetFloat3("positionOffset", boundsMin);
+		vertexShader->SetFloat3("positionScale", XMFLOAT3(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z));
+	}
+
+	pixelShader->SetSamplerState("basicSampler", sample);
+	pixelShader->SetShaderResourceView("diffuseTexture", srv);
+
+	// Once you've set all of the data you care to change for
+	// the next draw call, you need to actually send it to the GPU
+	//  - If you skip this, the "SetMatrix" calls above won't make it to the GPU!
+	vertexShader->CopyAllBufferData();
+	pixelShader->CopyAllBufferData();
+
+	// Set the vertex and pixel shaders to use for the next Draw() command
+	//  - These don't technically need to be set every frame...YET
+	//  - Once you start applying different shaders to different objects,
+	//    you'll need to swap the current shaders before each draw
+	vertexShader->SetShader();
+	pixelShader->SetShader();
+}
@@ -1,24 +1,34 @@
 #pragma once
 #include "DXCore.h"
 #include "SimpleShader.h"
+#include "Vertex.h"
+#include "Mesh.h"
 
 class Material
 {
 public:
-	Material(SimpleVertexShader* vShader, SimplePixelShader* pShader, ID3D11ShaderResourceView* srvPtr, ID3D11SamplerState* sampleState);
+	Material(SimpleVertexShader* vShader, SimplePixelShader* pShader, ID3D11ShaderResourceView* srvPtr, ID3D11SamplerState* sampleState, SimpleVertexShader* packedVShader = 0);
 	~Material();
 
 	// Accessors to retrieve important info about the Material
 	SimpleVertexShader* GetVertexShader() { return vertexShader; };
+	SimpleVertexShader* GetVertexShader(VertexFormat format) { return format == VERTEX_FORMAT_PACKED && packedVertexShader ? packedVertexShader : vertexShader; };
 	SimplePixelShader* GetPixelShader() { return pixelShader; };
 	ID3D11ShaderResourceView* GetSRV() { return srv; };
 	ID3D11SamplerState* GetSamplerState() { return sample; };
 
+	// Set up the shaders to draw the given mesh with this material
+	// (the matrices are already transposed for HLSL)
+	void Prepare(DirectX::XMFLOAT4X4 worldMatrix, DirectX::XMFLOAT4X4 viewMatrix, DirectX::XMFLOAT4X4 projMatrix, Mesh* mesh);
+
 private:
 	// Wrappers for DirectX shaders to provide simplified functionality
 	SimpleVertexShader* vertexShader;
 	SimplePixelShader* pixelShader;
 
+	// The vertex shader to use instead for meshes with packed vertices
+	SimpleVertexShader* packedVertexShader;
+
 	// Pointers to variables needed to keep track of the material's texture
 	ID3D11ShaderResourceView* srv;
 	ID3D11SamplerState* sample;
@@ -1,234 +1,759 @@
 #include "Mesh.h"
+#include "ObjLoader.h"
+#include "MeshBinary.h"
+#include "MeshOptimizer.h"
+#include "VertexPacking.h"
+#include "VertexStreams.h"
+#include <thread>
+#include <chrono>
+#include <cstring>
 
 
-Mesh::Mesh(Vertex* vertices, unsigned int numVerts, unsigned int* indices, unsigned int numIndices, ID3D11Device * device)
+void Mesh::CreateFromArrays(const void* vertices, VertexFormat vertexFormat, unsigned int stride, unsigned int positionOffset, unsigned int numVerts, const unsigned int* indices, unsigned int numIndices, GeometryPool* pool)
 {
-	CreateBuffers(vertices, numVerts, indices, numIndices, device);
+	this->pool = pool;
+	geometry = { vertexFormat, DXGI_FORMAT_R32_UINT, RANGE_ALLOCATOR_INVALID, RANGE_ALLOCATOR_INVALID };
+	indexCount = 0;
+	indexFormat = DXGI_FORMAT_R32_UINT;
+	this->vertexFormat = vertexFormat;
+	vertexCount = 0;
+	progressive = 0;
+	bvh = 0;
+
+	CalculateBounds(vertices, stride, positionOffset, numVerts);
+	CreateBuffers(vertices, vertexFormat, numVerts, indices, numIndices);
+
+	// Hand-made meshes only have the one level of detail, with one (unnamed) material
+	MeshLod lod = { 0, numIndices, 0.0f };
+	lods.push_back(lod);
+	MeshSubmesh submesh = { 0, numIndices, "" };
+	submeshes.push_back(submesh);
+	submeshCount = 1;
+	FindLodClusters();
 }
 
-Mesh::Mesh(char * filename, ID3D11Device * device)
+// --------------------------------------------------------
+// Finds a file named by a model, relative to the model
+// --------------------------------------------------------
+static std::string ResolveModelPath(const char* modelFilename, const std::string& path)
 {
-	// File input object
-	std::ifstream obj(filename);
+	if (path.empty())
+		return path;
 
-	// Check for successful open
-	if (!obj.is_open())
+	std::string model(modelFilename);
+	size_t slash = model.find_last_of("/\\");
+	return slash == std::string::npos ? path : model.substr(0, slash + 1) + path;
+}
+
+// --------------------------------------------------------
+// Loads a mesh from an OBJ file
+//
+// - The first time a file is loaded, the finished vertices and
+//    indices are also saved next to it as a .meshbin file, named
+//    after the format and options it was loaded with (so loading
+//    it another way doesn't replace it; see GetMeshCacheFilename())
+// - Later loads map that .meshbin and hand its data straight to
+//    the GPU, skipping the parse entirely, as long as the OBJ
+//    file's size, modified time and contents haven't changed
+// - Simpler levels of detail are generated on the first load,
+//    and saved in the .meshbin along with everything else
+// - With VERTEX_FORMAT_PACKED, the vertex buffer holds 16 byte
+//    PackedVertex structs, which must be drawn with a shader
+//    that decodes them (see VertexShaderPacked.hlsl)
+// - With "clustered", every level of detail is also split into
+//    clusters of up to CLUSTER_MAX_VERTICES verts, which can be
+//    culled on the CPU before drawing (see CullClusters())
+// - Faces are sorted by their "usemtl" material into one range
+//    per material (a submesh) at every level of detail, so the
+//    whole mesh still lives in one vertex and index buffer;
+//    each submesh is simplified on its own, so the seams between
+//    materials stay put
+// - With "progressive", the mesh gets a base mesh and vertex
+//    splits (see ProgressiveMesh.h) instead of fixed levels of
+//    detail, and SetTargetTriangleCount() picks how much of it
+//    is drawn; it never has clusters, since their index ranges
+//    would change under them, and models with more than one
+//    material get normal levels of detail instead
+// - A compressed .meshz copy is written next to the .meshbin,
+//    and can be loaded instead of the OBJ file by passing its
+//    name here (it keeps whatever format and clusters it was
+//    written with, ignoring "format" and "clustered"), though
+//    progressive meshes don't get one yet
+// --------------------------------------------------------
+Mesh::Mesh(const char * filename, GeometryPool* pool, VertexFormat format, bool clustered, bool progressive)
+{
+	this->pool = pool;
+	geometry = { VERTEX_FORMAT_FULL, DXGI_FORMAT_R32_UINT, RANGE_ALLOCATOR_INVALID, RANGE_ALLOCATOR_INVALID };
+	indexCount = 0;
+	indexFormat = DXGI_FORMAT_R32_UINT;
+	vertexFormat = VERTEX_FORMAT_FULL;
+	vertexCount = 0;
+	submeshCount = 0;
+	boundsMin = boundsMax = XMFLOAT3(0, 0, 0);
+	this->progressive = 0;
+	bvh = 0;
+	if (progressive)
+		clustered = false;
+
+	// Compressed meshes don't need the model they came from
+	size_t nameLength = strlen(filename);
+	size_t extensionLength = strlen(MESHZ_EXTENSION);
+	if (nameLength >= extensionLength && strcmp(filename + nameLength - extensionLength, MESHZ_EXTENSION) == 0)
+	{
+		LoadCompressed(filename);
 		return;
+	}
 
-	// Variables used while reading the file
-	std::vector<XMFLOAT3> positions;     // Positions from the file
-	std::vector<XMFLOAT3> normals;       // Normals from the file
-	std::vector<XMFLOAT2> uvs;           // UVs from the file
-	std::vector<Vertex> verts;           // Verts we're assembling
-	std::vector<UINT> indices;           // Indices of these verts
-	unsigned int vertCounter = 0;        // Count of vertices/indices
-	char chars[100];                     // String for line reading
+	// Is there an up to date binary version?  Use its data directly
+	// - Its size and last-write time are compared first, so an unchanged
+	//    model isn't even opened; only when those differ (the file may
+	//    just have been copied or saved again) is the whole file hashed
+	//    to see whether what's in it changed
+	FileStamp sourceStamp;
+	if (!GetFileStamp(filename, sourceStamp))
+		return;
+	unsigned int flags = (clustered ? MESHBIN_FLAG_CLUSTERED : 0) | (progressive ? MESHBIN_FLAG_PROGRESSIVE : 0);
+	std::string cacheFilename = GetMeshCacheFilename(filename, format, flags, MESHBIN_EXTENSION);
+	if (LoadBinary(cacheFilename.c_str(), filename, sourceStamp, 0, format, clustered, progressive))
+		return;
 
-										 // Still have data left?
-	while (obj.good())
+	MappedFile source(filename);
+	if (!source.IsOpen())
+		return;
+	unsigned long long sourceHash = HashBytes(source.GetData(), source.GetSize());
+	if (LoadBinary(cacheFilename.c_str(), filename, sourceStamp, &sourceHash, format, clustered, progressive))
 	{
-		// Get the line (100 characters should be more than enough)
-		obj.getline(chars, 100);
+		// Nothing really changed, so remember the new stamp and skip the hash next time
+		UpdateMeshBinaryStamp(cacheFilename.c_str(), sourceStamp);
+		return;
+	}
 
-		// Check the type of line
-		if (chars[0] == 'v' && chars[1] == 'n')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 norm;
-			sscanf_s(
-				chars,
-				"vn %f %f %f",
-				&norm.x, &norm.y, &norm.z);
-
-			// Add to the list of normals
-			normals.push_back(norm);
-		}
-		else if (chars[0] == 'v' && chars[1] == 't')
-		{
-			// Read the 2 numbers directly into an XMFLOAT2
-			XMFLOAT2 uv;
-			sscanf_s(
-				chars,
-				"vt %f %f",
-				&uv.x, &uv.y);
-
-			// Add to the list of uv's
-			uvs.push_back(uv);
-		}
-		else if (chars[0] == 'v')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 pos;
-			sscanf_s(
-				chars,
-				"v %f %f %f",
-				&pos.x, &pos.y, &pos.z);
-
-			// Add to the positions
-			positions.push_back(pos);
-		}
-		else if (chars[0] == 'f')
+	// Parse the file and weld the face corners into unique verts
+	// and the indices of those verts
+	std::vector<Vertex> verts;
+	std::vector<UINT> indices;
+	std::vector<ObjMaterialRun> materialRuns;
+	std::vector<std::string> materialLibraries;
+	if (source.GetSize() > OBJ_STREAM_THRESHOLD_BYTES)
+	{
+		// Huge files are streamed, so only the finished verts and
+		// indices are ever held in memory all at once
+		ObjVectorSink sink(verts, indices, &materialRuns, &materialLibraries);
+		StreamObj(filename, sink);
+	}
+	else
+	{
+		// Everything else is parsed in memory
+		// - Large files are split up and parsed on every available core
+		ObjData obj;
+		ParseObjParallel(source.GetData(), source.GetSize(), obj, std::thread::hardware_concurrency());
+		BuildIndexedMesh(obj, verts, indices, &materialRuns);
+		materialLibraries.swap(obj.MaterialLibraries);
+	}
+
+	BuildFromGeometry(verts, indices, materialRuns, materialLibraries, format, clustered, progressive, filename, &sourceStamp, sourceHash);
+}
+
+// --------------------------------------------------------
+// Makes a mesh from vertices and indices made in code (see
+// MeshPrimitives.h)
+//
+// - They go through the same steps as a model file's, so
+//    they get levels of detail, packing, clusters and the
+//    rest in exactly the same way
+// - Nothing is cached, since making them again is quicker
+//    than loading them would be
+// - "verts" and "indices" are used up in the process
+// --------------------------------------------------------
+Mesh::Mesh(std::vector<Vertex>& verts, std::vector<unsigned int>& indices, GeometryPool* pool, VertexFormat format, bool clustered, bool progressive)
+{
+	this->pool = pool;
+	geometry = { VERTEX_FORMAT_FULL, DXGI_FORMAT_R32_UINT, RANGE_ALLOCATOR_INVALID, RANGE_ALLOCATOR_INVALID };
+	indexCount = 0;
+	indexFormat = DXGI_FORMAT_R32_UINT;
+	vertexFormat = VERTEX_FORMAT_FULL;
+	vertexCount = 0;
+	submeshCount = 0;
+	boundsMin = boundsMax = XMFLOAT3(0, 0, 0);
+	this->progressive = 0;
+	bvh = 0;
+	if (progressive)
+		clustered = false;
+
+	BuildFromGeometry(verts, indices, std::vector<ObjMaterialRun>(), std::vector<std::string>(), format, clustered, progressive, "(generated)", 0, 0);
+}
+
+// --------------------------------------------------------
+// Turns welded vertices and indices into the finished mesh
+// (the second half of loading a model file, described above)
+//
+// - Only meshes with a "sourceStamp" are written out to a
+//    .meshbin and .meshz, named after "filename"
+// --------------------------------------------------------
+void Mesh::BuildFromGeometry(std::vector<Vertex>& verts, std::vector<unsigned int>& indices, const std::vector<ObjMaterialRun>& materialRuns, const std::vector<std::string>& materialLibraries,
+	VertexFormat format, bool clustered, bool progressive, const char* filename, const FileStamp* sourceStamp, unsigned long long sourceHash)
+{
+	unsigned int flags = (clustered ? MESHBIN_FLAG_CLUSTERED : 0) | (progressive ? MESHBIN_FLAG_PROGRESSIVE : 0);
+
+	// Nothing usable in the file
+	if (verts.empty() || indices.empty())
+		return;
+
+	// Gather each material's faces into one range of the indices
+	// - Only the first material library is kept, which is all most files have
+	std::vector<std::string> materials;
+	std::vector<unsigned int> materialStarts;
+	GroupTrianglesByMaterial(indices, materialRuns, materials, materialStarts);
+	if (!materialLibraries.empty())
+		materialLibrary = ResolveModelPath(filename, materialLibraries[0]);
+
+#if defined(DEBUG) || defined(_DEBUG)
+	printf("\n%s: %u verts (%u bytes) welded down to %u verts (%u bytes)",
+		filename,
+		(unsigned int)indices.size(), (unsigned int)(indices.size() * sizeof(Vertex)),
+		(unsigned int)verts.size(), (unsigned int)(verts.size() * sizeof(Vertex)));
+#endif
+
+	// Reorder the triangles and verts so the GPU can draw them
+	// with fewer vertex shader runs, less overdraw and fewer fetches
+	// (triangles stay inside their material's range)
+	OptimizeMesh(verts, indices, &materialStarts);
+
+	submeshCount = (unsigned int)materials.size();
+	for (unsigned int i = 0; i < submeshCount; i++)
+	{
+		MeshSubmesh submesh = { materialStarts[i], (i + 1 < submeshCount ? materialStarts[i + 1] : (unsigned int)indices.size()) - materialStarts[i] };
+		strncpy(submesh.Material, materials[i].c_str(), SUBMESH_MAX_MATERIAL_NAME - 1);
+		submeshes.push_back(submesh);
+	}
+
+	// Add simplified versions of the mesh to the end of the indices,
+	// so far away copies can be drawn with fewer triangles
+	// - Progressive meshes instead reorder everything coarse-first and
+	//    have a single level, whose size changes as it's refined
+	//    (which would mix up the materials' ranges, so it's only done
+	//    for models with one material)
+	ProgressiveMeshData progressiveData;
+	if (progressive && submeshCount > 1)
+	{
+#if defined(DEBUG) || defined(_DEBUG)
+		printf("\n  %u materials, so using levels of detail instead of a progressive mesh", submeshCount);
+#endif
+		progressive = false;
+	}
+	if (progressive)
+	{
+		BuildProgressiveMesh(verts, indices, progressiveData);
+		MeshLod lod = { 0, (unsigned int)indices.size(), 0.0f };
+		lods.assign(1, lod);
+		this->progressive = new ProgressiveMesh(progressiveData, &indices[0], (unsigned int)indices.size());
+
+#if defined(DEBUG) || defined(_DEBUG)
+		printf("\n  progressive: %u triangles at the base, error %g, %u splits",
+			progressiveData.BaseTriangleCount, progressiveData.BaseError, (unsigned int)progressiveData.Splits.size());
+#endif
+	}
+	else
+		BuildLodChain(&verts[0], verts.size(), indices, lods, &submeshes);
+
+#if defined(DEBUG) || defined(_DEBUG)
+	for (size_t i = 0; i < lods.size(); i++)
+		printf("\n  LOD %u: %u triangles, error %g", (unsigned int)i, lods[i].IndexCount / 3, lods[i].Error);
+	for (unsigned int i = 0; i < submeshCount; i++)
+		printf("\n  submesh %u: \"%s\", %u triangles", i, submeshes[i].Material, submeshes[i].IndexCount / 3);
+#endif
+
+	// Split each level into clusters if asked to
+	// - Clusters are just runs of each level's indices, so they
+	//    don't change the index buffer at all
+	// - Each submesh is split on its own, so a cluster only ever
+	//    uses one material
+	if (clustered)
+	{
+		std::vector<MeshCluster> submeshClusters;
+		for (size_t i = 0; i < lods.size(); i++)
 		{
-			// Read the face indices into an array
-			unsigned int i[12];
-			int facesRead = sscanf_s(
-				chars,
-				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-				&i[0], &i[1], &i[2],
-				&i[3], &i[4], &i[5],
-				&i[6], &i[7], &i[8],
-				&i[9], &i[10], &i[11]);
-
-			// - Create the verts by looking up
-			//    corresponding data from vectors
-			// - OBJ File indices are 1-based, so
-			//    they need to be adusted
-			Vertex v1;
-			v1.Position = positions[i[0] - 1];
-			v1.UV = uvs[i[1] - 1];
-			v1.Normal = normals[i[2] - 1];
-
-			Vertex v2;
-			v2.Position = positions[i[3] - 1];
-			v2.UV = uvs[i[4] - 1];
-			v2.Normal = normals[i[5] - 1];
-
-			Vertex v3;
-			v3.Position = positions[i[6] - 1];
-			v3.UV = uvs[i[7] - 1];
-			v3.Normal = normals[i[8] - 1];
-
-			// The model is most likely in a right-handed space,
-			// especially if it came from Maya.  We want to convert
-			// to a left-handed space for DirectX.  This means we 
-			// need to:
-			//  - Invert the Z position
-			//  - Invert the normal's Z
-			//  - Flip the winding order
-			// We also need to flip the UV coordinate since DirectX
-			// defines (0,0) as the top left of the texture, and many
-			// 3D modeling packages use the bottom left as (0,0)
-
-			// Flip the UV's since they're probably "upside down"
-			v1.UV.y = 1.0f - v1.UV.y;
-			v2.UV.y = 1.0f - v2.UV.y;
-			v3.UV.y = 1.0f - v3.UV.y;
-
-			// Flip Z (LH vs. RH)
-			v1.Position.z *= -1.0f;
-			v2.Position.z *= -1.0f;
-			v3.Position.z *= -1.0f;
-
-			// Flip normal Z
-			v1.Normal.z *= -1.0f;
-			v2.Normal.z *= -1.0f;
-			v3.Normal.z *= -1.0f;
-
-			// Add the verts to the vector (flipping the winding order)
-			verts.push_back(v1);
-			verts.push_back(v3);
-			verts.push_back(v2);
-
-			// Add three more indices
-			indices.push_back(vertCounter); vertCounter += 1;
-			indices.push_back(vertCounter); vertCounter += 1;
-			indices.push_back(vertCounter); vertCounter += 1;
-
-			// Was there a 4th face?
-			if (facesRead == 12)
+			unsigned int lodClusterCount = 0;
+			for (unsigned int s = 0; s < submeshCount; s++)
 			{
-				// Make the last vertex
-				Vertex v4;
-				v4.Position = positions[i[9] - 1];
-				v4.UV = uvs[i[10] - 1];
-				v4.Normal = normals[i[11] - 1];
-
-				// Flip the UV, Z pos and normal
-				v4.UV.y = 1.0f - v4.UV.y;
-				v4.Position.z *= -1.0f;
-				v4.Normal.z *= -1.0f;
-
-				// Add a whole triangle (flipping the winding order)
-				verts.push_back(v1);
-				verts.push_back(v4);
-				verts.push_back(v3);
-
-				// Add three more indices
-				indices.push_back(vertCounter); vertCounter += 1;
-				indices.push_back(vertCounter); vertCounter += 1;
-				indices.push_back(vertCounter); vertCounter += 1;
+				const MeshSubmesh& submesh = submeshes[i * submeshCount + s];
+				BuildClusters(&verts[0], &indices[0], submesh.FirstIndex, submesh.IndexCount, submeshClusters);
+				clusters.insert(clusters.end(), submeshClusters.begin(), submeshClusters.end());
+				lodClusterCount += (unsigned int)submeshClusters.size();
 			}
+
+#if defined(DEBUG) || defined(_DEBUG)
+			printf("\n  LOD %u: %u clusters", (unsigned int)i, lodClusterCount);
+#endif
 		}
 	}
+	FindLodClusters();
+
+	// - At this point, "verts" holds one Vertex per unique (position, uv, normal)
+	//    combination in the file, and "indices" references them three per triangle,
+	//    one level of detail after another
+	// - Corners shared between faces share a single vertex, and everything has been
+	//    ordered so the GPU's caches get as many hits as possible
+	// - Small meshes get 16 bit indices, and the cache stores whichever we pick
+	//    so the next load can hand it straight to the GPU too
+	DXGI_FORMAT indexFormat = ChooseIndexFormat((unsigned int)verts.size());
+	std::vector<unsigned short> shortIndices;
+	const void* indexData = PackIndices(&indices[0], (unsigned int)indices.size(), indexFormat, shortIndices);
+
+	CalculateBounds(&verts[0], VertexLayout<Vertex>::Stride, VertexLayout<Vertex>::PositionOffset, (unsigned int)verts.size());
+
+	// Squeeze the verts down to 16 bytes each if asked to
+	// - Positions are stored relative to the bounds, so those
+	//    have to be known first
+	std::vector<PackedVertex> packedVerts;
+	const void* vertexData = &verts[0];
+	if (format == VERTEX_FORMAT_PACKED)
+	{
+		packedVerts.resize(verts.size());
+		PackVertices(&verts[0], (unsigned int)verts.size(), boundsMin, boundsMax, &packedVerts[0]);
+		vertexData = &packedVerts[0];
+
+#if defined(DEBUG) || defined(_DEBUG)
+		PackingError error = MeasurePackingError(&verts[0], (unsigned int)verts.size(), boundsMin, boundsMax);
+		printf("\n  packed %u bytes -> %u bytes, max error: position %g, normal %.3f deg, uv %g",
+			(unsigned int)(verts.size() * sizeof(Vertex)), (unsigned int)(verts.size() * sizeof(PackedVertex)),
+			error.MaxPositionError, error.MaxNormalErrorDegrees, error.MaxUVError);
+#endif
+	}
 
-	// Close the file and create the actual buffers
-	obj.close();
+#if defined(DEBUG) || defined(_DEBUG)
+	// How much a depth-only pass saves by only binding the position stream
+	VertexStreamBandwidth bandwidth = MeasureStreamBandwidth(&indices[0], lods[0].IndexCount, verts.size(), format);
+	printf("\n  vertex fetch: depth pass %u bytes (interleaved %u), full pass %u bytes (interleaved %u)",
+		bandwidth.PositionBytes, bandwidth.InterleavedBytes,
+		bandwidth.SplitBytes, bandwidth.InterleavedBytes);
+#endif
+
+	// Positions go in one buffer and everything else in another, so passes
+	// that only need positions don't have to fetch the rest
+	// - The .meshbin keeps them split the same way, so the next load
+	//    can hand them to the pool without touching them
+	std::vector<char> streams[VERTEX_STREAM_COUNT];
+	const void* streamData[VERTEX_STREAM_COUNT] = {};
+	SplitVertexStreams(vertexData, format, (unsigned int)verts.size(), streams);
+	for (int s = 0; s < VERTEX_STREAM_COUNT; s++)
+		streamData[s] = streams[s].empty() ? 0 : &streams[s][0];
+
+	CreateBuffers(streamData, format, (unsigned int)verts.size(), indexData, indexFormat, (unsigned int)indices.size());
+
+	// Save the results for next time (it's fine if this fails, we'll just parse again)
+	if (!sourceStamp)
+		return;
+	std::string cacheFilename = GetMeshCacheFilename(filename, format, flags, MESHBIN_EXTENSION);
+	WriteMeshBinary(
+		cacheFilename.c_str(), *sourceStamp, sourceHash, flags,
+		streamData, format, (unsigned int)verts.size(),
+		indexData, indexFormat, (unsigned int)indices.size(),
+		&lods[0], (unsigned int)lods.size(),
+		&submeshes[0], submeshCount,
+		clusters.empty() ? 0 : &clusters[0], (unsigned int)clusters.size(),
+		progressive ? &progressiveData : 0,
+		materialLibraries.empty() ? std::string() : materialLibraries[0],
+		boundsMin, boundsMax);
+
+	// And a compressed copy, which is what gets shipped instead of the model
+	// (.meshz files have nowhere to keep splits, so progressive meshes don't get one)
+	if (progressive)
+		return;
+	std::string compressedFilename = GetMeshCacheFilename(filename, format, clustered ? MESHBIN_FLAG_CLUSTERED : 0, MESHZ_EXTENSION);
+	WriteMeshCompressed(
+		compressedFilename.c_str(),
+		vertexData, format, (unsigned int)verts.size(),
+		&indices[0], indexFormat, (unsigned int)indices.size(),
+		&lods[0], (unsigned int)lods.size(),
+		&submeshes[0], submeshCount,
+		clusters.empty() ? 0 : &clusters[0], (unsigned int)clusters.size(),
+		materialLibraries.empty() ? std::string() : materialLibraries[0],
+		boundsMin, boundsMax);
+}
 
+Mesh::~Mesh()
+{
+	// Give our space in the shared buffers back
+	pool->Free(geometry);
+	delete progressive;
+	delete bvh;
+}
 
-	// - At this point, "verts" is a vector of Vertex structs, and can be used
-	//    directly to create a vertex buffer:  &verts[0] is the address of the first vert
-	//
-	// - The vector "indices" is similar. It's a vector of unsigned ints and
-	//    can be used directly for the index buffer: &indices[0] is the address of the first int
-	//
-	// - "vertCounter" is BOTH the number of vertices and the number of indices
-	// - Yes, the indices are a bit redundant here (one per vertex).  Could you skip using
-	//    an index buffer in this case?  Sure!  Though, if your mesh class assumes you have
-	//    one, you'll need to write some extra code to handle cases when you don't.
+// --------------------------------------------------------
+// Refines or coarsens a progressive mesh to fit a budget
+//
+// - Only the indices the splits changed are uploaded, and the
+//    single level of detail shrinks or grows to match
+//
+// triangles - The most triangles to draw (the base mesh is
+//              drawn even if it has more)
+// --------------------------------------------------------
+void Mesh::SetTargetTriangleCount(unsigned int triangles)
+{
+	if (!progressive)
+		return;
 
-	CreateBuffers(&verts[0], vertCounter, &indices[0], vertCounter, device);
+	progressive->SetTargetTriangleCount(triangles);
+	UploadProgressiveIndices();
+	lods[0].IndexCount = progressive->GetIndexCount();
+	lods[0].Error = progressive->GetError();
+	submeshes[0].IndexCount = lods[0].IndexCount;
 }
 
-Mesh::~Mesh()
+void Mesh::UploadProgressiveIndices()
+{
+	unsigned int first, count;
+	if (!progressive->GetDirtyRange(first, count))
+		return;
+
+	std::vector<unsigned short> shortIndices;
+	const void* data = PackIndices(progressive->GetIndices() + first, count, indexFormat, shortIndices);
+	pool->UpdateIndices(geometry, first, count, data);
+	progressive->ClearDirtyRange();
+}
+
+// --------------------------------------------------------
+// Loads a mesh from its .meshbin file, if it's up to date
+//
+// cacheFilename - The .meshbin to try
+// filename      - The model it was built from
+// sourceStamp   - The model's size and last-write time
+// sourceHash    - HashBytes() of the model, or null to only
+//                  accept a .meshbin with the same stamp
+//
+// Returns false, leaving the mesh empty, if the .meshbin is
+// missing, broken, out of date or was built differently
+// --------------------------------------------------------
+bool Mesh::LoadBinary(const char* cacheFilename, const char* filename, const FileStamp& sourceStamp, const unsigned long long* sourceHash, VertexFormat format, bool clustered, bool progressive)
 {
-	// Release the DirectX Buffers
-	if (vertexBuffer) { vertexBuffer->Release(); }
-	if (indexBuffer) { indexBuffer->Release(); }
-}
-
-void Mesh::CreateBuffers(Vertex* vertices, unsigned int numVerts, unsigned int* indices, unsigned int numIndices, ID3D11Device* device)
-{
-	// Create the VERTEX BUFFER description -----------------------------------
-	// - The description is created on the stack because we only need
-	//    it to create the buffer.  The description is then useless.
-	D3D11_BUFFER_DESC vbd;
-	vbd.Usage = D3D11_USAGE_IMMUTABLE;
-	vbd.ByteWidth = sizeof(Vertex) * numVerts;       // 3 = number of vertices in the buffer
-	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER; // Tells DirectX this is a vertex buffer
-	vbd.CPUAccessFlags = 0;
-	vbd.MiscFlags = 0;
-	vbd.StructureByteStride = 0;
-
-	// Create the proper struct to hold the initial vertex data
-	// - This is how we put the initial data into the buffer
-	D3D11_SUBRESOURCE_DATA initialVertexData;
-	initialVertexData.pSysMem = vertices;
-
-	// Actually create the buffer with the initial data
-	// - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
-	device->CreateBuffer(&vbd, &initialVertexData, &vertexBuffer);
-
-
-	// Create the INDEX BUFFER description ------------------------------------
-	// - The description is created on the stack because we only need
-	//    it to create the buffer.  The description is then useless.
-	D3D11_BUFFER_DESC ibd;
-	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	ibd.ByteWidth = sizeof(unsigned int) * numIndices;         // 3 = number of indices in the buffer
-	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER; // Tells DirectX this is an index buffer
-	ibd.CPUAccessFlags = 0;
-	ibd.MiscFlags = 0;
-	ibd.StructureByteStride = 0;
-
-	// Create the proper struct to hold the initial index data
-	// - This is how we put the initial data into the buffer
-	D3D11_SUBRESOURCE_DATA initialIndexData;
-	initialIndexData.pSysMem = indices;
-
-	// Actually create the buffer with the initial data
-	// - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
-	device->CreateBuffer(&ibd, &initialIndexData, &indexBuffer);
-
-	// Make sure to set the index count, for reference while drawing
+	MeshBinaryFile cache(cacheFilename);
+	if (!cache.Matches(sourceStamp, sourceHash, format, clustered, progressive))
+		return false;
+
+	const MeshBinaryHeader& header = cache.GetHeader();
+	boundsMin = header.BoundsMin;
+	boundsMax = header.BoundsMax;
+	lods.assign(cache.GetLods(), cache.GetLods() + header.LodCount);
+	SetSubmeshes(cache.GetSubmeshes(), header.SubmeshCount, filename, cache.GetMaterialLibrary());
+	clusters.assign(cache.GetClusters(), cache.GetClusters() + header.ClusterCount);
+	FindLodClusters();
+
+	// The file's vertex streams are laid out just as the pool holds them, so they go straight from the mapping
+	const void* streams[VERTEX_STREAM_COUNT];
+	for (int s = 0; s < VERTEX_STREAM_COUNT; s++)
+		streams[s] = cache.GetVertexStream((VertexStream)s);
+	CreateBuffers(streams, cache.GetVertexFormat(), header.VertexCount, cache.GetIndices(), cache.GetIndexFormat(), header.IndexCount);
+
+	// Progressive meshes also need their own copy of the indices to change, which is made straight from the mapping too
+	if (header.BaseTriangleCount > 0)
+	{
+		ProgressiveMeshData data;
+		cache.GetProgressiveData(data);
+		if (header.IndexStride == sizeof(unsigned short))
+			this->progressive = new ProgressiveMesh(data, (const unsigned short*)cache.GetIndices(), header.IndexCount);
+		else
+			this->progressive = new ProgressiveMesh(data, (const unsigned int*)cache.GetIndices(), header.IndexCount);
+	}
+
+#if defined(DEBUG) || defined(_DEBUG)
+	printf("\n%s: %u verts loaded from %s", filename, header.VertexCount, cacheFilename);
+#endif
+	return true;
+}
+
+// --------------------------------------------------------
+// Loads a mesh from a .meshz file
+//
+// - The file holds exactly what the .meshbin would, so once
+//    it's decoded it goes to the GPU the same way
+// --------------------------------------------------------
+void Mesh::LoadCompressed(const char* filename)
+{
+#if defined(DEBUG) || defined(_DEBUG)
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+#endif
+
+	MeshCompressedFile file(filename);
+	if (!file.IsValid())
+		return;
+
+#if defined(DEBUG) || defined(_DEBUG)
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	printf("\n%s: %u verts decoded, %llu bytes -> %llu bytes (%.2fx) in %.3f ms (%.2f GB/s)",
+		filename, file.GetHeader().VertexCount,
+		file.GetFileSize(), file.GetDecodedSize(), (double)file.GetDecodedSize() / file.GetFileSize(),
+		seconds * 1000.0, seconds > 0 ? file.GetDecodedSize() / seconds / 1e9 : 0.0);
+#endif
+
+	const MeshCompressedHeader& header = file.GetHeader();
+	boundsMin = header.BoundsMin;
+	boundsMax = header.BoundsMax;
+	lods.assign(file.GetLods(), file.GetLods() + header.LodCount);
+	SetSubmeshes(file.GetSubmeshes(), header.SubmeshCount, filename, file.GetMaterialLibrary());
+	clusters.assign(file.GetClusters(), file.GetClusters() + header.ClusterCount);
+	FindLodClusters();
+	CreateBuffers(file.GetVertices(), file.GetVertexFormat(), header.VertexCount, file.GetIndices(), file.GetIndexFormat(), header.IndexCount);
+}
+
+// --------------------------------------------------------
+// Keeps the submeshes from a .meshbin or .meshz file
+//
+// submeshCount    - How many each level of detail has (the
+//                    levels have to be loaded already)
+// filename        - The file they came from, which sits next
+//                    to the model
+// materialLibrary - The material library, as the model named it
+// --------------------------------------------------------
+void Mesh::SetSubmeshes(const MeshSubmesh* submeshes, unsigned int submeshCount, const char* filename, const std::string& materialLibrary)
+{
+	this->submeshes.assign(submeshes, submeshes + lods.size() * submeshCount);
+	this->submeshCount = submeshCount;
+	this->materialLibrary = ResolveModelPath(filename, materialLibrary);
+}
+
+unsigned long long Mesh::GetBufferBytes()
+{
+	unsigned long long indexStride = indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(unsigned short) : sizeof(unsigned int);
+	return (unsigned long long)vertexCount * GetVertexStride() + (unsigned long long)indexCount * indexStride;
+}
+
+// --------------------------------------------------------
+// Picks the index buffer format for a mesh
+//
+// - Any mesh with 65,536 or fewer verts can be indexed with
+//    16 bit indices, which halves the size of the index buffer
+// --------------------------------------------------------
+DXGI_FORMAT Mesh::ChooseIndexFormat(unsigned int numVerts)
+{
+	return numVerts <= 0x10000 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+}
+
+// --------------------------------------------------------
+// Gets 32 bit indices into the given format
+//
+// indices      - The original 32 bit indices
+// format       - DXGI_FORMAT_R16_UINT or DXGI_FORMAT_R32_UINT
+// shortIndices - Storage for the converted indices, if needed
+//
+// Returns a pointer to the indices in the requested format
+// --------------------------------------------------------
+const void* Mesh::PackIndices(const unsigned int* indices, unsigned int numIndices, DXGI_FORMAT format, std::vector<unsigned short>& shortIndices)
+{
+	if (format != DXGI_FORMAT_R16_UINT)
+		return indices;
+
+	shortIndices.resize(numIndices);
+	for (unsigned int i = 0; i < numIndices; i++)
+		shortIndices[i] = (unsigned short)indices[i];
+	return numIndices ? &shortIndices[0] : 0;
+}
+
+void Mesh::CreateBuffers(const void* vertices, VertexFormat vertexFormat, unsigned int numVerts, const unsigned int* indices, unsigned int numIndices)
+{
+	// Use the smallest index format we can
+	DXGI_FORMAT format = ChooseIndexFormat(numVerts);
+	std::vector<unsigned short> shortIndices;
+	const void* indexData = PackIndices(indices, numIndices, format, shortIndices);
+
+	CreateBuffers(vertices, vertexFormat, numVerts, indexData, format, numIndices);
+}
+
+void Mesh::CreateBuffers(const void* vertices, VertexFormat vertexFormat, unsigned int numVerts, const void* indices, DXGI_FORMAT indexFormat, unsigned int numIndices)
+{
+	// Positions go in one buffer and everything else in another, so passes
+	// that only need positions don't have to fetch the rest
+	std::vector<char> streams[VERTEX_STREAM_COUNT];
+	const void* streamData[VERTEX_STREAM_COUNT] = {};
+	SplitVertexStreams(vertices, vertexFormat, numVerts, streams);
+	for (int s = 0; s < VERTEX_STREAM_COUNT; s++)
+		streamData[s] = streams[s].empty() ? 0 : &streams[s][0];
+
+	CreateBuffers(streamData, vertexFormat, numVerts, indices, indexFormat, numIndices);
+}
+
+void Mesh::CreateBuffers(const void* const* vertexStreams, VertexFormat vertexFormat, unsigned int numVerts, const void* indices, DXGI_FORMAT indexFormat, unsigned int numIndices)
+{
+	// Copy the data into the pool's shared buffers
+	// - Once we do this, we'll NEVER CHANGE THE DATA AGAIN (though the pool may move it)
+	geometry = pool->Allocate(vertexStreams, vertexFormat, numVerts, indices, indexFormat, numIndices);
+
+	// Make sure to set the index count and format, for reference while drawing
 	indexCount = numIndices;
+	this->indexFormat = indexFormat;
+	this->vertexFormat = vertexFormat;
+	vertexCount = numVerts;
+}
+
+bool Mesh::ReadGeometry(std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	std::vector<char> streams[VERTEX_STREAM_COUNT];
+	std::vector<char> indexData;
+	if (!pool->ReadBack(geometry, streams, indexData))
+		return false;
+
+	// Put the streams back together, and unpack them if need be
+	verts.resize(vertexCount);
+	if (vertexFormat == VERTEX_FORMAT_PACKED)
+	{
+		std::vector<PackedVertex> packed(vertexCount);
+		if (vertexCount > 0)
+			MergeVertexStreams(streams, vertexFormat, vertexCount, &packed[0]);
+		for (int i = 0; i < vertexCount; i++)
+			verts[i] = UnpackVertex(packed[i], boundsMin, boundsMax);
+	}
+	else if (vertexCount > 0)
+		MergeVertexStreams(streams, vertexFormat, vertexCount, &verts[0]);
+
+	indices.resize(indexCount);
+	for (int i = 0; i < indexCount; i++)
+	{
+		indices[i] = indexFormat == DXGI_FORMAT_R16_UINT ?
+			((const unsigned short*)&indexData[0])[i] :
+			((const unsigned int*)&indexData[0])[i];
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Builds the mesh's ray casting tree, if it doesn't have one
+//
+// - The geometry has to come back from the GPU, since the
+//    mesh keeps no copy of its own (and packed vertices are
+//    unpacked, so the tree matches what's drawn)
+// - Only the finest level of detail goes in the tree, and its
+//    triangles are numbered from that level's first index
+// --------------------------------------------------------
+bool Mesh::BuildBvh()
+{
+	if (bvh)
+		return true;
+
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	if (lods.empty() || !ReadGeometry(verts, indices) || verts.empty() || lods[0].IndexCount == 0)
+		return false;
+
+	bvh = new MeshBvh(&verts[0], &indices[lods[0].FirstIndex], lods[0].IndexCount);
+	return true;
+}
+
+void Mesh::CalculateBounds(const void* vertices, unsigned int stride, unsigned int positionOffset, unsigned int numVerts)
+{
+	if (numVerts == 0)
+	{
+		boundsMin = boundsMax = XMFLOAT3(0, 0, 0);
+		return;
+	}
+
+	// Grow the box around each vertex in turn
+	const char* position = (const char*)vertices + positionOffset;
+	XMVECTOR minV = XMLoadFloat3((const XMFLOAT3*)position);
+	XMVECTOR maxV = minV;
+	for (unsigned int i = 1; i < numVerts; i++)
+	{
+		XMVECTOR pos = XMLoadFloat3((const XMFLOAT3*)(position + i * stride));
+		minV = XMVectorMin(minV, pos);
+		maxV = XMVectorMax(maxV, pos);
+	}
+
+	XMStoreFloat3(&boundsMin, minV);
+	XMStoreFloat3(&boundsMax, maxV);
+}
+
+// --------------------------------------------------------
+// Works out where each level of detail's clusters start
+//
+// - Clusters never cross from one level into the next, and
+//    they're stored in index buffer order, so each level's
+//    clusters are one run of the array
+// --------------------------------------------------------
+void Mesh::FindLodClusters()
+{
+	lodClusterStarts.assign(lods.size() + 1, 0);
+
+	unsigned int c = 0;
+	for (size_t i = 0; i < lods.size(); i++)
+	{
+		lodClusterStarts[i] = c;
+		while (c < clusters.size() && clusters[c].FirstIndex < lods[i].FirstIndex + lods[i].IndexCount)
+			c++;
+	}
+	lodClusterStarts[lods.size()] = c;
+}
+
+// --------------------------------------------------------
+// Checks index formats are picked, packed and cached right
+// on either side of the 16 bit limit
+//
+// - Each mesh's triangles touch its first and last vertices
+//    (65,535 is the biggest index 16 bits can hold, so 65,536
+//    vertices is the most that still fit)
+// - The packed indices have to read back unchanged, both
+//    straight away and from a .meshbin written with them
+//    (as do the vertex streams written alongside them)
+// --------------------------------------------------------
+bool CheckIndexFormats()
+{
+	static const unsigned int vertexCounts[] = { 3, 65535, 65536, 65537, 100000 };
+	const char* filename = "./IndexFormatCheck" MESHBIN_EXTENSION;
+	bool passed = true;
+
+	printf("\nIndex formats:");
+	for (int c = 0; c < 5; c++)
+	{
+		unsigned int numVerts = vertexCounts[c];
+		std::vector<Vertex> verts(numVerts, Vertex());
+		std::vector<unsigned int> indices;
+		for (unsigned int v = 0; v + 2 < numVerts; v += 997)
+		{
+			indices.push_back(v);
+			indices.push_back(v + 1);
+			indices.push_back(numVerts - 1);
+		}
+
+		DXGI_FORMAT format = Mesh::ChooseIndexFormat(numVerts);
+		DXGI_FORMAT expected = numVerts <= 65536 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+		std::vector<unsigned short> shortIndices;
+		const void* packed = Mesh::PackIndices(&indices[0], (unsigned int)indices.size(), format, shortIndices);
+
+		bool packedOk = true;
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			unsigned int index = format == DXGI_FORMAT_R16_UINT ? ((const unsigned short*)packed)[i] : ((const unsigned int*)packed)[i];
+			packedOk = packedOk && index == indices[i];
+		}
+
+		// Round trip them through a cache file, along with vertex streams that can be told apart
+		for (unsigned int v = 0; v < numVerts; v++)
+			verts[v].Position.x = verts[v].UV.y = (float)v;
+		std::vector<char> streams[VERTEX_STREAM_COUNT];
+		SplitVertexStreams(&verts[0], VERTEX_FORMAT_FULL, numVerts, streams);
+		const void* streamData[VERTEX_STREAM_COUNT] = { &streams[VERTEX_STREAM_POSITION][0], &streams[VERTEX_STREAM_ATTRIBUTES][0] };
+
+		bool cachedOk = false;
+		FileStamp stamp = {};
+		MeshLod lod = { 0, (unsigned int)indices.size(), 0.0f };
+		MeshSubmesh submesh = { 0, (unsigned int)indices.size(), "" };
+		if (WriteMeshBinary(filename, stamp, 0, 0, streamData, VERTEX_FORMAT_FULL, numVerts, packed, format, (unsigned int)indices.size(),
+			&lod, 1, &submesh, 1, 0, 0, 0, "", XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 0)))
+		{
+			MeshBinaryFile cache(filename);
+			cachedOk = cache.IsValid() && cache.GetIndexFormat() == format && cache.GetHeader().IndexCount == indices.size();
+			for (size_t i = 0; cachedOk && i < indices.size(); i++)
+			{
+				unsigned int index = format == DXGI_FORMAT_R16_UINT ? ((const unsigned short*)cache.GetIndices())[i] : ((const unsigned int*)cache.GetIndices())[i];
+				cachedOk = index == indices[i];
+			}
+			for (int s = 0; cachedOk && s < VERTEX_STREAM_COUNT; s++)
+				cachedOk = memcmp(cache.GetVertexStream((VertexStream)s), &streams[s][0], streams[s].size()) == 0;
+		}
+		remove(filename);
+
+		bool ok = format == expected && packedOk && cachedOk;
+		printf("\n  %u verts: %s indices, %s", numVerts, format == DXGI_FORMAT_R16_UINT ? "16 bit" : "32 bit",
+			format != expected ? "FAILED (wrong format)" : !packedOk ? "FAILED (packing)" : !cachedOk ? "FAILED (cache file)" : "ok");
+		passed = passed && ok;
+	}
+	return passed;
 }
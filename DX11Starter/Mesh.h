@@ -3,6 +3,14 @@
 #include <d3d11.h>
 #include <DirectXMath.h>
 #include "Vertex.h"
+#include "VertexLayout.h"
+#include "MeshSimplifier.h"
+#include "MeshClusters.h"
+#include "ProgressiveMesh.h"
+#include "MeshBvh.h"
+#include "GeometryPool.h"
+#include "ObjLoader.h"
+#include "MappedFile.h"
 #include <string>
 #include <vector>
 #include <fstream>
@@ -12,27 +20,172 @@ using namespace DirectX;
 // --------------------------------------------------------
 // A custom mesh definition
 //
+// - The mesh's vertices and indices live in a GeometryPool's
+//    shared buffers, so a Mesh is really just where its data is
+//    in those buffers (plus what it knows about that data)
 // --------------------------------------------------------
 class Mesh
 {
 public:
-	Mesh(Vertex* vertices, unsigned int numVerts, unsigned int* indices, unsigned int numIndices, ID3D11Device* device);
-	Mesh(char* filename, ID3D11Device * device);
+	// Makes a mesh from arrays of any vertex type with VertexTraits (see VertexLayout.h)
+	// - Its position has to be 3 floats, since that's what the bounds are worked out from
+	template<typename VertexT>
+	Mesh(const VertexT* vertices, unsigned int numVerts, const unsigned int* indices, unsigned int numIndices, GeometryPool* pool)
+	{
+		static_assert(VertexLayout<VertexT>::PositionFormat == DXGI_FORMAT_R32G32B32_FLOAT, "Meshes made from arrays need float3 positions");
+		CreateFromArrays(vertices, VertexLayout<VertexT>::Format, VertexLayout<VertexT>::Stride, VertexLayout<VertexT>::PositionOffset, numVerts, indices, numIndices, pool);
+	}
+	Mesh(const char* filename, GeometryPool* pool, VertexFormat format = VERTEX_FORMAT_FULL, bool clustered = false, bool progressive = false);
+	Mesh(std::vector<Vertex>& verts, std::vector<unsigned int>& indices, GeometryPool* pool, VertexFormat format = VERTEX_FORMAT_FULL, bool clustered = false, bool progressive = false);
 	~Mesh();
 
+	// Meshes own their place in the pool (and their progressive mesh and tree), so they can't be copied
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+
 	// Get accessors that allow Meshes to retrieve the pointer to their buffers so they can be drawn
-	ID3D11Buffer* GetVertexBuffer() { return vertexBuffer; }
-	ID3D11Buffer* GetIndexBuffer() { return indexBuffer; }
+	// (these are shared with every other mesh in the same formats)
+	// - There's a vertex buffer per VertexStream, and a depth-only pass only needs the position one
+	ID3D11Buffer* GetVertexBuffer(VertexStream stream) { return pool->GetVertexBuffer(vertexFormat, stream); }
+	ID3D11Buffer* GetIndexBuffer() { return pool->GetIndexBuffer(indexFormat); }
 	int GetIndexCount() { return indexCount; }
+
+	// Where the mesh's data starts in those buffers, for DrawIndexed()
+	// (level of detail and cluster index ranges are relative to GetFirstIndex())
+	UINT GetBaseVertex() { return pool->GetBaseVertex(geometry); }
+	UINT GetFirstIndex() { return pool->GetFirstIndex(geometry); }
+	int GetVertexCount() { return vertexCount; }
+
+	// The layout of the vertex buffers, and the size of each vertex in them for IASetVertexBuffers()
+	VertexFormat GetVertexFormat() { return vertexFormat; }
+	UINT GetVertexStride(VertexStream stream) { return ::GetVertexStreamStride(vertexFormat, stream); }
+	UINT GetVertexStride() { return ::GetVertexStride(vertexFormat); }
+
+	// The format of the index buffer (16 or 32 bit), for IASetIndexBuffer()
+	DXGI_FORMAT GetIndexFormat() { return indexFormat; }
+
+	// How much GPU memory the vertex and index buffers take up
+	unsigned long long GetBufferBytes();
+
+	// Copies the vertices (unpacked, if they're packed) and every level of detail's indices back from the GPU
+	// (slow, since it waits on the GPU, so only for work done once, like building static batches)
+	bool ReadGeometry(std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+
+	// Picks the smallest index format that can address the given number of vertices
+	static DXGI_FORMAT ChooseIndexFormat(unsigned int numVerts);
+
+	// Gets the index data in the given format, converting into "shortIndices" if it needs to be 16 bit
+	static const void* PackIndices(const unsigned int* indices, unsigned int numIndices, DXGI_FORMAT format, std::vector<unsigned short>& shortIndices);
+
+	// The mesh's levels of detail, finest first, each a range of the index buffer
+	// (meshes made from arrays have just the one, and a model that couldn't be loaded has none)
+	unsigned int GetLodCount() { return (unsigned int)lods.size(); }
+	const MeshLod* GetLods() { return lods.empty() ? 0 : &lods[0]; }
+
+	// The parts of one level of detail that use each material, in index buffer order
+	// (every level has the same number, in the same order, and meshes made from arrays have just the one)
+	unsigned int GetSubmeshCount() { return submeshCount; }
+	const MeshSubmesh* GetSubmeshes(unsigned int lod) { return submeshes.empty() ? 0 : &submeshes[lod * submeshCount]; }
+
+	// The .mtl file the model named, relative to the working directory ("" if it didn't name one)
+	const std::string& GetMaterialLibrary() { return materialLibrary; }
+
+	// The clusters that make up one level of detail, in index buffer order
+	// (none unless the mesh was loaded with clusters, and they never cross from one submesh into the next)
+	bool HasClusters() { return !clusters.empty(); }
+	unsigned int GetClusterCount(unsigned int lod) { return clusters.empty() ? 0 : lodClusterStarts[lod + 1] - lodClusterStarts[lod]; }
+	const MeshCluster* GetClusters(unsigned int lod) { return clusters.empty() ? 0 : &clusters[lodClusterStarts[lod]]; }
+
+	// Moves a progressive mesh to the finest level with at most this many triangles, uploading
+	// just the indices that changed (does nothing for other meshes)
+	bool IsProgressive() { return progressive != 0; }
+	void SetTargetTriangleCount(unsigned int triangles);
+	unsigned int GetTriangleCount() { return lods.empty() ? 0 : lods[0].IndexCount / 3; }
+
+	// Builds a tree of the finest level's triangles (see MeshBvh.h), which the mesh keeps for ray casts
+	// (slow, like ReadGeometry(), so it's only done for meshes that ask, and only once)
+	bool BuildBvh();
+	MeshBvh* GetBvh() { return bvh; }
+
+	// Get accessors for the mesh's axis-aligned bounding box (in model space)
+	XMFLOAT3 GetBoundsMin() { return boundsMin; }
+	XMFLOAT3 GetBoundsMax() { return boundsMax; }
 private:
-	// Buffers to hold actual geometry data
-	ID3D11Buffer* vertexBuffer;
-	ID3D11Buffer* indexBuffer;
+	// The pool holding the actual geometry data, and where it is in there
+	GeometryPool* pool;
+	GeometryAllocation geometry;
 
-	// Number of indices in the mesh's index buffer
+	// Number of indices in the mesh's index buffer (across every level of detail)
 	int indexCount;
 
-	// Helper method that creates the index and vertex buffers
-	void CreateBuffers(Vertex* vertices, unsigned int numVerts, unsigned int* indices, unsigned int numIndices, ID3D11Device* device);
+	// Whether the vertex buffer holds full or packed vertices
+	VertexFormat vertexFormat;
+
+	// Whether the index buffer holds 16 or 32 bit indices
+	DXGI_FORMAT indexFormat;
+
+	// Number of (unique) vertices in the mesh's vertex buffer
+	int vertexCount;
+
+	// Where each level of detail's indices are
+	std::vector<MeshLod> lods;
+
+	// Where each level's materials' indices are (submeshCount per level, one level after another),
+	// and where those materials are defined
+	std::vector<MeshSubmesh> submeshes;
+	unsigned int submeshCount;
+	std::string materialLibrary;
+
+	// Small pieces of every level of detail that can be culled on their own,
+	// and where each level's clusters start (with an extra entry for the end)
+	std::vector<MeshCluster> clusters;
+	std::vector<unsigned int> lodClusterStarts;
+
+	// The CPU copy of a progressive mesh's indices, and its splits (null for other meshes)
+	ProgressiveMesh* progressive;
+
+	// The tree for ray casts (null until BuildBvh() is called)
+	MeshBvh* bvh;
+
+	// Corners of the box surrounding every vertex
+	XMFLOAT3 boundsMin;
+	XMFLOAT3 boundsMax;
+
+	// Helper method that does the work of the array constructor, once the vertex type's been boiled down to its layout
+	void CreateFromArrays(const void* vertices, VertexFormat vertexFormat, unsigned int stride, unsigned int positionOffset, unsigned int numVerts, const unsigned int* indices, unsigned int numIndices, GeometryPool* pool);
+
+	// Helper methods that put the vertices and indices in the pool
+	// (the first picks the index format, the second takes vertices and indices already in their final formats,
+	// and splits the vertices into their streams, and the third takes vertices that are already split)
+	void CreateBuffers(const void* vertices, VertexFormat vertexFormat, unsigned int numVerts, const unsigned int* indices, unsigned int numIndices);
+	void CreateBuffers(const void* vertices, VertexFormat vertexFormat, unsigned int numVerts, const void* indices, DXGI_FORMAT indexFormat, unsigned int numIndices);
+	void CreateBuffers(const void* const* vertexStreams, VertexFormat vertexFormat, unsigned int numVerts, const void* indices, DXGI_FORMAT indexFormat, unsigned int numIndices);
+
+	// Helper method that does everything after a model file's been parsed and welded
+	void BuildFromGeometry(std::vector<Vertex>& verts, std::vector<unsigned int>& indices, const std::vector<ObjMaterialRun>& materialRuns, const std::vector<std::string>& materialLibraries,
+		VertexFormat format, bool clustered, bool progressive, const char* filename, const FileStamp* sourceStamp, unsigned long long sourceHash);
+
+	// Helper method that loads everything from a model's .meshbin file, if it's up to date
+	bool LoadBinary(const char* cacheFilename, const char* filename, const FileStamp& sourceStamp, const unsigned long long* sourceHash, VertexFormat format, bool clustered, bool progressive);
+
+	// Helper method that loads everything from a compressed .meshz file
+	void LoadCompressed(const char* filename);
+
+	// Helper method that keeps the submeshes and material library, as stored in a model's cache files
+	void SetSubmeshes(const MeshSubmesh* submeshes, unsigned int submeshCount, const char* filename, const std::string& materialLibrary);
+
+	// Helper method that copies a progressive mesh's changed indices into the pool
+	void UploadProgressiveIndices();
+
+	// Helper method that finds the bounding box of the given vertices
+	// (each "stride" bytes apart, with a float3 position "positionOffset" bytes in)
+	void CalculateBounds(const void* vertices, unsigned int stride, unsigned int positionOffset, unsigned int numVerts);
+
+	// Helper method that works out which clusters belong to each level of detail
+	void FindLodClusters();
 };
 
+
+// Checks the index format picked for meshes with 3, 65,535, 65,536, 65,537 and 100,000 vertices,
+// and that their indices survive packing and a .meshbin, printing the results.  Returns false if any fail.
+bool CheckIndexFormats();
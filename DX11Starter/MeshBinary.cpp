@@ -0,0 +1,522 @@
+#include "MeshBinary.h"
+#include "MeshCodec.h"
+#include <fstream>
+#include <cstring>
+#include <cstddef>
+#include <cstdio>
+
+// --------------------------------------------------------
+// Maps a .meshbin file and checks that it's usable
+//
+// filename - Path to the .meshbin file
+// --------------------------------------------------------
+MeshBinaryFile::MeshBinaryFile(const char* filename)
+	: file(filename)
+{
+	header = 0;
+
+	// Big enough to hold a header?
+	if (!file.IsOpen() || file.GetSize() < sizeof(MeshBinaryHeader))
+		return;
+
+	// Is it a file we know how to read?
+	const MeshBinaryHeader* h = (const MeshBinaryHeader*)file.GetData();
+	if (memcmp(h->Magic, "MBIN", 4) != 0 ||
+		h->Version != MESHBIN_VERSION ||
+		(h->VertexFormat != VERTEX_FORMAT_FULL && h->VertexFormat != VERTEX_FORMAT_PACKED) ||
+		h->VertexStride != GetVertexStride((VertexFormat)h->VertexFormat) ||
+		(h->IndexStride != sizeof(unsigned short) && h->IndexStride != sizeof(unsigned int)))
+		return;
+
+	// Does the file actually contain all of the data the header describes?
+	// (A half-written file from a crash will fail this)
+	unsigned long long positionEnd = h->VertexStreamOffsets[VERTEX_STREAM_POSITION] +
+		(unsigned long long)h->VertexCount * GetVertexStreamStride((VertexFormat)h->VertexFormat, VERTEX_STREAM_POSITION);
+	unsigned long long attributeEnd = h->VertexStreamOffsets[VERTEX_STREAM_ATTRIBUTES] +
+		(unsigned long long)h->VertexCount * GetVertexStreamStride((VertexFormat)h->VertexFormat, VERTEX_STREAM_ATTRIBUTES);
+	unsigned long long indexEnd = h->IndexOffset + (unsigned long long)h->IndexCount * h->IndexStride;
+	unsigned long long lodEnd = h->LodOffset + (unsigned long long)h->LodCount * sizeof(MeshLod);
+	unsigned long long clusterEnd = h->ClusterOffset + (unsigned long long)h->ClusterCount * sizeof(MeshCluster);
+	unsigned long long splitEnd = h->SplitOffset + (unsigned long long)h->SplitCount * sizeof(VertexSplit);
+	unsigned long long changeEnd = h->ChangeOffset + (unsigned long long)h->ChangeCount * sizeof(IndexChange);
+	unsigned long long submeshEnd = h->SubmeshOffset + (unsigned long long)h->LodCount * h->SubmeshCount * sizeof(MeshSubmesh);
+	unsigned long long materialLibraryEnd = h->MaterialLibraryOffset + h->MaterialLibraryLength;
+	if (positionEnd > file.GetSize() || attributeEnd > file.GetSize() || indexEnd > file.GetSize() || lodEnd > file.GetSize() || clusterEnd > file.GetSize() ||
+		splitEnd > file.GetSize() || changeEnd > file.GetSize() || submeshEnd > file.GetSize() || materialLibraryEnd > file.GetSize() ||
+		h->VertexStreamOffsets[VERTEX_STREAM_POSITION] % sizeof(float) != 0 ||
+		h->VertexStreamOffsets[VERTEX_STREAM_ATTRIBUTES] % sizeof(float) != 0 || h->IndexOffset % h->IndexStride != 0 || h->LodOffset % sizeof(float) != 0 ||
+		h->ClusterOffset % sizeof(float) != 0 || h->SplitOffset % sizeof(float) != 0 || h->ChangeOffset % sizeof(float) != 0 ||
+		h->SubmeshOffset % sizeof(float) != 0)
+		return;
+
+	// Every level of detail has to stay inside the index data
+	const MeshLod* lods = (const MeshLod*)(file.GetData() + h->LodOffset);
+	if (h->LodCount == 0)
+		return;
+	for (unsigned int i = 0; i < h->LodCount; i++)
+	{
+		if ((unsigned long long)lods[i].FirstIndex + lods[i].IndexCount > h->IndexCount)
+			return;
+	}
+
+	// And so does every submesh, which has to have a terminated name
+	const MeshSubmesh* submeshes = (const MeshSubmesh*)(file.GetData() + h->SubmeshOffset);
+	if (h->SubmeshCount == 0)
+		return;
+	for (unsigned int i = 0; i < h->LodCount * h->SubmeshCount; i++)
+	{
+		if ((unsigned long long)submeshes[i].FirstIndex + submeshes[i].IndexCount > h->IndexCount ||
+			!memchr(submeshes[i].Material, 0, SUBMESH_MAX_MATERIAL_NAME))
+			return;
+	}
+
+	// And so does every cluster
+	const MeshCluster* clusters = (const MeshCluster*)(file.GetData() + h->ClusterOffset);
+	for (unsigned int i = 0; i < h->ClusterCount; i++)
+	{
+		if ((unsigned long long)clusters[i].FirstIndex + clusters[i].IndexCount > h->IndexCount)
+			return;
+	}
+
+	// Every index has to point at a vertex, since they go to the GPU as they are
+	const void* indices = file.GetData() + h->IndexOffset;
+	for (unsigned int i = 0; i < h->IndexCount; i++)
+	{
+		unsigned int index = h->IndexStride == sizeof(unsigned short) ?
+			((const unsigned short*)indices)[i] :
+			((const unsigned int*)indices)[i];
+		if (index >= h->VertexCount)
+			return;
+	}
+
+	// And every split's changes have to stay inside the mesh
+	if ((unsigned long long)h->BaseTriangleCount * 3 > h->IndexCount || h->BaseVertexCount > h->VertexCount)
+		return;
+	const VertexSplit* splits = (const VertexSplit*)(file.GetData() + h->SplitOffset);
+	for (unsigned int i = 0; i < h->SplitCount; i++)
+	{
+		if ((unsigned long long)splits[i].FirstChange + splits[i].ChangeCount > h->ChangeCount ||
+			(unsigned long long)splits[i].TriangleCount * 3 > h->IndexCount || splits[i].VertexCount > h->VertexCount)
+			return;
+	}
+	const IndexChange* changes = (const IndexChange*)(file.GetData() + h->ChangeOffset);
+	for (unsigned int i = 0; i < h->ChangeCount; i++)
+	{
+		if (changes[i].Position >= h->IndexCount || changes[i].Fine >= h->VertexCount || changes[i].Coarse >= h->VertexCount)
+			return;
+	}
+
+	header = h;
+}
+
+// --------------------------------------------------------
+// Checks that the mapped file was built from the given
+// version of the source file, in the given vertex format,
+// and was asked for with the same clusters and splits
+// (a mesh asked to be progressive may not have ended up so)
+//
+// - Without "sourceHash", the size and modified time have to
+//    match, which is cheap since the source is never read
+// - With it, only the contents have to match, so a model
+//    that was copied or saved again without changing is still
+//    up to date
+// --------------------------------------------------------
+bool MeshBinaryFile::Matches(const FileStamp& sourceStamp, const unsigned long long* sourceHash, VertexFormat format, bool clustered, bool progressive)
+{
+	return
+		header &&
+		header->VertexFormat == (unsigned int)format &&
+		header->Flags == ((clustered ? MESHBIN_FLAG_CLUSTERED : 0) | (progressive ? MESHBIN_FLAG_PROGRESSIVE : 0)) &&
+		(sourceHash ?
+			header->SourceHash == *sourceHash :
+			header->SourceSize == sourceStamp.Size && header->SourceModifiedTime == sourceStamp.ModifiedTime);
+}
+
+void MeshBinaryFile::GetProgressiveData(ProgressiveMeshData& data)
+{
+	const VertexSplit* splits = (const VertexSplit*)(file.GetData() + header->SplitOffset);
+	const IndexChange* changes = (const IndexChange*)(file.GetData() + header->ChangeOffset);
+	data.BaseTriangleCount = header->BaseTriangleCount;
+	data.BaseVertexCount = header->BaseVertexCount;
+	data.BaseError = header->BaseError;
+	data.Splits.assign(splits, splits + header->SplitCount);
+	data.Changes.assign(changes, changes + header->ChangeCount);
+}
+
+// --------------------------------------------------------
+// A fast 64-bit hash (FNV-1a, eight bytes at a time)
+//
+// data - The memory to hash
+// size - How many bytes there are
+// --------------------------------------------------------
+unsigned long long HashBytes(const void* data, size_t size)
+{
+	const unsigned long long prime = 1099511628211ull;
+	unsigned long long hash = 14695981039346656037ull ^ size;
+
+	// Whole 8 byte words first
+	const unsigned char* bytes = (const unsigned char*)data;
+	size_t wordCount = size / sizeof(unsigned long long);
+	for (size_t i = 0; i < wordCount; i++)
+	{
+		unsigned long long word;
+		memcpy(&word, bytes + i * sizeof(word), sizeof(word));
+		hash = (hash ^ word) * prime;
+		hash ^= hash >> 32;
+	}
+
+	// Then whatever bytes are left over
+	for (size_t i = wordCount * sizeof(unsigned long long); i < size; i++)
+		hash = (hash ^ bytes[i]) * prime;
+
+	return hash;
+}
+
+// --------------------------------------------------------
+// Names the cache file for a model loaded with the given
+// options, like "helix.obj.packed.clustered.meshbin"
+//
+// - Each way of loading a model gets a file of its own, so
+//    loading it two ways doesn't rebuild and overwrite one
+//    file back and forth
+//
+// modelFilename - The model the file is built from
+// format        - The vertex format it's loaded in
+// flags         - MESHBIN_FLAG_ values for what was asked for
+// extension     - MESHBIN_EXTENSION or MESHZ_EXTENSION
+// --------------------------------------------------------
+std::string GetMeshCacheFilename(const char* modelFilename, VertexFormat format, unsigned int flags, const char* extension)
+{
+	std::string name(modelFilename);
+	name += format == VERTEX_FORMAT_PACKED ? ".packed" : ".full";
+	if (flags & MESHBIN_FLAG_CLUSTERED)
+		name += ".clustered";
+	if (flags & MESHBIN_FLAG_PROGRESSIVE)
+		name += ".progressive";
+	return name + extension;
+}
+
+// --------------------------------------------------------
+// Moves a finished temporary file into place, or deletes
+// it if it wasn't written completely
+//
+// out          - The (closed) stream it was written with
+// tempFilename - Where it was written
+// filename     - Where it belongs
+// --------------------------------------------------------
+static bool FinishTempFile(const std::ofstream& out, const std::string& tempFilename, const char* filename)
+{
+	if (out.good() && MoveFileOver(tempFilename.c_str(), filename))
+		return true;
+
+	remove(tempFilename.c_str());
+	return false;
+}
+
+// --------------------------------------------------------
+// Records a new size and modified time for the model a
+// .meshbin was built from, without touching anything else
+//
+// - For when the model's stamp changed but its contents
+//    didn't, so later loads can skip hashing it again
+// - Only call this once the file is no longer mapped
+// --------------------------------------------------------
+bool UpdateMeshBinaryStamp(const char* filename, const FileStamp& sourceStamp)
+{
+	std::fstream file(filename, std::ios::in | std::ios::out | std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	file.seekp(offsetof(MeshBinaryHeader, SourceSize));
+	file.write((const char*)&sourceStamp.Size, sizeof(sourceStamp.Size));
+	file.seekp(offsetof(MeshBinaryHeader, SourceModifiedTime));
+	file.write((const char*)&sourceStamp.ModifiedTime, sizeof(sourceStamp.ModifiedTime));
+	return file.good();
+}
+
+// --------------------------------------------------------
+// Writes a mesh's final vertices and indices to a .meshbin
+// file, so they can be mapped directly next time
+//
+// - It's written under a temporary name and then moved over
+//    the old file, so it's never seen half-written
+//
+// filename    - Where to write the file
+// sourceStamp - Size and modified time of the model it came from
+// sourceHash  - HashBytes() of the model's contents
+// flags       - MESHBIN_FLAG_ values for what was asked for
+// vertexStreams - The vertices, one array per VertexStream,
+//               exactly as they go to the GPU
+// vertexFormat - Whether they're split from Vertex or PackedVertex structs
+// indices     - The index array, exactly as it goes to the GPU
+// indexFormat - DXGI_FORMAT_R16_UINT or DXGI_FORMAT_R32_UINT
+// lods        - The range of the indices each level of detail uses
+// submeshes   - Each level's submeshes, one level after another
+//               ("numSubmeshes" is how many each level has)
+// clusters    - The mesh's clusters, if it has any
+// progressive - The mesh's splits, if it's progressive (null if not)
+// materialLibrary - The model's material library ("" if none)
+// boundsMin/Max - The mesh's axis-aligned bounding box
+//
+// Returns false if the file couldn't be written
+// --------------------------------------------------------
+bool WriteMeshBinary(
+	const char* filename,
+	const FileStamp& sourceStamp,
+	unsigned long long sourceHash,
+	unsigned int flags,
+	const void* const* vertexStreams, VertexFormat vertexFormat, unsigned int numVerts,
+	const void* indices, DXGI_FORMAT indexFormat, unsigned int numIndices,
+	const MeshLod* lods, unsigned int numLods,
+	const MeshSubmesh* submeshes, unsigned int numSubmeshes,
+	const MeshCluster* clusters, unsigned int numClusters,
+	const ProgressiveMeshData* progressive,
+	const std::string& materialLibrary,
+	DirectX::XMFLOAT3 boundsMin, DirectX::XMFLOAT3 boundsMax)
+{
+	// Write to a temporary file first, so a load can never map a half-written .meshbin
+	std::string tempFilename = std::string(filename) + MESH_TEMP_EXTENSION;
+	std::ofstream out(tempFilename.c_str(), std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+		return false;
+
+	// Set up the header, keeping the arrays 16-byte aligned
+	MeshBinaryHeader header = {};
+	memcpy(header.Magic, "MBIN", 4);
+	header.Version = MESHBIN_VERSION;
+	header.Flags = flags;
+	header.VertexFormat = vertexFormat;
+	header.VertexStride = GetVertexStride(vertexFormat);
+	header.IndexStride = indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(unsigned short) : sizeof(unsigned int);
+	header.SourceSize = sourceStamp.Size;
+	header.SourceModifiedTime = sourceStamp.ModifiedTime;
+	header.SourceHash = sourceHash;
+	header.VertexCount = numVerts;
+	header.IndexCount = numIndices;
+	header.LodCount = numLods;
+	header.ClusterCount = numClusters;
+	unsigned long long next = sizeof(MeshBinaryHeader);
+	for (int s = 0; s < VERTEX_STREAM_COUNT; s++)
+	{
+		header.VertexStreamOffsets[s] = (next + 15) & ~15ull;
+		next = header.VertexStreamOffsets[s] + (unsigned long long)numVerts * GetVertexStreamStride(vertexFormat, (VertexStream)s);
+	}
+	header.IndexOffset = (next + 15) & ~15ull;
+	header.LodOffset = (header.IndexOffset + (unsigned long long)numIndices * header.IndexStride + 15) & ~15ull;
+	header.ClusterOffset = (header.LodOffset + (unsigned long long)numLods * sizeof(MeshLod) + 15) & ~15ull;
+	if (progressive)
+	{
+		header.BaseTriangleCount = progressive->BaseTriangleCount;
+		header.BaseVertexCount = progressive->BaseVertexCount;
+		header.BaseError = progressive->BaseError;
+		header.SplitCount = (unsigned int)progressive->Splits.size();
+		header.ChangeCount = (unsigned int)progressive->Changes.size();
+	}
+	header.SplitOffset = (header.ClusterOffset + (unsigned long long)numClusters * sizeof(MeshCluster) + 15) & ~15ull;
+	header.ChangeOffset = (header.SplitOffset + (unsigned long long)header.SplitCount * sizeof(VertexSplit) + 15) & ~15ull;
+	header.SubmeshCount = numSubmeshes;
+	header.MaterialLibraryLength = (unsigned int)materialLibrary.size();
+	header.SubmeshOffset = (header.ChangeOffset + (unsigned long long)header.ChangeCount * sizeof(IndexChange) + 15) & ~15ull;
+	header.MaterialLibraryOffset = header.SubmeshOffset + (unsigned long long)numLods * numSubmeshes * sizeof(MeshSubmesh);
+	header.BoundsMin = boundsMin;
+	header.BoundsMax = boundsMax;
+
+	// Write everything, padding up to the start of each section
+	static const char padding[16] = {};
+	unsigned long long written = 0;
+	auto writeSection = [&](unsigned long long offset, const void* data, unsigned long long bytes)
+	{
+		if (bytes == 0)
+			return;
+		out.write(padding, (std::streamsize)(offset - written));
+		out.write((const char*)data, (std::streamsize)bytes);
+		written = offset + bytes;
+	};
+	writeSection(0, &header, sizeof(header));
+	for (int s = 0; s < VERTEX_STREAM_COUNT; s++)
+		writeSection(header.VertexStreamOffsets[s], vertexStreams[s], (unsigned long long)numVerts * GetVertexStreamStride(vertexFormat, (VertexStream)s));
+	writeSection(header.IndexOffset, indices, (unsigned long long)numIndices * header.IndexStride);
+	writeSection(header.LodOffset, lods, (unsigned long long)numLods * sizeof(MeshLod));
+	writeSection(header.ClusterOffset, clusters, (unsigned long long)numClusters * sizeof(MeshCluster));
+	if (progressive)
+	{
+		writeSection(header.SplitOffset, progressive->Splits.data(), (unsigned long long)header.SplitCount * sizeof(VertexSplit));
+		writeSection(header.ChangeOffset, progressive->Changes.data(), (unsigned long long)header.ChangeCount * sizeof(IndexChange));
+	}
+	writeSection(header.SubmeshOffset, submeshes, (unsigned long long)numLods * numSubmeshes * sizeof(MeshSubmesh));
+	writeSection(header.MaterialLibraryOffset, materialLibrary.data(), materialLibrary.size());
+
+	out.close();
+	return FinishTempFile(out, tempFilename, filename);
+}
+
+// --------------------------------------------------------
+// Reads a .meshz file and decodes it
+//
+// - Everything is checked before it's used: the header, the
+//    hash of the rest of the file, and that the compressed
+//    blocks decode to exactly the sizes the header says
+//
+// filename - Path to the .meshz file
+// --------------------------------------------------------
+MeshCompressedFile::MeshCompressedFile(const char* filename)
+{
+	valid = false;
+	fileSize = 0;
+	header = {};
+
+	MappedFile file(filename);
+	if (!file.IsOpen() || file.GetSize() < sizeof(MeshCompressedHeader))
+		return;
+	fileSize = file.GetSize();
+
+	// Is it a file we know how to read?
+	memcpy(&header, file.GetData(), sizeof(header));
+	if (memcmp(header.Magic, "MSHZ", 4) != 0 ||
+		header.Version != MESHZ_VERSION ||
+		(header.VertexFormat != VERTEX_FORMAT_FULL && header.VertexFormat != VERTEX_FORMAT_PACKED) ||
+		header.VertexStride != GetVertexStride((VertexFormat)header.VertexFormat) ||
+		(header.IndexStride != sizeof(unsigned short) && header.IndexStride != sizeof(unsigned int)) ||
+		header.LodCount == 0 || header.SubmeshCount == 0)
+		return;
+
+	// Is it all there, and unchanged since it was written?
+	const unsigned char* data = (const unsigned char*)file.GetData() + sizeof(MeshCompressedHeader);
+	unsigned long long dataSize = file.GetSize() - sizeof(MeshCompressedHeader);
+	unsigned long long lodBytes = (unsigned long long)header.LodCount * sizeof(MeshLod);
+	unsigned long long submeshBytes = (unsigned long long)header.LodCount * header.SubmeshCount * sizeof(MeshSubmesh);
+	unsigned long long clusterBytes = (unsigned long long)header.ClusterCount * sizeof(MeshCluster);
+	if (lodBytes + submeshBytes + clusterBytes + header.MaterialLibraryLength + header.VertexBytes + header.IndexBytes != dataSize ||
+		HashBytes(data, (size_t)dataSize) != header.DataHash)
+		return;
+
+	// The levels of detail, submeshes, clusters and material library are stored as they are
+	lods.resize(header.LodCount);
+	memcpy(&lods[0], data, (size_t)lodBytes);
+	data += lodBytes;
+	submeshes.resize((size_t)header.LodCount * header.SubmeshCount);
+	memcpy(&submeshes[0], data, (size_t)submeshBytes);
+	data += submeshBytes;
+	clusters.resize(header.ClusterCount);
+	if (header.ClusterCount > 0)
+		memcpy(&clusters[0], data, (size_t)clusterBytes);
+	data += clusterBytes;
+	materialLibrary.assign((const char*)data, header.MaterialLibraryLength);
+	data += header.MaterialLibraryLength;
+
+	for (unsigned int i = 0; i < header.LodCount; i++)
+	{
+		if ((unsigned long long)lods[i].FirstIndex + lods[i].IndexCount > header.IndexCount)
+			return;
+	}
+	for (size_t i = 0; i < submeshes.size(); i++)
+	{
+		if ((unsigned long long)submeshes[i].FirstIndex + submeshes[i].IndexCount > header.IndexCount ||
+			!memchr(submeshes[i].Material, 0, SUBMESH_MAX_MATERIAL_NAME))
+			return;
+	}
+	for (unsigned int i = 0; i < header.ClusterCount; i++)
+	{
+		if ((unsigned long long)clusters[i].FirstIndex + clusters[i].IndexCount > header.IndexCount)
+			return;
+	}
+
+	// Decode the vertices and indices
+	vertices.resize((size_t)header.VertexCount * header.VertexStride);
+	indices.resize((size_t)header.IndexCount * header.IndexStride);
+	if (vertices.empty() || indices.empty() ||
+		!DecodeVertexBuffer(data, (size_t)header.VertexBytes, &vertices[0], header.VertexCount, header.VertexStride) ||
+		!DecodeIndexBuffer(data + header.VertexBytes, (size_t)header.IndexBytes, &indices[0], header.IndexCount, header.IndexStride))
+		return;
+
+	// Every index has to point at a vertex
+	for (unsigned int i = 0; i < header.IndexCount; i++)
+	{
+		unsigned int index = header.IndexStride == sizeof(unsigned short) ?
+			((const unsigned short*)&indices[0])[i] :
+			((const unsigned int*)&indices[0])[i];
+		if (index >= header.VertexCount)
+			return;
+	}
+
+	valid = true;
+}
+
+unsigned long long MeshCompressedFile::GetDecodedSize()
+{
+	return vertices.size() + indices.size() + lods.size() * sizeof(MeshLod) + submeshes.size() * sizeof(MeshSubmesh) +
+		clusters.size() * sizeof(MeshCluster) + materialLibrary.size();
+}
+
+// --------------------------------------------------------
+// Compresses a mesh's final vertices and indices into a
+// .meshz file
+//
+// filename     - Where to write the file
+// vertices     - The vertex array, exactly as it goes to the GPU
+// vertexFormat - Whether those are Vertex or PackedVertex structs
+// indices      - The 32 bit index array (the codec works on these,
+//                 whatever size they're decoded to)
+// indexFormat  - The format to decode the indices into
+// lods         - The range of the indices each level of detail uses
+// submeshes    - Each level's submeshes, one level after another
+//                 ("numSubmeshes" is how many each level has)
+// clusters     - The mesh's clusters, if it has any
+// materialLibrary - The model's material library ("" if none)
+// boundsMin/Max - The mesh's axis-aligned bounding box
+//
+// Returns false if the file couldn't be written
+// --------------------------------------------------------
+bool WriteMeshCompressed(
+	const char* filename,
+	const void* vertices, VertexFormat vertexFormat, unsigned int numVerts,
+	const unsigned int* indices, DXGI_FORMAT indexFormat, unsigned int numIndices,
+	const MeshLod* lods, unsigned int numLods,
+	const MeshSubmesh* submeshes, unsigned int numSubmeshes,
+	const MeshCluster* clusters, unsigned int numClusters,
+	const std::string& materialLibrary,
+	DirectX::XMFLOAT3 boundsMin, DirectX::XMFLOAT3 boundsMax)
+{
+	// Compress the big arrays
+	std::vector<unsigned char> encodedVertices;
+	std::vector<unsigned char> encodedIndices;
+	EncodeVertexBuffer(vertices, numVerts, GetVertexStride(vertexFormat), encodedVertices);
+	EncodeIndexBuffer(indices, numIndices, encodedIndices);
+
+	// Put everything after the header together, so it can be hashed
+	std::vector<unsigned char> data;
+	data.insert(data.end(), (const unsigned char*)lods, (const unsigned char*)(lods + numLods));
+	data.insert(data.end(), (const unsigned char*)submeshes, (const unsigned char*)(submeshes + numLods * numSubmeshes));
+	data.insert(data.end(), (const unsigned char*)clusters, (const unsigned char*)(clusters + numClusters));
+	data.insert(data.end(), materialLibrary.begin(), materialLibrary.end());
+	data.insert(data.end(), encodedVertices.begin(), encodedVertices.end());
+	data.insert(data.end(), encodedIndices.begin(), encodedIndices.end());
+
+	MeshCompressedHeader header = {};
+	memcpy(header.Magic, "MSHZ", 4);
+	header.Version = MESHZ_VERSION;
+	header.VertexFormat = vertexFormat;
+	header.VertexStride = GetVertexStride(vertexFormat);
+	header.IndexStride = indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(unsigned short) : sizeof(unsigned int);
+	header.VertexCount = numVerts;
+	header.IndexCount = numIndices;
+	header.LodCount = numLods;
+	header.SubmeshCount = numSubmeshes;
+	header.ClusterCount = numClusters;
+	header.MaterialLibraryLength = (unsigned int)materialLibrary.size();
+	header.VertexBytes = encodedVertices.size();
+	header.IndexBytes = encodedIndices.size();
+	header.DataHash = HashBytes(data.empty() ? 0 : &data[0], data.size());
+	header.BoundsMin = boundsMin;
+	header.BoundsMax = boundsMax;
+
+	// Written to a temporary file first, like a .meshbin
+	std::string tempFilename = std::string(filename) + MESH_TEMP_EXTENSION;
+	std::ofstream out(tempFilename.c_str(), std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+		return false;
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)data.data(), (std::streamsize)data.size());
+	out.close();
+	return FinishTempFile(out, tempFilename, filename);
+}
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include "Vertex.h"
+#include "MappedFile.h"
+#include "MeshSimplifier.h"
+#include "MeshClusters.h"
+#include "ProgressiveMesh.h"
+#include <vector>
+#include <string>
+
+// Ends the name of a model's cached binary (see GetMeshCacheFilename())
+#define MESHBIN_EXTENSION ".meshbin"
+
+// Appended to a cache file's name while it's being written
+#define MESH_TEMP_EXTENSION ".tmp"
+
+// Bump this whenever the layout of a .meshbin file changes
+const unsigned int MESHBIN_VERSION = 9;
+
+// What a .meshbin was asked to be built with (a MeshBinaryHeader's Flags)
+// - Recorded separately from what it ended up with, since a mesh with
+//    several materials is never made progressive
+const unsigned int MESHBIN_FLAG_CLUSTERED = 1;
+const unsigned int MESHBIN_FLAG_PROGRESSIVE = 2;
+
+// --------------------------------------------------------
+// The start of a .meshbin file
+//
+// - Followed by the vertices, split into one array per
+//    VertexStream (see Vertex.h) just as the GeometryPool
+//    holds them: VertexCount positions at
+//    VertexStreamOffsets[VERTEX_STREAM_POSITION], then
+//    VertexCount sets of the other attributes at
+//    VertexStreamOffsets[VERTEX_STREAM_ATTRIBUTES] (both in
+//    the layout VertexFormat gives them),
+//    then IndexCount 16 or 32 bit indices at IndexOffset,
+//    then LodCount MeshLod structs at LodOffset,
+//    then ClusterCount MeshCluster structs at ClusterOffset
+//    (none unless the mesh was loaded with clusters),
+//    then SplitCount VertexSplit structs at SplitOffset and
+//    ChangeCount IndexChange structs at ChangeOffset (none
+//    unless the mesh is progressive, when BaseTriangleCount
+//    isn't 0 and the vertices and indices are coarse-first),
+//    then LodCount * SubmeshCount MeshSubmesh structs at
+//    SubmeshOffset (each level's, one level after another),
+//    then MaterialLibraryLength characters (no terminator)
+//    at MaterialLibraryOffset
+// - The Source fields record which version of the original
+//    model file this was built from
+// --------------------------------------------------------
+struct MeshBinaryHeader
+{
+	char Magic[4];				// Always "MBIN"
+	unsigned int Version;		// MESHBIN_VERSION when written
+	unsigned int Flags;			// MESHBIN_FLAG_ values
+	unsigned int VertexFormat;	// A VertexFormat value
+	unsigned int VertexStride;	// Size of a vertex in that format when written (across every stream)
+	unsigned int IndexStride;	// 2 or 4 bytes per index
+
+	unsigned long long SourceSize;
+	unsigned long long SourceModifiedTime;
+	unsigned long long SourceHash;
+
+	unsigned int VertexCount;
+	unsigned int IndexCount;	// Every level of detail's indices, one after another
+	unsigned int LodCount;
+	unsigned int ClusterCount;
+	unsigned long long VertexStreamOffsets[VERTEX_STREAM_COUNT];
+	unsigned long long IndexOffset;
+	unsigned long long LodOffset;
+	unsigned long long ClusterOffset;
+
+	unsigned int BaseTriangleCount;	// Progressive meshes only
+	unsigned int BaseVertexCount;
+	float BaseError;
+	unsigned int SplitCount;
+	unsigned int ChangeCount;
+	unsigned long long SplitOffset;
+	unsigned long long ChangeOffset;
+
+	unsigned int SubmeshCount;			// Per level of detail
+	unsigned int MaterialLibraryLength;	// The model's first "mtllib", as written (0 if it had none)
+	unsigned long long SubmeshOffset;
+	unsigned long long MaterialLibraryOffset;
+
+	DirectX::XMFLOAT3 BoundsMin;
+	DirectX::XMFLOAT3 BoundsMax;
+};
+
+// --------------------------------------------------------
+// A .meshbin file mapped into memory
+//
+// - The vertex and index pointers point straight into the
+//    mapped file, so nothing is parsed or copied
+// - They stay valid for as long as this object exists
+// --------------------------------------------------------
+class MeshBinaryFile
+{
+public:
+	MeshBinaryFile(const char* filename);
+
+	// Is this a complete .meshbin file with the layout we expect?
+	bool IsValid() { return header != 0; }
+
+	// Was this built from this version of the source file, in this vertex format, and asked for
+	// with or without clusters, and progressive or not?
+	// - The source file has to have the same size and last-write time, or if "sourceHash" isn't
+	//    null, the same contents (whatever its stamp)
+	bool Matches(const FileStamp& sourceStamp, const unsigned long long* sourceHash, VertexFormat format, bool clustered, bool progressive);
+
+	// Accessors for the mapped data (only call these if the file is valid)
+	const MeshBinaryHeader& GetHeader() { return *header; }
+	const void* GetVertexStream(VertexStream stream) { return file.GetData() + header->VertexStreamOffsets[stream]; }
+	VertexFormat GetVertexFormat() { return (VertexFormat)header->VertexFormat; }
+	const void* GetIndices() { return file.GetData() + header->IndexOffset; }
+	const MeshLod* GetLods() { return (const MeshLod*)(file.GetData() + header->LodOffset); }
+	const MeshCluster* GetClusters() { return (const MeshCluster*)(file.GetData() + header->ClusterOffset); }
+	const MeshSubmesh* GetSubmeshes() { return (const MeshSubmesh*)(file.GetData() + header->SubmeshOffset); }
+	std::string GetMaterialLibrary() { return std::string(file.GetData() + header->MaterialLibraryOffset, header->MaterialLibraryLength); }
+	DXGI_FORMAT GetIndexFormat() { return header->IndexStride == sizeof(unsigned short) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT; }
+
+	// Copies out a progressive mesh's splits (only call this if the file is valid and BaseTriangleCount isn't 0)
+	void GetProgressiveData(ProgressiveMeshData& data);
+
+private:
+	MappedFile file;
+	const MeshBinaryHeader* header;
+};
+
+// Ends the name of a model's compressed version (see GetMeshCacheFilename())
+#define MESHZ_EXTENSION ".meshz"
+
+// Bump this whenever the layout of a .meshz file changes
+const unsigned int MESHZ_VERSION = 2;
+
+// --------------------------------------------------------
+// The start of a .meshz file, a compressed copy of what's in
+// a .meshbin (see MeshCodec.h)
+//
+// - Followed by LodCount MeshLod structs, then LodCount *
+//    SubmeshCount MeshSubmesh structs, then ClusterCount
+//    MeshCluster structs, then MaterialLibraryLength characters
+//    of the material library's name, then VertexBytes of vertex data from
+//    EncodeVertexBuffer(), then IndexBytes of index data from
+//    EncodeIndexBuffer(), with no padding in between
+// - It doesn't record anything about the model it came from,
+//    so it can be shipped and loaded instead of the model
+// --------------------------------------------------------
+struct MeshCompressedHeader
+{
+	char Magic[4];				// Always "MSHZ"
+	unsigned int Version;		// MESHZ_VERSION when written
+	unsigned int VertexFormat;	// A VertexFormat value
+	unsigned int VertexStride;	// Size of a vertex in that format when written
+	unsigned int IndexStride;	// 2 or 4 bytes per index, once decoded
+
+	unsigned int VertexCount;
+	unsigned int IndexCount;
+	unsigned int LodCount;
+	unsigned int SubmeshCount;	// Per level of detail
+	unsigned int ClusterCount;
+	unsigned int MaterialLibraryLength;
+	unsigned long long VertexBytes;	// Compressed sizes
+	unsigned long long IndexBytes;
+	unsigned long long DataHash;	// HashBytes() of everything after the header
+
+	DirectX::XMFLOAT3 BoundsMin;
+	DirectX::XMFLOAT3 BoundsMax;
+};
+
+// --------------------------------------------------------
+// A .meshz file, read and decompressed
+//
+// - Unlike MeshBinaryFile, the data has to be decoded into
+//    memory of our own, which happens in the constructor
+// --------------------------------------------------------
+class MeshCompressedFile
+{
+public:
+	MeshCompressedFile(const char* filename);
+
+	// Was this a complete .meshz file that decoded cleanly?
+	bool IsValid() { return valid; }
+
+	// Accessors for the decoded data (only call these if the file is valid)
+	const MeshCompressedHeader& GetHeader() { return header; }
+	const void* GetVertices() { return vertices.empty() ? 0 : &vertices[0]; }
+	VertexFormat GetVertexFormat() { return (VertexFormat)header.VertexFormat; }
+	const void* GetIndices() { return indices.empty() ? 0 : &indices[0]; }
+	const MeshLod* GetLods() { return lods.empty() ? 0 : &lods[0]; }
+	const MeshCluster* GetClusters() { return clusters.empty() ? 0 : &clusters[0]; }
+	const MeshSubmesh* GetSubmeshes() { return submeshes.empty() ? 0 : &submeshes[0]; }
+	const std::string& GetMaterialLibrary() { return materialLibrary; }
+	DXGI_FORMAT GetIndexFormat() { return header.IndexStride == sizeof(unsigned short) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT; }
+
+	// How big the file was, and how big the data it held is
+	unsigned long long GetFileSize() { return fileSize; }
+	unsigned long long GetDecodedSize();
+
+private:
+	bool valid;
+	unsigned long long fileSize;
+	MeshCompressedHeader header;
+	std::vector<unsigned char> vertices;
+	std::vector<unsigned char> indices;
+	std::vector<MeshLod> lods;
+	std::vector<MeshSubmesh> submeshes;
+	std::vector<MeshCluster> clusters;
+	std::string materialLibrary;
+};
+
+// The name of a model's .meshbin or .meshz (given as "extension") when it's loaded in "format" with
+// "flags" (MESHBIN_FLAG_ values), so each way of loading it gets its own file
+std::string GetMeshCacheFilename(const char* modelFilename, VertexFormat format, unsigned int flags, const char* extension);
+
+// Fast 64-bit hash of a block of memory, used to fingerprint source files
+unsigned long long HashBytes(const void* data, size_t size);
+
+// Writes a .meshbin file, replacing any old one in a single step.  Returns false if it couldn't be written.
+bool WriteMeshBinary(
+	const char* filename,
+	const FileStamp& sourceStamp,
+	unsigned long long sourceHash,
+	unsigned int flags,
+	const void* const* vertexStreams, VertexFormat vertexFormat, unsigned int numVerts,
+	const void* indices, DXGI_FORMAT indexFormat, unsigned int numIndices,
+	const MeshLod* lods, unsigned int numLods,
+	const MeshSubmesh* submeshes, unsigned int numSubmeshes,
+	const MeshCluster* clusters, unsigned int numClusters,
+	const ProgressiveMeshData* progressive,
+	const std::string& materialLibrary,
+	DirectX::XMFLOAT3 boundsMin, DirectX::XMFLOAT3 boundsMax);
+
+// Records a model's new size and modified time in its .meshbin, once its contents are known not to have
+// changed.  Returns false if the file couldn't be written.
+bool UpdateMeshBinaryStamp(const char* filename, const FileStamp& sourceStamp);
+
+// Compresses a mesh's final vertices and indices into a .meshz file, replacing any old one in a single step.
+// Returns false if it couldn't be written.
+bool WriteMeshCompressed(
+	const char* filename,
+	const void* vertices, VertexFormat vertexFormat, unsigned int numVerts,
+	const unsigned int* indices, DXGI_FORMAT indexFormat, unsigned int numIndices,
+	const MeshLod* lods, unsigned int numLods,
+	const MeshSubmesh* submeshes, unsigned int numSubmeshes,
+	const MeshCluster* clusters, unsigned int numClusters,
+	const std::string& materialLibrary,
+	DirectX::XMFLOAT3 boundsMin, DirectX::XMFLOAT3 boundsMax);
+
@@ -0,0 +1,638 @@
+#include "MeshBvh.h"
+#include "ObjLoader.h"
+#include "MeshOptimizer.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+// How many entries a traversal's stack can need: each level
+// pushes at most three more than it pops, and halving splits
+// can add at most 32 levels past BVH_MAX_DEPTH
+const unsigned int BVH_STACK_SIZE = 3 * (BVH_MAX_DEPTH + 32) + 1;
+
+// --------------------------------------------------------
+// An axis-aligned box, while the tree is being built
+// --------------------------------------------------------
+struct BvhBounds
+{
+	XMFLOAT3 Min;
+	XMFLOAT3 Max;
+};
+
+static BvhBounds EmptyBounds()
+{
+	return { XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX), XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX) };
+}
+
+static void GrowBounds(BvhBounds& bounds, const XMFLOAT3& point)
+{
+	bounds.Min = XMFLOAT3(fminf(bounds.Min.x, point.x), fminf(bounds.Min.y, point.y), fminf(bounds.Min.z, point.z));
+	bounds.Max = XMFLOAT3(fmaxf(bounds.Max.x, point.x), fmaxf(bounds.Max.y, point.y), fmaxf(bounds.Max.z, point.z));
+}
+
+static void GrowBounds(BvhBounds& bounds, const BvhBounds& other)
+{
+	GrowBounds(bounds, other.Min);
+	GrowBounds(bounds, other.Max);
+}
+
+// Half the surface area (all the heuristic needs is the ratio between boxes)
+static float HalfArea(const BvhBounds& bounds)
+{
+	if (bounds.Max.x < bounds.Min.x)
+		return 0.0f;
+	float x = bounds.Max.x - bounds.Min.x;
+	float y = bounds.Max.y - bounds.Min.y;
+	float z = bounds.Max.z - bounds.Min.z;
+	return x * y + y * z + z * x;
+}
+
+static float GetAxis(const XMFLOAT3& v, int axis)
+{
+	return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+// --------------------------------------------------------
+// A node of the two-child tree the four-child one is
+// collapsed from
+// --------------------------------------------------------
+struct BvhBuildNode
+{
+	BvhBounds Bounds;
+	unsigned int Left;		// Children (inner nodes only)
+	unsigned int Right;
+	unsigned int First;		// Where its triangles are in the build order (leaves only)
+	unsigned int Count;		// How many (0 for inner nodes)
+};
+
+// --------------------------------------------------------
+// Everything the build works on
+// --------------------------------------------------------
+struct BvhBuilder
+{
+	std::vector<BvhBounds> TriangleBounds;
+	std::vector<XMFLOAT3> Centroids;
+	std::vector<unsigned int> Order;	// Triangles, grouped by the leaf they end up in
+	std::vector<BvhBuildNode> Nodes;
+};
+
+// --------------------------------------------------------
+// Builds the two-child tree over a range of triangles
+//
+// - Every split into BVH_SAH_BINS bins along each axis is
+//    scored by the surface area heuristic, and the cheapest
+//    one wins, unless keeping the range as a leaf is cheaper
+// - Ranges with no useful split (such as triangles all with
+//    the same centroid), and ranges past BVH_MAX_DEPTH, are
+//    halved instead
+//
+// Returns the new node's index
+// --------------------------------------------------------
+static unsigned int BuildBvhNode(BvhBuilder& builder, unsigned int first, unsigned int count, unsigned int depth)
+{
+	unsigned int index = (unsigned int)builder.Nodes.size();
+	builder.Nodes.push_back(BvhBuildNode());
+
+	BvhBounds bounds = EmptyBounds();
+	BvhBounds centroidBounds = EmptyBounds();
+	for (unsigned int i = first; i < first + count; i++)
+	{
+		GrowBounds(bounds, builder.TriangleBounds[builder.Order[i]]);
+		GrowBounds(centroidBounds, builder.Centroids[builder.Order[i]]);
+	}
+	builder.Nodes[index].Bounds = bounds;
+
+	if (count == 1)
+	{
+		builder.Nodes[index].First = first;
+		builder.Nodes[index].Count = count;
+		return index;
+	}
+
+	// Find the cheapest binned split (costing a node visit as much as a triangle test)
+	float area = HalfArea(bounds);
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	unsigned int bestSplit = 0;
+	if (depth < BVH_MAX_DEPTH && area > 0)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float axisMin = GetAxis(centroidBounds.Min, axis);
+			float extent = GetAxis(centroidBounds.Max, axis) - axisMin;
+			if (extent <= 0)
+				continue;
+
+			BvhBounds binBounds[BVH_SAH_BINS];
+			unsigned int binCounts[BVH_SAH_BINS] = {};
+			for (unsigned int b = 0; b < BVH_SAH_BINS; b++)
+				binBounds[b] = EmptyBounds();
+			float binScale = BVH_SAH_BINS / extent;
+			for (unsigned int i = first; i < first + count; i++)
+			{
+				unsigned int t = builder.Order[i];
+				unsigned int b = (std::min)((unsigned int)((GetAxis(builder.Centroids[t], axis) - axisMin) * binScale), BVH_SAH_BINS - 1);
+				binCounts[b]++;
+				GrowBounds(binBounds[b], builder.TriangleBounds[t]);
+			}
+
+			// Sweep from the right to get the cost of everything past each split, then from the left
+			float rightCosts[BVH_SAH_BINS];
+			BvhBounds right = EmptyBounds();
+			unsigned int rightCount = 0;
+			for (unsigned int b = BVH_SAH_BINS - 1; b > 0; b--)
+			{
+				GrowBounds(right, binBounds[b]);
+				rightCount += binCounts[b];
+				rightCosts[b] = HalfArea(right) * rightCount;
+			}
+			BvhBounds left = EmptyBounds();
+			unsigned int leftCount = 0;
+			for (unsigned int b = 1; b < BVH_SAH_BINS; b++)
+			{
+				GrowBounds(left, binBounds[b - 1]);
+				leftCount += binCounts[b - 1];
+				if (leftCount == 0 || leftCount == count)
+					continue;
+				float cost = 1.0f + (HalfArea(left) * leftCount + rightCosts[b]) / area;
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = b;
+				}
+			}
+		}
+	}
+
+	// Keep small ranges whole when splitting them wouldn't pay off
+	if (count <= BVH_MAX_LEAF_TRIANGLES && (bestAxis < 0 || (float)count <= bestCost))
+	{
+		builder.Nodes[index].First = first;
+		builder.Nodes[index].Count = count;
+		return index;
+	}
+
+	unsigned int* begin = &builder.Order[first];
+	unsigned int* mid = 0;
+	if (bestAxis >= 0)
+	{
+		float axisMin = GetAxis(centroidBounds.Min, bestAxis);
+		float binScale = BVH_SAH_BINS / (GetAxis(centroidBounds.Max, bestAxis) - axisMin);
+		mid = std::partition(begin, begin + count, [&](unsigned int t)
+		{
+			return (std::min)((unsigned int)((GetAxis(builder.Centroids[t], bestAxis) - axisMin) * binScale), BVH_SAH_BINS - 1) < bestSplit;
+		});
+	}
+	else
+	{
+		// Halve the range along its longest axis
+		XMFLOAT3 extent(centroidBounds.Max.x - centroidBounds.Min.x, centroidBounds.Max.y - centroidBounds.Min.y, centroidBounds.Max.z - centroidBounds.Min.z);
+		int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+		mid = begin + count / 2;
+		std::nth_element(begin, mid, begin + count, [&](unsigned int a, unsigned int b)
+		{
+			return GetAxis(builder.Centroids[a], axis) < GetAxis(builder.Centroids[b], axis);
+		});
+	}
+
+	unsigned int leftCount = (unsigned int)(mid - begin);
+	unsigned int leftChild = BuildBvhNode(builder, first, leftCount, depth + 1);
+	unsigned int rightChild = BuildBvhNode(builder, first + leftCount, count - leftCount, depth + 1);
+	builder.Nodes[index].Left = leftChild;
+	builder.Nodes[index].Right = rightChild;
+	builder.Nodes[index].Count = 0;
+	return index;
+}
+
+// --------------------------------------------------------
+// Turns a node of the two-child tree into a four-child node
+//
+// - The node's children are opened up, biggest first, until
+//    there are four of them (or only leaves are left), which
+//    pulls the two levels below each node up into it
+// - Nodes are written depth first, so a node's first child
+//    comes right after it
+// - Adds each child's share of the expected traversal cost
+//    to "sahCost"
+//
+// Returns the new node's index
+// --------------------------------------------------------
+static unsigned int CollapseBvhNode(const std::vector<BvhBuildNode>& buildNodes, unsigned int buildIndex, float rootArea, std::vector<BvhNode>& nodes, float& sahCost)
+{
+	unsigned int children[4];
+	unsigned int childCount = 0;
+	const BvhBuildNode& buildNode = buildNodes[buildIndex];
+	if (buildNode.Count > 0)
+		children[childCount++] = buildIndex;
+	else
+	{
+		children[childCount++] = buildNode.Left;
+		children[childCount++] = buildNode.Right;
+	}
+	while (childCount < 4)
+	{
+		int biggest = -1;
+		float biggestArea = -1.0f;
+		for (unsigned int c = 0; c < childCount; c++)
+		{
+			const BvhBuildNode& child = buildNodes[children[c]];
+			if (child.Count == 0 && HalfArea(child.Bounds) > biggestArea)
+			{
+				biggest = c;
+				biggestArea = HalfArea(child.Bounds);
+			}
+		}
+		if (biggest < 0)
+			break;
+		unsigned int opened = children[biggest];
+		children[biggest] = buildNodes[opened].Left;
+		children[childCount++] = buildNodes[opened].Right;
+	}
+
+	unsigned int index = (unsigned int)nodes.size();
+	BvhNode node = {};
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		node.Child[c] = BVH_NO_CHILD;
+		node.TriangleCount[c] = 0;
+	}
+	nodes.push_back(node);
+
+	for (unsigned int c = 0; c < childCount; c++)
+	{
+		const BvhBuildNode& child = buildNodes[children[c]];
+		(&nodes[index].MinX.x)[c] = child.Bounds.Min.x;
+		(&nodes[index].MinY.x)[c] = child.Bounds.Min.y;
+		(&nodes[index].MinZ.x)[c] = child.Bounds.Min.z;
+		(&nodes[index].MaxX.x)[c] = child.Bounds.Max.x;
+		(&nodes[index].MaxY.x)[c] = child.Bounds.Max.y;
+		(&nodes[index].MaxZ.x)[c] = child.Bounds.Max.z;
+
+		float share = rootArea > 0 ? HalfArea(child.Bounds) / rootArea : 1.0f;
+		if (child.Count > 0)
+		{
+			nodes[index].Child[c] = child.First;
+			nodes[index].TriangleCount[c] = child.Count;
+			sahCost += share * child.Count;
+		}
+		else
+		{
+			unsigned int childIndex = CollapseBvhNode(buildNodes, children[c], rootArea, nodes, sahCost);
+			nodes[index].Child[c] = childIndex;
+			sahCost += share;
+		}
+	}
+	return index;
+}
+
+static BvhTriangle MakeBvhTriangle(const Vertex* verts, const unsigned int* indices, unsigned int triangle)
+{
+	const XMFLOAT3& p0 = verts[indices[triangle * 3]].Position;
+	const XMFLOAT3& p1 = verts[indices[triangle * 3 + 1]].Position;
+	const XMFLOAT3& p2 = verts[indices[triangle * 3 + 2]].Position;
+
+	BvhTriangle result;
+	result.V0 = p0;
+	result.Edge1 = XMFLOAT3(p1.x - p0.x, p1.y - p0.y, p1.z - p0.z);
+	result.Edge2 = XMFLOAT3(p2.x - p0.x, p2.y - p0.y, p2.z - p0.z);
+	result.Index = triangle;
+	return result;
+}
+
+// --------------------------------------------------------
+// Builds the tree over every triangle in "indices"
+//
+// - Triangles are gathered into leaves of the two-child tree
+//    first, then that's collapsed into four-child nodes, and
+//    the triangles are copied out in leaf order
+// --------------------------------------------------------
+MeshBvh::MeshBvh(const Vertex* verts, const unsigned int* indices, unsigned int numIndices)
+{
+	sahCost = 0.0f;
+	unsigned int triangleCount = numIndices / 3;
+	if (triangleCount == 0)
+		return;
+
+	BvhBuilder builder;
+	builder.TriangleBounds.resize(triangleCount);
+	builder.Centroids.resize(triangleCount);
+	builder.Order.resize(triangleCount);
+	builder.Nodes.reserve(triangleCount * 2);
+	for (unsigned int t = 0; t < triangleCount; t++)
+	{
+		BvhBounds bounds = EmptyBounds();
+		for (int c = 0; c < 3; c++)
+			GrowBounds(bounds, verts[indices[t * 3 + c]].Position);
+		builder.TriangleBounds[t] = bounds;
+		builder.Centroids[t] = XMFLOAT3((bounds.Min.x + bounds.Max.x) * 0.5f, (bounds.Min.y + bounds.Max.y) * 0.5f, (bounds.Min.z + bounds.Max.z) * 0.5f);
+		builder.Order[t] = t;
+	}
+
+	BuildBvhNode(builder, 0, triangleCount, 0);
+
+	// The root is always visited
+	sahCost = 1.0f;
+	CollapseBvhNode(builder.Nodes, 0, HalfArea(builder.Nodes[0].Bounds), nodes, sahCost);
+
+	triangles.resize(triangleCount);
+	for (unsigned int i = 0; i < triangleCount; i++)
+		triangles[i] = MakeBvhTriangle(verts, indices, builder.Order[i]);
+}
+
+// --------------------------------------------------------
+// Ray/triangle test (Moller-Trumbore), two sided
+//
+// - Returns true for hits no further than "maxDistance",
+//    filling in the distance and barycentrics
+// --------------------------------------------------------
+static inline bool IntersectBvhTriangle(const BvhTriangle& tri, const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, float& distance, float& u, float& v)
+{
+	// p = direction x edge2
+	float px = direction.y * tri.Edge2.z - direction.z * tri.Edge2.y;
+	float py = direction.z * tri.Edge2.x - direction.x * tri.Edge2.z;
+	float pz = direction.x * tri.Edge2.y - direction.y * tri.Edge2.x;
+	float det = tri.Edge1.x * px + tri.Edge1.y * py + tri.Edge1.z * pz;
+	if (fabsf(det) < 1e-12f)
+		return false;
+	float invDet = 1.0f / det;
+
+	float sx = origin.x - tri.V0.x;
+	float sy = origin.y - tri.V0.y;
+	float sz = origin.z - tri.V0.z;
+	float hitU = (sx * px + sy * py + sz * pz) * invDet;
+	if (hitU < 0.0f || hitU > 1.0f)
+		return false;
+
+	// q = s x edge1
+	float qx = sy * tri.Edge1.z - sz * tri.Edge1.y;
+	float qy = sz * tri.Edge1.x - sx * tri.Edge1.z;
+	float qz = sx * tri.Edge1.y - sy * tri.Edge1.x;
+	float hitV = (direction.x * qx + direction.y * qy + direction.z * qz) * invDet;
+	if (hitV < 0.0f || hitU + hitV > 1.0f)
+		return false;
+
+	float t = (tri.Edge2.x * qx + tri.Edge2.y * qy + tri.Edge2.z * qz) * invDet;
+	if (t < 0.0f || t > maxDistance)
+		return false;
+
+	distance = t;
+	u = hitU;
+	v = hitV;
+	return true;
+}
+
+// --------------------------------------------------------
+// Walks the tree along a ray
+//
+// - Each node's four boxes are tested at once with vector
+//    math (the slab test, one coordinate of all four boxes
+//    per register)
+// - For closest hits, the children that are hit are pushed
+//    furthest first, so the nearest is visited next, and
+//    anything further than the closest hit so far is skipped
+//    when it's popped
+// - For any hit, the first hit ends the walk
+// --------------------------------------------------------
+template<bool AnyHit>
+bool MeshBvh::Traverse(XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, RayHit& hit) const
+{
+	if (nodes.empty())
+		return false;
+
+	struct StackEntry
+	{
+		unsigned int Child;
+		unsigned int TriangleCount;
+		float Distance;		// Where the ray enters the child's box
+	};
+	StackEntry stack[BVH_STACK_SIZE];
+	unsigned int stackSize = 0;
+	stack[stackSize++] = { 0, 0, 0.0f };
+
+	XMVECTOR rayOrigin = XMLoadFloat3(&origin);
+	XMVECTOR inverseDirection = XMVectorReciprocal(XMLoadFloat3(&direction));
+	XMVECTOR originX = XMVectorSplatX(rayOrigin);
+	XMVECTOR originY = XMVectorSplatY(rayOrigin);
+	XMVECTOR originZ = XMVectorSplatZ(rayOrigin);
+	XMVECTOR inverseX = XMVectorSplatX(inverseDirection);
+	XMVECTOR inverseY = XMVectorSplatY(inverseDirection);
+	XMVECTOR inverseZ = XMVectorSplatZ(inverseDirection);
+	XMVECTOR zero = XMVectorZero();
+	XMVECTOR infinity = XMVectorSplatInfinity();
+
+	float closest = maxDistance;
+	bool found = false;
+	while (stackSize > 0)
+	{
+		StackEntry entry = stack[--stackSize];
+		if (entry.Distance > closest)
+			continue;
+
+		// Leaves test their triangles one by one
+		if (entry.TriangleCount > 0)
+		{
+			for (unsigned int i = entry.Child; i < entry.Child + entry.TriangleCount; i++)
+			{
+				float distance, u, v;
+				if (!IntersectBvhTriangle(triangles[i], origin, direction, closest, distance, u, v))
+					continue;
+				if (AnyHit)
+					return true;
+				closest = distance;
+				hit = { distance, triangles[i].Index, u, v };
+				found = true;
+			}
+			continue;
+		}
+
+		// Inner nodes test all four children's boxes at once
+		const BvhNode& node = nodes[entry.Child];
+		XMVECTOR nearX = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4A(&node.MinX), originX), inverseX);
+		XMVECTOR farX = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4A(&node.MaxX), originX), inverseX);
+		XMVECTOR nearY = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4A(&node.MinY), originY), inverseY);
+		XMVECTOR farY = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4A(&node.MaxY), originY), inverseY);
+		XMVECTOR nearZ = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4A(&node.MinZ), originZ), inverseZ);
+		XMVECTOR farZ = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4A(&node.MaxZ), originZ), inverseZ);
+		XMVECTOR enter = XMVectorMax(XMVectorMax(XMVectorMin(nearX, farX), XMVectorMin(nearY, farY)), XMVectorMax(XMVectorMin(nearZ, farZ), zero));
+		XMVECTOR exit = XMVectorMin(XMVectorMin(XMVectorMax(nearX, farX), XMVectorMax(nearY, farY)), XMVectorMin(XMVectorMax(nearZ, farZ), XMVectorReplicate(closest)));
+
+		// Missed boxes get an infinite distance
+		XMFLOAT4A distances;
+		XMStoreFloat4A(&distances, XMVectorSelect(infinity, enter, XMVectorLessOrEqual(enter, exit)));
+
+		StackEntry hits[4];
+		unsigned int hitCount = 0;
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			float distance = (&distances.x)[c];
+			if (node.Child[c] == BVH_NO_CHILD || !(distance <= closest))
+				continue;
+
+			// Keep the hits sorted furthest first (for closest hits)
+			StackEntry child = { node.Child[c], node.TriangleCount[c], distance };
+			unsigned int at = hitCount++;
+			while (!AnyHit && at > 0 && hits[at - 1].Distance < distance)
+			{
+				hits[at] = hits[at - 1];
+				at--;
+			}
+			hits[at] = child;
+		}
+		for (unsigned int h = 0; h < hitCount; h++)
+			stack[stackSize++] = hits[h];
+	}
+	return found;
+}
+
+bool MeshBvh::Intersect(XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, RayHit& hit) const
+{
+	return Traverse<false>(origin, direction, maxDistance, hit);
+}
+
+bool MeshBvh::Occluded(XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance) const
+{
+	RayHit hit;
+	return Traverse<true>(origin, direction, maxDistance, hit);
+}
+
+// --------------------------------------------------------
+// Casts random rays at models, through their trees and by
+// testing every triangle
+//
+// - Rays start on a sphere around the model and aim at
+//    random points inside its bounds, so most of them hit
+// - Closest hits run to infinity, and any hits stop at the
+//    point aimed at (like shadow rays would)
+// - Testing every triangle is only timed on some of the rays,
+//    and the closest hits are checked against it
+// - Any hits have to agree with the closest hits about
+//    whether there's something before the point aimed at
+// - Everything runs on one thread, so the rates are per core
+// - Returns false if a model can't be read, or any ray's
+//    answers differ
+// --------------------------------------------------------
+bool BenchmarkRaycasts(const char* modelDirectory)
+{
+	const unsigned int rayCount = 100000;
+	const unsigned int bruteForceRayCount = 1000;
+	static const char* models[] = { "helix.obj", "sphere.obj" };
+
+	bool passed = true;
+	printf("\nRay casts (%u rays per model):", rayCount);
+	for (int m = 0; m < 2; m++)
+	{
+		std::string filename = std::string(modelDirectory) + "/" + models[m];
+		MappedFile source(filename.c_str());
+		if (!source.IsOpen())
+		{
+			printf("\n  %s: couldn't be read", models[m]);
+			passed = false;
+			continue;
+		}
+		ObjData obj;
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+		ParseObjParallel(source.GetData(), source.GetSize(), obj, std::thread::hardware_concurrency());
+		BuildIndexedMesh(obj, verts, indices);
+		OptimizeMesh(verts, indices);
+		if (indices.empty())
+			continue;
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		MeshBvh bvh(&verts[0], &indices[0], (unsigned int)indices.size());
+		double buildSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+		// Make the rays
+		BvhBounds bounds = EmptyBounds();
+		for (auto& v : verts)
+			GrowBounds(bounds, v.Position);
+		XMVECTOR boundsMin = XMLoadFloat3(&bounds.Min);
+		XMVECTOR boundsMax = XMLoadFloat3(&bounds.Max);
+		XMVECTOR center = (boundsMin + boundsMax) * 0.5f;
+		float radius = XMVectorGetX(XMVector3Length(boundsMax - boundsMin));
+
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::vector<XMFLOAT3> origins(rayCount);
+		std::vector<XMFLOAT3> directions(rayCount);
+		for (unsigned int r = 0; r < rayCount; r++)
+		{
+			float z = unit(random) * 2.0f - 1.0f;
+			float angle = unit(random) * XM_2PI;
+			float ring = sqrtf(1.0f - z * z);
+			XMVECTOR origin = center + XMVectorSet(ring * cosf(angle), ring * sinf(angle), z, 0) * radius;
+			XMVECTOR target = boundsMin + (boundsMax - boundsMin) * XMVectorSet(unit(random), unit(random), unit(random), 0);
+			XMStoreFloat3(&origins[r], origin);
+			XMStoreFloat3(&directions[r], target - origin);
+		}
+
+		// Closest hits
+		unsigned int hits = 0;
+		std::vector<RayHit> closestHits(rayCount);
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int r = 0; r < rayCount; r++)
+		{
+			if (bvh.Intersect(origins[r], directions[r], FLT_MAX, closestHits[r]))
+				hits++;
+			else
+				closestHits[r].Distance = FLT_MAX;
+		}
+		double closestSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+		// Any hits
+		unsigned int occluded = 0;
+		std::vector<bool> anyHits(rayCount);
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int r = 0; r < rayCount; r++)
+		{
+			anyHits[r] = bvh.Occluded(origins[r], directions[r], 1.0f);
+			if (anyHits[r])
+				occluded++;
+		}
+		double anySeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+		// (hits right at the point aimed at could go either way)
+		unsigned int anyMismatches = 0;
+		for (unsigned int r = 0; r < rayCount; r++)
+		{
+			if (fabsf(closestHits[r].Distance - 1.0f) > 1e-4f && anyHits[r] != (closestHits[r].Distance <= 1.0f))
+				anyMismatches++;
+		}
+
+		// Every triangle, for comparison
+		std::vector<BvhTriangle> triangles(indices.size() / 3);
+		for (unsigned int t = 0; t < triangles.size(); t++)
+			triangles[t] = MakeBvhTriangle(&verts[0], &indices[0], t);
+		unsigned int mismatches = 0;
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int r = 0; r < bruteForceRayCount; r++)
+		{
+			float closest = FLT_MAX;
+			for (auto& tri : triangles)
+			{
+				float distance, u, v;
+				if (IntersectBvhTriangle(tri, origins[r], directions[r], closest, distance, u, v))
+					closest = distance;
+			}
+			if (fabsf(closest - closestHits[r].Distance) > 1e-4f * closest)
+				mismatches++;
+		}
+		double bruteForceSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+		printf("\n  %s: %u triangles, %u nodes (%llu bytes), SAH cost %.1f, built in %.3f ms",
+			models[m], bvh.GetTriangleCount(), bvh.GetNodeCount(), bvh.GetMemoryBytes(), bvh.GetSahCost(), buildSeconds * 1000.0);
+		printf("\n    closest hit: %.2f Mrays/s (%u hit), any hit: %.2f Mrays/s (%u hit, %u disagree), every triangle: %.3f Mrays/s, %u of %u differ",
+			rayCount / closestSeconds / 1e6, hits, rayCount / anySeconds / 1e6, occluded, anyMismatches,
+			bruteForceRayCount / bruteForceSeconds / 1e6, mismatches, bruteForceRayCount);
+		passed = passed && mismatches == 0 && anyMismatches == 0;
+	}
+	return passed;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Vertex.h"
+#include <DirectXMath.h>
+#include <vector>
+
+// The most triangles one leaf can hold, and how many bins
+// each axis is split into when looking for the best split
+const unsigned int BVH_MAX_LEAF_TRIANGLES = 8;
+const unsigned int BVH_SAH_BINS = 16;
+
+// How deep the tree can get before splits fall back to halving
+// (which keeps the traversal stack's size fixed)
+const unsigned int BVH_MAX_DEPTH = 48;
+
+// Marks a node's unused lanes
+const unsigned int BVH_NO_CHILD = 0xFFFFFFFF;
+
+// --------------------------------------------------------
+// One node of the flattened tree, with the bounding boxes of
+// up to four children stored side by side, so a ray is
+// tested against all four at once
+//
+// - Each of MinX..MaxZ holds one coordinate of all four boxes
+// - A child with a TriangleCount is a leaf, and its Child is
+//    where its triangles start; otherwise Child is the node's
+//    index (or BVH_NO_CHILD, for lanes with no child at all)
+// --------------------------------------------------------
+struct BvhNode
+{
+	DirectX::XMFLOAT4A MinX;
+	DirectX::XMFLOAT4A MinY;
+	DirectX::XMFLOAT4A MinZ;
+	DirectX::XMFLOAT4A MaxX;
+	DirectX::XMFLOAT4A MaxY;
+	DirectX::XMFLOAT4A MaxZ;
+	unsigned int Child[4];
+	unsigned int TriangleCount[4];
+};
+
+// --------------------------------------------------------
+// A triangle, stored the way the intersection test wants it
+// --------------------------------------------------------
+struct BvhTriangle
+{
+	DirectX::XMFLOAT3 V0;
+	DirectX::XMFLOAT3 Edge1;	// V1 - V0
+	DirectX::XMFLOAT3 Edge2;	// V2 - V0
+	unsigned int Index;			// Which triangle of the mesh it is
+};
+
+// --------------------------------------------------------
+// Where a ray hit
+// --------------------------------------------------------
+struct RayHit
+{
+	float Distance;		// Along the ray, in multiples of its direction
+	unsigned int Triangle;
+	float U;			// Barycentric weights of the triangle's
+	float V;			// second and third corners
+};
+
+// --------------------------------------------------------
+// A bounding volume hierarchy over a mesh's triangles, for
+// ray casts against the actual surface
+//
+// - Built top down with a binned surface area heuristic
+//    (each split is the one that minimizes the expected cost
+//    of tracing a random ray through the two halves), then
+//    collapsed from two children per node into four
+// - Nodes and triangles are each in one array, in the order
+//    a traversal is most likely to visit them
+// - Triangles are two sided, and the tree keeps its own copy
+//    of them, so it doesn't need the mesh once it's built
+// - Queries only read the tree, so any number of threads can
+//    cast rays through it at once
+// --------------------------------------------------------
+class MeshBvh
+{
+public:
+	MeshBvh(const Vertex* verts, const unsigned int* indices, unsigned int numIndices);
+
+	// Finds the closest hit along the ray within "maxDistance" (in multiples of "direction")
+	bool Intersect(DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, RayHit& hit) const;
+
+	// Checks whether the ray hits anything within "maxDistance", stopping at the first hit found
+	bool Occluded(DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance) const;
+
+	// Size of the tree
+	unsigned int GetNodeCount() const { return (unsigned int)nodes.size(); }
+	unsigned int GetTriangleCount() const { return (unsigned int)triangles.size(); }
+	unsigned long long GetMemoryBytes() const { return nodes.size() * sizeof(BvhNode) + triangles.size() * sizeof(BvhTriangle); }
+
+	// The expected cost of a ray through the tree, in triangle tests
+	// (each node visit counting as one, and each triangle as one more)
+	float GetSahCost() const { return sahCost; }
+
+private:
+	std::vector<BvhNode> nodes;
+	std::vector<BvhTriangle> triangles;
+	float sahCost;
+
+	// Helper method with the traversal both queries share
+	template<bool AnyHit>
+	bool Traverse(DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, RayHit& hit) const;
+};
+
+// Times building trees for, and casting random rays at, the models in "modelDirectory",
+// checking the results against testing every triangle, and prints the results.  Returns false if any differ.
+bool BenchmarkRaycasts(const char* modelDirectory);
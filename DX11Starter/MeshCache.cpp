@@ -0,0 +1,193 @@
+#include "MeshCache.h"
+#include <vector>
+#include <cctype>
+#include <exception>
+
+MeshCache::MeshCache(GeometryPool* pool)
+{
+	this->pool = pool;
+	stats = {};
+}
+
+MeshCache::~MeshCache()
+{
+	// Every handle should be gone by now, since their meshes
+	// call back into the cache when they're deleted
+}
+
+// --------------------------------------------------------
+// Gets a shared handle to a mesh
+//
+// - If the mesh is alive, this is just a lookup
+// - If another thread is loading it, this waits for that load
+// - Otherwise the file is loaded here, outside the lock, so
+//    different meshes can load on different threads at once
+//
+// filename    - Path to the model file
+// format      - Which vertex format to load it with
+// clustered   - Whether to split it into clusters
+// progressive - Whether to build it as a progressive mesh (note
+//                that every user shares its current level)
+// --------------------------------------------------------
+std::shared_ptr<Mesh> MeshCache::Load(const char* filename, VertexFormat format, bool clustered, bool progressive)
+{
+	// The same file loaded differently is a different mesh
+	std::string key = NormalizePath(filename);
+	key += '|';
+	key += (char)('0' + format);
+	key += clustered ? 'c' : '-';
+	key += progressive ? 'p' : '-';
+
+	std::promise<std::shared_ptr<Mesh>> promise;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		Entry& entry = entries[key];
+
+		// Already loaded?
+		std::shared_ptr<Mesh> mesh = entry.Loaded.lock();
+		if (mesh)
+		{
+			stats.Hits++;
+			return mesh;
+		}
+
+		// Somebody else is loading it?  Wait for theirs, without holding up everyone else
+		if (entry.Loading.valid())
+		{
+			stats.Hits++;
+			std::shared_future<std::shared_ptr<Mesh>> loading = entry.Loading;
+			lock.unlock();
+			return loading.get();
+		}
+
+		// We're the ones loading it
+		stats.Misses++;
+		entry.Loading = promise.get_future().share();
+	}
+
+	// Load it, and have it tell the cache when it's deleted
+	// - If loading throws, the entry has to stop saying it's loading, and
+	//    everyone waiting gets the same exception, so the next Load() can
+	//    try again instead of finding a promise nobody will ever keep
+	Mesh* loaded;
+	try
+	{
+		loaded = new Mesh(filename, pool, format, clustered, progressive);
+	}
+	catch (...)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			entries[key].Loading = std::shared_future<std::shared_ptr<Mesh>>();
+		}
+		promise.set_exception(std::current_exception());
+		throw;
+	}
+
+	// A model that couldn't be read (or had nothing in it) isn't kept either,
+	// so it's tried again next time rather than handed out as if it had worked
+	if (loaded->GetLodCount() == 0)
+	{
+		delete loaded;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			entries[key].Loading = std::shared_future<std::shared_ptr<Mesh>>();
+		}
+		promise.set_value(std::shared_ptr<Mesh>());
+		return std::shared_ptr<Mesh>();
+	}
+
+	unsigned long long bytes = loaded->GetBufferBytes();
+	std::shared_ptr<Mesh> mesh(loaded, [this, key, bytes](Mesh* m) { Unload(key, m, bytes); });
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Entry& entry = entries[key];
+		entry.Loaded = mesh;
+		entry.Loading = std::shared_future<std::shared_ptr<Mesh>>();
+		stats.ResidentBytes += bytes;
+		stats.ResidentMeshes++;
+	}
+
+	// Wake up anyone who asked for it while it was loading
+	promise.set_value(mesh);
+	return mesh;
+}
+
+MeshCacheStats MeshCache::GetStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+// --------------------------------------------------------
+// Deletes a mesh once nothing is using it
+//
+// - Its entry is only removed if it hasn't been loaded again
+//    (or started loading again) in the meantime
+// --------------------------------------------------------
+void MeshCache::Unload(const std::string& key, Mesh* mesh, unsigned long long bytes)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stats.ResidentBytes -= bytes;
+		stats.ResidentMeshes--;
+
+		auto found = entries.find(key);
+		if (found != entries.end() && found->second.Loaded.expired() && !found->second.Loading.valid())
+			entries.erase(found);
+	}
+
+	// The buffers can be released without holding the lock
+	delete mesh;
+}
+
+// --------------------------------------------------------
+// Puts a path into a standard form, so different ways of
+// writing the same path find the same mesh
+//
+// - "\" becomes "/", and repeated slashes are merged
+// - "." parts are dropped, and ".." removes the part before it
+// - Windows paths aren't case sensitive, so they're lower cased
+//
+// filename - The path as it was passed in
+// --------------------------------------------------------
+std::string MeshCache::NormalizePath(const char* filename)
+{
+	std::string path = filename;
+	bool absolute = !path.empty() && (path[0] == '/' || path[0] == '\\');
+
+	// Split it up into its parts, resolving "." and ".." as we go
+	std::vector<std::string> parts;
+	size_t start = 0;
+	while (start <= path.size())
+	{
+		size_t end = path.find_first_of("/\\", start);
+		if (end == std::string::npos)
+			end = path.size();
+		std::string part = path.substr(start, end - start);
+		start = end + 1;
+
+		if (part.empty() || part == ".")
+			continue;
+		if (part == ".." && !parts.empty() && parts.back() != "..")
+			parts.pop_back();
+		else
+			parts.push_back(part);
+	}
+
+	// Put it back together
+	std::string result = absolute ? "/" : "";
+	for (size_t i = 0; i < parts.size(); i++)
+	{
+		if (i > 0) result += '/';
+		result += parts[i];
+	}
+
+#if defined(_WIN32)
+	for (size_t i = 0; i < result.size(); i++)
+		result[i] = (char)tolower((unsigned char)result[i]);
+#endif
+
+	return result;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Mesh.h"
+#include "GeometryPool.h"
+#include <string>
+#include <memory>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+
+// --------------------------------------------------------
+// How well the cache is doing
+// --------------------------------------------------------
+struct MeshCacheStats
+{
+	unsigned long long Hits;			// Requests for a mesh that was loaded (or loading) already
+	unsigned long long Misses;			// Requests that had to load the file
+	unsigned long long ResidentBytes;	// GPU memory used by every mesh that's still alive
+	unsigned int ResidentMeshes;
+};
+
+// --------------------------------------------------------
+// Loads meshes from model files, and shares them
+//
+// - Meshes are looked up by their normalized path (along with
+//    the vertex format, clustering and progressive-ness they
+//    were loaded with),
+//    so asking for the same model twice only loads it once
+// - The returned handles are reference counted: the mesh is
+//    deleted when the last one goes away, and loaded again if
+//    it's asked for after that
+// - Load() can be called from several threads at once, and
+//    requests for a mesh that's still loading wait for that
+//    load instead of starting another
+// - The cache must outlive every handle it gives out
+// --------------------------------------------------------
+class MeshCache
+{
+public:
+	MeshCache(GeometryPool* pool);
+	~MeshCache();
+
+	// Gets a shared handle to the mesh in the given file, loading it if it isn't already
+	// (null if the file couldn't be loaded, which is tried again on the next call)
+	std::shared_ptr<Mesh> Load(const char* filename, VertexFormat format = VERTEX_FORMAT_FULL, bool clustered = false, bool progressive = false);
+
+	// Gets a copy of the hit, miss and memory counts
+	MeshCacheStats GetStats();
+
+	// Turns a path into the form used to look meshes up
+	// (forward slashes, no "." or ".." parts, lower case on Windows)
+	static std::string NormalizePath(const char* filename);
+
+private:
+	// One mesh, either alive or in the middle of loading
+	struct Entry
+	{
+		std::weak_ptr<Mesh> Loaded;
+		std::shared_future<std::shared_ptr<Mesh>> Loading;
+	};
+
+	// Called when the last handle to a mesh goes away
+	void Unload(const std::string& key, Mesh* mesh, unsigned long long bytes);
+
+	// Where loaded meshes put their geometry
+	GeometryPool* pool;
+
+	// Guards everything below
+	std::mutex mutex;
+	std::unordered_map<std::string, Entry> entries;
+	MeshCacheStats stats;
+};
@@ -0,0 +1,246 @@
+#include "MeshClusters.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Works out the bounding sphere and normal cone of a cluster
+// whose index range has already been set
+// --------------------------------------------------------
+static void CalculateClusterBounds(const Vertex* verts, const unsigned int* indices, MeshCluster& cluster)
+{
+	const unsigned int* clusterIndices = indices + cluster.FirstIndex;
+
+	// Sphere around the center of the cluster's box
+	XMVECTOR minV = XMLoadFloat3(&verts[clusterIndices[0]].Position);
+	XMVECTOR maxV = minV;
+	for (unsigned int i = 1; i < cluster.IndexCount; i++)
+	{
+		XMVECTOR p = XMLoadFloat3(&verts[clusterIndices[i]].Position);
+		minV = XMVectorMin(minV, p);
+		maxV = XMVectorMax(maxV, p);
+	}
+	XMVECTOR center = (minV + maxV) * 0.5f;
+	float radiusSq = 0;
+	for (unsigned int i = 0; i < cluster.IndexCount; i++)
+	{
+		XMVECTOR p = XMLoadFloat3(&verts[clusterIndices[i]].Position);
+		radiusSq = std::max(radiusSq, XMVectorGetX(XMVector3LengthSq(p - center)));
+	}
+	XMStoreFloat3(&cluster.Center, center);
+	cluster.Radius = sqrtf(radiusSq);
+
+	// The cone's axis is the average facing of the triangles
+	// (zero-area triangles don't face anywhere, so they're skipped)
+	unsigned int triCount = cluster.IndexCount / 3;
+	std::vector<XMVECTOR> normals;
+	normals.reserve(triCount);
+	XMVECTOR axis = XMVectorZero();
+	for (unsigned int t = 0; t < triCount; t++)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&verts[clusterIndices[t * 3]].Position);
+		XMVECTOR p1 = XMLoadFloat3(&verts[clusterIndices[t * 3 + 1]].Position);
+		XMVECTOR p2 = XMLoadFloat3(&verts[clusterIndices[t * 3 + 2]].Position);
+		XMVECTOR n = XMVector3Cross(p1 - p0, p2 - p0);
+		if (XMVectorGetX(XMVector3LengthSq(n)) == 0)
+		{
+			normals.push_back(XMVectorZero());
+			continue;
+		}
+		n = XMVector3Normalize(n);
+		normals.push_back(n);
+		axis += n;
+	}
+
+	// Triangles facing every which way can't be culled together
+	cluster.ConeCutoff = 2.0f;
+	cluster.ConeApex = cluster.Center;
+	cluster.ConeAxis = XMFLOAT3(0, 0, 0);
+	if (XMVectorGetX(XMVector3LengthSq(axis)) == 0)
+		return;
+	axis = XMVector3Normalize(axis);
+	XMStoreFloat3(&cluster.ConeAxis, axis);
+
+	// The cone's half angle reaches the triangle facing furthest from the axis
+	float minDot = 1.0f;
+	for (unsigned int t = 0; t < triCount; t++)
+	{
+		if (XMVectorGetX(XMVector3LengthSq(normals[t])) > 0)
+			minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(axis, normals[t])));
+	}
+
+	// Wider than about 84 degrees, almost no view would cull it anyway
+	if (minDot <= 0.1f)
+		return;
+
+	// Back the apex off along the axis until every triangle's
+	// plane is in front of it, so testing from the apex is safe
+	float maxT = 0;
+	for (unsigned int t = 0; t < triCount; t++)
+	{
+		if (XMVectorGetX(XMVector3LengthSq(normals[t])) == 0)
+			continue;
+		XMVECTOR p0 = XMLoadFloat3(&verts[clusterIndices[t * 3]].Position);
+		float distance = XMVectorGetX(XMVector3Dot(center - p0, normals[t]));
+		float alongAxis = XMVectorGetX(XMVector3Dot(axis, normals[t]));
+		maxT = std::max(maxT, distance / alongAxis);
+	}
+	XMStoreFloat3(&cluster.ConeApex, center - axis * maxT);
+	cluster.ConeCutoff = sqrtf(1.0f - minDot * minDot);
+}
+
+// --------------------------------------------------------
+// Splits a range of an index buffer into clusters
+//
+// - Triangles are taken in the order they're already in (which
+//    the vertex cache optimization has made spatially coherent),
+//    and a new cluster starts whenever the next triangle would
+//    go over CLUSTER_MAX_VERTICES or CLUSTER_MAX_TRIANGLES
+// - So each cluster is just a sub-range of the index buffer,
+//    and visible neighbours can still be drawn in one call
+//
+// verts      - The mesh's vertices
+// indices    - The mesh's whole index buffer
+// firstIndex - Where the range to split starts
+// indexCount - How long it is
+// clusters   - Filled with the clusters, in index buffer order
+// --------------------------------------------------------
+void BuildClusters(const Vertex* verts, const unsigned int* indices, unsigned int firstIndex, unsigned int indexCount, std::vector<MeshCluster>& clusters)
+{
+	clusters.clear();
+
+	MeshCluster cluster = {};
+	cluster.FirstIndex = firstIndex;
+	unsigned int clusterVerts[CLUSTER_MAX_VERTICES];
+	unsigned int clusterVertCount = 0;
+
+	for (unsigned int i = firstIndex; i + 2 < firstIndex + indexCount; i += 3)
+	{
+		// How many new verts would this triangle add?
+		unsigned int newVerts[3];
+		unsigned int newVertCount = 0;
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int v = indices[i + c];
+			bool found = std::find(clusterVerts, clusterVerts + clusterVertCount, v) != clusterVerts + clusterVertCount ||
+				std::find(newVerts, newVerts + newVertCount, v) != newVerts + newVertCount;
+			if (!found)
+				newVerts[newVertCount++] = v;
+		}
+
+		// Full?  Finish this cluster and start another
+		if (clusterVertCount + newVertCount > CLUSTER_MAX_VERTICES || cluster.IndexCount / 3 + 1 > CLUSTER_MAX_TRIANGLES)
+		{
+			CalculateClusterBounds(verts, indices, cluster);
+			clusters.push_back(cluster);
+
+			cluster = MeshCluster();
+			cluster.FirstIndex = i;
+			clusterVertCount = 0;
+			newVertCount = 0;
+			for (int c = 0; c < 3; c++)
+			{
+				unsigned int v = indices[i + c];
+				if (std::find(newVerts, newVerts + newVertCount, v) == newVerts + newVertCount)
+					newVerts[newVertCount++] = v;
+			}
+		}
+
+		for (unsigned int n = 0; n < newVertCount; n++)
+			clusterVerts[clusterVertCount++] = newVerts[n];
+		cluster.IndexCount += 3;
+	}
+
+	if (cluster.IndexCount > 0)
+	{
+		CalculateClusterBounds(verts, indices, cluster);
+		clusters.push_back(cluster);
+	}
+}
+
+// --------------------------------------------------------
+// Culls clusters that can't be seen
+//
+// - A cluster whose sphere is entirely behind any of the six
+//    frustum planes is off screen
+// - A cluster seen from inside its normal cone's shadow only
+//    has back faces toward the camera, which the rasterizer
+//    would throw away anyway (this holds in model space for any
+//    world matrix that doesn't mirror the mesh)
+// - Whatever is left is merged into as few ranges as possible
+//
+// clusters       - The clusters to test, in index buffer order
+// worldViewProj  - Model to clip space (row major, NOT transposed)
+// cameraPosition - The camera's position in model space
+// visible        - Filled with the ranges to draw
+// stats          - Added to with what was culled
+// --------------------------------------------------------
+void CullClusters(const MeshCluster* clusters, unsigned int clusterCount, const XMFLOAT4X4& worldViewProj, XMFLOAT3 cameraPosition, std::vector<IndexRange>& visible, ClusterCullStats& stats)
+{
+	visible.clear();
+
+	// Pull the frustum planes out of the matrix (Gribb and Hartmann),
+	// which puts them in model space, pointing inward
+	const XMFLOAT4X4& m = worldViewProj;
+	XMVECTOR col0 = XMVectorSet(m._11, m._21, m._31, m._41);
+	XMVECTOR col1 = XMVectorSet(m._12, m._22, m._32, m._42);
+	XMVECTOR col2 = XMVectorSet(m._13, m._23, m._33, m._43);
+	XMVECTOR col3 = XMVectorSet(m._14, m._24, m._34, m._44);
+	XMVECTOR planes[6] =
+	{
+		col3 + col0,	// Left
+		col3 - col0,	// Right
+		col3 + col1,	// Bottom
+		col3 - col1,	// Top
+		col2,			// Near
+		col3 - col2,	// Far
+	};
+	for (int p = 0; p < 6; p++)
+		planes[p] = XMPlaneNormalize(planes[p]);
+
+	XMVECTOR camera = XMLoadFloat3(&cameraPosition);
+	for (unsigned int i = 0; i < clusterCount; i++)
+	{
+		const MeshCluster& cluster = clusters[i];
+		unsigned int triCount = cluster.IndexCount / 3;
+		stats.ClustersTested++;
+		stats.TrianglesTested += triCount;
+
+		// Outside any plane?
+		XMVECTOR center = XMLoadFloat3(&cluster.Center);
+		bool outside = false;
+		for (int p = 0; p < 6 && !outside; p++)
+			outside = XMVectorGetX(XMPlaneDotCoord(planes[p], center)) < -cluster.Radius;
+		if (outside)
+		{
+			stats.ClustersFrustumCulled++;
+			stats.TrianglesCulled += triCount;
+			continue;
+		}
+
+		// Facing away?
+		XMVECTOR view = XMLoadFloat3(&cluster.ConeApex) - camera;
+		float viewLength = XMVectorGetX(XMVector3Length(view));
+		if (viewLength > 0 &&
+			XMVectorGetX(XMVector3Dot(view, XMLoadFloat3(&cluster.ConeAxis))) >= cluster.ConeCutoff * viewLength)
+		{
+			stats.ClustersBackfaceCulled++;
+			stats.TrianglesCulled += triCount;
+			continue;
+		}
+
+		// Visible, so either extend the last range or start a new one
+		if (!visible.empty() && visible.back().FirstIndex + visible.back().IndexCount == cluster.FirstIndex)
+		{
+			visible.back().IndexCount += cluster.IndexCount;
+		}
+		else
+		{
+			IndexRange range = { cluster.FirstIndex, cluster.IndexCount };
+			visible.push_back(range);
+		}
+	}
+
+	stats.RangesDrawn += (unsigned int)visible.size();
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Vertex.h"
+#include <DirectXMath.h>
+#include <vector>
+
+// The most vertices and triangles one cluster can hold
+// (the sizes GPUs work best with for meshlets)
+const unsigned int CLUSTER_MAX_VERTICES = 64;
+const unsigned int CLUSTER_MAX_TRIANGLES = 124;
+
+// --------------------------------------------------------
+// A small run of a mesh's triangles that can be culled as
+// a unit, in the mesh's model space
+//
+// - The bounding sphere is for frustum culling
+// - The normal cone covers every triangle's facing: when the
+//    camera is inside the cone's "shadow" behind the apex,
+//    every triangle faces away and the cluster can be skipped
+// --------------------------------------------------------
+struct MeshCluster
+{
+	unsigned int FirstIndex;	// Where this cluster's indices start
+	unsigned int IndexCount;	// How many indices it has
+
+	DirectX::XMFLOAT3 Center;	// Bounding sphere
+	float Radius;
+
+	DirectX::XMFLOAT3 ConeApex;	// Normal cone
+	DirectX::XMFLOAT3 ConeAxis;
+	float ConeCutoff;			// Sine of the cone's half angle (above 1 when it can't be culled)
+};
+
+// --------------------------------------------------------
+// A run of indices to draw with one DrawIndexed() call
+// --------------------------------------------------------
+struct IndexRange
+{
+	unsigned int FirstIndex;
+	unsigned int IndexCount;
+};
+
+// --------------------------------------------------------
+// How much a culling pass threw away
+// --------------------------------------------------------
+struct ClusterCullStats
+{
+	unsigned int ClustersTested;
+	unsigned int ClustersFrustumCulled;		// Entirely outside the view
+	unsigned int ClustersBackfaceCulled;	// Every triangle facing away
+	unsigned int TrianglesTested;
+	unsigned int TrianglesCulled;
+	unsigned int RangesDrawn;				// Draw calls left after merging neighbours
+};
+
+// Splits a range of an index buffer into clusters, in order, without moving any indices
+void BuildClusters(const Vertex* verts, const unsigned int* indices, unsigned int firstIndex, unsigned int indexCount, std::vector<MeshCluster>& clusters);
+
+// Culls clusters against a frustum and camera (both in the clusters' model space),
+// filling "visible" with the index ranges that are left
+void CullClusters(const MeshCluster* clusters, unsigned int clusterCount, const DirectX::XMFLOAT4X4& worldViewProj, DirectX::XMFLOAT3 cameraPosition, std::vector<IndexRange>& visible, ClusterCullStats& stats);
@@ -0,0 +1,353 @@
+#include "MeshCodec.h"
+#include "Vertex.h"
+#include <cstring>
+
+// --------------------------------------------------------
+// Helpers for variable length numbers
+//
+// - Varints store 7 bits per byte, low bits first, with the
+//    top bit set on every byte but the last
+// - LZ lengths are a run of 255s plus whatever's left over,
+//    added onto the 4 bits already in the token
+// --------------------------------------------------------
+static void WriteVarint(std::vector<unsigned char>& out, unsigned long long value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((unsigned char)value);
+}
+
+static bool ReadVarint(const unsigned char*& p, const unsigned char* end, unsigned long long& value)
+{
+	value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		if (p == end)
+			return false;
+		unsigned char byte = *p++;
+		value |= (unsigned long long)(byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+			return true;
+	}
+	return false;
+}
+
+static void WriteLength(std::vector<unsigned char>& out, size_t length)
+{
+	while (length >= 255)
+	{
+		out.push_back(255);
+		length -= 255;
+	}
+	out.push_back((unsigned char)length);
+}
+
+static bool ReadLength(const unsigned char*& p, const unsigned char* end, size_t& length)
+{
+	unsigned char byte;
+	do
+	{
+		if (p == end)
+			return false;
+		byte = *p++;
+		length += byte;
+	} while (byte == 255);
+	return true;
+}
+
+// Hashes the 4 bytes at "p", for finding earlier copies of them
+static unsigned int HashFour(const unsigned char* p)
+{
+	unsigned int value;
+	memcpy(&value, p, sizeof(value));
+	return (value * 2654435761u) >> (32 - MESH_CODEC_HASH_BITS);
+}
+
+// --------------------------------------------------------
+// Writes one LZ sequence: some literal bytes, then (unless
+// it's the last sequence) a match to copy from earlier on
+//
+// - The token holds both lengths in 4 bits each, with 15
+//    meaning "more follows"
+// --------------------------------------------------------
+static void WriteSequence(std::vector<unsigned char>& out, const unsigned char* literals, size_t literalCount, size_t offset, size_t matchLength)
+{
+	size_t matchCode = matchLength ? matchLength - MESH_CODEC_MIN_MATCH : 0;
+	out.push_back((unsigned char)(((literalCount < 15 ? literalCount : 15) << 4) | (matchCode < 15 ? matchCode : 15)));
+	if (literalCount >= 15)
+		WriteLength(out, literalCount - 15);
+	out.insert(out.end(), literals, literals + literalCount);
+
+	if (matchLength == 0)
+		return;
+	out.push_back((unsigned char)(offset & 0xFF));
+	out.push_back((unsigned char)(offset >> 8));
+	if (matchCode >= 15)
+		WriteLength(out, matchCode - 15);
+}
+
+// --------------------------------------------------------
+// Compresses a block of bytes
+//
+// - Starts with the uncompressed size (as a varint), then
+//    LZ sequences until the end of the block
+// - Matches are found with a single-entry hash table, which
+//    is greedy but fast, and filtered mesh data is repetitive
+//    enough that it finds most of what there is
+// --------------------------------------------------------
+void CompressBytes(const unsigned char* data, size_t size, std::vector<unsigned char>& out)
+{
+	out.clear();
+	out.reserve(size / 2 + 16);
+	WriteVarint(out, size);
+
+	const size_t empty = (size_t)-1;
+	std::vector<size_t> table((size_t)1 << MESH_CODEC_HASH_BITS, empty);
+
+	size_t anchor = 0;
+	size_t i = 0;
+	while (i + MESH_CODEC_MIN_MATCH <= size)
+	{
+		unsigned int hash = HashFour(data + i);
+		size_t candidate = table[hash];
+		table[hash] = i;
+
+		if (candidate == empty || i - candidate > MESH_CODEC_WINDOW || memcmp(data + candidate, data + i, MESH_CODEC_MIN_MATCH) != 0)
+		{
+			i++;
+			continue;
+		}
+
+		// Extend the match as far as it goes
+		size_t length = MESH_CODEC_MIN_MATCH;
+		while (i + length < size && data[candidate + length] == data[i + length])
+			length++;
+
+		WriteSequence(out, data + anchor, i - anchor, i - candidate, length);
+		i += length;
+		anchor = i;
+	}
+
+	// Whatever's left is literals
+	WriteSequence(out, data + anchor, size - anchor, 0, 0);
+}
+
+bool DecompressBytes(const unsigned char* data, size_t size, size_t maxSize, std::vector<unsigned char>& out)
+{
+	const unsigned char* p = data;
+	const unsigned char* end = data + size;
+
+	unsigned long long rawSize;
+	if (!ReadVarint(p, end, rawSize) || rawSize > maxSize)
+		return false;
+	out.resize((size_t)rawSize);
+
+	unsigned char* start = out.data();
+	unsigned char* o = start;
+	unsigned char* outEnd = start + out.size();
+
+	while (p < end)
+	{
+		// Literals
+		unsigned char token = *p++;
+		size_t literalCount = token >> 4;
+		if (literalCount == 15 && !ReadLength(p, end, literalCount))
+			return false;
+		if (literalCount > (size_t)(end - p) || literalCount > (size_t)(outEnd - o))
+			return false;
+
+		// Short runs are copied as one fixed size block when there's room to,
+		// which is much quicker than a memcpy() of some unknown size
+		if (literalCount <= 16 && end - p >= 16 && outEnd - o >= 16)
+			memcpy(o, p, 16);
+		else
+			memcpy(o, p, literalCount);
+		o += literalCount;
+		p += literalCount;
+
+		// The last sequence has no match
+		if (p == end)
+			break;
+
+		// Match
+		if (end - p < 2)
+			return false;
+		size_t offset = p[0] | (p[1] << 8);
+		p += 2;
+		size_t length = (token & 15) + MESH_CODEC_MIN_MATCH;
+		if ((token & 15) == 15 && !ReadLength(p, end, length))
+			return false;
+		if (offset == 0 || offset > (size_t)(o - start) || length > (size_t)(outEnd - o))
+			return false;
+
+		// Copy it, a whole repeat of the pattern at a time when it overlaps itself
+		const unsigned char* from = o - offset;
+		if (length <= 16 && offset >= 16 && outEnd - o >= 16)
+			memcpy(o, from, 16);
+		else if (offset == 1)
+			memset(o, *from, length);
+		else if (offset >= length)
+			memcpy(o, from, length);
+		else
+		{
+			for (size_t copied = 0; copied < length; copied += offset)
+				memcpy(o + copied, from + copied, length - copied < offset ? length - copied : offset);
+		}
+		o += length;
+	}
+
+	return o == outEnd;
+}
+
+// --------------------------------------------------------
+// Compresses vertices of any layout
+//
+// - Byte k of every vertex goes in plane k, as the difference
+//    from byte k of the vertex before it (wrapping around), so
+//    bytes that rarely change (like the top bytes of floats)
+//    become long runs of zeros
+//
+// vertices - The vertex array
+// count    - How many vertices there are
+// stride   - The size of each vertex in bytes
+// out      - Filled with the compressed data
+// --------------------------------------------------------
+void EncodeVertexBuffer(const void* vertices, unsigned int count, unsigned int stride, std::vector<unsigned char>& out)
+{
+	const unsigned char* source = (const unsigned char*)vertices;
+	std::vector<unsigned char> planes((size_t)count * stride);
+
+	for (unsigned int k = 0; k < stride; k++)
+	{
+		unsigned char* plane = planes.data() + (size_t)k * count;
+		unsigned char previous = 0;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			unsigned char byte = source[(size_t)i * stride + k];
+			plane[i] = (unsigned char)(byte - previous);
+			previous = byte;
+		}
+	}
+
+	CompressBytes(planes.data(), planes.size(), out);
+}
+
+// --------------------------------------------------------
+// Undoes the byte plane deltas, putting each byte back in
+// its vertex
+//
+// - One whole vertex at a time, so the writes are in order and
+//    each vertex's bytes are just the last one's plus the deltas
+// - The common strides get their own copy of the loop, so the
+//    compiler can unroll it
+// --------------------------------------------------------
+template <unsigned int Stride>
+static void UndoVertexDeltas(const unsigned char* planes, unsigned char* vertices, unsigned int count, unsigned int stride)
+{
+	if (Stride != 0)
+		stride = Stride;
+
+	if (count == 0)
+		return;
+	for (unsigned int k = 0; k < stride; k++)
+		vertices[k] = planes[(size_t)k * count];
+
+	for (unsigned int i = 1; i < count; i++)
+	{
+		unsigned char* vertex = vertices + (size_t)i * stride;
+		const unsigned char* previous = vertex - stride;
+		for (unsigned int k = 0; k < stride; k++)
+			vertex[k] = (unsigned char)(previous[k] + planes[(size_t)k * count + i]);
+	}
+}
+
+bool DecodeVertexBuffer(const unsigned char* data, size_t size, void* vertices, unsigned int count, unsigned int stride)
+{
+	std::vector<unsigned char> planes;
+	if (!DecompressBytes(data, size, (size_t)count * stride, planes) || planes.size() != (size_t)count * stride)
+		return false;
+
+	if (stride == sizeof(Vertex))
+		UndoVertexDeltas<sizeof(Vertex)>(planes.data(), (unsigned char*)vertices, count, stride);
+	else if (stride == sizeof(PackedVertex))
+		UndoVertexDeltas<sizeof(PackedVertex)>(planes.data(), (unsigned char*)vertices, count, stride);
+	else
+		UndoVertexDeltas<0>(planes.data(), (unsigned char*)vertices, count, stride);
+	return true;
+}
+
+// --------------------------------------------------------
+// Compresses a triangle list's indices
+//
+// - Each index is stored as the difference from the one
+//    before it: after OptimizeVertexCache() neighbouring
+//    triangles share verts, and after OptimizeVertexFetch()
+//    those verts are next to each other, so most differences
+//    are small (even in the simpler levels of detail)
+// - Those are zigzag encoded, so small negative numbers are
+//    small too, and written as varints
+//
+// indices - The 32 bit indices
+// count   - How many there are
+// out     - Filled with the compressed data
+// --------------------------------------------------------
+void EncodeIndexBuffer(const unsigned int* indices, unsigned int count, std::vector<unsigned char>& out)
+{
+	std::vector<unsigned char> codes;
+	codes.reserve(count);
+
+	unsigned int previous = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		int delta = (int)(indices[i] - previous);
+		WriteVarint(codes, (unsigned int)((delta << 1) ^ (delta >> 31)));
+		previous = indices[i];
+	}
+
+	CompressBytes(codes.data(), codes.size(), out);
+}
+
+// --------------------------------------------------------
+// Undoes the varints and deltas, writing whichever size of
+// index the caller asked for
+// --------------------------------------------------------
+template <typename IndexType>
+static bool DecodeIndexDeltas(const unsigned char* p, const unsigned char* end, IndexType* indices, unsigned int count)
+{
+	unsigned int previous = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		// Most codes are a single byte
+		unsigned int code;
+		if (p < end && *p < 0x80)
+			code = *p++;
+		else
+		{
+			unsigned long long longCode;
+			if (!ReadVarint(p, end, longCode))
+				return false;
+			code = (unsigned int)longCode;
+		}
+
+		previous += (code >> 1) ^ (0u - (code & 1));
+		indices[i] = (IndexType)previous;
+	}
+	return p == end;
+}
+
+bool DecodeIndexBuffer(const unsigned char* data, size_t size, void* indices, unsigned int count, unsigned int indexStride)
+{
+	// Each index's varint is at most 5 bytes
+	std::vector<unsigned char> codes;
+	if (!DecompressBytes(data, size, (size_t)count * 5, codes))
+		return false;
+
+	const unsigned char* p = codes.data();
+	const unsigned char* end = p + codes.size();
+	if (indexStride == sizeof(unsigned short))
+		return DecodeIndexDeltas(p, end, (unsigned short*)indices, count);
+	return DecodeIndexDeltas(p, end, (unsigned int*)indices, count);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+// Shortest run of bytes the LZ stage will encode as a match,
+// and how many bits of hash it uses to find them
+const unsigned int MESH_CODEC_MIN_MATCH = 4;
+const unsigned int MESH_CODEC_HASH_BITS = 14;
+
+// Furthest back a match can point (offsets are stored in 16 bits)
+const unsigned int MESH_CODEC_WINDOW = 0xFFFF;
+
+// --------------------------------------------------------
+// Lossless compression for vertex and index buffers
+//
+// - Vertices are split into byte planes (every vertex's first
+//    byte, then every vertex's second byte...) and each byte is
+//    stored as the difference from the vertex before it, which
+//    turns slowly changing data into long runs of small values
+// - Indices are stored as the difference from the index before
+//    them, which is small once a mesh has been through
+//    OptimizeMesh(), written as zigzag varints
+// - Both are then run through a small LZ77 stage (in the style
+//    of LZ4) which is simple enough to decode at over a GB/s
+// --------------------------------------------------------
+
+// Compresses any block of bytes with the LZ stage
+void CompressBytes(const unsigned char* data, size_t size, std::vector<unsigned char>& out);
+
+// Decompresses a block from CompressBytes().  Returns false if it's corrupt, or would be bigger than maxSize.
+bool DecompressBytes(const unsigned char* data, size_t size, size_t maxSize, std::vector<unsigned char>& out);
+
+// Filters and compresses "count" vertices, "stride" bytes each
+void EncodeVertexBuffer(const void* vertices, unsigned int count, unsigned int stride, std::vector<unsigned char>& out);
+
+// Decodes exactly "count" vertices into "vertices".  Returns false if the data is corrupt.
+bool DecodeVertexBuffer(const unsigned char* data, size_t size, void* vertices, unsigned int count, unsigned int stride);
+
+// Encodes and compresses "count" indices
+void EncodeIndexBuffer(const unsigned int* indices, unsigned int count, std::vector<unsigned char>& out);
+
+// Decodes exactly "count" indices into "indices", as 2 or 4 byte values.  Returns false if the data is corrupt.
+bool DecodeIndexBuffer(const unsigned char* data, size_t size, void* indices, unsigned int count, unsigned int indexStride);
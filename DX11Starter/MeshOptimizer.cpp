@@ -0,0 +1,502 @@
+#include "MeshOptimizer.h"
+#include "ObjLoader.h"
+#include <algorithm>
+#include <string>
+#include <chrono>
+#include <cstdio>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Which triangles use each vertex, stored as one flat list
+// with an offset into it per vertex
+// --------------------------------------------------------
+struct TriangleAdjacency
+{
+	std::vector<unsigned int> Counts;	// Triangles using each vertex
+	std::vector<unsigned int> Offsets;	// Where each vertex's triangles start in Triangles
+	std::vector<unsigned int> Triangles;
+};
+
+static void BuildAdjacency(const unsigned int* indices, size_t numIndices, size_t numVerts, TriangleAdjacency& adjacency)
+{
+	adjacency.Counts.assign(numVerts, 0);
+	adjacency.Offsets.resize(numVerts);
+	adjacency.Triangles.resize(numIndices);
+
+	for (size_t i = 0; i < numIndices; i++)
+		adjacency.Counts[indices[i]]++;
+
+	unsigned int offset = 0;
+	for (size_t v = 0; v < numVerts; v++)
+	{
+		adjacency.Offsets[v] = offset;
+		offset += adjacency.Counts[v];
+	}
+
+	// Fill in the lists, using the offsets as write cursors and then putting them back
+	for (size_t i = 0; i < numIndices; i++)
+		adjacency.Triangles[adjacency.Offsets[indices[i]]++] = (unsigned int)(i / 3);
+	for (size_t v = 0; v < numVerts; v++)
+		adjacency.Offsets[v] -= adjacency.Counts[v];
+}
+
+// --------------------------------------------------------
+// Runs every optimization, in order, on a welded mesh:
+//  1. Triangle order for the post-transform vertex cache
+//  2. Cluster order for less overdraw (barely hurting step 1)
+//  3. Vertex order for the pre-transform fetch from memory
+//
+// - With "rangeStarts", steps 1 and 2 run on each range on its
+//    own (so triangles never leave their material's range), and
+//    step 3 runs over all of them
+// --------------------------------------------------------
+void OptimizeMesh(std::vector<Vertex>& verts, std::vector<unsigned int>& indices, const std::vector<unsigned int>* rangeStarts)
+{
+	if (verts.empty() || indices.size() < 3)
+		return;
+
+	std::vector<unsigned int> clusters;
+	size_t rangeCount = rangeStarts ? rangeStarts->size() : 1;
+	for (size_t r = 0; r < rangeCount; r++)
+	{
+		size_t first = rangeStarts ? (*rangeStarts)[r] : 0;
+		size_t last = rangeStarts && r + 1 < rangeCount ? (*rangeStarts)[r + 1] : indices.size();
+		if (last - first < 3)
+			continue;
+
+		OptimizeVertexCache(&indices[first], last - first, verts.size(), clusters);
+		OptimizeOverdraw(&indices[first], last - first, &verts[0], verts.size(), clusters, OVERDRAW_CACHE_THRESHOLD);
+	}
+
+	size_t usedVerts = OptimizeVertexFetch(&verts[0], verts.size(), &indices[0], indices.size());
+	verts.resize(usedVerts);
+}
+
+// --------------------------------------------------------
+// Reorders triangles for the post-transform vertex cache
+//
+// - This is "Tipsify" from Sander, Nehab and Barczak's "Fast
+//    Triangle Reordering for Vertex Locality and Reduced Overdraw"
+// - It fans out around one vertex at a time, emitting all of its
+//    remaining triangles, then moves on to the neighbour that is
+//    most likely to still be in the cache
+// - When no neighbour qualifies it jumps elsewhere, which starts
+//    a new cluster (recorded for OptimizeOverdraw)
+//
+// indices    - The index buffer, reordered in place
+// numVerts   - How many vertices the indices refer to
+// clusters   - Filled with the first triangle of each cluster
+// --------------------------------------------------------
+void OptimizeVertexCache(unsigned int* indices, size_t numIndices, size_t numVerts, std::vector<unsigned int>& clusters)
+{
+	const int cacheSize = (int)VERTEX_CACHE_SIZE;
+	size_t numTris = numIndices / 3;
+	clusters.clear();
+	if (numTris == 0)
+		return;
+
+	TriangleAdjacency adjacency;
+	BuildAdjacency(indices, numIndices, numVerts, adjacency);
+
+	// Live triangle counts start out as every triangle using the vertex
+	std::vector<unsigned int> liveTris(adjacency.Counts);
+
+	std::vector<int> cacheTime(numVerts, 0);	// When each vertex last entered the cache
+	std::vector<bool> emitted(numTris, false);
+	std::vector<unsigned int> deadEnds;			// Recently used verts, for when we get stuck
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> output;
+	output.reserve(numIndices);
+
+	int timestamp = cacheSize + 1;
+	size_t cursor = 0;							// Next vertex to try in input order
+	int fanVertex = 0;
+	clusters.push_back(0);
+
+	while (fanVertex >= 0)
+	{
+		candidates.clear();
+
+		// Emit every remaining triangle around the fanning vertex
+		unsigned int start = adjacency.Offsets[fanVertex];
+		unsigned int count = adjacency.Counts[fanVertex];
+		for (unsigned int t = start; t < start + count; t++)
+		{
+			unsigned int tri = adjacency.Triangles[t];
+			if (emitted[tri])
+				continue;
+
+			for (int c = 0; c < 3; c++)
+			{
+				unsigned int v = indices[tri * 3 + c];
+				output.push_back(v);
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				liveTris[v]--;
+
+				// Not in the cache any more?  It gets loaded again
+				if (timestamp - cacheTime[v] > cacheSize)
+					cacheTime[v] = timestamp++;
+			}
+			emitted[tri] = true;
+		}
+
+		// Pick the candidate that will still be in the cache after
+		// its remaining triangles are emitted, preferring older ones
+		int best = -1;
+		int bestPriority = -1;
+		for (unsigned int v : candidates)
+		{
+			if (liveTris[v] == 0)
+				continue;
+
+			int priority = 0;
+			if (timestamp - cacheTime[v] + 2 * (int)liveTris[v] <= cacheSize)
+				priority = timestamp - cacheTime[v];
+
+			if (priority > bestPriority)
+			{
+				best = (int)v;
+				bestPriority = priority;
+			}
+		}
+
+		// Stuck?  Back up to a recently used vertex, or failing that
+		// the next unfinished one in input order.  Either way the cache
+		// won't help much, so this starts a new cluster.
+		if (best == -1)
+		{
+			while (!deadEnds.empty() && best == -1)
+			{
+				unsigned int v = deadEnds.back();
+				deadEnds.pop_back();
+				if (liveTris[v] > 0)
+					best = (int)v;
+			}
+
+			while (best == -1 && cursor < numVerts)
+			{
+				if (liveTris[cursor] > 0)
+					best = (int)cursor;
+				cursor++;
+			}
+
+			unsigned int trisSoFar = (unsigned int)(output.size() / 3);
+			if (best != -1 && trisSoFar > clusters.back())
+				clusters.push_back(trisSoFar);
+		}
+
+		fanVertex = best;
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+// --------------------------------------------------------
+// Counts the misses a run of indices makes in the simulated
+// cache, starting from a cold cache
+//
+// - Moving the timestamp forward by a whole cache's worth makes
+//    every vertex look stale, which empties the cache for free
+// --------------------------------------------------------
+static unsigned int SimulateCacheMisses(const unsigned int* indices, size_t numIndices, std::vector<int>& cacheTime, int& timestamp)
+{
+	timestamp += VERTEX_CACHE_SIZE;
+
+	unsigned int misses = 0;
+	for (size_t i = 0; i < numIndices; i++)
+	{
+		unsigned int v = indices[i];
+		if (timestamp - cacheTime[v] > (int)VERTEX_CACHE_SIZE)
+		{
+			cacheTime[v] = timestamp++;
+			misses++;
+		}
+	}
+	return misses;
+}
+
+// --------------------------------------------------------
+// Reorders clusters of triangles to reduce overdraw
+//
+// - Also from Sander et al.  Clusters facing away from the
+//    middle of the mesh are drawn first, since they tend to
+//    hide the rest of it
+// - Clusters are first split further wherever their vertex
+//    cache efficiency is already within "threshold" of the
+//    whole cluster's, giving more freedom to reorder
+//
+// indices   - The index buffer, reordered in place
+// verts     - The vertices, for positions
+// clusters  - The first triangle of each cluster, from OptimizeVertexCache
+// threshold - How much worse the cache efficiency may get (1.05 = 5%)
+// --------------------------------------------------------
+void OptimizeOverdraw(unsigned int* indices, size_t numIndices, const Vertex* verts, size_t numVerts, const std::vector<unsigned int>& clusters, float threshold)
+{
+	size_t numTris = numIndices / 3;
+	if (numTris == 0 || clusters.empty())
+		return;
+
+	// Split clusters at "soft" boundaries, simulating the cache as we go
+	std::vector<int> cacheTime(numVerts, 0);
+	int timestamp = VERTEX_CACHE_SIZE + 1;
+	std::vector<unsigned int> softClusters;
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		unsigned int start = clusters[c];
+		unsigned int end = c + 1 < clusters.size() ? clusters[c + 1] : (unsigned int)numTris;
+		if (start >= end)
+			continue;
+
+		// How good is the cache efficiency of the whole cluster?
+		unsigned int wholeMisses = SimulateCacheMisses(indices + start * 3, (end - start) * 3, cacheTime, timestamp);
+		float target = (float)wholeMisses / (end - start) * threshold;
+
+		// Walk the cluster from a cold cache, cutting it whenever
+		// the piece so far is already efficient enough
+		timestamp += VERTEX_CACHE_SIZE;
+		softClusters.push_back(start);
+		unsigned int pieceStart = start;
+		unsigned int misses = 0;
+		for (unsigned int t = start; t < end; t++)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				unsigned int v = indices[t * 3 + i];
+				if (timestamp - cacheTime[v] > (int)VERTEX_CACHE_SIZE)
+				{
+					cacheTime[v] = timestamp++;
+					misses++;
+				}
+			}
+
+			if (t + 1 < end && (float)misses / (t + 1 - pieceStart) <= target)
+			{
+				softClusters.push_back(t + 1);
+				pieceStart = t + 1;
+				misses = 0;
+				timestamp += VERTEX_CACHE_SIZE;
+			}
+		}
+	}
+
+	// Centre of the whole mesh, weighted by triangle area
+	std::vector<XMFLOAT3> triCentroids(numTris);
+	std::vector<XMFLOAT3> triNormals(numTris);	// Length is twice the triangle's area
+	XMVECTOR meshCentroid = XMVectorZero();
+	float meshArea = 0;
+	for (size_t t = 0; t < numTris; t++)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&verts[indices[t * 3 + 0]].Position);
+		XMVECTOR p1 = XMLoadFloat3(&verts[indices[t * 3 + 1]].Position);
+		XMVECTOR p2 = XMLoadFloat3(&verts[indices[t * 3 + 2]].Position);
+		XMVECTOR centroid = (p0 + p1 + p2) / 3.0f;
+		XMVECTOR normal = XMVector3Cross(p1 - p0, p2 - p0);
+		float area = XMVectorGetX(XMVector3Length(normal));
+
+		XMStoreFloat3(&triCentroids[t], centroid);
+		XMStoreFloat3(&triNormals[t], normal);
+		meshCentroid += centroid * area;
+		meshArea += area;
+	}
+	if (meshArea > 0)
+		meshCentroid = meshCentroid / meshArea;
+
+	// Score each cluster by how far it faces out from the centre
+	struct ClusterSort { float Key; unsigned int Cluster; };
+	std::vector<ClusterSort> sorted(softClusters.size());
+	for (size_t c = 0; c < softClusters.size(); c++)
+	{
+		unsigned int start = softClusters[c];
+		unsigned int end = c + 1 < softClusters.size() ? softClusters[c + 1] : (unsigned int)numTris;
+
+		XMVECTOR centroid = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		float area = 0;
+		for (unsigned int t = start; t < end; t++)
+		{
+			XMVECTOR triNormal = XMLoadFloat3(&triNormals[t]);
+			float triArea = XMVectorGetX(XMVector3Length(triNormal));
+			centroid += XMLoadFloat3(&triCentroids[t]) * triArea;
+			normal += triNormal;
+			area += triArea;
+		}
+		if (area > 0)
+			centroid = centroid / area;
+
+		sorted[c].Key = XMVectorGetX(XMVector3Dot(centroid - meshCentroid, XMVector3Normalize(normal)));
+		sorted[c].Cluster = (unsigned int)c;
+	}
+
+	// Outward-facing clusters first (ties keep their cache-friendly order)
+	std::stable_sort(sorted.begin(), sorted.end(),
+		[](const ClusterSort& a, const ClusterSort& b) { return a.Key > b.Key; });
+
+	std::vector<unsigned int> output;
+	output.reserve(numTris * 3);
+	for (const ClusterSort& s : sorted)
+	{
+		unsigned int start = softClusters[s.Cluster];
+		unsigned int end = s.Cluster + 1 < softClusters.size() ? softClusters[s.Cluster + 1] : (unsigned int)numTris;
+		output.insert(output.end(), indices + start * 3, indices + end * 3);
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+// --------------------------------------------------------
+// Reorders vertices into the order the index buffer first
+// uses them, so vertex fetches walk forward through memory
+//
+// verts   - The vertices, reordered in place
+// indices - The index buffer, rewritten to match
+//
+// Returns how many vertices are used; any unused ones end up
+// at the back of the array and can be dropped
+// --------------------------------------------------------
+size_t OptimizeVertexFetch(Vertex* verts, size_t numVerts, unsigned int* indices, size_t numIndices)
+{
+	const unsigned int unused = 0xFFFFFFFF;
+	std::vector<unsigned int> remap(numVerts, unused);
+	std::vector<Vertex> reordered;
+	reordered.reserve(numVerts);
+
+	for (size_t i = 0; i < numIndices; i++)
+	{
+		unsigned int& newIndex = remap[indices[i]];
+		if (newIndex == unused)
+		{
+			newIndex = (unsigned int)reordered.size();
+			reordered.push_back(verts[indices[i]]);
+		}
+		indices[i] = newIndex;
+	}
+
+	std::copy(reordered.begin(), reordered.end(), verts);
+	return reordered.size();
+}
+
+// --------------------------------------------------------
+// Simulates a FIFO post-transform vertex cache
+//
+// indices   - The index buffer to draw
+// numVerts  - How many vertices the indices refer to
+// cacheSize - How many vertices the cache holds
+// --------------------------------------------------------
+VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t numIndices, size_t numVerts, unsigned int cacheSize)
+{
+	VertexCacheStats stats = {};
+	std::vector<unsigned int> cacheTime(numVerts, 0);
+	unsigned int timestamp = cacheSize + 1;
+	std::vector<bool> used(numVerts, false);
+	size_t usedVerts = 0;
+
+	for (size_t i = 0; i < numIndices; i++)
+	{
+		unsigned int v = indices[i];
+		if (timestamp - cacheTime[v] > cacheSize)
+		{
+			cacheTime[v] = timestamp++;
+			stats.VerticesTransformed++;
+		}
+		if (!used[v])
+		{
+			used[v] = true;
+			usedVerts++;
+		}
+	}
+
+	size_t numTris = numIndices / 3;
+	stats.ACMR = numTris ? (float)stats.VerticesTransformed / numTris : 0;
+	stats.ATVR = usedVerts ? (float)stats.VerticesTransformed / usedVerts : 0;
+	return stats;
+}
+
+// --------------------------------------------------------
+// Simulates fetching vertices through a small cache of
+// 64 byte lines, the way the input assembler reads memory
+//
+// indices    - The index buffer to draw
+// numVerts   - How many vertices the indices refer to
+// vertexSize - Size in bytes of one vertex
+// --------------------------------------------------------
+VertexFetchStats AnalyzeVertexFetch(const unsigned int* indices, size_t numIndices, size_t numVerts, size_t vertexSize)
+{
+	const size_t lineSize = 64;
+	const size_t lineCount = 64;	// A 4KB fully associative cache, evicting oldest first
+
+	VertexFetchStats stats = {};
+	std::vector<size_t> cache;
+	cache.reserve(lineCount);
+	size_t nextEvict = 0;
+
+	for (size_t i = 0; i < numIndices; i++)
+	{
+		size_t first = indices[i] * vertexSize / lineSize;
+		size_t last = (indices[i] * vertexSize + vertexSize - 1) / lineSize;
+		for (size_t line = first; line <= last; line++)
+		{
+			if (std::find(cache.begin(), cache.end(), line) != cache.end())
+				continue;
+
+			stats.BytesFetched += (unsigned int)lineSize;
+			if (cache.size() < lineCount)
+				cache.push_back(line);
+			else
+			{
+				cache[nextEvict] = line;
+				nextEvict = (nextEvict + 1) % lineCount;
+			}
+		}
+	}
+
+	stats.Overfetch = numVerts ? (float)stats.BytesFetched / (numVerts * vertexSize) : 0;
+	return stats;
+}
+
+// --------------------------------------------------------
+// Measures what OptimizeMesh() does for each sample model
+//
+// - "Before" is the order welding leaves the triangles and
+//    vertices in, which is the order they were in the file
+// - Fetches are measured for full vertices, which is what
+//    the optimizer is given
+// --------------------------------------------------------
+void BenchmarkMeshOptimizer(const char* modelDirectory)
+{
+	static const char* models[] = { "cube.obj", "sphere.obj", "cylinder.obj", "cone.obj", "torus.obj", "helix.obj" };
+
+	printf("\nMesh optimizer (before -> after):");
+	for (int m = 0; m < 6; m++)
+	{
+		std::string filename = std::string(modelDirectory) + "/" + models[m];
+		ObjData obj;
+		if (!LoadObj(filename.c_str(), obj, 1))
+		{
+			printf("\n  %s: couldn't be read", models[m]);
+			continue;
+		}
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+		BuildIndexedMesh(obj, verts, indices);
+		if (verts.empty() || indices.empty())
+			continue;
+
+		VertexCacheStats cacheBefore = AnalyzeVertexCache(&indices[0], indices.size(), verts.size(), VERTEX_CACHE_SIZE);
+		VertexFetchStats fetchBefore = AnalyzeVertexFetch(&indices[0], indices.size(), verts.size(), sizeof(Vertex));
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		OptimizeMesh(verts, indices);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		VertexCacheStats cacheAfter = AnalyzeVertexCache(&indices[0], indices.size(), verts.size(), VERTEX_CACHE_SIZE);
+		VertexFetchStats fetchAfter = AnalyzeVertexFetch(&indices[0], indices.size(), verts.size(), sizeof(Vertex));
+		printf("\n  %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, overfetch %.3f -> %.3f (%u triangles in %.2f ms)",
+			models[m],
+			cacheBefore.ACMR, cacheAfter.ACMR,
+			cacheBefore.ATVR, cacheAfter.ATVR,
+			fetchBefore.Overfetch, fetchAfter.Overfetch,
+			(unsigned int)indices.size() / 3, ms);
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Vertex.h"
+#include <vector>
+
+// How many vertices the simulated post-transform cache holds
+const unsigned int VERTEX_CACHE_SIZE = 16;
+
+// How much worse than the best possible vertex cache efficiency
+// the overdraw step is allowed to make a cluster (1.05 = 5%)
+const float OVERDRAW_CACHE_THRESHOLD = 1.05f;
+
+// --------------------------------------------------------
+// Results of running an index buffer through a simulated
+// FIFO post-transform vertex cache
+// --------------------------------------------------------
+struct VertexCacheStats
+{
+	unsigned int VerticesTransformed;	// Cache misses
+	float ACMR;							// Average cache miss ratio: misses per triangle (0.5 is ideal, 3 is worst)
+	float ATVR;							// Average transform to vertex ratio: misses per vertex (1 is ideal)
+};
+
+// --------------------------------------------------------
+// Results of simulating the memory reads the input assembler
+// makes while fetching vertices
+// --------------------------------------------------------
+struct VertexFetchStats
+{
+	unsigned int BytesFetched;	// Cache-line sized reads made
+	float Overfetch;			// Bytes fetched per byte of vertex data (1 is ideal)
+};
+
+// Runs every optimization below, in the right order, on a welded mesh
+// (if "rangeStarts" isn't null, triangles are only reordered within the ranges of indices starting at each one)
+void OptimizeMesh(std::vector<Vertex>& verts, std::vector<unsigned int>& indices, const std::vector<unsigned int>* rangeStarts = 0);
+
+// Reorders triangles so vertices are reused while they're still in the post-transform cache (Tipsify)
+// Fills "clusters" with the index of the first triangle of each run that starts from a cold cache.
+void OptimizeVertexCache(unsigned int* indices, size_t numIndices, size_t numVerts, std::vector<unsigned int>& clusters);
+
+// Reorders the clusters from OptimizeVertexCache so outward-facing ones draw first, reducing overdraw
+void OptimizeOverdraw(unsigned int* indices, size_t numIndices, const Vertex* verts, size_t numVerts, const std::vector<unsigned int>& clusters, float threshold);
+
+// Reorders vertices into the order they're first used, returning how many are still referenced
+size_t OptimizeVertexFetch(Vertex* verts, size_t numVerts, unsigned int* indices, size_t numIndices);
+
+// Simulators for measuring the effect of the optimizations
+VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t numIndices, size_t numVerts, unsigned int cacheSize);
+VertexFetchStats AnalyzeVertexFetch(const unsigned int* indices, size_t numIndices, size_t numVerts, size_t vertexSize);
+
+// Optimizes each model in "modelDirectory", printing its cache and fetch stats before and after
+void BenchmarkMeshOptimizer(const char* modelDirectory);
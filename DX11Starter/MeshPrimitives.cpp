@@ -0,0 +1,575 @@
+#include "MeshPrimitives.h"
+#include "MeshOptimizer.h"
+#include "ObjLoader.h"
+#include "MappedFile.h"
+#include <unordered_map>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Adds one triangle, facing the way its vertices' normals do
+//
+// - Surfaces are generated without worrying about which way
+//    round each triangle goes, so this flips any that would
+//    face inward (clockwise is front facing)
+// - Triangles with no area, like the ones that meet at the
+//    poles of a sphere or the point of a cone, are dropped
+// --------------------------------------------------------
+static void AppendTriangle(const std::vector<Vertex>& verts, unsigned int a, unsigned int b, unsigned int c, std::vector<unsigned int>& indices)
+{
+	XMVECTOR pa = XMLoadFloat3(&verts[a].Position);
+	XMVECTOR pb = XMLoadFloat3(&verts[b].Position);
+	XMVECTOR pc = XMLoadFloat3(&verts[c].Position);
+	XMVECTOR facing = XMVector3Cross(XMVectorSubtract(pb, pa), XMVectorSubtract(pc, pa));
+
+	// (compared to the longest edge, since trig leaves "matching" corners a rounding error apart)
+	float longest = XMVectorGetX(XMVectorMax(XMVector3LengthSq(XMVectorSubtract(pb, pa)),
+		XMVectorMax(XMVector3LengthSq(XMVectorSubtract(pc, pb)), XMVector3LengthSq(XMVectorSubtract(pa, pc)))));
+	if (XMVectorGetX(XMVector3LengthSq(facing)) <= 1e-12f * longest * longest)
+		return;
+
+	XMVECTOR normal = XMVectorAdd(XMLoadFloat3(&verts[a].Normal), XMVectorAdd(XMLoadFloat3(&verts[b].Normal), XMLoadFloat3(&verts[c].Normal)));
+	bool flip = XMVectorGetX(XMVector3Dot(facing, normal)) < 0.0f;
+
+	indices.push_back(a);
+	indices.push_back(flip ? c : b);
+	indices.push_back(flip ? b : c);
+}
+
+// --------------------------------------------------------
+// Adds a grid of quads that's been wrapped into some shape
+//
+// - "surface" is called with u and v from 0 to 1 and returns
+//    the vertex there; the first and last row and column are
+//    separate vertices, so UVs can run all the way around
+// --------------------------------------------------------
+template<typename SurfaceFunction>
+static void AppendSurface(unsigned int uSegments, unsigned int vSegments, SurfaceFunction surface, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	unsigned int first = (unsigned int)verts.size();
+	for (unsigned int j = 0; j <= vSegments; j++)
+	{
+		for (unsigned int i = 0; i <= uSegments; i++)
+			verts.push_back(surface((float)i / uSegments, (float)j / vSegments));
+	}
+
+	unsigned int row = uSegments + 1;
+	for (unsigned int j = 0; j < vSegments; j++)
+	{
+		for (unsigned int i = 0; i < uSegments; i++)
+		{
+			unsigned int corner = first + j * row + i;
+			AppendTriangle(verts, corner, corner + 1, corner + row + 1, indices);
+			AppendTriangle(verts, corner, corner + row + 1, corner + row, indices);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Adds a flat, round cap
+//
+// center - The middle of the disc
+// normal - Which way it faces
+// axisU  - Direction to its edge at angle 0
+// axisV  - Direction to its edge a quarter turn later
+// --------------------------------------------------------
+static void AppendDisc(XMFLOAT3 center, XMFLOAT3 normal, XMFLOAT3 axisU, XMFLOAT3 axisV, float radius, unsigned int segments, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	XMVECTOR c = XMLoadFloat3(&center);
+	XMVECTOR u = XMLoadFloat3(&axisU);
+	XMVECTOR v = XMLoadFloat3(&axisV);
+	AppendSurface(segments, 1, [&](float s, float t)
+	{
+		float angle = XM_2PI * s;
+		float x = cosf(angle) * t;
+		float y = sinf(angle) * t;
+
+		Vertex vertex;
+		XMStoreFloat3(&vertex.Position, XMVectorAdd(c, XMVectorScale(XMVectorAdd(XMVectorScale(u, x), XMVectorScale(v, y)), radius)));
+		vertex.Normal = normal;
+		vertex.UV = XMFLOAT2(0.5f + 0.5f * x, 0.5f - 0.5f * y);
+		return vertex;
+	}, verts, indices);
+}
+
+// --------------------------------------------------------
+// Welds vertices that came out exactly the same (the middles
+// of discs, and the like) and optimizes the result, so every
+// generator hands back the same kind of mesh ObjLoader does
+// --------------------------------------------------------
+static void FinishPrimitive(std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	std::unordered_map<Vertex, unsigned int, VertexHash, VertexEqual> welded;
+	welded.reserve(verts.size());
+	std::vector<unsigned int> remap(verts.size());
+	unsigned int count = 0;
+	for (size_t i = 0; i < verts.size(); i++)
+	{
+		std::pair<std::unordered_map<Vertex, unsigned int, VertexHash, VertexEqual>::iterator, bool> found = welded.insert(std::make_pair(verts[i], count));
+		if (found.second)
+			verts[count++] = verts[i];
+		remap[i] = found.first->second;
+	}
+	verts.resize(count);
+	for (size_t i = 0; i < indices.size(); i++)
+		indices[i] = remap[indices[i]];
+
+	OptimizeMesh(verts, indices);
+}
+
+// --------------------------------------------------------
+// Generates a flat, convex polygon as a fan from its first corner
+//
+// - UVs are the corners' positions across the polygon's
+//    plane, so textures keep their size from shape to shape
+// --------------------------------------------------------
+void GeneratePolygon(const XMFLOAT3* corners, unsigned int numCorners, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	verts.clear();
+	indices.clear();
+	if (numCorners < 3)
+		return;
+
+	// Clockwise corners make this point out of the front
+	XMVECTOR origin = XMLoadFloat3(&corners[0]);
+	XMVECTOR right = XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&corners[1]), origin));
+	XMVECTOR normal = XMVector3Normalize(XMVector3Cross(right, XMVectorSubtract(XMLoadFloat3(&corners[2]), origin)));
+	XMVECTOR down = XMVector3Cross(normal, right);
+
+	for (unsigned int i = 0; i < numCorners; i++)
+	{
+		XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&corners[i]), origin);
+
+		Vertex vertex;
+		vertex.Position = corners[i];
+		XMStoreFloat3(&vertex.Normal, normal);
+		vertex.UV = XMFLOAT2(XMVectorGetX(XMVector3Dot(offset, right)), XMVectorGetX(XMVector3Dot(offset, down)));
+		verts.push_back(vertex);
+	}
+	for (unsigned int i = 1; i + 1 < numCorners; i++)
+		AppendTriangle(verts, 0, i, i + 1, indices);
+
+	FinishPrimitive(verts, indices);
+}
+
+// --------------------------------------------------------
+// Generates a box, one quad per face
+// --------------------------------------------------------
+void GenerateBox(XMFLOAT3 size, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	verts.clear();
+	indices.clear();
+
+	// Each face's normal, and which way is up on it when looking straight at it
+	static const XMFLOAT3 faces[6][2] =
+	{
+		{ XMFLOAT3(+1, 0, 0), XMFLOAT3(0, 1, 0) },
+		{ XMFLOAT3(-1, 0, 0), XMFLOAT3(0, 1, 0) },
+		{ XMFLOAT3(0, +1, 0), XMFLOAT3(0, 0, 1) },
+		{ XMFLOAT3(0, -1, 0), XMFLOAT3(0, 0, -1) },
+		{ XMFLOAT3(0, 0, +1), XMFLOAT3(0, 1, 0) },
+		{ XMFLOAT3(0, 0, -1), XMFLOAT3(0, 1, 0) },
+	};
+
+	XMVECTOR scale = XMLoadFloat3(&size);
+	for (int f = 0; f < 6; f++)
+	{
+		XMVECTOR normal = XMLoadFloat3(&faces[f][0]);
+		XMVECTOR up = XMLoadFloat3(&faces[f][1]);
+		XMVECTOR right = XMVector3Cross(up, XMVectorNegate(normal));
+		AppendSurface(1, 1, [&](float u, float v)
+		{
+			XMVECTOR position = XMVectorAdd(XMVectorScale(normal, 0.5f),
+				XMVectorAdd(XMVectorScale(right, u - 0.5f), XMVectorScale(up, 0.5f - v)));
+
+			Vertex vertex;
+			XMStoreFloat3(&vertex.Position, XMVectorMultiply(position, scale));
+			vertex.Normal = faces[f][0];
+			vertex.UV = XMFLOAT2(u, v);
+			return vertex;
+		}, verts, indices);
+	}
+
+	FinishPrimitive(verts, indices);
+}
+
+// --------------------------------------------------------
+// Generates a sphere out of "slices" wedges from pole to pole,
+// cut into "stacks" rings
+// --------------------------------------------------------
+void GenerateUVSphere(float radius, unsigned int slices, unsigned int stacks, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	verts.clear();
+	indices.clear();
+
+	AppendSurface(slices, stacks, [&](float u, float v)
+	{
+		float around = XM_2PI * u;
+		float down = XM_PI * v;
+		XMFLOAT3 normal(sinf(down) * cosf(around), cosf(down), sinf(down) * sinf(around));
+
+		Vertex vertex;
+		vertex.Position = XMFLOAT3(normal.x * radius, normal.y * radius, normal.z * radius);
+		vertex.Normal = normal;
+		vertex.UV = XMFLOAT2(u, v);
+		return vertex;
+	}, verts, indices);
+
+	FinishPrimitive(verts, indices);
+}
+
+// --------------------------------------------------------
+// Generates a sphere by splitting each of an icosahedron's
+// triangles into four, over and over, pushing the new corners
+// out onto the sphere each time
+//
+// - UVs are wrapped the same way as GenerateUVSphere()'s, which
+//    needs the vertices along the seam where U goes from 1 back
+//    to 0 doubled up, and the ones at the poles given a U per
+//    triangle
+// --------------------------------------------------------
+void GenerateIcoSphere(float radius, unsigned int subdivisions, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	verts.clear();
+	indices.clear();
+
+	// The icosahedron: three golden rectangles at right angles
+	const float t = (1.0f + sqrtf(5.0f)) * 0.5f;
+	std::vector<XMFLOAT3> points =
+	{
+		XMFLOAT3(-1, t, 0), XMFLOAT3(1, t, 0), XMFLOAT3(-1, -t, 0), XMFLOAT3(1, -t, 0),
+		XMFLOAT3(0, -1, t), XMFLOAT3(0, 1, t), XMFLOAT3(0, -1, -t), XMFLOAT3(0, 1, -t),
+		XMFLOAT3(t, 0, -1), XMFLOAT3(t, 0, 1), XMFLOAT3(-t, 0, -1), XMFLOAT3(-t, 0, 1),
+	};
+	std::vector<unsigned int> triangles =
+	{
+		0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11,
+		1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+		3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9,
+		4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1,
+	};
+	for (size_t i = 0; i < points.size(); i++)
+		XMStoreFloat3(&points[i], XMVector3Normalize(XMLoadFloat3(&points[i])));
+
+	// Split every edge in half, sharing the new point between the edge's two triangles
+	for (unsigned int s = 0; s < subdivisions; s++)
+	{
+		std::unordered_map<unsigned long long, unsigned int> midpoints;
+		auto midpoint = [&](unsigned int a, unsigned int b)
+		{
+			unsigned long long key = a < b ? ((unsigned long long)a << 32) | b : ((unsigned long long)b << 32) | a;
+			std::unordered_map<unsigned long long, unsigned int>::iterator found = midpoints.find(key);
+			if (found != midpoints.end())
+				return found->second;
+
+			XMFLOAT3 point;
+			XMStoreFloat3(&point, XMVector3Normalize(XMVectorAdd(XMLoadFloat3(&points[a]), XMLoadFloat3(&points[b]))));
+			points.push_back(point);
+			midpoints[key] = (unsigned int)points.size() - 1;
+			return (unsigned int)points.size() - 1;
+		};
+
+		std::vector<unsigned int> split;
+		split.reserve(triangles.size() * 4);
+		for (size_t i = 0; i < triangles.size(); i += 3)
+		{
+			unsigned int a = triangles[i], b = triangles[i + 1], c = triangles[i + 2];
+			unsigned int ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+			unsigned int corners[] = { a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca };
+			split.insert(split.end(), corners, corners + 12);
+		}
+		triangles.swap(split);
+	}
+
+	// Make a vertex per point, then fix up the triangles whose UVs wrap around
+	for (size_t i = 0; i < points.size(); i++)
+	{
+		const XMFLOAT3& n = points[i];
+		float u = atan2f(n.z, n.x) / XM_2PI;
+
+		Vertex vertex;
+		vertex.Position = XMFLOAT3(n.x * radius, n.y * radius, n.z * radius);
+		vertex.Normal = n;
+		vertex.UV = XMFLOAT2(u < 0.0f ? u + 1.0f : u, acosf(n.y < -1.0f ? -1.0f : n.y > 1.0f ? 1.0f : n.y) / XM_PI);
+		verts.push_back(vertex);
+	}
+
+	std::unordered_map<unsigned int, unsigned int> wrapped;
+	for (size_t i = 0; i < triangles.size(); i += 3)
+	{
+		unsigned int* corner = &triangles[i];
+
+		// A triangle spanning more than half of U crosses the seam,
+		// so its corners on the low side get copies past 1
+		float minU = 1.0f, maxU = 0.0f;
+		for (int k = 0; k < 3; k++)
+		{
+			if (fabsf(verts[corner[k]].Normal.y) >= 0.9999f)
+				continue;
+			float u = verts[corner[k]].UV.x;
+			minU = u < minU ? u : minU;
+			maxU = u > maxU ? u : maxU;
+		}
+		if (maxU - minU > 0.5f)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				if (verts[corner[k]].UV.x >= 0.5f || fabsf(verts[corner[k]].Normal.y) >= 0.9999f)
+					continue;
+
+				std::unordered_map<unsigned int, unsigned int>::iterator found = wrapped.find(corner[k]);
+				if (found == wrapped.end())
+				{
+					Vertex copy = verts[corner[k]];
+					copy.UV.x += 1.0f;
+					verts.push_back(copy);
+					found = wrapped.insert(std::make_pair(corner[k], (unsigned int)verts.size() - 1)).first;
+				}
+				corner[k] = found->second;
+			}
+		}
+
+		// U means nothing at a pole, so give it the U between the other two corners
+		for (int k = 0; k < 3; k++)
+		{
+			if (fabsf(verts[corner[k]].Normal.y) < 0.9999f)
+				continue;
+
+			Vertex copy = verts[corner[k]];
+			copy.UV.x = (verts[corner[(k + 1) % 3]].UV.x + verts[corner[(k + 2) % 3]].UV.x) * 0.5f;
+			verts.push_back(copy);
+			corner[k] = (unsigned int)verts.size() - 1;
+		}
+
+		AppendTriangle(verts, corner[0], corner[1], corner[2], indices);
+	}
+
+	FinishPrimitive(verts, indices);
+}
+
+// --------------------------------------------------------
+// Generates a cylinder: a tube cut into "stacks" rings, with
+// a disc on each end
+// --------------------------------------------------------
+void GenerateCylinder(float radius, float height, unsigned int slices, unsigned int stacks, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	verts.clear();
+	indices.clear();
+
+	AppendSurface(slices, stacks, [&](float u, float v)
+	{
+		float around = XM_2PI * u;
+
+		Vertex vertex;
+		vertex.Position = XMFLOAT3(cosf(around) * radius, height * (0.5f - v), sinf(around) * radius);
+		vertex.Normal = XMFLOAT3(cosf(around), 0, sinf(around));
+		vertex.UV = XMFLOAT2(u, v);
+		return vertex;
+	}, verts, indices);
+
+	float top = height * 0.5f;
+	AppendDisc(XMFLOAT3(0, top, 0), XMFLOAT3(0, 1, 0), XMFLOAT3(1, 0, 0), XMFLOAT3(0, 0, 1), radius, slices, verts, indices);
+	AppendDisc(XMFLOAT3(0, -top, 0), XMFLOAT3(0, -1, 0), XMFLOAT3(1, 0, 0), XMFLOAT3(0, 0, -1), radius, slices, verts, indices);
+
+	FinishPrimitive(verts, indices);
+}
+
+// --------------------------------------------------------
+// Generates a cone: a sloped side narrowing to a point, cut
+// into "stacks" rings, on a disc
+//
+// - The side's normals lean up by the slope, so it shades
+//    smoothly around but stays sharp at the base
+// --------------------------------------------------------
+void GenerateCone(float radius, float height, unsigned int slices, unsigned int stacks, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	verts.clear();
+	indices.clear();
+
+	float slope = sqrtf(radius * radius + height * height);
+	AppendSurface(slices, stacks, [&](float u, float v)
+	{
+		float around = XM_2PI * u;
+
+		Vertex vertex;
+		vertex.Position = XMFLOAT3(cosf(around) * radius * v, height * (0.5f - v), sinf(around) * radius * v);
+		vertex.Normal = XMFLOAT3(cosf(around) * height / slope, radius / slope, sinf(around) * height / slope);
+		vertex.UV = XMFLOAT2(u, v);
+		return vertex;
+	}, verts, indices);
+
+	AppendDisc(XMFLOAT3(0, -height * 0.5f, 0), XMFLOAT3(0, -1, 0), XMFLOAT3(1, 0, 0), XMFLOAT3(0, 0, -1), radius, slices, verts, indices);
+
+	FinishPrimitive(verts, indices);
+}
+
+// --------------------------------------------------------
+// Generates a torus: a circle of "tubeSegments" swept around
+// the Y axis in "segments" steps
+// --------------------------------------------------------
+void GenerateTorus(float radius, float tubeRadius, unsigned int segments, unsigned int tubeSegments, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	verts.clear();
+	indices.clear();
+
+	AppendSurface(segments, tubeSegments, [&](float u, float v)
+	{
+		float around = XM_2PI * u;
+		float tube = XM_2PI * v;
+		XMFLOAT3 normal(cosf(tube) * cosf(around), sinf(tube), cosf(tube) * sinf(around));
+
+		Vertex vertex;
+		vertex.Position = XMFLOAT3(
+			cosf(around) * radius + normal.x * tubeRadius,
+			normal.y * tubeRadius,
+			sinf(around) * radius + normal.z * tubeRadius);
+		vertex.Normal = normal;
+		vertex.UV = XMFLOAT2(u, v);
+		return vertex;
+	}, verts, indices);
+
+	FinishPrimitive(verts, indices);
+}
+
+// --------------------------------------------------------
+// Generates a helix: a circle of "tubeSegments" swept along a
+// coil, with a disc on each end
+//
+// - The circle is kept square to the coil, using the direction
+//    out from the Y axis (which is always at right angles to
+//    the coil) and the one at right angles to both
+// - V runs along the tube as far as U does around it, so the
+//    texture isn't stretched
+// --------------------------------------------------------
+void GenerateHelix(float radius, float tubeRadius, float height, float turns, unsigned int segmentsPerTurn, unsigned int tubeSegments, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	verts.clear();
+	indices.clear();
+
+	float angleRange = XM_2PI * turns;
+	float length = sqrtf(angleRange * radius * angleRange * radius + height * height);
+	unsigned int segments = (unsigned int)ceilf(turns * segmentsPerTurn);
+	if (segments == 0)
+		return;
+
+	// The middle of the tube, and the three directions at each point along it
+	auto frame = [&](float along, XMVECTOR& center, XMVECTOR& tangent, XMVECTOR& out, XMVECTOR& side)
+	{
+		float angle = angleRange * along;
+		out = XMVectorSet(cosf(angle), 0, sinf(angle), 0);
+		center = XMVectorAdd(XMVectorScale(out, radius), XMVectorSet(0, height * (along - 0.5f), 0, 0));
+		tangent = XMVector3Normalize(XMVectorSet(-sinf(angle) * angleRange * radius, height, cosf(angle) * angleRange * radius, 0));
+		side = XMVector3Cross(tangent, out);
+	};
+
+	AppendSurface(tubeSegments, segments, [&](float u, float v)
+	{
+		XMVECTOR center, tangent, out, side;
+		frame(v, center, tangent, out, side);
+		float tube = XM_2PI * u;
+		XMVECTOR normal = XMVectorAdd(XMVectorScale(out, cosf(tube)), XMVectorScale(side, sinf(tube)));
+
+		Vertex vertex;
+		XMStoreFloat3(&vertex.Position, XMVectorAdd(center, XMVectorScale(normal, tubeRadius)));
+		XMStoreFloat3(&vertex.Normal, normal);
+		vertex.UV = XMFLOAT2(u, v * length / (XM_2PI * tubeRadius));
+		return vertex;
+	}, verts, indices);
+
+	// Caps facing back along the coil at the start, and on along it at the end
+	for (int end = 0; end < 2; end++)
+	{
+		XMVECTOR center, tangent, out, side;
+		frame((float)end, center, tangent, out, side);
+		XMFLOAT3 c, n, u, v;
+		XMStoreFloat3(&c, center);
+		XMStoreFloat3(&n, end ? tangent : XMVectorNegate(tangent));
+		XMStoreFloat3(&u, out);
+		XMStoreFloat3(&v, side);
+		AppendDisc(c, n, u, v, tubeRadius, tubeSegments, verts, indices);
+	}
+
+	FinishPrimitive(verts, indices);
+}
+
+// --------------------------------------------------------
+// Compares generating each shape with loading the model
+// it stands in for
+//
+// - The OBJ side is what a first load does before building
+//    levels of detail: map, parse, weld and optimize (later
+//    loads use the .meshbin instead, so this is the worst case
+//    the generators remove)
+// - Tessellations are picked to give about the same triangle
+//    count as each model, and each side's best of several runs
+//    is reported
+// --------------------------------------------------------
+void BenchmarkPrimitives(const char* modelDirectory)
+{
+	const int runs = 5;
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+
+	auto generate = [&](int shape)
+	{
+		switch (shape)
+		{
+		case 0: GenerateBox(XMFLOAT3(1, 1, 1), verts, indices); break;
+		case 1: GenerateUVSphere(0.5f, 40, 20, verts, indices); break;
+		case 2: GenerateCylinder(0.5f, 1.0f, 40, 1, verts, indices); break;
+		case 3: GenerateCone(0.5f, 1.0f, 20, 1, verts, indices); break;
+		case 4: GenerateTorus(0.5f, 0.2f, 20, 20, verts, indices); break;
+		case 5: GenerateHelix(0.8f, 0.2f, 2.0f, 3.0f, 100, 8, verts, indices); break;
+		}
+	};
+	static const char* models[] = { "cube.obj", "sphere.obj", "cylinder.obj", "cone.obj", "torus.obj", "helix.obj" };
+
+	printf("\nPrimitives vs. OBJ files (best of %d):", runs);
+	for (int shape = 0; shape < 6; shape++)
+	{
+		std::string filename = std::string(modelDirectory) + "/" + models[shape];
+
+		double objSeconds = 1e30;
+		unsigned int objTriangles = 0;
+		for (int r = 0; r < runs; r++)
+		{
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			MappedFile source(filename.c_str());
+			if (!source.IsOpen())
+				break;
+			ObjData obj;
+			verts.clear();
+			indices.clear();
+			ParseObjParallel(source.GetData(), source.GetSize(), obj, std::thread::hardware_concurrency());
+			BuildIndexedMesh(obj, verts, indices);
+			OptimizeMesh(verts, indices);
+			double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			objSeconds = seconds < objSeconds ? seconds : objSeconds;
+			objTriangles = (unsigned int)indices.size() / 3;
+		}
+
+		double generatedSeconds = 1e30;
+		for (int r = 0; r < runs; r++)
+		{
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			generate(shape);
+			double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			generatedSeconds = seconds < generatedSeconds ? seconds : generatedSeconds;
+		}
+
+		if (objTriangles == 0)
+		{
+			printf("\n  %s: couldn't be read, generated %u triangles in %.3f ms", models[shape], (unsigned int)indices.size() / 3, generatedSeconds * 1000.0);
+			continue;
+		}
+		printf("\n  %s: %u triangles in %.3f ms, generated %u triangles in %.3f ms (%.1fx faster)",
+			models[shape], objTriangles, objSeconds * 1000.0,
+			(unsigned int)indices.size() / 3, generatedSeconds * 1000.0,
+			generatedSeconds > 0 ? objSeconds / generatedSeconds : 0.0);
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Vertex.h"
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Generators for simple shapes, computed instead of loaded
+//
+// - Each one fills "verts" and "indices" with a welded mesh
+//    that's already been through OptimizeMesh(), exactly like
+//    a parsed OBJ file's, so it can go straight into a Mesh
+// - Shapes are centered on the origin, with clockwise (front
+//    facing) triangles, normals pointing out and UVs running
+//    left to right, top to bottom, in the same left-handed
+//    space models are converted into
+// - "Segments" are the number of quads around (or along) a
+//    curved surface, so the tessellation can be picked per use
+// --------------------------------------------------------
+
+// A flat, convex polygon, from corners listed clockwise as seen from its front
+// (covers the triangles and quads that used to be typed in by hand)
+void GeneratePolygon(const DirectX::XMFLOAT3* corners, unsigned int numCorners, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+
+// A box with a separate, fully textured quad per face
+void GenerateBox(DirectX::XMFLOAT3 size, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+
+// A sphere made of rings of latitude and longitude
+void GenerateUVSphere(float radius, unsigned int slices, unsigned int stacks, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+
+// A sphere made by subdividing an icosahedron, so its triangles are all about the same size
+// (each subdivision has 4x the triangles: 0 is the 20 triangle icosahedron itself)
+void GenerateIcoSphere(float radius, unsigned int subdivisions, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+
+// A cylinder standing on the Y axis, with caps
+void GenerateCylinder(float radius, float height, unsigned int slices, unsigned int stacks, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+
+// A cone standing on the Y axis, point up, with a cap on its base
+void GenerateCone(float radius, float height, unsigned int slices, unsigned int stacks, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+
+// A torus lying in the XZ plane ("radius" is to the middle of the tube)
+void GenerateTorus(float radius, float tubeRadius, unsigned int segments, unsigned int tubeSegments, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+
+// A tube coiled around the Y axis, with caps on both ends
+// ("radius" is to the middle of the tube, and "height" is from the middle of one end to the other)
+void GenerateHelix(float radius, float tubeRadius, float height, float turns, unsigned int segmentsPerTurn, unsigned int tubeSegments, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+
+// Times generating each shape against parsing and welding the model in "modelDirectory" that it replaces,
+// and prints the results
+void BenchmarkPrimitives(const char* modelDirectory);
@@ -0,0 +1,616 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <cfloat>
+#include <climits>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// The sum of squared distances to a set of planes, stored as
+// the symmetric matrix form from Garland and Heckbert's
+// "Surface Simplification Using Quadric Error Metrics"
+//
+// - Each plane is weighted by the area of its triangle, and
+//    the total weight is kept so errors can be averaged
+// --------------------------------------------------------
+struct Quadric
+{
+	double A00, A11, A22, A01, A02, A12;
+	double B0, B1, B2;
+	double C;
+	double Weight;
+};
+
+static void AddPlane(Quadric& q, double nx, double ny, double nz, double d, double weight)
+{
+	q.A00 += weight * nx * nx;
+	q.A11 += weight * ny * ny;
+	q.A22 += weight * nz * nz;
+	q.A01 += weight * nx * ny;
+	q.A02 += weight * nx * nz;
+	q.A12 += weight * ny * nz;
+	q.B0 += weight * nx * d;
+	q.B1 += weight * ny * d;
+	q.B2 += weight * nz * d;
+	q.C += weight * d * d;
+	q.Weight += weight;
+}
+
+static void AddQuadric(Quadric& q, const Quadric& other)
+{
+	q.A00 += other.A00; q.A11 += other.A11; q.A22 += other.A22;
+	q.A01 += other.A01; q.A02 += other.A02; q.A12 += other.A12;
+	q.B0 += other.B0; q.B1 += other.B1; q.B2 += other.B2;
+	q.C += other.C;
+	q.Weight += other.Weight;
+}
+
+// Mean squared distance from the point to the quadric's planes
+static double EvaluateQuadric(const Quadric& q, const XMFLOAT3& p)
+{
+	double x = p.x, y = p.y, z = p.z;
+	double error =
+		q.A00 * x * x + q.A11 * y * y + q.A22 * z * z +
+		2 * (q.A01 * x * y + q.A02 * x * z + q.A12 * y * z) +
+		2 * (q.B0 * x + q.B1 * y + q.B2 * z) +
+		q.C;
+
+	// Rounding can push an exact fit slightly negative
+	return q.Weight > 0 ? fabs(error) / q.Weight : 0;
+}
+
+// --------------------------------------------------------
+// Copies the triangles, leaving out exact repeats
+//
+// - Some exporters write every face twice, which would make
+//    every edge look non-manifold (and so locked)
+// - Each triangle is rotated to start at its smallest index, so
+//    repeats match no matter which corner they start from
+// --------------------------------------------------------
+static void RemoveDuplicateTriangles(const unsigned int* indices, size_t numIndices, std::vector<unsigned int>& result)
+{
+	struct Triangle
+	{
+		unsigned int Index[3];
+		bool operator<(const Triangle& other) const { return std::lexicographical_compare(Index, Index + 3, other.Index, other.Index + 3); }
+		bool operator==(const Triangle& other) const { return std::equal(Index, Index + 3, other.Index); }
+	};
+
+	std::vector<Triangle> tris(numIndices / 3);
+	for (size_t t = 0; t < tris.size(); t++)
+	{
+		const unsigned int* tri = &indices[t * 3];
+		int first = tri[0] <= tri[1] && tri[0] <= tri[2] ? 0 : (tri[1] <= tri[2] ? 1 : 2);
+		for (int c = 0; c < 3; c++)
+			tris[t].Index[c] = tri[(first + c) % 3];
+	}
+	std::sort(tris.begin(), tris.end());
+	tris.erase(std::unique(tris.begin(), tris.end()), tris.end());
+
+	result.resize(tris.size() * 3);
+	for (size_t t = 0; t < tris.size(); t++)
+		for (int c = 0; c < 3; c++)
+			result[t * 3 + c] = tris[t].Index[c];
+}
+
+// --------------------------------------------------------
+// Finds the vertices that share a position (the copies made
+// along uv and normal seams), giving each vertex the index of
+// the first vertex at its position
+// --------------------------------------------------------
+static void GroupPositions(const Vertex* verts, size_t numVerts, std::vector<unsigned int>& group)
+{
+	std::vector<unsigned int> order(numVerts);
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [verts](unsigned int a, unsigned int b)
+	{
+		const XMFLOAT3& pa = verts[a].Position;
+		const XMFLOAT3& pb = verts[b].Position;
+		if (pa.x != pb.x) return pa.x < pb.x;
+		if (pa.y != pb.y) return pa.y < pb.y;
+		if (pa.z != pb.z) return pa.z < pb.z;
+		return a < b;
+	});
+
+	group.resize(numVerts);
+	for (size_t i = 0; i < numVerts; i++)
+	{
+		const XMFLOAT3& p = verts[order[i]].Position;
+		bool samePosition = false;
+		if (i > 0)
+		{
+			const XMFLOAT3& prev = verts[order[i - 1]].Position;
+			samePosition = p.x == prev.x && p.y == prev.y && p.z == prev.z;
+		}
+		group[order[i]] = samePosition ? group[order[i - 1]] : order[i];
+	}
+}
+
+// --------------------------------------------------------
+// Works out which positions must never move: those on borders
+// (and non-manifold edges), since moving them would eat into
+// the silhouette of open meshes
+//
+// locked - Filled with a flag per position (indexed by the
+//          group's first vertex)
+// --------------------------------------------------------
+static void FindLockedPositions(const unsigned int* indices, size_t numIndices, const std::vector<unsigned int>& group, std::vector<unsigned char>& locked)
+{
+	locked.assign(group.size(), 0);
+
+	// Every edge between positions, smaller one first, sorted
+	// so that each edge's triangles end up next to each other
+	std::vector<unsigned long long> edges;
+	edges.reserve(numIndices);
+	for (size_t i = 0; i < numIndices; i += 3)
+	{
+		for (int e = 0; e < 3; e++)
+		{
+			unsigned long long a = group[indices[i + e]];
+			unsigned long long b = group[indices[i + (e + 1) % 3]];
+			edges.push_back(a < b ? (a << 32) | b : (b << 32) | a);
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+
+	// Anything other than exactly two triangles per edge locks both ends
+	for (size_t i = 0; i < edges.size(); )
+	{
+		size_t end = i;
+		while (end < edges.size() && edges[end] == edges[i])
+			end++;
+
+		if (end - i != 2)
+		{
+			locked[(unsigned int)(edges[i] >> 32)] = 1;
+			locked[(unsigned int)(edges[i] & 0xFFFFFFFF)] = 1;
+		}
+		i = end;
+	}
+}
+
+// --------------------------------------------------------
+// Which triangles use each vertex, stored as one flat list
+// with an offset into it per vertex
+// --------------------------------------------------------
+struct VertexTriangles
+{
+	std::vector<unsigned int> Counts;
+	std::vector<unsigned int> Offsets;
+	std::vector<unsigned int> Triangles;
+
+	const unsigned int* Begin(unsigned int v) const { return &Triangles[0] + Offsets[v]; }
+	const unsigned int* End(unsigned int v) const { return &Triangles[0] + Offsets[v] + Counts[v]; }
+};
+
+static void BuildVertexTriangles(const std::vector<unsigned int>& indices, size_t numVerts, VertexTriangles& adjacency)
+{
+	adjacency.Counts.assign(numVerts, 0);
+	adjacency.Offsets.resize(numVerts);
+	adjacency.Triangles.resize(indices.size() + 1);
+
+	for (size_t i = 0; i < indices.size(); i++)
+		adjacency.Counts[indices[i]]++;
+
+	unsigned int offset = 0;
+	for (size_t v = 0; v < numVerts; v++)
+	{
+		adjacency.Offsets[v] = offset;
+		offset += adjacency.Counts[v];
+	}
+
+	// Fill in the lists, using the offsets as write cursors and then putting them back
+	for (size_t i = 0; i < indices.size(); i++)
+		adjacency.Triangles[adjacency.Offsets[indices[i]]++] = (unsigned int)(i / 3);
+	for (size_t v = 0; v < numVerts; v++)
+		adjacency.Offsets[v] -= adjacency.Counts[v];
+}
+
+// --------------------------------------------------------
+// Finds the vertex at position "toGroup" that shares a triangle
+// with vertex "from", which is where "from" has to go when its
+// position collapses (so it keeps matching uvs and normals)
+//
+// Returns "from" itself if there isn't one
+// --------------------------------------------------------
+static unsigned int FindCollapseVertex(
+	const std::vector<unsigned int>& indices,
+	const std::vector<unsigned int>& group,
+	const VertexTriangles& adjacency,
+	unsigned int from, unsigned int toGroup)
+{
+	for (const unsigned int* t = adjacency.Begin(from); t != adjacency.End(from); t++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int v = indices[*t * 3 + c];
+			if (group[v] == toGroup)
+				return v;
+		}
+	}
+	return from;
+}
+
+// --------------------------------------------------------
+// Checks whether every vertex at one position can collapse
+// onto another position
+//
+// - Every vertex that's still in use needs a partner at the
+//    new position, or a uv or normal seam would tear open
+// - No triangle may turn over (or very nearly) in the move
+// --------------------------------------------------------
+static bool CanCollapse(
+	const Vertex* verts,
+	const std::vector<unsigned int>& indices,
+	const std::vector<unsigned int>& group,
+	const VertexTriangles& adjacency,
+	const std::vector<unsigned int>& fromVerts,
+	unsigned int toGroup)
+{
+	XMVECTOR target = XMLoadFloat3(&verts[toGroup].Position);
+	for (size_t i = 0; i < fromVerts.size(); i++)
+	{
+		unsigned int from = fromVerts[i];
+		if (adjacency.Counts[from] == 0)
+			continue;
+
+		if (FindCollapseVertex(indices, group, adjacency, from, toGroup) == from)
+			return false;
+
+		for (const unsigned int* t = adjacency.Begin(from); t != adjacency.End(from); t++)
+		{
+			const unsigned int* tri = &indices[*t * 3];
+
+			// Triangles on the collapsing edge disappear, so they can't flip
+			if (group[tri[0]] == toGroup || group[tri[1]] == toGroup || group[tri[2]] == toGroup)
+				continue;
+
+			XMVECTOR p[3];
+			XMVECTOR moved[3];
+			for (int c = 0; c < 3; c++)
+			{
+				p[c] = XMLoadFloat3(&verts[tri[c]].Position);
+				moved[c] = tri[c] == from ? target : p[c];
+			}
+
+			XMVECTOR before = XMVector3Cross(p[1] - p[0], p[2] - p[0]);
+			XMVECTOR after = XMVector3Cross(moved[1] - moved[0], moved[2] - moved[0]);
+
+			// Allow the normal to swing up to about 75 degrees
+			float dot = XMVectorGetX(XMVector3Dot(before, after));
+			float lengths = XMVectorGetX(XMVector3Length(before)) * XMVectorGetX(XMVector3Length(after));
+			if (dot <= 0.25f * lengths)
+				return false;
+		}
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Simplifies a mesh by collapsing edges, cheapest first
+//
+// - Collapses work on positions rather than vertices: every
+//    vertex at a position (one per side of a seam) moves at
+//    once, each onto its partner at the new position
+// - Each position carries a quadric of the planes around it,
+//    and collapsing position A onto its neighbour B costs the
+//    average squared distance from B to both of their planes
+// - Collapses only ever move a vertex onto an existing one, so
+//    the result uses the original vertex buffer unchanged
+// - Works in passes: each pass picks the best collapse for
+//    every position, then does as many as it can without two
+//    of them touching the same triangles
+//
+// verts            - The mesh's vertices
+// indices          - The mesh's indices (three per triangle)
+// targetIndexCount - How many indices to get down to
+// result           - Filled with the simplified indices
+// moves            - If not null, filled with every vertex moved,
+//                     collapse by collapse (collapses in the same
+//                     pass never touch, so replaying them one at a
+//                     time gives the same result)
+//
+// Returns the error of the worst collapse made (the distance
+// the surface moved, in model units).  The result can have
+// more indices than asked for if borders, seams or flips get
+// in the way.
+// --------------------------------------------------------
+float SimplifyMesh(const Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices, size_t targetIndexCount, std::vector<unsigned int>& result, std::vector<VertexMove>* moves)
+{
+	if (moves)
+		moves->clear();
+	result.assign(indices, indices + numIndices);
+	if (numIndices <= targetIndexCount || numVerts == 0)
+		return 0;
+
+	// Repeated triangles add nothing, so they're the first to go
+	RemoveDuplicateTriangles(indices, numIndices, result);
+	if (result.size() <= targetIndexCount)
+		return 0;
+
+	std::vector<unsigned int> group;
+	GroupPositions(verts, numVerts, group);
+
+	std::vector<unsigned char> locked;
+	FindLockedPositions(&result[0], result.size(), group, locked);
+
+	// Link the vertices at each position into a list, starting from
+	// the group's first vertex (which always has the smallest index)
+	std::vector<unsigned int> nextInGroup(numVerts, UINT_MAX);
+	std::vector<unsigned int> lastInGroup(numVerts);
+	for (unsigned int v = 0; v < numVerts; v++)
+	{
+		if (group[v] != v)
+			nextInGroup[lastInGroup[group[v]]] = v;
+		lastInGroup[group[v]] = v;
+	}
+
+	// Start each position's quadric with the planes of the triangles around it
+	std::vector<Quadric> quadrics(numVerts, Quadric());
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		const XMFLOAT3& p0 = verts[result[i]].Position;
+		const XMFLOAT3& p1 = verts[result[i + 1]].Position;
+		const XMFLOAT3& p2 = verts[result[i + 2]].Position;
+
+		double e1[3] = { (double)p1.x - p0.x, (double)p1.y - p0.y, (double)p1.z - p0.z };
+		double e2[3] = { (double)p2.x - p0.x, (double)p2.y - p0.y, (double)p2.z - p0.z };
+		double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+		double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (length == 0)
+			continue;
+
+		n[0] /= length; n[1] /= length; n[2] /= length;
+		double d = -(n[0] * p0.x + n[1] * p0.y + n[2] * p0.z);
+		for (int c = 0; c < 3; c++)
+			AddPlane(quadrics[group[result[i + c]]], n[0], n[1], n[2], d, length * 0.5);
+	}
+
+	struct Collapse
+	{
+		double Cost;
+		unsigned int From;	// Group collapsing
+		unsigned int To;	// Group it collapses onto
+		bool operator<(const Collapse& other) const { return Cost < other.Cost; }
+	};
+
+	VertexTriangles adjacency;
+	std::vector<Collapse> collapses;
+	std::vector<unsigned int> fromVerts;
+	std::vector<unsigned char> touched;
+	std::vector<unsigned int> remap(numVerts);
+	double maxError = 0;
+	unsigned int collapseCount = 0;
+
+	while (result.size() > targetIndexCount)
+	{
+		size_t numTris = result.size() / 3;
+		BuildVertexTriangles(result, numVerts, adjacency);
+
+		// Find the cheapest valid collapse for each position that may move
+		collapses.clear();
+		for (unsigned int a = 0; a < numVerts; a++)
+		{
+			if (group[a] != a || locked[a])
+				continue;
+
+			fromVerts.clear();
+			for (unsigned int v = a; v != UINT_MAX; v = nextInGroup[v])
+				fromVerts.push_back(v);
+
+			Collapse best = { DBL_MAX, a, a };
+			for (size_t i = 0; i < fromVerts.size(); i++)
+			{
+				for (const unsigned int* t = adjacency.Begin(fromVerts[i]); t != adjacency.End(fromVerts[i]); t++)
+				{
+					for (int c = 0; c < 3; c++)
+					{
+						unsigned int b = group[result[*t * 3 + c]];
+						if (b == a || b == best.To)
+							continue;
+
+						Quadric combined = quadrics[a];
+						AddQuadric(combined, quadrics[b]);
+						double cost = EvaluateQuadric(combined, verts[b].Position);
+						if (cost < best.Cost && CanCollapse(verts, result, group, adjacency, fromVerts, b))
+						{
+							best.Cost = cost;
+							best.To = b;
+						}
+					}
+				}
+			}
+
+			if (best.To != a)
+				collapses.push_back(best);
+		}
+		std::sort(collapses.begin(), collapses.end());
+
+		// Do the cheapest ones first, stopping once enough triangles are gone
+		size_t trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+		size_t trianglesRemoved = 0;
+		std::iota(remap.begin(), remap.end(), 0);
+		touched.assign(numVerts, 0);
+		for (size_t i = 0; i < collapses.size() && trianglesRemoved < trianglesToRemove; i++)
+		{
+			const Collapse& collapse = collapses[i];
+			if (touched[collapse.From] || touched[collapse.To])
+				continue;
+
+			for (unsigned int v = collapse.From; v != UINT_MAX; v = nextInGroup[v])
+			{
+				if (adjacency.Counts[v] == 0)
+					continue;
+				remap[v] = FindCollapseVertex(result, group, adjacency, v, collapse.To);
+				if (moves)
+				{
+					VertexMove move = { collapseCount, v, remap[v], (float)sqrt(std::max(collapse.Cost, 0.0)) };
+					moves->push_back(move);
+				}
+
+				// Everything around the moving vertices is now off limits this
+				// pass, since the checks above assumed it wouldn't change
+				for (const unsigned int* t = adjacency.Begin(v); t != adjacency.End(v); t++)
+				{
+					const unsigned int* tri = &result[*t * 3];
+					touched[group[tri[0]]] = touched[group[tri[1]]] = touched[group[tri[2]]] = 1;
+					if (group[tri[0]] == collapse.To || group[tri[1]] == collapse.To || group[tri[2]] == collapse.To)
+						trianglesRemoved++;
+				}
+			}
+
+			AddQuadric(quadrics[collapse.To], quadrics[collapse.From]);
+			maxError = std::max(maxError, collapse.Cost);
+			collapseCount++;
+		}
+
+		// Nothing left that can move
+		if (trianglesRemoved == 0)
+			break;
+
+		// Move the collapsed vertices and drop the triangles that became slivers
+		size_t write = 0;
+		for (size_t t = 0; t < numTris; t++)
+		{
+			unsigned int i0 = remap[result[t * 3]];
+			unsigned int i1 = remap[result[t * 3 + 1]];
+			unsigned int i2 = remap[result[t * 3 + 2]];
+			if (group[i0] == group[i1] || group[i1] == group[i2] || group[i0] == group[i2])
+				continue;
+
+			result[write++] = i0;
+			result[write++] = i1;
+			result[write++] = i2;
+		}
+		result.resize(write);
+	}
+
+	return (float)sqrt(maxError);
+}
+
+// --------------------------------------------------------
+// Builds a chain of levels of detail for a mesh
+//
+// - Each level is simplified from the original (so its error
+//    is measured against the original surface), aiming for
+//    LOD_TRIANGLE_RATIO of the previous level's triangles
+// - The chain ends at MESH_MAX_LODS levels, or earlier once
+//    the levels get too small or stop shrinking
+// - Each level gets its own vertex cache ordering
+// - With submeshes, each one is simplified on its own, so the
+//    edges between materials count as borders and never move;
+//    a submesh that can't shrink any more keeps its previous
+//    level's triangles
+//
+// verts     - The mesh's vertices, shared by every level
+// indices   - The original indices; the coarser levels are appended
+// lods      - Filled with every level, the original first
+// submeshes - The original's submeshes, in index order; each new
+//             level's are appended, in the same order
+// --------------------------------------------------------
+void BuildLodChain(const Vertex* verts, size_t numVerts, std::vector<unsigned int>& indices, std::vector<MeshLod>& lods, std::vector<MeshSubmesh>* submeshes)
+{
+	lods.clear();
+	MeshLod original = { 0, (unsigned int)indices.size(), 0.0f };
+	lods.push_back(original);
+	if (indices.size() < 3)
+		return;
+
+	// Without submeshes, the whole mesh is simplified as one piece
+	std::vector<MeshSubmesh> whole;
+	if (!submeshes)
+	{
+		MeshSubmesh all = { 0, (unsigned int)indices.size(), "" };
+		whole.push_back(all);
+		submeshes = &whole;
+	}
+	size_t submeshCount = submeshes->size();
+
+	std::vector<unsigned int> originalIndices(indices);
+	std::vector<unsigned int> simplified;
+	std::vector<unsigned int> levelIndices;
+	std::vector<MeshSubmesh> levelSubmeshes(submeshCount);
+	std::vector<float> submeshErrors(submeshCount, 0.0f);
+	std::vector<unsigned int> clusters;
+	while (lods.size() < MESH_MAX_LODS)
+	{
+		const MeshLod& previous = lods.back();
+		size_t target = (size_t)(previous.IndexCount / 3 * LOD_TRIANGLE_RATIO) * 3;
+		if (target / 3 < LOD_MIN_TRIANGLES)
+			break;
+
+		// Shrink each submesh by the same ratio
+		const MeshSubmesh* previousSubmeshes = &(*submeshes)[(lods.size() - 1) * submeshCount];
+		levelIndices.clear();
+		for (size_t s = 0; s < submeshCount; s++)
+		{
+			const MeshSubmesh& source = (*submeshes)[s];
+			const MeshSubmesh& last = previousSubmeshes[s];
+			size_t submeshTarget = (size_t)(last.IndexCount / 3 * LOD_TRIANGLE_RATIO) * 3;
+
+			simplified.clear();
+			float error = submeshErrors[s];
+			if (submeshTarget > 0)
+				error = SimplifyMesh(verts, numVerts, &originalIndices[source.FirstIndex], source.IndexCount, submeshTarget, simplified);
+
+			if (simplified.empty() || simplified.size() > last.IndexCount * LOD_MIN_REDUCTION)
+				simplified.assign(indices.begin() + last.FirstIndex, indices.begin() + last.FirstIndex + last.IndexCount);
+			else
+			{
+				OptimizeVertexCache(&simplified[0], simplified.size(), numVerts, clusters);
+				submeshErrors[s] = error;
+			}
+
+			levelSubmeshes[s] = last;
+			levelSubmeshes[s].FirstIndex = (unsigned int)(indices.size() + levelIndices.size());
+			levelSubmeshes[s].IndexCount = (unsigned int)simplified.size();
+			levelIndices.insert(levelIndices.end(), simplified.begin(), simplified.end());
+		}
+
+		if (levelIndices.empty() || levelIndices.size() > previous.IndexCount * LOD_MIN_REDUCTION)
+			break;
+
+		// Coarser levels should never claim to be more accurate than finer ones
+		float error = previous.Error;
+		for (size_t s = 0; s < submeshCount; s++)
+			error = std::max(error, submeshErrors[s]);
+
+		MeshLod lod = { (unsigned int)indices.size(), (unsigned int)levelIndices.size(), error };
+		indices.insert(indices.end(), levelIndices.begin(), levelIndices.end());
+		submeshes->insert(submeshes->end(), levelSubmeshes.begin(), levelSubmeshes.end());
+		lods.push_back(lod);
+	}
+}
+
+// --------------------------------------------------------
+// Picks which level of detail to draw
+//
+// - A level's error is scaled up to world units, then projected
+//    to find how many pixels it would cover at this distance
+// - The coarsest level that stays under maxPixelError wins
+//
+// lods             - Every level, finest first
+// distance         - From the camera to the nearest part of the mesh
+// modelScale       - How much the mesh is scaled by in the world
+// projectionScaleY - The projection matrix's Y scale (_22)
+// screenHeight     - The height of the render target, in pixels
+// maxPixelError    - How many pixels the error may cover
+//
+// Returns the index of the level to draw
+// --------------------------------------------------------
+unsigned int SelectLod(const MeshLod* lods, unsigned int lodCount, float distance, float modelScale, float projectionScaleY, float screenHeight, float maxPixelError)
+{
+	if (lodCount == 0 || distance <= 0)
+		return 0;
+
+	float pixelsPerUnit = projectionScaleY * screenHeight * 0.5f / distance;
+	for (unsigned int i = lodCount - 1; i > 0; i--)
+	{
+		if (lods[i].Error * modelScale * pixelsPerUnit <= maxPixelError)
+			return i;
+	}
+	return 0;
+}
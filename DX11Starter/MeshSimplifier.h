@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Vertex.h"
+#include <vector>
+
+// The most detail levels a mesh gets, including the original
+const unsigned int MESH_MAX_LODS = 5;
+
+// Each level aims for this fraction of the previous level's triangles
+const float LOD_TRIANGLE_RATIO = 0.5f;
+
+// Stop adding levels once the simplifier can't get at least
+// this far below the previous level (0.85 = 15% fewer triangles)
+const float LOD_MIN_REDUCTION = 0.85f;
+
+// Stop adding levels once a level would have fewer triangles than this
+const unsigned int LOD_MIN_TRIANGLES = 16;
+
+// How far (in pixels) a level's error may move on screen before
+// a finer level is used instead
+const float LOD_MAX_PIXEL_ERROR = 1.0f;
+
+// --------------------------------------------------------
+// One level of detail: a range of a mesh's index buffer
+// (every level shares the same vertex buffer)
+// --------------------------------------------------------
+struct MeshLod
+{
+	unsigned int FirstIndex;	// Where this level's indices start
+	unsigned int IndexCount;	// How many indices it has
+	float Error;				// How far (in model units) it strays from the original surface
+};
+
+// The longest material name a submesh keeps (including the terminator)
+const unsigned int SUBMESH_MAX_MATERIAL_NAME = 64;
+
+// --------------------------------------------------------
+// The part of one level of detail that uses one material
+//
+// - A level's submeshes are contiguous and in the same order
+//    at every level, so drawing a level is one draw per
+//    submesh, switching only the material in between
+// --------------------------------------------------------
+struct MeshSubmesh
+{
+	unsigned int FirstIndex;	// Where this submesh's indices start
+	unsigned int IndexCount;	// How many indices it has
+	char Material[SUBMESH_MAX_MATERIAL_NAME];	// The material's name from the model file ("" if it didn't name one)
+};
+
+// --------------------------------------------------------
+// One vertex moved by a collapse.  A collapse moves every
+// vertex at its position, so it's a run of these sharing
+// the same Collapse number.
+// --------------------------------------------------------
+struct VertexMove
+{
+	unsigned int Collapse;	// Which collapse this was part of, counting up in the order they were made
+	unsigned int From;		// The vertex that moved
+	unsigned int To;		// The vertex it moved onto
+	float Error;			// The collapse's error (in model units)
+};
+
+// Simplifies a mesh with edge collapses ordered by quadric error, writing the new indices
+// (and, if "moves" isn't null, every vertex each collapse moved, in order)
+// Returns the geometric error of the result (in model units)
+float SimplifyMesh(const Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices, size_t targetIndexCount, std::vector<unsigned int>& result, std::vector<VertexMove>* moves = 0);
+
+// Appends coarser and coarser levels to the end of "indices", filling "lods" with every level (the original first)
+// (and, if "submeshes" isn't null, simplifying each of the original's submeshes on its own and appending
+// every new level's submeshes after them)
+void BuildLodChain(const Vertex* verts, size_t numVerts, std::vector<unsigned int>& indices, std::vector<MeshLod>& lods, std::vector<MeshSubmesh>* submeshes = 0);
+
+// Picks the coarsest level whose error, projected onto the screen, is still under maxPixelError
+unsigned int SelectLod(const MeshLod* lods, unsigned int lodCount, float distance, float modelScale, float projectionScaleY, float screenHeight, float maxPixelError);
@@ -0,0 +1,1385 @@
+#include "ObjLoader.h"
+#include "MappedFile.h"
+#include <thread>
+#include <fstream>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <chrono>
+#include <cmath>
+
+using namespace DirectX;
+
+// Exact powers of ten for the float parser (doubles hold these without rounding)
+static const double powersOfTen[] =
+{
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// --------------------------------------------------------
+// Small tokenizer helpers
+//
+// - Each takes the current read position and the end of the
+//    text, and returns the position just past what it consumed
+// - None of them copy or allocate anything
+// --------------------------------------------------------
+static inline bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+static inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+static inline const char* SkipSpaces(const char* p, const char* end)
+{
+	while (p < end && IsSpace(*p)) p++;
+	return p;
+}
+
+static inline const char* SkipLine(const char* p, const char* end)
+{
+	const char* newline = (const char*)memchr(p, '\n', end - p);
+	return newline ? newline + 1 : end;
+}
+
+// Is this line the given keyword, followed by a space?
+static inline bool IsKeyword(const char* p, const char* end, const char* keyword, size_t length)
+{
+	return (size_t)(end - p) > length && memcmp(p, keyword, length) == 0 && IsSpace(p[length]);
+}
+
+// Reads the rest of the line (minus surrounding spaces) as a name, since
+// material and file names can have spaces in them
+static const char* ParseName(const char* p, const char* end, std::string& name)
+{
+	p = SkipSpaces(p, end);
+	const char* newline = (const char*)memchr(p, '\n', end - p);
+	const char* last = newline ? newline : end;
+	while (last > p && IsSpace(last[-1])) last--;
+	name.assign(p, last);
+	return last;
+}
+
+// --------------------------------------------------------
+// Parses a decimal float like "-0.0453", "12" or "1.5e-3"
+//
+// - Up to 19 significant digits are gathered into an integer,
+//    then scaled once by an exact power of ten
+// - Leaves "value" at 0 if there's no number here
+// --------------------------------------------------------
+static const char* ParseFloat(const char* p, const char* end, float& value)
+{
+	p = SkipSpaces(p, end);
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		p++;
+	}
+
+	unsigned long long mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+
+	// Whole part
+	for (; p < end && IsDigit(*p); p++)
+	{
+		if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); if (mantissa) digits++; }
+		else exponent++;
+	}
+
+	// Fractional part
+	if (p < end && *p == '.')
+	{
+		for (p++; p < end && IsDigit(*p); p++)
+		{
+			if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); if (mantissa) digits++; exponent--; }
+		}
+	}
+
+	// Scientific notation
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		const char* q = p + 1;
+		bool negativeExp = false;
+		if (q < end && (*q == '-' || *q == '+'))
+		{
+			negativeExp = (*q == '-');
+			q++;
+		}
+
+		if (q < end && IsDigit(*q))
+		{
+			int e = 0;
+			for (; q < end && IsDigit(*q); q++)
+				if (e < 10000) e = e * 10 + (*q - '0');
+			exponent += negativeExp ? -e : e;
+			p = q;
+		}
+	}
+
+	// Scale by the exponent, a chunk at a time if it's outside the table
+	double result = (double)mantissa;
+	while (exponent > 22) { result *= 1e22; exponent -= 22; }
+	while (exponent < -22) { result /= 1e22; exponent += 22; }
+	result = exponent >= 0 ? result * powersOfTen[exponent] : result / powersOfTen[-exponent];
+
+	value = (float)(negative ? -result : result);
+	return p;
+}
+
+// --------------------------------------------------------
+// Parses a (possibly negative) integer.  Sets "found" to
+// false, and consumes nothing, if there are no digits here.
+// --------------------------------------------------------
+static const char* ParseInt(const char* p, const char* end, int& value, bool& found)
+{
+	const char* start = p;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		p++;
+	}
+
+	found = p < end && IsDigit(*p);
+	if (!found)
+		return start;
+
+	long long result = 0;
+	for (; p < end && IsDigit(*p); p++)
+		if (result < 0x7FFFFFFF) result = result * 10 + (*p - '0');
+
+	value = (int)(negative ? -result : result);
+	return p;
+}
+
+// --------------------------------------------------------
+// Turns an OBJ index (1-based, or negative to count back from
+// the most recent element) into a 0-based index
+// --------------------------------------------------------
+static inline unsigned int ResolveIndex(int index, size_t count)
+{
+	if (index > 0) return (unsigned int)(index - 1);
+	if (index < 0 && (size_t)(-index) <= count) return (unsigned int)(count + index);
+	return OBJ_MISSING_INDEX;
+}
+
+// --------------------------------------------------------
+// How many of each kind of element a stretch of OBJ text has,
+// or how many came before it in the file
+// --------------------------------------------------------
+struct ObjCounts
+{
+	size_t Positions;
+	size_t Normals;
+	size_t UVs;
+	size_t Faces;
+};
+
+// --------------------------------------------------------
+// Parses one "v/vt/vn", "v//vn", "v/vt" or "v" face corner.
+// Returns the input position if there's no corner here.
+//
+// counts - How many of each attribute precede this line in the
+//          whole file, for resolving negative (relative) indices
+// --------------------------------------------------------
+static const char* ParseCorner(const char* p, const char* end, const ObjCounts& counts, ObjCorner& corner)
+{
+	corner.Position = corner.UV = corner.Normal = OBJ_MISSING_INDEX;
+
+	int index;
+	bool found;
+	const char* start = p;
+	p = ParseInt(p, end, index, found);
+	if (!found)
+		return start;
+	corner.Position = ResolveIndex(index, counts.Positions);
+
+	if (p < end && *p == '/')
+	{
+		p = ParseInt(p + 1, end, index, found);
+		if (found) corner.UV = ResolveIndex(index, counts.UVs);
+
+		if (p < end && *p == '/')
+		{
+			p = ParseInt(p + 1, end, index, found);
+			if (found) corner.Normal = ResolveIndex(index, counts.Normals);
+		}
+	}
+
+	return p;
+}
+
+// --------------------------------------------------------
+// Counts each kind of line so the attribute arrays can be
+// sized once up front, instead of growing while we parse
+// --------------------------------------------------------
+static ObjCounts CountObj(const char* p, const char* end)
+{
+	ObjCounts counts = {};
+	while (p < end)
+	{
+		p = SkipSpaces(p, end);
+		if (end - p >= 2)
+		{
+			if (p[0] == 'v' && IsSpace(p[1])) counts.Positions++;
+			else if (p[0] == 'v' && p[1] == 'n') counts.Normals++;
+			else if (p[0] == 'v' && p[1] == 't') counts.UVs++;
+			else if (p[0] == 'f' && IsSpace(p[1])) counts.Faces++;
+		}
+		p = SkipLine(p, end);
+	}
+	return counts;
+}
+
+// --------------------------------------------------------
+// Parses a stretch of OBJ text made up of whole lines
+//
+// p, end  - The text to parse
+// obj     - Data whose attribute arrays are already big enough;
+//           this stretch's attributes are written in place
+// base    - Where this stretch's attributes go in those arrays,
+//           which is also how many came before it in the file
+// corners - Where to append this stretch's triangles
+// runs    - Where to append this stretch's material runs, with
+//           triangles counted from the start of "corners"
+// libraries - Where to append the material libraries it names
+//
+// - Only touches its own slice of the attribute arrays, so
+//    several stretches can be parsed at the same time
+// --------------------------------------------------------
+static void ParseObjRange(const char* p, const char* end, ObjData& obj, ObjCounts base, std::vector<ObjCorner>& corners, std::vector<ObjMaterialRun>& runs, std::vector<std::string>& libraries)
+{
+	// Running counts, which double as write positions
+	ObjCounts counts = base;
+
+	while (p < end)
+	{
+		p = SkipSpaces(p, end);
+		if (p >= end)
+			break;
+
+		// Check the type of line
+		if (end - p >= 2 && p[0] == 'v' && p[1] == 'n')
+		{
+			XMFLOAT3& norm = obj.Normals[counts.Normals++];
+			p = ParseFloat(p + 2, end, norm.x);
+			p = ParseFloat(p, end, norm.y);
+			p = ParseFloat(p, end, norm.z);
+		}
+		else if (end - p >= 2 && p[0] == 'v' && p[1] == 't')
+		{
+			XMFLOAT2& uv = obj.UVs[counts.UVs++];
+			p = ParseFloat(p + 2, end, uv.x);
+			p = ParseFloat(p, end, uv.y);
+		}
+		else if (end - p >= 2 && p[0] == 'v' && IsSpace(p[1]))
+		{
+			XMFLOAT3& pos = obj.Positions[counts.Positions++];
+			p = ParseFloat(p + 1, end, pos.x);
+			p = ParseFloat(p, end, pos.y);
+			p = ParseFloat(p, end, pos.z);
+		}
+		else if (end - p >= 2 && p[0] == 'f' && IsSpace(p[1]))
+		{
+			// Split the polygon into a fan of triangles around its
+			// first corner, flipping the winding order as we go
+			// (the file is right-handed, DirectX is left-handed)
+			ObjCorner first, previous, current;
+			int cornerCount = 0;
+			p++;
+			while (true)
+			{
+				p = SkipSpaces(p, end);
+				const char* next = ParseCorner(p, end, counts, current);
+				if (next == p)
+					break;
+				p = next;
+
+				if (cornerCount == 0) first = current;
+				else if (cornerCount >= 2)
+				{
+					corners.push_back(first);
+					corners.push_back(current);
+					corners.push_back(previous);
+				}
+
+				previous = current;
+				cornerCount++;
+			}
+		}
+		else if (IsKeyword(p, end, "usemtl", 6))
+		{
+			ObjMaterialRun run = { (unsigned int)(corners.size() / 3) };
+			p = ParseName(p + 6, end, run.Material);
+			runs.push_back(run);
+		}
+		else if (IsKeyword(p, end, "mtllib", 6))
+		{
+			std::string library;
+			p = ParseName(p + 6, end, library);
+			libraries.push_back(library);
+		}
+
+		// Skip whatever is left on this line (comments, groups, etc.)
+		p = SkipLine(p, end);
+	}
+}
+
+// --------------------------------------------------------
+// Grows the attribute arrays to make room for the given
+// counts, returning where the new elements start
+// --------------------------------------------------------
+static ObjCounts GrowObj(ObjData& obj, const ObjCounts& counts)
+{
+	ObjCounts base = { obj.Positions.size(), obj.Normals.size(), obj.UVs.size(), 0 };
+	obj.Positions.resize(base.Positions + counts.Positions);
+	obj.Normals.resize(base.Normals + counts.Normals);
+	obj.UVs.resize(base.UVs + counts.UVs);
+	return base;
+}
+
+// --------------------------------------------------------
+// Parses OBJ text that is already in memory
+//
+// text   - The start of the OBJ text (doesn't need a null terminator)
+// length - How many bytes of text there are
+// obj    - Where to append the positions, normals, uvs, triangles
+//          and materials
+// --------------------------------------------------------
+void ParseObj(const char* text, size_t length, ObjData& obj)
+{
+	const char* end = text + length;
+
+	ObjCounts counts = CountObj(text, end);
+	ObjCounts base = GrowObj(obj, counts);
+
+	obj.Corners.reserve(obj.Corners.size() + counts.Faces * 3);
+	ParseObjRange(text, end, obj, base, obj.Corners, obj.MaterialRuns, obj.MaterialLibraries);
+}
+
+// --------------------------------------------------------
+// Parses OBJ text that is already in memory, using several
+// threads.  The result is identical to ParseObj().
+//
+// text        - The start of the OBJ text
+// length      - How many bytes of text there are
+// obj         - Where to append the positions, normals, uvs, triangles
+//               and materials
+// threadCount - How many threads to split the work across
+//
+// - The text is cut into one chunk per thread at line boundaries
+// - Each thread counts the elements in its chunk, and a prefix
+//    sum of those counts tells every chunk where its attributes
+//    go and how to resolve its negative face indices
+// - Each thread then parses its chunk straight into its slice of
+//    the attribute arrays, with triangles (and material runs) going
+//    to per-chunk lists
+// - Finally the lists are stitched together in file order, moving
+//    each chunk's runs past the triangles that came before it
+// --------------------------------------------------------
+void ParseObjParallel(const char* text, size_t length, ObjData& obj, unsigned int threadCount)
+{
+	// Don't bother splitting up tiny files
+	size_t maxChunks = length / OBJ_MIN_CHUNK_BYTES;
+	if (threadCount > maxChunks) threadCount = (unsigned int)maxChunks;
+	if (threadCount <= 1)
+	{
+		ParseObj(text, length, obj);
+		return;
+	}
+
+	const char* end = text + length;
+
+	// Find where each chunk starts, moving each cut forward to just past a newline
+	std::vector<const char*> chunkStarts(threadCount + 1);
+	chunkStarts[0] = text;
+	chunkStarts[threadCount] = end;
+	for (unsigned int i = 1; i < threadCount; i++)
+	{
+		const char* cut = text + (length / threadCount) * i;
+		if (cut < chunkStarts[i - 1]) cut = chunkStarts[i - 1];
+		chunkStarts[i] = cut > text && cut[-1] == '\n' ? cut : SkipLine(cut, end);
+	}
+
+	// Count each chunk's elements in parallel
+	std::vector<ObjCounts> chunkCounts(threadCount);
+	std::vector<std::thread> workers;
+	workers.reserve(threadCount);
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		workers.push_back(std::thread([&, i]()
+		{
+			chunkCounts[i] = CountObj(chunkStarts[i], chunkStarts[i + 1]);
+		}));
+	}
+	for (auto& worker : workers) worker.join();
+	workers.clear();
+
+	// Prefix sum the counts to get each chunk's starting offsets
+	ObjCounts total = {};
+	std::vector<ObjCounts> chunkBases(threadCount);
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		chunkBases[i] = total;
+		total.Positions += chunkCounts[i].Positions;
+		total.Normals += chunkCounts[i].Normals;
+		total.UVs += chunkCounts[i].UVs;
+		total.Faces += chunkCounts[i].Faces;
+	}
+
+	// Make room for everything, then offset each chunk past what was already there
+	ObjCounts base = GrowObj(obj, total);
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		chunkBases[i].Positions += base.Positions;
+		chunkBases[i].Normals += base.Normals;
+		chunkBases[i].UVs += base.UVs;
+	}
+
+	// Parse every chunk in parallel
+	std::vector<std::vector<ObjCorner>> chunkCorners(threadCount);
+	std::vector<std::vector<ObjMaterialRun>> chunkRuns(threadCount);
+	std::vector<std::vector<std::string>> chunkLibraries(threadCount);
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		workers.push_back(std::thread([&, i]()
+		{
+			chunkCorners[i].reserve(chunkCounts[i].Faces * 3);
+			ParseObjRange(chunkStarts[i], chunkStarts[i + 1], obj, chunkBases[i], chunkCorners[i], chunkRuns[i], chunkLibraries[i]);
+		}));
+	}
+	for (auto& worker : workers) worker.join();
+
+	// Stitch the triangles back together in file order
+	size_t cornerTotal = 0;
+	for (auto& corners : chunkCorners) cornerTotal += corners.size();
+	obj.Corners.reserve(obj.Corners.size() + cornerTotal);
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		for (auto& run : chunkRuns[i])
+		{
+			run.FirstTriangle += (unsigned int)(obj.Corners.size() / 3);
+			obj.MaterialRuns.push_back(run);
+		}
+		obj.MaterialLibraries.insert(obj.MaterialLibraries.end(), chunkLibraries[i].begin(), chunkLibraries[i].end());
+		obj.Corners.insert(obj.Corners.end(), chunkCorners[i].begin(), chunkCorners[i].end());
+	}
+}
+
+// --------------------------------------------------------
+// Maps the file into memory and parses the whole thing
+//
+// filename    - Path to the OBJ file
+// obj         - Where to put the parsed data
+// threadCount - Threads to parse with (0 picks one per CPU core)
+//
+// Returns false if the file could not be opened
+// --------------------------------------------------------
+bool LoadObj(const char* filename, ObjData& obj, unsigned int threadCount)
+{
+	MappedFile file(filename);
+	if (!file.IsOpen())
+		return false;
+
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+
+	ParseObjParallel(file.GetData(), file.GetSize(), obj, threadCount);
+	return true;
+}
+
+// --------------------------------------------------------
+// Builds the left-handed vertex for one face corner
+//
+// - Missing uvs and normals are left at zero
+// - The corner's position must exist
+// --------------------------------------------------------
+static Vertex MakeVertex(const ObjCorner& corner, const XMFLOAT3* positions, const XMFLOAT2* uvs, size_t uvCount, const XMFLOAT3* normals, size_t normalCount)
+{
+	// - Create the vert by looking up
+	//    corresponding data from the attribute arrays
+	Vertex v = {};
+	v.Position = positions[corner.Position];
+	if (corner.UV < uvCount) v.UV = uvs[corner.UV];
+	if (corner.Normal < normalCount) v.Normal = normals[corner.Normal];
+
+	// The model is most likely in a right-handed space,
+	// especially if it came from Maya.  We want to convert
+	// to a left-handed space for DirectX.  This means we 
+	// need to:
+	//  - Invert the Z position
+	//  - Invert the normal's Z
+	//  - Flip the winding order (done while parsing)
+	// We also need to flip the UV coordinate since DirectX
+	// defines (0,0) as the top left of the texture, and many
+	// 3D modeling packages use the bottom left as (0,0)
+	v.UV.y = 1.0f - v.UV.y;
+	v.Position.z *= -1.0f;
+	v.Normal.z *= -1.0f;
+	return v;
+}
+
+// --------------------------------------------------------
+// Converts the parsed OBJ data into vertices and indices
+//
+// - Each unique (position, uv, normal) combination becomes
+//    a single vertex, which every triangle using it shares
+// - Values are compared rather than indices, since many
+//    exporters write the same normal or position more than once
+// - Triangles referencing positions that don't exist are skipped
+//    (and material runs are renumbered to match)
+// --------------------------------------------------------
+void BuildIndexedMesh(const ObjData& obj, std::vector<Vertex>& verts, std::vector<unsigned int>& indices, std::vector<ObjMaterialRun>* materialRuns)
+{
+	// Lookup from a (position, uv, normal) combination to the
+	// vertex already created for it, so shared corners are reused
+	std::unordered_map<Vertex, unsigned int, VertexHash, VertexEqual> vertLookup;
+	vertLookup.reserve(obj.Positions.size() * 2);
+
+	verts.reserve(obj.Positions.size());
+	indices.reserve(obj.Corners.size());
+	if (materialRuns)
+		materialRuns->clear();
+
+	size_t nextRun = 0;
+	for (size_t tri = 0; tri + 2 < obj.Corners.size(); tri += 3)
+	{
+		// Start any runs that begin here, counting only the triangles we've kept
+		for (; materialRuns && nextRun < obj.MaterialRuns.size() && obj.MaterialRuns[nextRun].FirstTriangle <= tri / 3; nextRun++)
+		{
+			ObjMaterialRun run = { (unsigned int)(indices.size() / 3), obj.MaterialRuns[nextRun].Material };
+			if (!materialRuns->empty() && materialRuns->back().FirstTriangle == run.FirstTriangle)
+				materialRuns->back() = run;
+			else
+				materialRuns->push_back(run);
+		}
+
+		// Skip triangles that reference positions that don't exist
+		bool valid = true;
+		for (int c = 0; c < 3; c++)
+			valid = valid && obj.Corners[tri + c].Position < obj.Positions.size();
+		if (!valid)
+			continue;
+
+		for (int c = 0; c < 3; c++)
+		{
+			Vertex v = MakeVertex(obj.Corners[tri + c], obj.Positions.data(), obj.UVs.data(), obj.UVs.size(), obj.Normals.data(), obj.Normals.size());
+
+			// Already made this exact vertex?  Reuse it
+			auto found = vertLookup.find(v);
+			if (found != vertLookup.end())
+			{
+				indices.push_back(found->second);
+				continue;
+			}
+
+			unsigned int index = (unsigned int)verts.size();
+			verts.push_back(v);
+			vertLookup[v] = index;
+			indices.push_back(index);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Sorts triangles into one contiguous range per material
+//
+// indices      - The triangles, reordered in place
+// materialRuns - Which material each stretch of triangles uses
+// materials    - Filled with each material's name, in the order
+//                they're first used ("" for triangles before
+//                the first run)
+// rangeStarts  - Filled with where each material's indices start
+//
+// - Triangles keep their order within each material, and
+//    materials no triangle uses are left out
+// --------------------------------------------------------
+void GroupTrianglesByMaterial(std::vector<unsigned int>& indices, const std::vector<ObjMaterialRun>& materialRuns, std::vector<std::string>& materials, std::vector<unsigned int>& rangeStarts)
+{
+	materials.clear();
+	rangeStarts.clear();
+
+	// Give each triangle its material's slot, numbering materials as they're first used
+	size_t numTris = indices.size() / 3;
+	std::vector<unsigned int> triangleSlots(numTris);
+	std::unordered_map<std::string, unsigned int> slots;
+	std::vector<unsigned int> slotCounts;
+	size_t nextRun = 0;
+	std::string current;
+	for (size_t t = 0; t < numTris; t++)
+	{
+		while (nextRun < materialRuns.size() && materialRuns[nextRun].FirstTriangle <= t)
+			current = materialRuns[nextRun++].Material;
+
+		auto found = slots.find(current);
+		if (found == slots.end())
+		{
+			found = slots.insert(std::make_pair(current, (unsigned int)materials.size())).first;
+			materials.push_back(current);
+			slotCounts.push_back(0);
+		}
+		triangleSlots[t] = found->second;
+		slotCounts[found->second]++;
+	}
+
+	// Prefix sum the counts to find where each range starts, then copy every triangle into place
+	unsigned int start = 0;
+	for (size_t m = 0; m < materials.size(); m++)
+	{
+		rangeStarts.push_back(start * 3);
+		start += slotCounts[m];
+	}
+	if (materials.size() <= 1)
+		return;
+
+	std::vector<unsigned int> sorted(indices.size());
+	std::vector<unsigned int> cursors(rangeStarts);
+	for (size_t t = 0; t < numTris; t++)
+	{
+		unsigned int& cursor = cursors[triangleSlots[t]];
+		memcpy(&sorted[cursor], &indices[t * 3], 3 * sizeof(unsigned int));
+		cursor += 3;
+	}
+	indices.swap(sorted);
+}
+
+// --------------------------------------------------------
+// Reads the materials out of a .mtl file
+//
+// - Only "newmtl", "Kd" and "map_Kd" are understood; every
+//    other line is skipped
+// - Texture options (like "-s 1 1 1") are skipped, leaving
+//    just the file name
+//
+// Returns false if the file could not be opened
+// --------------------------------------------------------
+bool LoadMtl(const char* filename, std::vector<ObjMaterial>& materials)
+{
+	MappedFile file(filename);
+	if (!file.IsOpen())
+		return false;
+
+	const char* p = file.GetData();
+	const char* end = p + file.GetSize();
+	while (p < end)
+	{
+		p = SkipSpaces(p, end);
+		if (IsKeyword(p, end, "newmtl", 6))
+		{
+			ObjMaterial material;
+			material.DiffuseColor = XMFLOAT3(1, 1, 1);
+			p = ParseName(p + 6, end, material.Name);
+			materials.push_back(material);
+		}
+		else if (!materials.empty() && IsKeyword(p, end, "Kd", 2))
+		{
+			XMFLOAT3& color = materials.back().DiffuseColor;
+			p = ParseFloat(p + 2, end, color.x);
+			p = ParseFloat(p, end, color.y);
+			p = ParseFloat(p, end, color.z);
+		}
+		else if (!materials.empty() && IsKeyword(p, end, "map_Kd", 6))
+		{
+			std::string& texture = materials.back().DiffuseTexture;
+			p = ParseName(p + 6, end, texture);
+			while (!texture.empty() && texture[0] == '-')
+			{
+				size_t space = texture.find_last_of(" \t");
+				texture = space == std::string::npos ? std::string() : texture.substr(space + 1);
+			}
+		}
+		p = SkipLine(p, end);
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// An array that's written to a temporary file instead of
+// kept in memory, through a fixed-size write buffer
+// --------------------------------------------------------
+struct ObjSpillFile
+{
+	std::string Path;
+	std::vector<char> Buffer;
+	std::ofstream Out;
+
+	bool Open(const std::string& path, size_t bufferBytes)
+	{
+		Path = path;
+		Buffer.resize(bufferBytes);
+		Out.rdbuf()->pubsetbuf(&Buffer[0], (std::streamsize)Buffer.size());
+		Out.open(path.c_str(), std::ios::binary | std::ios::trunc);
+		return Out.is_open();
+	}
+
+	template<typename T> void Append(const T& value) { Out.write((const char*)&value, sizeof(T)); }
+};
+
+// --------------------------------------------------------
+// Parses a stretch of whole OBJ lines, appending what it
+// finds to the spill files instead of arrays in memory
+//
+// counts - How many of each element came before this stretch,
+//          updated as elements are found
+// spills - The position, normal, uv and corner files
+// runs, libraries - Where to append material runs (counting
+//          every triangle in the file) and material libraries,
+//          which are small enough to keep in memory
+// --------------------------------------------------------
+static void StreamObjLines(const char* p, const char* end, ObjCounts& counts, ObjSpillFile* spills, std::vector<ObjMaterialRun>& runs, std::vector<std::string>& libraries)
+{
+	while (p < end)
+	{
+		p = SkipSpaces(p, end);
+		if (p >= end)
+			break;
+
+		// Same line handling as ParseObjRange(), just written out
+		if (end - p >= 2 && p[0] == 'v' && p[1] == 'n')
+		{
+			XMFLOAT3 norm;
+			p = ParseFloat(p + 2, end, norm.x);
+			p = ParseFloat(p, end, norm.y);
+			p = ParseFloat(p, end, norm.z);
+			spills[1].Append(norm);
+			counts.Normals++;
+		}
+		else if (end - p >= 2 && p[0] == 'v' && p[1] == 't')
+		{
+			XMFLOAT2 uv;
+			p = ParseFloat(p + 2, end, uv.x);
+			p = ParseFloat(p, end, uv.y);
+			spills[2].Append(uv);
+			counts.UVs++;
+		}
+		else if (end - p >= 2 && p[0] == 'v' && IsSpace(p[1]))
+		{
+			XMFLOAT3 pos;
+			p = ParseFloat(p + 1, end, pos.x);
+			p = ParseFloat(p, end, pos.y);
+			p = ParseFloat(p, end, pos.z);
+			spills[0].Append(pos);
+			counts.Positions++;
+		}
+		else if (end - p >= 2 && p[0] == 'f' && IsSpace(p[1]))
+		{
+			// Fan triangulation with flipped winding, as in ParseObjRange()
+			ObjCorner first, previous, current;
+			int cornerCount = 0;
+			p++;
+			while (true)
+			{
+				p = SkipSpaces(p, end);
+				const char* next = ParseCorner(p, end, counts, current);
+				if (next == p)
+					break;
+				p = next;
+
+				if (cornerCount == 0) first = current;
+				else if (cornerCount >= 2)
+				{
+					spills[3].Append(first);
+					spills[3].Append(current);
+					spills[3].Append(previous);
+					counts.Faces++;
+				}
+
+				previous = current;
+				cornerCount++;
+			}
+		}
+		else if (IsKeyword(p, end, "usemtl", 6))
+		{
+			ObjMaterialRun run = { (unsigned int)counts.Faces };
+			p = ParseName(p + 6, end, run.Material);
+			runs.push_back(run);
+		}
+		else if (IsKeyword(p, end, "mtllib", 6))
+		{
+			std::string library;
+			p = ParseName(p + 6, end, library);
+			libraries.push_back(library);
+		}
+
+		p = SkipLine(p, end);
+	}
+}
+
+// --------------------------------------------------------
+// Imports an OBJ file in bounded memory
+//
+// filename  - Path to the OBJ file
+// sink      - Receives the welded vertices and indices, in batches
+// memoryCap - Roughly the most memory the importer will allocate
+// stats     - Optional, filled in with what the import found and used
+//
+// - Pass one reads the file through a fixed window, and spills
+//    positions, normals, uvs and triangle corners to temporary
+//    files next to it as they're parsed
+// - Pass two maps the attribute files (the OS pages them in
+//    and out as needed, so they don't count against the cap),
+//    reads the corners back a batch at a time, and welds them
+// - The weld table has a fixed size: when it fills up it's
+//    emptied, so a vertex seen again much later may be written
+//    twice.  The mesh is still correct, just slightly less welded
+//    (OBJ files are usually local enough that this is rare)
+// - Material libraries are handed to the sink once pass one is
+//    done, and material changes as pass two reaches them
+// - The result is the same as BuildIndexedMesh() whenever the
+//    weld table never fills up
+//
+// Returns false if the file (or the temporary files) couldn't be opened
+// --------------------------------------------------------
+bool StreamObj(const char* filename, ObjStreamSink& sink, size_t memoryCap, ObjStreamStats* stats)
+{
+	ObjStreamStats localStats = {};
+	ObjStreamStats& result = stats ? *stats : localStats;
+	result = ObjStreamStats();
+
+	// Share out the budget
+	// - 1/8 for the read window, 1/8 for the spill files' write buffers
+	// - 1/16 for reading corners back, 1/8 for the output batches
+	// - Half for the weld table
+	if (memoryCap < 1024 * 1024) memoryCap = 1024 * 1024;
+	size_t windowBytes = memoryCap / 8;
+	size_t spillBufferBytes = memoryCap / 32;
+	size_t cornerBatchTriangles = memoryCap / 16 / (3 * sizeof(ObjCorner));
+	size_t vertBatchMax = memoryCap / 16 / sizeof(Vertex);
+	size_t indexBatchMax = memoryCap / 16 / sizeof(unsigned int);
+	size_t weldMax = memoryCap / 2 / OBJ_STREAM_WELD_ENTRY_BYTES;
+
+	std::ifstream in(filename, std::ios::binary);
+	if (!in.is_open())
+		return false;
+
+	// Pass one: parse the file a window at a time ----------------------------
+	const char* spillNames[4] = { ".positions.tmp", ".normals.tmp", ".uvs.tmp", ".corners.tmp" };
+	ObjSpillFile spills[4];
+	bool opened = true;
+	for (int i = 0; i < 4; i++)
+		opened = spills[i].Open(std::string(filename) + spillNames[i], spillBufferBytes) && opened;
+
+	ObjCounts counts = {};
+	std::vector<ObjMaterialRun> runs;
+	std::vector<std::string> libraries;
+	if (opened)
+	{
+		std::vector<char> window(windowBytes);
+		size_t carried = 0;
+		bool skipping = false;
+		while (true)
+		{
+			// Top the window up after whatever partial line was left from last time
+			in.read(&window[carried], (std::streamsize)(windowBytes - carried));
+			size_t filled = carried + (size_t)in.gcount();
+			bool last = filled < windowBytes;
+			const char* text = &window[0];
+			const char* end = text + filled;
+
+			// Still looking for the end of a line that was too long?
+			if (skipping)
+			{
+				const char* newline = (const char*)memchr(text, '\n', end - text);
+				if (!newline)
+				{
+					carried = 0;
+					if (last) break;
+					continue;
+				}
+				text = newline + 1;
+				skipping = false;
+			}
+
+			// Parse up to the last whole line (or everything, at the end of the file)
+			const char* cut = end;
+			if (!last)
+			{
+				while (cut > text && cut[-1] != '\n') cut--;
+				if (cut == text)
+				{
+					// Not a single line ending in the whole window
+					result.LinesTooLong++;
+					skipping = true;
+					carried = 0;
+					continue;
+				}
+			}
+			StreamObjLines(text, cut, counts, spills, runs, libraries);
+
+			carried = end - cut;
+			memmove(&window[0], cut, carried);
+			if (last) break;
+		}
+
+		result.PeakBytes = windowBytes + 4 * spillBufferBytes;
+	}
+
+	for (int i = 0; i < 4; i++)
+		spills[i].Out.close();
+	in.close();
+
+	result.Positions = counts.Positions;
+	result.Normals = counts.Normals;
+	result.UVs = counts.UVs;
+	result.Triangles = counts.Faces;
+	for (size_t i = 0; i < libraries.size(); i++)
+		sink.AddMaterialLibrary(libraries[i].c_str());
+
+	// Pass two: weld the triangles -------------------------------------------
+	if (opened)
+	{
+		MappedFile positionFile(spills[0].Path.c_str());
+		MappedFile normalFile(spills[1].Path.c_str());
+		MappedFile uvFile(spills[2].Path.c_str());
+		const XMFLOAT3* positions = (const XMFLOAT3*)positionFile.GetData();
+		const XMFLOAT3* normals = (const XMFLOAT3*)normalFile.GetData();
+		const XMFLOAT2* uvs = (const XMFLOAT2*)uvFile.GetData();
+		size_t positionCount = positionFile.GetSize() / sizeof(XMFLOAT3);
+		size_t normalCount = normalFile.GetSize() / sizeof(XMFLOAT3);
+		size_t uvCount = uvFile.GetSize() / sizeof(XMFLOAT2);
+
+		std::ifstream cornerFile(spills[3].Path.c_str(), std::ios::binary);
+		std::vector<ObjCorner> cornerBatch(cornerBatchTriangles * 3);
+		std::vector<Vertex> vertBatch;
+		std::vector<unsigned int> indexBatch;
+		vertBatch.reserve(vertBatchMax);
+		indexBatch.reserve(indexBatchMax);
+
+		std::unordered_map<Vertex, unsigned int, VertexHash, VertexEqual> vertLookup;
+		vertLookup.reserve(weldMax);
+		size_t weldPeak = 0;
+
+		// Hands the batches to the sink, vertices first
+		auto flush = [&]()
+		{
+			if (!vertBatch.empty()) sink.WriteVertices(&vertBatch[0], vertBatch.size());
+			if (!indexBatch.empty()) sink.WriteIndices(&indexBatch[0], indexBatch.size());
+			result.VerticesOut += vertBatch.size();
+			result.IndicesOut += indexBatch.size();
+			vertBatch.clear();
+			indexBatch.clear();
+		};
+
+		unsigned int nextIndex = 0;
+		size_t triangleNumber = 0;
+		size_t nextRun = 0;
+		while (cornerFile.is_open())
+		{
+			cornerFile.read((char*)&cornerBatch[0], (std::streamsize)(cornerBatch.size() * sizeof(ObjCorner)));
+			size_t triangles = (size_t)cornerFile.gcount() / (3 * sizeof(ObjCorner));
+			if (triangles == 0)
+				break;
+
+			for (size_t t = 0; t < triangles; t++, triangleNumber++)
+			{
+				const ObjCorner* tri = &cornerBatch[t * 3];
+
+				// Has the material changed?  Everything so far goes out with the old one
+				if (nextRun < runs.size() && runs[nextRun].FirstTriangle <= triangleNumber)
+				{
+					flush();
+					for (; nextRun < runs.size() && runs[nextRun].FirstTriangle <= triangleNumber; nextRun++)
+						sink.BeginMaterial(runs[nextRun].Material.c_str());
+				}
+
+				// Skip triangles that reference positions that don't exist
+				if (tri[0].Position >= positionCount || tri[1].Position >= positionCount || tri[2].Position >= positionCount)
+					continue;
+
+				// Keep the batches from growing past their share
+				if (vertBatch.size() + 3 > vertBatchMax || indexBatch.size() + 3 > indexBatchMax)
+					flush();
+
+				for (int c = 0; c < 3; c++)
+				{
+					Vertex v = MakeVertex(tri[c], positions, uvs, uvCount, normals, normalCount);
+
+					// Already made this exact vertex (recently)?  Reuse it
+					auto found = vertLookup.find(v);
+					if (found != vertLookup.end())
+					{
+						indexBatch.push_back(found->second);
+						continue;
+					}
+
+					// Out of room to remember vertices?  Start over
+					if (vertLookup.size() >= weldMax)
+					{
+						vertLookup.clear();
+						result.WeldResets++;
+					}
+
+					vertBatch.push_back(v);
+					vertLookup[v] = nextIndex;
+					indexBatch.push_back(nextIndex);
+					nextIndex++;
+				}
+				weldPeak = std::max(weldPeak, vertLookup.size());
+			}
+		}
+		flush();
+
+		size_t passTwoBytes =
+			cornerBatch.size() * sizeof(ObjCorner) +
+			vertBatchMax * sizeof(Vertex) +
+			indexBatchMax * sizeof(unsigned int) +
+			weldPeak * OBJ_STREAM_WELD_ENTRY_BYTES;
+		result.PeakBytes = std::max(result.PeakBytes, passTwoBytes);
+	}
+
+	// Clean up the temporary files (their mappings are closed by now)
+	for (int i = 0; i < 4; i++)
+		remove(spills[i].Path.c_str());
+
+	return opened;
+}
+
+// --------------------------------------------------------
+// Loads each model in "modelDirectory" with and without
+// welding, and checks the welded mesh is the same shape
+//
+// - Every index has to point at a vertex equal to the one
+//    its face corner makes, and no two vertices can be equal
+// - Prints each model's vertex count and size both ways:
+//    without welding, every corner is its own vertex, with
+//    an index list that just counts up
+// - Returns false if any model can't be read, or fails
+// --------------------------------------------------------
+bool CheckObjWelding(const char* modelDirectory)
+{
+	static const char* models[] = { "cube.obj", "sphere.obj", "cylinder.obj", "cone.obj", "torus.obj", "helix.obj" };
+	bool passed = true;
+
+	printf("\nOBJ welding:");
+	for (int m = 0; m < 6; m++)
+	{
+		std::string filename = std::string(modelDirectory) + "/" + models[m];
+		ObjData obj;
+		if (!LoadObj(filename.c_str(), obj, 1))
+		{
+			printf("\n  %s: couldn't be read", models[m]);
+			passed = false;
+			continue;
+		}
+
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+		BuildIndexedMesh(obj, verts, indices);
+
+		bool matches = indices.size() == obj.Corners.size();
+		for (size_t i = 0; matches && i < indices.size(); i++)
+		{
+			Vertex corner = MakeVertex(obj.Corners[i], obj.Positions.data(), obj.UVs.data(), obj.UVs.size(), obj.Normals.data(), obj.Normals.size());
+			matches = indices[i] < verts.size() && VertexEqual()(verts[indices[i]], corner);
+		}
+		std::unordered_map<Vertex, unsigned int, VertexHash, VertexEqual> unique;
+		for (size_t v = 0; v < verts.size(); v++)
+			unique[verts[v]] = (unsigned int)v;
+		bool welded = unique.size() == verts.size();
+
+		size_t beforeBytes = obj.Corners.size() * (sizeof(Vertex) + sizeof(unsigned int));
+		size_t afterBytes = verts.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int);
+		printf("\n  %s: %u verts (%u bytes) before, %u verts (%u bytes) after, %u indices, %s",
+			models[m], (unsigned int)obj.Corners.size(), (unsigned int)beforeBytes,
+			(unsigned int)verts.size(), (unsigned int)afterBytes, (unsigned int)indices.size(),
+			!matches ? "FAILED (triangles changed)" : !welded ? "FAILED (duplicate verts)" : "ok");
+		passed = passed && matches && welded;
+	}
+	return passed;
+}
+
+// --------------------------------------------------------
+// The way OBJ files used to be read, kept to compare against:
+// a line at a time (of at most 100 characters) with getline,
+// each parsed with sscanf, only handling triangles and quads
+// with every index given
+// --------------------------------------------------------
+static void ParseObjLines(const char* filename, ObjData& obj)
+{
+	std::ifstream file(filename);
+	char chars[100];
+	while (file.good())
+	{
+		file.getline(chars, 100);
+
+		if (chars[0] == 'v' && chars[1] == 'n')
+		{
+			XMFLOAT3 norm;
+			sscanf(chars, "vn %f %f %f", &norm.x, &norm.y, &norm.z);
+			obj.Normals.push_back(norm);
+		}
+		else if (chars[0] == 'v' && chars[1] == 't')
+		{
+			XMFLOAT2 uv;
+			sscanf(chars, "vt %f %f", &uv.x, &uv.y);
+			obj.UVs.push_back(uv);
+		}
+		else if (chars[0] == 'v')
+		{
+			XMFLOAT3 pos;
+			sscanf(chars, "v %f %f %f", &pos.x, &pos.y, &pos.z);
+			obj.Positions.push_back(pos);
+		}
+		else if (chars[0] == 'f')
+		{
+			int i[12];
+			int facesRead = sscanf(chars, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
+				&i[0], &i[1], &i[2], &i[3], &i[4], &i[5], &i[6], &i[7], &i[8], &i[9], &i[10], &i[11]);
+
+			// The same flipped fan the tokenizer makes
+			ObjCorner c[4];
+			for (int k = 0; k < 4; k++)
+			{
+				c[k].Position = i[k * 3] - 1;
+				c[k].UV = i[k * 3 + 1] - 1;
+				c[k].Normal = i[k * 3 + 2] - 1;
+			}
+			obj.Corners.push_back(c[0]);
+			obj.Corners.push_back(c[2]);
+			obj.Corners.push_back(c[1]);
+			if (facesRead == 12)
+			{
+				obj.Corners.push_back(c[0]);
+				obj.Corners.push_back(c[3]);
+				obj.Corners.push_back(c[2]);
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Times parsing models with the tokenizer, against the old
+// getline and sscanf loop
+//
+// - Both sides run on one thread, and include opening the
+//    file, so the difference is just the parsing
+// - Both have to give exactly the same attributes and corners
+// --------------------------------------------------------
+void BenchmarkObjParsing(const char* modelDirectory)
+{
+	const int runs = 10;
+	static const char* models[] = { "helix.obj", "sphere.obj", "torus.obj" };
+
+	printf("\nOBJ parsing (best of %d):", runs);
+	for (int m = 0; m < 3; m++)
+	{
+		std::string filename = std::string(modelDirectory) + "/" + models[m];
+
+		double lineSeconds = 1e30;
+		double tokenSeconds = 1e30;
+		ObjData lineObj;
+		ObjData tokenObj;
+		bool opened = true;
+		for (int r = 0; r < runs && opened; r++)
+		{
+			lineObj = ObjData();
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			ParseObjLines(filename.c_str(), lineObj);
+			double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			lineSeconds = seconds < lineSeconds ? seconds : lineSeconds;
+
+			tokenObj = ObjData();
+			start = std::chrono::high_resolution_clock::now();
+			opened = LoadObj(filename.c_str(), tokenObj, 1);
+			seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			tokenSeconds = seconds < tokenSeconds ? seconds : tokenSeconds;
+		}
+		if (!opened)
+		{
+			printf("\n  %s: couldn't be read", models[m]);
+			continue;
+		}
+
+		bool same =
+			lineObj.Positions.size() == tokenObj.Positions.size() &&
+			lineObj.Normals.size() == tokenObj.Normals.size() &&
+			lineObj.UVs.size() == tokenObj.UVs.size() &&
+			lineObj.Corners.size() == tokenObj.Corners.size() &&
+			(lineObj.Positions.empty() || memcmp(&lineObj.Positions[0], &tokenObj.Positions[0], lineObj.Positions.size() * sizeof(XMFLOAT3)) == 0) &&
+			(lineObj.Normals.empty() || memcmp(&lineObj.Normals[0], &tokenObj.Normals[0], lineObj.Normals.size() * sizeof(XMFLOAT3)) == 0) &&
+			(lineObj.UVs.empty() || memcmp(&lineObj.UVs[0], &tokenObj.UVs[0], lineObj.UVs.size() * sizeof(XMFLOAT2)) == 0) &&
+			(lineObj.Corners.empty() || memcmp(&lineObj.Corners[0], &tokenObj.Corners[0], lineObj.Corners.size() * sizeof(ObjCorner)) == 0);
+
+		printf("\n  %s: %.3f ms with getline and sscanf, %.3f ms with the tokenizer (%.1fx), %s",
+			models[m], lineSeconds * 1000.0, tokenSeconds * 1000.0,
+			tokenSeconds > 0 ? lineSeconds / tokenSeconds : 0.0, same ? "same results" : "DIFFERENT RESULTS");
+	}
+}
+
+// Whether two parses gave exactly the same attributes, corners and material runs
+static bool SameObj(const ObjData& a, const ObjData& b)
+{
+	if (a.Positions.size() != b.Positions.size() || a.Normals.size() != b.Normals.size() ||
+		a.UVs.size() != b.UVs.size() || a.Corners.size() != b.Corners.size() || a.MaterialRuns.size() != b.MaterialRuns.size())
+		return false;
+	for (size_t i = 0; i < a.MaterialRuns.size(); i++)
+	{
+		if (a.MaterialRuns[i].FirstTriangle != b.MaterialRuns[i].FirstTriangle || a.MaterialRuns[i].Material != b.MaterialRuns[i].Material)
+			return false;
+	}
+	return
+		(a.Positions.empty() || memcmp(&a.Positions[0], &b.Positions[0], a.Positions.size() * sizeof(XMFLOAT3)) == 0) &&
+		(a.Normals.empty() || memcmp(&a.Normals[0], &b.Normals[0], a.Normals.size() * sizeof(XMFLOAT3)) == 0) &&
+		(a.UVs.empty() || memcmp(&a.UVs[0], &b.UVs[0], a.UVs.size() * sizeof(XMFLOAT2)) == 0) &&
+		(a.Corners.empty() || memcmp(&a.Corners[0], &b.Corners[0], a.Corners.size() * sizeof(ObjCorner)) == 0);
+}
+
+// --------------------------------------------------------
+// Makes the text of an OBJ file that's a grid of quads, with
+// a vertex, normal and uv per grid point
+//
+// - Has comments, material changes, and every other row's
+//    faces use negative (relative) indices
+// - A 500 x 500 grid is about 40 MB
+// --------------------------------------------------------
+static std::string MakeGridObj(int gridSize)
+{
+	std::string text;
+	text.reserve((size_t)(gridSize + 1) * (gridSize + 1) * 170);
+	char line[128];
+	text += "# Made-up grid\nmtllib grid.mtl\n";
+	for (int y = 0; y <= gridSize; y++)
+	{
+		for (int x = 0; x <= gridSize; x++)
+		{
+			snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvn 0.000000 1.000000 0.000000\nvt %.6f %.6f\n",
+				x * 0.01f, sinf(x * 0.1f) * cosf(y * 0.1f), y * 0.01f, (float)x / gridSize, (float)y / gridSize);
+			text += line;
+		}
+	}
+	int vertexCount = (gridSize + 1) * (gridSize + 1);
+	for (int y = 0; y < gridSize; y++)
+	{
+		snprintf(line, sizeof(line), "# row %d\nusemtl row%d\n", y, y % 4);
+		text += line;
+		for (int x = 0; x < gridSize; x++)
+		{
+			int c[4] = { y * (gridSize + 1) + x + 1, y * (gridSize + 1) + x + 2, (y + 1) * (gridSize + 1) + x + 2, (y + 1) * (gridSize + 1) + x + 1 };
+			if (y % 2)
+			{
+				for (int k = 0; k < 4; k++)
+					c[k] -= vertexCount + 1;
+			}
+			snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", c[0], c[0], c[0], c[1], c[1], c[1], c[2], c[2], c[2], c[3], c[3], c[3]);
+			text += line;
+		}
+	}
+	return text;
+}
+
+// --------------------------------------------------------
+// Times parsing a large made-up OBJ file on more and more
+// threads
+//
+// - The file is MakeGridObj()'s, about 40 MB of text, so
+//    chunks have to get relative indices and material
+//    changes right too
+// - Every thread count has to give exactly what one thread
+//    does
+// --------------------------------------------------------
+void BenchmarkObjThreads()
+{
+	const int runs = 3;
+	std::string text = MakeGridObj(500);
+
+	unsigned int cores = std::thread::hardware_concurrency();
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads <= 16 && threads <= (std::max)(cores, 8u); threads *= 2)
+		threadCounts.push_back(threads);
+	if (cores > threadCounts.back())
+		threadCounts.push_back(cores);
+
+	printf("\nOBJ parsing on threads (%.1f MB made-up file, %u cores, best of %d):", text.size() / (1024.0 * 1024.0), cores, runs);
+	ObjData reference;
+	double oneThreadSeconds = 0;
+	for (size_t t = 0; t < threadCounts.size(); t++)
+	{
+		double best = 1e30;
+		ObjData obj;
+		for (int r = 0; r < runs; r++)
+		{
+			obj = ObjData();
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			ParseObjParallel(text.data(), text.size(), obj, threadCounts[t]);
+			double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			best = seconds < best ? seconds : best;
+		}
+
+		if (t == 0)
+		{
+			reference = obj;
+			oneThreadSeconds = best;
+		}
+		printf("\n  %u threads: %.3f ms (%.2fx), %s", threadCounts[t], best * 1000.0,
+			best > 0 ? oneThreadSeconds / best : 0.0, SameObj(obj, reference) ? "same as one thread" : "DIFFERENT FROM ONE THREAD");
+	}
+}
+
+// --------------------------------------------------------
+// Streams a made-up OBJ file much bigger than the memory
+// cap, and checks the import stayed under the cap and gave
+// the same triangles as parsing it all in memory
+//
+// - The file is MakeGridObj()'s, about 25 MB, written next
+//    to the models and removed afterwards
+// - The cap is small enough that the weld table fills up,
+//    so some vertices are written twice: the triangles are
+//    compared corner by corner rather than index by index
+// - Returns false if the file can't be written, or the
+//    import goes over the cap or changes the mesh
+// --------------------------------------------------------
+bool CheckObjStreaming(const char* modelDirectory)
+{
+	const size_t memoryCap = 4 * 1024 * 1024;
+	std::string filename = std::string(modelDirectory) + "/StreamingCheck.obj";
+	std::string text = MakeGridObj(400);
+
+	printf("\nOBJ streaming (%.1f MB made-up file, %u KB cap):", text.size() / (1024.0 * 1024.0), (unsigned int)(memoryCap / 1024));
+	{
+		std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+		out.write(text.data(), (std::streamsize)text.size());
+		if (!out.good())
+		{
+			printf("\n  Couldn't write %s", filename.c_str());
+			return false;
+		}
+	}
+
+	// The in-memory import, to compare against
+	ObjData obj;
+	ParseObj(text.data(), text.size(), obj);
+	std::vector<Vertex> refVerts;
+	std::vector<unsigned int> refIndices;
+	BuildIndexedMesh(obj, refVerts, refIndices);
+	text.clear();
+	text.shrink_to_fit();
+
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	std::vector<ObjMaterialRun> runs;
+	ObjVectorSink sink(verts, indices, &runs);
+	ObjStreamStats stats;
+	bool read = StreamObj(filename.c_str(), sink, memoryCap, &stats);
+	remove(filename.c_str());
+	if (!read)
+	{
+		printf("\n  Couldn't stream %s", filename.c_str());
+		return false;
+	}
+
+	bool underCap = stats.PeakBytes <= memoryCap;
+	bool counted =
+		stats.Triangles == obj.Corners.size() / 3 &&
+		stats.VerticesOut == verts.size() &&
+		stats.IndicesOut == indices.size() &&
+		runs.size() == obj.MaterialRuns.size();
+	bool matches = indices.size() == refIndices.size();
+	for (size_t i = 0; matches && i < indices.size(); i++)
+		matches = indices[i] < verts.size() && VertexEqual()(verts[indices[i]], refVerts[refIndices[i]]);
+
+	printf("\n  %u triangles, %u verts (%u in memory), %u weld resets, %u KB at most, %s",
+		(unsigned int)stats.Triangles, (unsigned int)verts.size(), (unsigned int)refVerts.size(),
+		(unsigned int)stats.WeldResets, (unsigned int)(stats.PeakBytes / 1024),
+		!underCap ? "FAILED (over the cap)" : !counted ? "FAILED (counts are off)" : !matches ? "FAILED (triangles changed)" : "ok");
+	return underCap && counted && matches;
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include "Vertex.h"
+#include <vector>
+#include <unordered_map>
+#include <string>
+#include <cstring>
+
+// Marks a face corner that has no uv or normal in the file
+const unsigned int OBJ_MISSING_INDEX = 0xFFFFFFFF;
+
+// Smallest stretch of text worth handing to its own thread when parsing in parallel
+const size_t OBJ_MIN_CHUNK_BYTES = 256 * 1024;
+
+// --------------------------------------------------------
+// The 0-based position/uv/normal indices of a single
+// triangle corner from an OBJ file
+// --------------------------------------------------------
+struct ObjCorner
+{
+	unsigned int Position;
+	unsigned int UV;
+	unsigned int Normal;
+};
+
+// --------------------------------------------------------
+// A "usemtl" line: every triangle from FirstTriangle up to
+// the next run's first uses the named material
+// --------------------------------------------------------
+struct ObjMaterialRun
+{
+	unsigned int FirstTriangle;
+	std::string Material;
+};
+
+// --------------------------------------------------------
+// The raw contents of an OBJ file
+//
+// - Attributes are exactly as they appear in the file
+// - Polygons have been split into triangles, three corners
+//    each, already in DirectX's (flipped) winding order
+// - Triangles before the first "usemtl" have no material
+// --------------------------------------------------------
+struct ObjData
+{
+	std::vector<DirectX::XMFLOAT3> Positions;
+	std::vector<DirectX::XMFLOAT3> Normals;
+	std::vector<DirectX::XMFLOAT2> UVs;
+	std::vector<ObjCorner> Corners;
+	std::vector<ObjMaterialRun> MaterialRuns;		// In file order
+	std::vector<std::string> MaterialLibraries;	// The "mtllib" files, as written
+};
+
+// --------------------------------------------------------
+// One material from a .mtl file (just the parts we use)
+// --------------------------------------------------------
+struct ObjMaterial
+{
+	std::string Name;
+	DirectX::XMFLOAT3 DiffuseColor;	// "Kd"
+	std::string DiffuseTexture;		// "map_Kd", relative to the .mtl file ("" if there isn't one)
+};
+
+// The streaming importer's defaults: 64 MB of working memory in total,
+// and files bigger than 256 MB are streamed rather than parsed in memory
+const size_t OBJ_STREAM_DEFAULT_MEMORY_CAP = 64 * 1024 * 1024;
+const size_t OBJ_STREAM_THRESHOLD_BYTES = 256 * 1024 * 1024;
+
+// Rough cost of one entry in the streaming importer's weld table
+// (the vertex, its index, and the hash node around them)
+const size_t OBJ_STREAM_WELD_ENTRY_BYTES = 64;
+
+// --------------------------------------------------------
+// Receives the streaming importer's output a batch at a time
+//
+// - Vertices are always written before any indices that use
+//    them, and indices count from the very first vertex
+// - AddMaterialLibrary() is called for each "mtllib" before
+//    anything else is written
+// - BeginMaterial() is called whenever the material changes,
+//    after every index written with the one before
+// --------------------------------------------------------
+class ObjStreamSink
+{
+public:
+	virtual ~ObjStreamSink() {}
+	virtual void WriteVertices(const Vertex* verts, size_t count) = 0;
+	virtual void WriteIndices(const unsigned int* indices, size_t count) = 0;
+	virtual void AddMaterialLibrary(const char* name) {}
+	virtual void BeginMaterial(const char* name) {}
+};
+
+// --------------------------------------------------------
+// A sink that just collects everything into arrays
+// (and, if given somewhere to put them, the material runs
+// and libraries)
+// --------------------------------------------------------
+class ObjVectorSink : public ObjStreamSink
+{
+public:
+	ObjVectorSink(std::vector<Vertex>& verts, std::vector<unsigned int>& indices, std::vector<ObjMaterialRun>* materialRuns = 0, std::vector<std::string>* materialLibraries = 0)
+		: verts(verts), indices(indices), materialRuns(materialRuns), materialLibraries(materialLibraries) {}
+	void WriteVertices(const Vertex* v, size_t count) { verts.insert(verts.end(), v, v + count); }
+	void WriteIndices(const unsigned int* i, size_t count) { indices.insert(indices.end(), i, i + count); }
+	void AddMaterialLibrary(const char* name) { if (materialLibraries) materialLibraries->push_back(name); }
+	void BeginMaterial(const char* name)
+	{
+		if (!materialRuns) return;
+		ObjMaterialRun run = { (unsigned int)(indices.size() / 3), name };
+		materialRuns->push_back(run);
+	}
+
+private:
+	std::vector<Vertex>& verts;
+	std::vector<unsigned int>& indices;
+	std::vector<ObjMaterialRun>* materialRuns;
+	std::vector<std::string>* materialLibraries;
+};
+
+// --------------------------------------------------------
+// How a streaming import went
+// --------------------------------------------------------
+struct ObjStreamStats
+{
+	size_t Positions;
+	size_t Normals;
+	size_t UVs;
+	size_t Triangles;
+	size_t VerticesOut;
+	size_t IndicesOut;
+	size_t LinesTooLong;	// Lines longer than the read window, which were skipped
+	size_t WeldResets;		// Times the weld table filled up and was emptied
+	size_t PeakBytes;		// Most working memory the importer had allocated at once
+};
+
+// --------------------------------------------------------
+// Hashes and compares vertices by value, so identical
+// (position, uv, normal) combinations can share one vertex
+// --------------------------------------------------------
+struct VertexHash
+{
+	size_t operator()(const Vertex& v) const
+	{
+		const float* f = &v.Position.x;
+		size_t hash = 2166136261u;
+		for (unsigned int i = 0; i < sizeof(Vertex) / sizeof(float); i++)
+		{
+			// Adding zero turns -0.0f into 0.0f so both hash the same
+			float value = f[i] + 0.0f;
+			unsigned int bits;
+			memcpy(&bits, &value, sizeof(bits));
+			hash = (hash ^ bits) * 16777619u; // FNV-1a style mixing
+		}
+		return hash;
+	}
+};
+
+struct VertexEqual
+{
+	bool operator()(const Vertex& a, const Vertex& b) const
+	{
+		return
+			a.Position.x == b.Position.x && a.Position.y == b.Position.y && a.Position.z == b.Position.z &&
+			a.Normal.x == b.Normal.x && a.Normal.y == b.Normal.y && a.Normal.z == b.Normal.z &&
+			a.UV.x == b.UV.x && a.UV.y == b.UV.y;
+	}
+};
+
+// Maps the file into memory and parses it.  Returns false if the file can't be opened.
+// A threadCount of 0 uses one thread per CPU core (small files always use just one).
+bool LoadObj(const char* filename, ObjData& obj, unsigned int threadCount = 0);
+
+// Parses OBJ text that is already in memory, appending to the given data
+void ParseObj(const char* text, size_t length, ObjData& obj);
+
+// Same as ParseObj(), but splits the text into chunks parsed on several threads
+void ParseObjParallel(const char* text, size_t length, ObjData& obj, unsigned int threadCount);
+
+// Converts the parsed file into a welded, left-handed vertex array and index list
+// (and, if "materialRuns" isn't null, fills it with the file's material runs, counted in the output's triangles)
+void BuildIndexedMesh(const ObjData& obj, std::vector<Vertex>& verts, std::vector<unsigned int>& indices, std::vector<ObjMaterialRun>* materialRuns = 0);
+
+// Sorts triangles so each material's are contiguous (in order of first use), filling "materials"
+// with each material's name and "rangeStarts" with where its indices start
+void GroupTrianglesByMaterial(std::vector<unsigned int>& indices, const std::vector<ObjMaterialRun>& materialRuns, std::vector<std::string>& materials, std::vector<unsigned int>& rangeStarts);
+
+// Parses a .mtl material library.  Returns false if the file can't be opened.
+bool LoadMtl(const char* filename, std::vector<ObjMaterial>& materials);
+
+// Imports an OBJ file while only ever holding a fixed amount of it in memory,
+// writing the welded vertices and indices to the sink as it goes.  Returns false if the file can't be read.
+bool StreamObj(const char* filename, ObjStreamSink& sink, size_t memoryCap = OBJ_STREAM_DEFAULT_MEMORY_CAP, ObjStreamStats* stats = 0);
+
+// Checks that welding each model in "modelDirectory" keeps every triangle the same and leaves no duplicate
+// vertices, printing each one's vertex counts and sizes before and after.  Returns false if any fail.
+bool CheckObjWelding(const char* modelDirectory);
+
+// Times parsing some of the models in "modelDirectory" with the tokenizer, against the getline and sscanf
+// loop it replaced, checking both give the same results, and prints the results
+void BenchmarkObjParsing(const char* modelDirectory);
+
+// Times parsing a large made-up OBJ file on 1, 2, 4 and 8 threads (and one per core), checking
+// each gives exactly what one thread does, and prints the results
+void BenchmarkObjThreads();
+
+// Streams a made-up OBJ file bigger than a small memory cap (written to "modelDirectory" and removed again),
+// checking it stays under the cap and gives the same triangles as loading it all at once.  Returns false if not.
+bool CheckObjStreaming(const char* modelDirectory);
@@ -0,0 +1,438 @@
+#include "ProgressiveMesh.h"
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "ObjLoader.h"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <string>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Sets up a mesh's index buffer at a known level
+//
+// data        - The mesh's splits, from BuildProgressiveMesh()
+// indices     - The whole index buffer, as it is at "level"
+//                (entries past that level's triangles are never
+//                read, so they can be left unfilled)
+// level       - How many splits "indices" already has applied
+//                (UINT_MAX for all of them)
+// --------------------------------------------------------
+ProgressiveMesh::ProgressiveMesh(const ProgressiveMeshData& data, const unsigned int* indices, unsigned int numIndices, unsigned int level)
+	: data(data), indices(indices, indices + numIndices)
+{
+	this->level = std::min(level, (unsigned int)data.Splits.size());
+	ClearDirtyRange();
+}
+
+ProgressiveMesh::ProgressiveMesh(const ProgressiveMeshData& data, const unsigned short* indices, unsigned int numIndices, unsigned int level)
+	: data(data), indices(indices, indices + numIndices)
+{
+	this->level = std::min(level, (unsigned int)data.Splits.size());
+	ClearDirtyRange();
+}
+
+// --------------------------------------------------------
+// Moves to a level, one split at a time
+//
+// - Refining writes each split's fine values, which includes
+//    every corner of the triangles it adds
+// - Coarsening writes the coarse values, except in the
+//    triangles that stop being drawn (they'll be rewritten in
+//    full if they're ever added back)
+//
+// level - How many splits to have applied
+// --------------------------------------------------------
+void ProgressiveMesh::SetLevel(unsigned int level)
+{
+	level = std::min(level, GetSplitCount());
+
+	while (this->level < level)
+	{
+		const VertexSplit& split = data.Splits[this->level];
+		for (unsigned int c = split.FirstChange; c < split.FirstChange + split.ChangeCount; c++)
+		{
+			const IndexChange& change = data.Changes[c];
+			indices[change.Position] = change.Fine;
+			dirtyStart = std::min(dirtyStart, change.Position);
+			dirtyEnd = std::max(dirtyEnd, change.Position + 1);
+		}
+		this->level++;
+	}
+
+	while (this->level > level)
+	{
+		this->level--;
+		const VertexSplit& split = data.Splits[this->level];
+		unsigned int drawn = GetIndexCount();
+		for (unsigned int c = split.FirstChange; c < split.FirstChange + split.ChangeCount; c++)
+		{
+			const IndexChange& change = data.Changes[c];
+			if (change.Position >= drawn)
+				continue;
+			indices[change.Position] = change.Coarse;
+			dirtyStart = std::min(dirtyStart, change.Position);
+			dirtyEnd = std::max(dirtyEnd, change.Position + 1);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Picks the finest level that fits a triangle budget
+//
+// - Levels only ever add triangles, so this is a binary
+//    search of the splits' triangle counts
+// --------------------------------------------------------
+void ProgressiveMesh::SetTargetTriangleCount(unsigned int triangles)
+{
+	unsigned int fits = (unsigned int)(std::upper_bound(data.Splits.begin(), data.Splits.end(), triangles,
+		[](unsigned int count, const VertexSplit& split) { return count < split.TriangleCount; }) - data.Splits.begin());
+	SetLevel(fits);
+}
+
+unsigned int ProgressiveMesh::GetTriangleCount()
+{
+	return level == 0 ? data.BaseTriangleCount : data.Splits[level - 1].TriangleCount;
+}
+
+unsigned int ProgressiveMesh::GetVertexCount()
+{
+	return level == 0 ? data.BaseVertexCount : data.Splits[level - 1].VertexCount;
+}
+
+float ProgressiveMesh::GetError()
+{
+	return level == 0 ? data.BaseError : data.Splits[level - 1].Error;
+}
+
+bool ProgressiveMesh::GetDirtyRange(unsigned int& first, unsigned int& count)
+{
+	unsigned int end = std::min(dirtyEnd, GetIndexCount());
+	if (dirtyStart >= end)
+		return false;
+
+	first = dirtyStart;
+	count = end - dirtyStart;
+	return true;
+}
+
+void ProgressiveMesh::ClearDirtyRange()
+{
+	dirtyStart = UINT_MAX;
+	dirtyEnd = 0;
+}
+
+// --------------------------------------------------------
+// Turns a mesh into a base mesh plus vertex splits
+//
+// - The simplifier collapses the mesh as far as it will go
+//    (down to about LOD_MIN_TRIANGLES), recording every vertex
+//    each collapse moves
+// - Those collapses are replayed one at a time, noting each
+//    index they change and which collapse removes each
+//    triangle; splits are the collapses in reverse
+// - Triangles are then sorted so the base mesh comes first,
+//    followed by the ones each split adds, in split order, and
+//    the vertices are sorted by the first level that uses them
+//    (each group keeps its old order, so most of the vertex
+//    cache ordering survives inside a split's triangles)
+//
+// verts   - The mesh's vertices, reordered coarse-first
+// indices - The mesh's indices, reordered so every level is
+//            a prefix of them (left fully refined)
+// data    - Filled with the base mesh's size and every split
+// --------------------------------------------------------
+void BuildProgressiveMesh(std::vector<Vertex>& verts, std::vector<unsigned int>& indices, ProgressiveMeshData& data)
+{
+	data.BaseTriangleCount = (unsigned int)(indices.size() / 3);
+	data.BaseVertexCount = (unsigned int)verts.size();
+	data.BaseError = 0;
+	data.Splits.clear();
+	data.Changes.clear();
+	if (indices.size() < 3 || verts.empty())
+		return;
+
+	unsigned int numVerts = (unsigned int)verts.size();
+	unsigned int numTris = (unsigned int)(indices.size() / 3);
+
+	// Collapse as far as possible, stopping short of collapsing closed
+	// meshes away to nothing
+	std::vector<unsigned int> simplified;
+	std::vector<VertexMove> moves;
+	SimplifyMesh(&verts[0], numVerts, &indices[0], indices.size(), LOD_MIN_TRIANGLES * 3, simplified, &moves);
+	unsigned int collapseCount = moves.empty() ? 0 : moves.back().Collapse + 1;
+
+	// Which corners use each vertex, for finding the ones a move changes
+	// (corners of removed triangles are left in and skipped)
+	std::vector<std::vector<unsigned int>> vertexCorners(numVerts);
+	for (unsigned int c = 0; c < indices.size(); c++)
+		vertexCorners[indices[c]].push_back(c);
+
+	struct CornerChange
+	{
+		unsigned int Collapse;
+		unsigned int Corner;
+		unsigned int Fine;
+		unsigned int Coarse;
+	};
+
+	// Replay the collapses one by one
+	std::vector<unsigned int> corners(indices);
+	std::vector<unsigned int> removedBy(numTris, UINT_MAX);
+	std::vector<unsigned int> changedBy(indices.size(), UINT_MAX);
+	std::vector<float> collapseErrors(collapseCount, 0.0f);
+	std::vector<CornerChange> changes;
+	std::vector<unsigned int> movedTris;
+	for (size_t m = 0; m < moves.size(); )
+	{
+		unsigned int collapse = moves[m].Collapse;
+		collapseErrors[collapse] = moves[m].Error;
+
+		// Move every corner on the collapsing vertices
+		movedTris.clear();
+		for (; m < moves.size() && moves[m].Collapse == collapse; m++)
+		{
+			const VertexMove& move = moves[m];
+			std::vector<unsigned int>& from = vertexCorners[move.From];
+			for (size_t i = 0; i < from.size(); i++)
+			{
+				unsigned int c = from[i];
+				if (removedBy[c / 3] != UINT_MAX)
+					continue;
+
+				CornerChange change = { collapse, c, move.From, move.To };
+				changes.push_back(change);
+				changedBy[c] = collapse;
+				corners[c] = move.To;
+				vertexCorners[move.To].push_back(c);
+				movedTris.push_back(c / 3);
+			}
+			std::vector<unsigned int>().swap(from);
+		}
+
+		// Triangles with two corners at the same position are gone
+		for (size_t i = 0; i < movedTris.size(); i++)
+		{
+			unsigned int t = movedTris[i];
+			if (removedBy[t] != UINT_MAX)
+				continue;
+
+			const XMFLOAT3& p0 = verts[corners[t * 3]].Position;
+			const XMFLOAT3& p1 = verts[corners[t * 3 + 1]].Position;
+			const XMFLOAT3& p2 = verts[corners[t * 3 + 2]].Position;
+			bool same01 = p0.x == p1.x && p0.y == p1.y && p0.z == p1.z;
+			bool same12 = p1.x == p2.x && p1.y == p2.y && p1.z == p2.z;
+			bool same02 = p0.x == p2.x && p0.y == p2.y && p0.z == p2.z;
+			if (!same01 && !same12 && !same02)
+				continue;
+			removedBy[t] = collapse;
+
+			// The split that adds it back writes all three corners, so
+			// the ones that didn't move need recording too
+			for (unsigned int c = t * 3; c < t * 3 + 3; c++)
+			{
+				if (changedBy[c] == collapse)
+					continue;
+				CornerChange change = { collapse, c, corners[c], corners[c] };
+				changes.push_back(change);
+			}
+		}
+	}
+
+	// Split s undoes the collapse made s'th from last
+	// - Base triangles go first, then the ones each split adds back
+	std::vector<unsigned int> triSplit(numTris);
+	for (unsigned int t = 0; t < numTris; t++)
+		triSplit[t] = removedBy[t] == UINT_MAX ? 0 : collapseCount - removedBy[t];
+
+	std::vector<unsigned int> triOrder(numTris);
+	for (unsigned int t = 0; t < numTris; t++)
+		triOrder[t] = t;
+	std::stable_sort(triOrder.begin(), triOrder.end(), [&triSplit](unsigned int a, unsigned int b) { return triSplit[a] < triSplit[b]; });
+
+	std::vector<unsigned int> triPosition(numTris);
+	for (unsigned int i = 0; i < numTris; i++)
+		triPosition[triOrder[i]] = i;
+
+	// Each split's changes, in split order
+	std::stable_sort(changes.begin(), changes.end(), [](const CornerChange& a, const CornerChange& b) { return a.Collapse > b.Collapse; });
+
+	// Find the first level that uses each vertex: the base mesh's
+	// are in the final corners, the rest come from the fine values
+	const unsigned int unused = UINT_MAX;
+	std::vector<unsigned int> vertexLevel(numVerts, unused);
+	for (unsigned int t = 0; t < numTris; t++)
+	{
+		if (removedBy[t] != UINT_MAX)
+			continue;
+		for (unsigned int c = t * 3; c < t * 3 + 3; c++)
+			vertexLevel[corners[c]] = 0;
+	}
+	for (size_t i = 0; i < changes.size(); i++)
+	{
+		unsigned int split = collapseCount - changes[i].Collapse;
+		vertexLevel[changes[i].Fine] = std::min(vertexLevel[changes[i].Fine], split);
+	}
+
+	std::vector<unsigned int> vertexOrder(numVerts);
+	for (unsigned int v = 0; v < numVerts; v++)
+		vertexOrder[v] = v;
+	std::stable_sort(vertexOrder.begin(), vertexOrder.end(), [&vertexLevel](unsigned int a, unsigned int b) { return vertexLevel[a] < vertexLevel[b]; });
+
+	std::vector<unsigned int> remap(numVerts);
+	std::vector<Vertex> sortedVerts(numVerts);
+	for (unsigned int i = 0; i < numVerts; i++)
+	{
+		remap[vertexOrder[i]] = i;
+		sortedVerts[i] = verts[vertexOrder[i]];
+	}
+	verts.swap(sortedVerts);
+
+	// The fully refined indices, in their new places
+	std::vector<unsigned int> sortedIndices(indices.size());
+	for (unsigned int t = 0; t < numTris; t++)
+	{
+		for (unsigned int k = 0; k < 3; k++)
+			sortedIndices[triPosition[t] * 3 + k] = remap[indices[t * 3 + k]];
+	}
+	indices.swap(sortedIndices);
+
+	// Count up the triangles and vertices each level adds
+	std::vector<unsigned int> levelTriangles(collapseCount + 1, 0);
+	for (unsigned int t = 0; t < numTris; t++)
+		levelTriangles[triSplit[t]]++;
+
+	std::vector<unsigned int> levelVertices(collapseCount + 1, 0);
+	for (unsigned int v = 0; v < numVerts; v++)
+	{
+		if (vertexLevel[v] != unused)
+			levelVertices[vertexLevel[v]]++;
+	}
+
+	// The error of each level is the worst collapse it still has
+	std::vector<float> levelErrors(collapseCount + 1, 0.0f);
+	for (unsigned int j = 0; j < collapseCount; j++)
+		levelErrors[collapseCount - j - 1] = std::max(collapseErrors[j], j > 0 ? levelErrors[collapseCount - j] : 0.0f);
+
+	// Finally, the splits themselves
+	data.BaseTriangleCount = levelTriangles[0];
+	data.BaseVertexCount = levelVertices[0];
+	data.BaseError = levelErrors[0];
+
+	data.Changes.resize(changes.size());
+	for (size_t i = 0; i < changes.size(); i++)
+	{
+		const CornerChange& change = changes[i];
+		IndexChange& out = data.Changes[i];
+		out.Position = triPosition[change.Corner / 3] * 3 + change.Corner % 3;
+		out.Fine = remap[change.Fine];
+		out.Coarse = remap[change.Coarse];
+	}
+
+	unsigned int triangleCount = data.BaseTriangleCount;
+	unsigned int vertexCount = data.BaseVertexCount;
+	size_t c = 0;
+	for (unsigned int s = 1; s <= collapseCount; s++)
+	{
+		VertexSplit split = {};
+		split.FirstChange = (unsigned int)c;
+		while (c < changes.size() && collapseCount - changes[c].Collapse == s)
+			c++;
+		split.ChangeCount = (unsigned int)c - split.FirstChange;
+
+		triangleCount += levelTriangles[s];
+		vertexCount += levelVertices[s];
+		split.TriangleCount = triangleCount;
+		split.VertexCount = vertexCount;
+		split.Error = levelErrors[s];
+		data.Splits.push_back(split);
+	}
+}
+
+// --------------------------------------------------------
+// Checks that a progressive mesh refines back to exactly the
+// mesh it was built from
+//
+// - Starts from just the base mesh's indices, with everything
+//    after them filled with garbage (as if only the start of
+//    the file had been streamed in), so any index a split
+//    forgets to write shows up
+// - Every level is checked to only use its own vertices
+//
+// data        - The mesh's splits
+// fineIndices - Its fully refined indices
+// numVerts    - How many vertices it has
+// --------------------------------------------------------
+bool CheckProgressiveMesh(const ProgressiveMeshData& data, const unsigned int* fineIndices, unsigned int numIndices, unsigned int numVerts)
+{
+	// Get the base mesh's indices by coarsening all the way down
+	ProgressiveMesh full(data, fineIndices, numIndices);
+	full.SetLevel(0);
+
+	std::vector<unsigned int> streamed(numIndices, UINT_MAX);
+	std::copy(full.GetIndices(), full.GetIndices() + full.GetIndexCount(), streamed.begin());
+	ProgressiveMesh mesh(data, &streamed[0], numIndices, 0);
+
+	for (unsigned int level = 0; level <= mesh.GetSplitCount(); level++)
+	{
+		mesh.SetLevel(level);
+		if (mesh.GetIndexCount() > numIndices || mesh.GetVertexCount() > numVerts)
+			return false;
+
+		const unsigned int* indices = mesh.GetIndices();
+		for (unsigned int i = 0; i < mesh.GetIndexCount(); i++)
+		{
+			if (indices[i] >= mesh.GetVertexCount())
+				return false;
+		}
+	}
+
+	return mesh.GetIndexCount() == numIndices && std::equal(fineIndices, fineIndices + numIndices, mesh.GetIndices());
+}
+
+// --------------------------------------------------------
+// Builds a progressive mesh from each of the sample models
+// and checks it refines back to what it was built from
+//
+// - The models are welded and optimized first, the same as
+//    a first load of a progressive Mesh
+// --------------------------------------------------------
+bool CheckProgressiveMeshes(const char* modelDirectory)
+{
+	static const char* models[] = { "cube.obj", "sphere.obj", "cylinder.obj", "cone.obj", "torus.obj", "helix.obj" };
+	bool passed = true;
+
+	printf("\nProgressive meshes (coarsened and refined back):");
+	for (int m = 0; m < 6; m++)
+	{
+		std::string filename = std::string(modelDirectory) + "/" + models[m];
+		ObjData obj;
+		if (!LoadObj(filename.c_str(), obj, 1))
+		{
+			printf("\n  %s: couldn't be read", models[m]);
+			passed = false;
+			continue;
+		}
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+		BuildIndexedMesh(obj, verts, indices);
+		OptimizeMesh(verts, indices);
+		if (verts.empty() || indices.empty())
+		{
+			printf("\n  %s: no triangles", models[m]);
+			passed = false;
+			continue;
+		}
+
+		ProgressiveMeshData data;
+		BuildProgressiveMesh(verts, indices, data);
+		bool ok = CheckProgressiveMesh(data, &indices[0], (unsigned int)indices.size(), (unsigned int)verts.size());
+		printf("\n  %s: %u triangles at the base, %u splits up to %u triangles, %s",
+			models[m], data.BaseTriangleCount, (unsigned int)data.Splits.size(), (unsigned int)indices.size() / 3,
+			ok ? "ok" : "FAILED (didn't refine back to the same triangles)");
+		passed = passed && ok;
+	}
+
+	return passed;
+}
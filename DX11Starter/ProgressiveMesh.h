@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Vertex.h"
+#include <vector>
+#include <climits>
+
+// --------------------------------------------------------
+// One vertex split: the reverse of one of the simplifier's
+// edge collapses, adding its triangles back
+//
+// - Applying splits 0..n-1 to the base mesh gives level n,
+//    and each level's triangles are the first TriangleCount
+//    of the index buffer, so drawing a level is just drawing
+//    fewer indices
+// - Vertices are stored coarse-first too, so a level only
+//    ever uses the first VertexCount of them (which lets the
+//    vertices, indices and splits all be streamed in from
+//    the front of the file)
+// --------------------------------------------------------
+struct VertexSplit
+{
+	unsigned int FirstChange;	// Where this split's entries in the change list start
+	unsigned int ChangeCount;	// How many there are
+	unsigned int TriangleCount;	// Triangles in the mesh once this split is applied
+	unsigned int VertexCount;	// Vertices it uses once this split is applied
+	float Error;				// How far (in model units) it strays from the original surface then
+};
+
+// --------------------------------------------------------
+// One index buffer entry that a split changes
+//
+// - Splitting writes the Fine value, and collapsing back
+//    writes the Coarse one
+// - Every corner of the triangles a split adds is listed,
+//    since those indices may hold anything until then
+// --------------------------------------------------------
+struct IndexChange
+{
+	unsigned int Position;	// Which entry of the index buffer
+	unsigned int Fine;		// Its value after the split
+	unsigned int Coarse;	// Its value before
+};
+
+// --------------------------------------------------------
+// Everything needed to move a mesh between levels, besides
+// the index buffer itself
+// --------------------------------------------------------
+struct ProgressiveMeshData
+{
+	unsigned int BaseTriangleCount;	// Triangles before any splits
+	unsigned int BaseVertexCount;	// Vertices those use
+	float BaseError;				// How far the base mesh strays from the original surface
+	std::vector<VertexSplit> Splits;
+	std::vector<IndexChange> Changes;
+};
+
+// --------------------------------------------------------
+// A mesh's index buffer at some level between its base
+// mesh and the original
+//
+// - Usually starts out fully refined (every split applied)
+// - Moving between levels applies or undoes splits one by
+//    one, so only the indices they touch change; the range of
+//    those that's inside the drawn triangles is kept so just
+//    that part needs uploading
+// --------------------------------------------------------
+class ProgressiveMesh
+{
+public:
+	// "indices" are BuildProgressiveMesh()'s fully refined indices, or (for a mesh being streamed in)
+	// the indices of some coarser level
+	ProgressiveMesh(const ProgressiveMeshData& data, const unsigned int* indices, unsigned int numIndices, unsigned int level = UINT_MAX);
+
+	// The same, for indices stored in 16 bits (they're widened as they're copied in)
+	ProgressiveMesh(const ProgressiveMeshData& data, const unsigned short* indices, unsigned int numIndices, unsigned int level = UINT_MAX);
+
+	// Applies or undoes splits until "level" of them are applied
+	void SetLevel(unsigned int level);
+
+	// Moves to the finest level with at most this many triangles (never coarser than the base mesh)
+	void SetTargetTriangleCount(unsigned int triangles);
+
+	// The current level, and how many there are past the base mesh
+	unsigned int GetLevel() { return level; }
+	unsigned int GetSplitCount() { return (unsigned int)data.Splits.size(); }
+
+	// What's drawn at the current level
+	unsigned int GetTriangleCount();
+	unsigned int GetIndexCount() { return GetTriangleCount() * 3; }
+	unsigned int GetVertexCount();
+	float GetError();
+
+	// The whole index buffer (only the first GetIndexCount() are meaningful)
+	const unsigned int* GetIndices() { return &indices[0]; }
+
+	// The range of indices changed since the last ClearDirtyRange()
+	// Returns false if nothing drawn has changed
+	bool GetDirtyRange(unsigned int& first, unsigned int& count);
+	void ClearDirtyRange();
+
+private:
+	ProgressiveMeshData data;
+	std::vector<unsigned int> indices;
+	unsigned int level;
+
+	// Changed indices, as a half-open range (empty when dirtyStart >= dirtyEnd)
+	unsigned int dirtyStart;
+	unsigned int dirtyEnd;
+};
+
+// Collapses a mesh all the way down and records the collapses as splits,
+// reordering its verts and indices coarse-first (the indices end up fully refined)
+void BuildProgressiveMesh(std::vector<Vertex>& verts, std::vector<unsigned int>& indices, ProgressiveMeshData& data);
+
+// Coarsens to the base mesh and refines back one split at a time, checking every level
+// Returns true if the fully refined result matches "fineIndices" exactly
+bool CheckProgressiveMesh(const ProgressiveMeshData& data, const unsigned int* fineIndices, unsigned int numIndices, unsigned int numVerts);
+
+// Builds and checks a progressive mesh from each sample model in "modelDirectory"
+// Returns false if any can't be read or don't refine back to what they were built from
+bool CheckProgressiveMeshes(const char* modelDirectory);
@@ -0,0 +1,273 @@
+#include "RangeAllocator.h"
+#include <algorithm>
+#include <iterator>
+#include <cstdio>
+
+RangeAllocator::RangeAllocator(unsigned int capacity)
+{
+	this->capacity = capacity;
+	used = 0;
+	if (capacity > 0)
+		freeBlocks[0] = capacity;
+}
+
+// --------------------------------------------------------
+// Finds room for a new range
+//
+// size - How many units it needs
+//
+// Returns a handle to the range, or RANGE_ALLOCATOR_INVALID
+// if no single free block is big enough
+// --------------------------------------------------------
+unsigned int RangeAllocator::Allocate(unsigned int size)
+{
+	if (size == 0)
+		return RANGE_ALLOCATOR_INVALID;
+
+	// Find the smallest block that fits
+	auto best = freeBlocks.end();
+	for (auto block = freeBlocks.begin(); block != freeBlocks.end(); ++block)
+	{
+		if (block->second >= size && (best == freeBlocks.end() || block->second < best->second))
+		{
+			best = block;
+			if (best->second == size)
+				break;
+		}
+	}
+	if (best == freeBlocks.end())
+		return RANGE_ALLOCATOR_INVALID;
+
+	// Take the front of it, leaving the rest free
+	unsigned int offset = best->first;
+	unsigned int remaining = best->second - size;
+	freeBlocks.erase(best);
+	if (remaining > 0)
+		freeBlocks[offset + size] = remaining;
+
+	// Record it under a new (or reused) handle
+	Allocation allocation = { offset, size, true };
+	unsigned int handle;
+	if (!freeHandles.empty())
+	{
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+		allocations[handle] = allocation;
+	}
+	else
+	{
+		handle = (unsigned int)allocations.size();
+		allocations.push_back(allocation);
+	}
+
+	used += size;
+	return handle;
+}
+
+void RangeAllocator::Free(unsigned int handle)
+{
+	if (handle >= allocations.size() || !allocations[handle].Live)
+		return;
+
+	Allocation& allocation = allocations[handle];
+	AddFreeBlock(allocation.Offset, allocation.Size);
+	used -= allocation.Size;
+	allocation.Live = false;
+	freeHandles.push_back(handle);
+}
+
+void RangeAllocator::Grow(unsigned int newCapacity)
+{
+	if (newCapacity <= capacity)
+		return;
+
+	AddFreeBlock(capacity, newCapacity - capacity);
+	capacity = newCapacity;
+}
+
+// --------------------------------------------------------
+// Packs every allocation together at the start of the space
+//
+// - Allocations keep their order, so each one only ever moves
+//    toward the start, and doing the moves in the order given
+//    never overwrites something that hasn't moved yet
+//
+// moves - Filled with every allocation that changed offset
+// --------------------------------------------------------
+void RangeAllocator::Defragment(std::vector<RangeMove>& moves)
+{
+	moves.clear();
+
+	// Sort the live allocations by where they are now
+	std::vector<unsigned int> live;
+	for (unsigned int i = 0; i < allocations.size(); i++)
+	{
+		if (allocations[i].Live)
+			live.push_back(i);
+	}
+	std::sort(live.begin(), live.end(), [this](unsigned int a, unsigned int b) { return allocations[a].Offset < allocations[b].Offset; });
+
+	// Slide each one down against the one before it
+	unsigned int next = 0;
+	for (size_t i = 0; i < live.size(); i++)
+	{
+		Allocation& allocation = allocations[live[i]];
+		if (allocation.Offset != next)
+		{
+			RangeMove move = { live[i], allocation.Offset, next, allocation.Size };
+			moves.push_back(move);
+			allocation.Offset = next;
+		}
+		next += allocation.Size;
+	}
+
+	// Everything after that is one big free block
+	freeBlocks.clear();
+	if (next < capacity)
+		freeBlocks[next] = capacity - next;
+}
+
+unsigned int RangeAllocator::GetLargestFreeBlock()
+{
+	unsigned int largest = 0;
+	for (auto& block : freeBlocks)
+		largest = std::max(largest, block.second);
+	return largest;
+}
+
+bool RangeAllocator::IsCompact()
+{
+	if (freeBlocks.empty())
+		return true;
+	return freeBlocks.size() == 1 && freeBlocks.begin()->first + freeBlocks.begin()->second == capacity;
+}
+
+void RangeAllocator::AddFreeBlock(unsigned int offset, unsigned int size)
+{
+	// Merge with the block after it?
+	auto after = freeBlocks.lower_bound(offset);
+	if (after != freeBlocks.end() && after->first == offset + size)
+	{
+		size += after->second;
+		after = freeBlocks.erase(after);
+	}
+
+	// Merge with the block before it?
+	if (after != freeBlocks.begin())
+	{
+		auto before = std::prev(after);
+		if (before->first + before->second == offset)
+		{
+			before->second += size;
+			return;
+		}
+	}
+
+	freeBlocks[offset] = size;
+}
+
+// --------------------------------------------------------
+// Runs a small allocator through each of its jobs, checking
+// where everything ends up
+//
+// - Best fit: a request goes in the smallest gap it fits,
+//    not the first one
+// - Freeing ranges next to each other (in either order)
+//    leaves one free block, not several
+// - A request that doesn't fit anywhere fails cleanly, and
+//    fits once the space has grown
+// - Defragment()'s moves only ever go toward the start, and
+//    leave everything packed in the same order
+// --------------------------------------------------------
+bool CheckRangeAllocator()
+{
+	bool passed = true;
+	printf("\nRange allocator:");
+
+	// Leave gaps of 30, 10 and 20 between allocations
+	RangeAllocator allocator(100);
+	unsigned int a = allocator.Allocate(10);	// 0-10
+	unsigned int gap30 = allocator.Allocate(30);	// 10-40
+	unsigned int b = allocator.Allocate(10);	// 40-50
+	unsigned int gap10 = allocator.Allocate(10);	// 50-60
+	unsigned int c = allocator.Allocate(10);	// 60-70
+	unsigned int gap20 = allocator.Allocate(20);	// 70-90
+	unsigned int d = allocator.Allocate(10);	// 90-100
+	allocator.Free(gap30);
+	allocator.Free(gap10);
+	allocator.Free(gap20);
+
+	unsigned int fits10 = allocator.Allocate(10);
+	unsigned int fits15 = allocator.Allocate(15);
+	bool bestFit = allocator.GetOffset(fits10) == 50 && allocator.GetOffset(fits15) == 70;
+	printf("\n  Best fit: %s", bestFit ? "ok" : "FAILED (picked the wrong gap)");
+	passed = passed && bestFit;
+
+	// Give those back, then free "b" and "c", which should each join up with the free blocks either side
+	allocator.Free(fits10);
+	allocator.Free(fits15);
+	bool merged = allocator.GetFreeBlockCount() == 3;
+	allocator.Free(b);
+	merged = merged && allocator.GetFreeBlockCount() == 2 && allocator.GetLargestFreeBlock() == 50;
+	allocator.Free(c);
+	merged = merged && allocator.GetFreeBlockCount() == 1 && allocator.GetLargestFreeBlock() == 80 && allocator.GetUsed() == 20;
+	printf("\n  Merging on free: %s", merged ? "ok" : "FAILED (neighbouring free blocks weren't joined)");
+	passed = passed && merged;
+
+	// Only 90 units are free once "d" is gone too
+	allocator.Free(d);
+	unsigned int tooBig = allocator.Allocate(95);
+	bool growing = tooBig == RANGE_ALLOCATOR_INVALID && allocator.GetUsed() == 10;
+	allocator.Grow(120);
+	unsigned int grown = allocator.Allocate(95);
+	growing = growing &&
+		grown != RANGE_ALLOCATOR_INVALID &&
+		allocator.GetOffset(grown) == 10 &&
+		allocator.GetCapacity() == 120 &&
+		allocator.GetFreeBlockCount() == 1;
+	printf("\n  Running out and growing: %s", growing ? "ok" : "FAILED (the grown space wasn't joined to the free block before it)");
+	passed = passed && growing;
+
+	// Punch holes in the middle, then pack everything back down
+	allocator.Free(grown);
+	unsigned int e = allocator.Allocate(5);		// 10-15
+	unsigned int f = allocator.Allocate(40);	// 15-55
+	unsigned int hole = allocator.Allocate(30);	// 55-85
+	unsigned int g = allocator.Allocate(20);	// 85-105
+	allocator.Free(e);
+	allocator.Free(hole);
+	bool packed = allocator.IsFragmentedFor(40);
+	std::vector<RangeMove> moves;
+	allocator.Defragment(moves);
+
+	// Replay the moves on a copy of the space to check they're safe to do in order
+	std::vector<unsigned int> space(allocator.GetCapacity(), RANGE_ALLOCATOR_INVALID);
+	unsigned int handles[] = { a, f, g };
+	unsigned int oldOffsets[] = { 0, 15, 85 };
+	for (int h = 0; h < 3; h++)
+	{
+		for (unsigned int i = 0; i < allocator.GetSize(handles[h]); i++)
+			space[oldOffsets[h] + i] = handles[h];
+	}
+	for (size_t m = 0; m < moves.size(); m++)
+	{
+		packed = packed && moves[m].To < moves[m].From && moves[m].Size == allocator.GetSize(moves[m].Handle);
+		for (unsigned int i = 0; packed && i < moves[m].Size; i++)
+			space[moves[m].To + i] = space[moves[m].From + i];
+	}
+
+	// They should now sit one after the other from the start, in the same order
+	unsigned int next = 0;
+	for (int h = 0; h < 3; h++)
+	{
+		packed = packed && allocator.GetOffset(handles[h]) == next;
+		for (unsigned int i = 0; packed && i < allocator.GetSize(handles[h]); i++)
+			packed = space[next + i] == handles[h];
+		next += allocator.GetSize(handles[h]);
+	}
+	packed = packed && moves.size() == 2 && allocator.IsCompact() && allocator.GetLargestFreeBlock() == allocator.GetCapacity() - next;
+	printf("\n  Defragmenting (%u moves): %s", (unsigned int)moves.size(), packed ? "ok" : "FAILED (ranges were lost or reordered)");
+	passed = passed && packed;
+
+	return passed;
+}
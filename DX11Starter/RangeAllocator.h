@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+#include <map>
+
+// Returned by RangeAllocator::Allocate() when there's no room
+const unsigned int RANGE_ALLOCATOR_INVALID = 0xFFFFFFFF;
+
+// --------------------------------------------------------
+// One allocation that Defragment() slid to a new offset
+// --------------------------------------------------------
+struct RangeMove
+{
+	unsigned int Handle;
+	unsigned int From;		// Old offset
+	unsigned int To;		// New offset
+	unsigned int Size;
+};
+
+// --------------------------------------------------------
+// Hands out ranges of a fixed-size space (like a big GPU
+// buffer), without touching the space itself
+//
+// - Free space is kept in a list sorted by offset, so freed
+//    ranges merge with their neighbours straight away
+// - Allocations are "best fit": the smallest free block that
+//    fits is used, which leaves the big blocks for big requests
+// - Allocations are referred to by handle rather than offset,
+//    so Defragment() can move them without anyone losing track
+// - Sizes and offsets are in whatever units the caller likes
+//    (vertices, indices, bytes...)
+// --------------------------------------------------------
+class RangeAllocator
+{
+public:
+	RangeAllocator(unsigned int capacity);
+
+	// Finds room for "size" units, returning a handle to the range (or RANGE_ALLOCATOR_INVALID)
+	unsigned int Allocate(unsigned int size);
+
+	// Gives a range back
+	void Free(unsigned int handle);
+
+	// Where an allocation currently is, and how big it is
+	unsigned int GetOffset(unsigned int handle) { return allocations[handle].Offset; }
+	unsigned int GetSize(unsigned int handle) { return allocations[handle].Size; }
+
+	// Adds space to the end
+	void Grow(unsigned int newCapacity);
+
+	// Slides every allocation down to the start, leaving one free block at the end,
+	// and fills "moves" with the allocations that changed offset (in the order they moved)
+	void Defragment(std::vector<RangeMove>& moves);
+
+	// Accessors for how full the space is
+	unsigned int GetCapacity() { return capacity; }
+	unsigned int GetUsed() { return used; }
+	unsigned int GetFreeBlockCount() { return (unsigned int)freeBlocks.size(); }
+	unsigned int GetLargestFreeBlock();
+
+	// Is all of the free space in one block at the end already?
+	bool IsCompact();
+
+	// Would a request for "size" only fit after defragmenting?
+	bool IsFragmentedFor(unsigned int size) { return capacity - used >= size && GetLargestFreeBlock() < size; }
+
+private:
+	struct Allocation
+	{
+		unsigned int Offset;
+		unsigned int Size;
+		bool Live;
+	};
+
+	unsigned int capacity;
+	unsigned int used;
+
+	// Free blocks, offset -> size
+	std::map<unsigned int, unsigned int> freeBlocks;
+
+	// Every allocation, indexed by handle, and the handles that can be reused
+	std::vector<Allocation> allocations;
+	std::vector<unsigned int> freeHandles;
+
+	// Puts a block back in the free list, merging it with its neighbours
+	void AddFreeBlock(unsigned int offset, unsigned int size);
+};
+
+// Runs an allocator through best fit, merging, growing and defragmenting, checking
+// where each range ends up.  Returns false if any of them are wrong.
+bool CheckRangeAllocator();
@@ -1,4 +1,5 @@
 #include "SimpleShader.h"
+#include "VertexStreams.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // ------ BASE SIMPLE SHADER --------------------------------------------------
@@ -604,6 +605,32 @@ SimpleVertexShader::SimpleVertexShader(ID3D11Device * device, ID3D11DeviceContex
 	this->perInstanceCompatible = perInstanceCompatible;
 }
 
+// --------------------------------------------------------
+// Constructor overload which takes a custom input layout description
+//
+// Use this when the vertex data uses formats that reflection
+// can't figure out on its own (like 16 bit normalized values),
+// since the shader's inputs always reflect as 32 bit
+//
+// inputElements - The elements of the layout, which are copied
+// inputElementCount - How many elements there are
+// --------------------------------------------------------
+SimpleVertexShader::SimpleVertexShader(ID3D11Device * device, ID3D11DeviceContext * context, const D3D11_INPUT_ELEMENT_DESC * inputElements, unsigned int inputElementCount)
+	: ISimpleShader(device, context)
+{
+	this->inputLayout = 0;
+	this->shader = 0;
+	this->customInputElements.assign(inputElements, inputElements + inputElementCount);
+
+	// Check the description for per-instance data
+	this->perInstanceCompatible = false;
+	for (unsigned int i = 0; i < inputElementCount; i++)
+	{
+		if (inputElements[i].InputSlotClass == D3D11_INPUT_PER_INSTANCE_DATA)
+			this->perInstanceCompatible = true;
+	}
+}
+
 // --------------------------------------------------------
 // Destructor - Clean up actual shader (base will be called automatically)
 // --------------------------------------------------------
@@ -651,6 +678,18 @@ bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 	if (inputLayout)
 		return true;
 
+	// Were we given a description of the layout to use instead of reflecting one?
+	if (!customInputElements.empty())
+	{
+		result = device->CreateInputLayout(
+			&customInputElements[0],
+			(unsigned int)customInputElements.size(),
+			shaderBlob->GetBufferPointer(),
+			shaderBlob->GetBufferSize(),
+			&inputLayout);
+		return result == S_OK;
+	}
+
 	// Vertex shader was created successfully, so we now use the
 	// shader code to re-reflect and create an input layout that 
 	// matches what the vertex shader expects.  Code adapted from:
@@ -687,15 +726,14 @@ bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 		D3D11_INPUT_ELEMENT_DESC elementDesc;
 		elementDesc.SemanticName = paramDesc.SemanticName;
 		elementDesc.SemanticIndex = paramDesc.SemanticIndex;
-		elementDesc.InputSlot = 0;
-		elementDesc.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+		elementDesc.InputSlot = 0; // Slots and offsets are filled in by AssignVertexStreams() below
+		elementDesc.AlignedByteOffset = 0;
 		elementDesc.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
 		elementDesc.InstanceDataStepRate = 0;
 
 		// Replace anything affected by "per instance" data
 		if (isPerInstance)
 		{
-			elementDesc.InputSlot = 1; // Assume per instance data comes from another input slot!
 			elementDesc.InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
 			elementDesc.InstanceDataStepRate = 1;
 
@@ -732,6 +770,10 @@ bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 		inputLayoutDesc.push_back(elementDesc);
 	}
 
+	// Positions come from one vertex buffer and everything else from another,
+	// so a depth-only pass can bind just the positions (see VertexStreams.h)
+	AssignVertexStreams(&inputLayoutDesc[0], (unsigned int)inputLayoutDesc.size());
+
 	// Try to create Input Layout
 	HRESULT hr = device->CreateInputLayout(
 		&inputLayoutDesc[0], 
@@ -0,0 +1,432 @@
+#include "StaticBatch.h"
+#include "MeshPrimitives.h"
+#include <thread>
+#include <chrono>
+#include <unordered_map>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <cstdio>
+
+StaticBatch::StaticBatch(Material* material, std::vector<Vertex>& verts, std::vector<unsigned int>& indices, std::vector<MeshCluster>& clusters, unsigned int entityCount, GeometryPool* pool)
+{
+	this->material = material;
+	this->clusters = clusters;
+	this->entityCount = entityCount;
+	mesh = new Mesh(&verts[0], (unsigned int)verts.size(), &indices[0], (unsigned int)indices.size(), pool);
+}
+
+StaticBatch::~StaticBatch()
+{
+	delete mesh;
+}
+
+void StaticBatch::PrepareMaterial(XMFLOAT4X4 viewMatrix, XMFLOAT4X4 projMatrix)
+{
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	material->Prepare(identity, viewMatrix, projMatrix, mesh);
+}
+
+void StaticBatch::CullClusters(XMFLOAT3 cameraPosition, XMFLOAT4X4 viewMatrix, XMFLOAT4X4 projMatrix, std::vector<IndexRange>& visible, ClusterCullStats& stats)
+{
+	// The clusters are already in world space, so only the view and projection are needed
+	// (the stored matrices are transposed for HLSL, so undo that first)
+	XMMATRIX view = XMMatrixTranspose(XMLoadFloat4x4(&viewMatrix));
+	XMMATRIX proj = XMMatrixTranspose(XMLoadFloat4x4(&projMatrix));
+	XMFLOAT4X4 viewProj;
+	XMStoreFloat4x4(&viewProj, view * proj);
+
+	::CullClusters(clusters.empty() ? 0 : &clusters[0], (unsigned int)clusters.size(), viewProj, cameraPosition, visible, stats);
+}
+
+// --------------------------------------------------------
+// One entity's submesh, on its way into a batch
+// --------------------------------------------------------
+struct StaticPiece
+{
+	// Where it comes from: a mesh's geometry (read back from the GPU), and the range of its indices
+	const std::vector<Vertex>* SourceVerts;
+	const std::vector<unsigned int>* SourceIndices;
+	unsigned int SourceFirstIndex;
+	unsigned int IndexCount;
+
+	// The entity's world matrix (not transposed), and which batch the piece goes in
+	XMFLOAT4X4 World;
+	unsigned int Batch;
+
+	// The source vertices the piece uses, and its indices into those
+	std::vector<unsigned int> Vertices;
+	std::vector<unsigned int> Indices;
+
+	// Where the piece goes in its batch, and the clusters it's split into there
+	unsigned int BaseVertex;
+	unsigned int FirstIndex;
+	std::vector<MeshCluster> Clusters;
+};
+
+// --------------------------------------------------------
+// Runs "work" on every piece, spread across threads
+//
+// - Pieces are dealt out to the threads in turn, so a few
+//    big pieces in a row don't all land on one thread
+// --------------------------------------------------------
+template<typename Work>
+static void ForEachStaticPiece(std::vector<StaticPiece>& pieces, unsigned int threadCount, Work work)
+{
+	std::vector<std::thread> workers;
+	workers.reserve(threadCount);
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		workers.push_back(std::thread([&, i]()
+		{
+			for (size_t p = i; p < pieces.size(); p += threadCount)
+				work(pieces[p]);
+		}));
+	}
+	for (auto& worker : workers) worker.join();
+}
+
+// --------------------------------------------------------
+// Merges pieces into their batches' world space geometry
+// (the second half of BuildStaticBatches(), below, which
+// only works on the CPU)
+//
+// batchCount    - How many batches the pieces go into
+// threadCount   - Threads to use (0 picks one per CPU core)
+// batchVerts, batchIndices, batchClusters - Filled with each
+//                 batch's vertices, indices and clusters
+//
+// Returns how many threads were actually used
+// --------------------------------------------------------
+static unsigned int MergeStaticPieces(std::vector<StaticPiece>& pieces, size_t batchCount, unsigned int threadCount, std::vector<std::vector<Vertex>>& batchVerts, std::vector<std::vector<unsigned int>>& batchIndices, std::vector<std::vector<MeshCluster>>& batchClusters)
+{
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+	if (threadCount > pieces.size()) threadCount = (unsigned int)pieces.size();
+	if (threadCount == 0) threadCount = 1;
+
+	// Gather each piece's vertices in parallel
+	ForEachStaticPiece(pieces, threadCount, [](StaticPiece& piece)
+	{
+		std::vector<unsigned int> remap(piece.SourceVerts->size(), UINT_MAX);
+		piece.Indices.resize(piece.IndexCount);
+		for (unsigned int i = 0; i < piece.IndexCount; i++)
+		{
+			unsigned int v = (*piece.SourceIndices)[piece.SourceFirstIndex + i];
+			if (remap[v] == UINT_MAX)
+			{
+				remap[v] = (unsigned int)piece.Vertices.size();
+				piece.Vertices.push_back(v);
+			}
+			piece.Indices[i] = remap[v];
+		}
+	});
+
+	// Prefix sum the counts to find where each piece goes in its batch
+	batchVerts.assign(batchCount, std::vector<Vertex>());
+	batchIndices.assign(batchCount, std::vector<unsigned int>());
+	std::vector<unsigned int> vertexTotals(batchCount, 0);
+	std::vector<unsigned int> indexTotals(batchCount, 0);
+	for (auto& piece : pieces)
+	{
+		piece.BaseVertex = vertexTotals[piece.Batch];
+		piece.FirstIndex = indexTotals[piece.Batch];
+		vertexTotals[piece.Batch] += (unsigned int)piece.Vertices.size();
+		indexTotals[piece.Batch] += piece.IndexCount;
+	}
+	for (size_t b = 0; b < batchCount; b++)
+	{
+		batchVerts[b].resize(vertexTotals[b]);
+		batchIndices[b].resize(indexTotals[b]);
+	}
+
+	// Transform every piece into its slice of its batch in parallel
+	ForEachStaticPiece(pieces, threadCount, [&](StaticPiece& piece)
+	{
+		XMMATRIX world = XMLoadFloat4x4(&piece.World);
+		XMMATRIX normalMatrix = XMMatrixTranspose(XMMatrixInverse(0, world));
+		bool mirrored = XMVectorGetX(XMMatrixDeterminant(world)) < 0;
+
+		Vertex* verts = &batchVerts[piece.Batch][piece.BaseVertex];
+		for (size_t i = 0; i < piece.Vertices.size(); i++)
+		{
+			Vertex v = (*piece.SourceVerts)[piece.Vertices[i]];
+			XMStoreFloat3(&v.Position, XMVector3TransformCoord(XMLoadFloat3(&v.Position), world));
+			XMStoreFloat3(&v.Normal, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&v.Normal), normalMatrix)));
+			verts[i] = v;
+		}
+
+		unsigned int* indices = &batchIndices[piece.Batch][piece.FirstIndex];
+		for (unsigned int i = 0; i + 2 < piece.IndexCount; i += 3)
+		{
+			indices[i] = piece.BaseVertex + piece.Indices[i];
+			indices[i + 1] = piece.BaseVertex + piece.Indices[mirrored ? i + 2 : i + 1];
+			indices[i + 2] = piece.BaseVertex + piece.Indices[mirrored ? i + 1 : i + 2];
+		}
+
+		// Only this piece's vertices and indices are read, and this thread just wrote them
+		BuildClusters(&batchVerts[piece.Batch][0], &batchIndices[piece.Batch][0], piece.FirstIndex, piece.IndexCount, piece.Clusters);
+	});
+
+	// Collect each batch's clusters (the pieces are already in index buffer order)
+	batchClusters.assign(batchCount, std::vector<MeshCluster>());
+	for (auto& piece : pieces)
+		batchClusters[piece.Batch].insert(batchClusters[piece.Batch].end(), piece.Clusters.begin(), piece.Clusters.end());
+	return threadCount;
+}
+
+// --------------------------------------------------------
+// Merges static entities into batches
+//
+// world       - Every entity in the scene (only the static ones are merged)
+// transforms  - Where the entities' transforms are
+// pool        - Where to put the batches' geometry
+// batches     - Where to add the new batches
+// threadCount - Threads to transform the vertices with (0 picks one per CPU core)
+//
+// - Each mesh's geometry is read back from the pool once, no
+//    matter how many entities use it, and every entity's
+//    submeshes become pieces of the batch for their material
+// - Each thread first gathers its pieces' vertices (a piece
+//    only takes the vertices its own indices use), then a
+//    prefix sum of the counts tells every piece where it goes
+//    in its batch
+// - Each thread then transforms its pieces straight into their
+//    slices of the batch (normals by the inverse transpose, and
+//    with the winding flipped for mirrored entities, so the
+//    triangles still face the right way), and splits them into
+//    clusters
+// --------------------------------------------------------
+void BuildStaticBatches(EntityWorld* world, TransformStore* transforms, GeometryPool* pool, std::vector<StaticBatch*>& batches, unsigned int threadCount)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	// Read back every static entity's geometry and split it into pieces, grouped by material
+	std::unordered_map<Mesh*, std::pair<std::vector<Vertex>, std::vector<unsigned int>>> sources;
+	std::vector<StaticPiece> pieces;
+	std::vector<Material*> materials;
+	std::vector<unsigned int> entityCounts;
+	std::vector<unsigned int> lastEntities;
+	unsigned int entityTotal = 0;
+	world->ForEach<TransformComponent, MeshComponent, MaterialComponent, StaticComponent>([&](Entity entity, TransformComponent& transform, MeshComponent& meshComponent, MaterialComponent& material, StaticComponent&)
+	{
+		Mesh* mesh = meshComponent.Geometry.get();
+		auto found = sources.find(mesh);
+		if (found == sources.end())
+		{
+			found = sources.emplace(mesh, std::make_pair(std::vector<Vertex>(), std::vector<unsigned int>())).first;
+			if (!mesh->ReadGeometry(found->second.first, found->second.second))
+				found->second.first.clear();
+		}
+		if (found->second.first.empty())
+		{
+			world->Remove<StaticComponent>(entity);
+			return;
+		}
+
+		transforms->UpdateWorldMatrix(transform.Transform);
+		unsigned int e = entityTotal++;
+		XMFLOAT4X4 storedWorld = transforms->GetWorldMatrix(transform.Transform);
+
+		const MeshSubmesh* submeshes = mesh->GetSubmeshes(0);
+		for (unsigned int s = 0; s < mesh->GetSubmeshCount(); s++)
+		{
+			if (submeshes[s].IndexCount == 0)
+				continue;
+
+			// Find (or start) the batch for this material
+			Material* submeshMaterial = material.Submeshes[s];
+			unsigned int batch = (unsigned int)(std::find(materials.begin(), materials.end(), submeshMaterial) - materials.begin());
+			if (batch == materials.size())
+			{
+				materials.push_back(submeshMaterial);
+				entityCounts.push_back(0);
+				lastEntities.push_back(UINT_MAX);
+			}
+			if (lastEntities[batch] != e)
+			{
+				entityCounts[batch]++;
+				lastEntities[batch] = e;
+			}
+
+			StaticPiece piece = {};
+			piece.SourceVerts = &found->second.first;
+			piece.SourceIndices = &found->second.second;
+			piece.SourceFirstIndex = submeshes[s].FirstIndex;
+			piece.IndexCount = submeshes[s].IndexCount;
+			XMStoreFloat4x4(&piece.World, XMMatrixTranspose(XMLoadFloat4x4(&storedWorld)));
+			piece.Batch = batch;
+			pieces.push_back(piece);
+		}
+	});
+
+	// Take the static mark off the entities that couldn't be merged
+	world->ApplyChanges();
+	if (pieces.empty())
+		return;
+
+	std::vector<std::vector<Vertex>> batchVerts;
+	std::vector<std::vector<unsigned int>> batchIndices;
+	std::vector<std::vector<MeshCluster>> batchClusters;
+	threadCount = MergeStaticPieces(pieces, materials.size(), threadCount, batchVerts, batchIndices, batchClusters);
+
+	// Make the batches
+	unsigned int clusterTotal = 0;
+	for (size_t b = 0; b < materials.size(); b++)
+	{
+		batches.push_back(new StaticBatch(materials[b], batchVerts[b], batchIndices[b], batchClusters[b], entityCounts[b], pool));
+		clusterTotal += (unsigned int)batchClusters[b].size();
+	}
+
+#if defined(DEBUG) || defined(_DEBUG)
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	unsigned int vertexTotal = 0;
+	unsigned int triangleTotal = 0;
+	for (size_t b = 0; b < materials.size(); b++)
+	{
+		vertexTotal += (unsigned int)batchVerts[b].size();
+		triangleTotal += (unsigned int)batchIndices[b].size() / 3;
+	}
+	printf("\nStatic batches: %u entities in %u batches, %u vertices, %u triangles, %u clusters in %.3f ms (%u threads)",
+		entityTotal, (unsigned int)materials.size(), vertexTotal, triangleTotal, clusterTotal, seconds * 1000.0, threadCount);
+#endif
+}
+
+// --------------------------------------------------------
+// Merges a made-up scene of static pieces on the CPU, and
+// checks the batches hold exactly what the pieces did
+//
+// - The scene is a floor (one batch) and a grid of pillars
+//    (another), every tenth pillar mirrored
+// - Every batch triangle has to be its piece's triangle in
+//    world space, facing the same way (so mirrored pieces
+//    have to have had their winding flipped)
+// - The clusters have to cover each batch's indices exactly,
+//    in order
+// - Merging on one thread and on several has to give the same
+//    batches, and both are timed
+// --------------------------------------------------------
+bool CheckStaticBatches()
+{
+	const int gridSize = 20;
+	std::vector<Vertex> floorVerts, pillarVerts;
+	std::vector<unsigned int> floorIndices, pillarIndices;
+	GenerateBox(XMFLOAT3(12.0f, 0.2f, 12.0f), floorVerts, floorIndices);
+	GenerateCylinder(0.25f, 3.0f, 16, 1, pillarVerts, pillarIndices);
+
+	// The pieces are used up by merging, so they're made again for every run
+	auto makePieces = [&](std::vector<StaticPiece>& pieces)
+	{
+		pieces.clear();
+		StaticPiece floor = {};
+		floor.SourceVerts = &floorVerts;
+		floor.SourceIndices = &floorIndices;
+		floor.IndexCount = (unsigned int)floorIndices.size();
+		XMStoreFloat4x4(&floor.World, XMMatrixTranslation(0, -1.6f, 0));
+		floor.Batch = 0;
+		pieces.push_back(floor);
+
+		for (int i = 0; i < gridSize * gridSize; i++)
+		{
+			StaticPiece pillar = {};
+			pillar.SourceVerts = &pillarVerts;
+			pillar.SourceIndices = &pillarIndices;
+			pillar.IndexCount = (unsigned int)pillarIndices.size();
+			XMMATRIX world =
+				XMMatrixScaling(i % 10 == 0 ? -1.0f : 1.0f, 1.0f + (i % 3) * 0.5f, 1.0f) *
+				XMMatrixRotationY(i * 0.3f) *
+				XMMatrixTranslation((float)(i % gridSize) - gridSize / 2, 0, (float)(i / gridSize) - gridSize / 2);
+			XMStoreFloat4x4(&pillar.World, world);
+			pillar.Batch = 1;
+			pieces.push_back(pillar);
+		}
+	};
+
+	// Merge on one thread, then on one per core, timing both
+	std::vector<StaticPiece> pieces;
+	std::vector<std::vector<Vertex>> batchVerts[2];
+	std::vector<std::vector<unsigned int>> batchIndices[2];
+	std::vector<std::vector<MeshCluster>> batchClusters[2];
+	double seconds[2];
+	unsigned int threads[2] = { 1, 0 };
+	for (int run = 0; run < 2; run++)
+	{
+		makePieces(pieces);
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		threads[run] = MergeStaticPieces(pieces, 2, threads[run], batchVerts[run], batchIndices[run], batchClusters[run]);
+		seconds[run] = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// Each triangle in the batch against its piece's, moved into the world
+	bool placed = true;
+	bool facing = true;
+	for (size_t p = 0; p < pieces.size() && placed; p++)
+	{
+		const StaticPiece& piece = pieces[p];
+		XMMATRIX world = XMLoadFloat4x4(&piece.World);
+		bool mirrored = XMVectorGetX(XMMatrixDeterminant(world)) < 0;
+		const std::vector<Vertex>& verts = batchVerts[0][piece.Batch];
+		const unsigned int* indices = &batchIndices[0][piece.Batch][piece.FirstIndex];
+		for (unsigned int i = 0; i + 2 < piece.IndexCount && placed; i += 3)
+		{
+			unsigned int order[3] = { i, mirrored ? i + 2 : i + 1, mirrored ? i + 1 : i + 2 };
+			XMVECTOR source[3], merged[3];
+			for (int c = 0; c < 3; c++)
+			{
+				const Vertex& original = (*piece.SourceVerts)[(*piece.SourceIndices)[piece.SourceFirstIndex + order[c]]];
+				source[c] = XMVector3TransformCoord(XMLoadFloat3(&original.Position), world);
+				placed = placed && indices[i + c] < verts.size();
+				if (!placed)
+					break;
+				merged[c] = XMLoadFloat3(&verts[indices[i + c]].Position);
+				placed = XMVector3NearEqual(source[c], merged[c], XMVectorReplicate(1e-4f)) &&
+					original.UV.x == verts[indices[i + c]].UV.x && original.UV.y == verts[indices[i + c]].UV.y;
+			}
+			if (!placed)
+				break;
+
+			// The merged face has to point the same way as the piece's vertex normals do
+			XMVECTOR faceNormal = XMVector3Cross(merged[1] - merged[0], merged[2] - merged[0]);
+			XMVECTOR vertexNormals =
+				XMLoadFloat3(&verts[indices[i]].Normal) +
+				XMLoadFloat3(&verts[indices[i + 1]].Normal) +
+				XMLoadFloat3(&verts[indices[i + 2]].Normal);
+			const Vertex& a = (*piece.SourceVerts)[(*piece.SourceIndices)[piece.SourceFirstIndex + i]];
+			const Vertex& b = (*piece.SourceVerts)[(*piece.SourceIndices)[piece.SourceFirstIndex + i + 1]];
+			const Vertex& c = (*piece.SourceVerts)[(*piece.SourceIndices)[piece.SourceFirstIndex + i + 2]];
+			XMVECTOR sourceFace = XMVector3Cross(XMLoadFloat3(&b.Position) - XMLoadFloat3(&a.Position), XMLoadFloat3(&c.Position) - XMLoadFloat3(&a.Position));
+			XMVECTOR sourceNormals = XMLoadFloat3(&a.Normal) + XMLoadFloat3(&b.Normal) + XMLoadFloat3(&c.Normal);
+			facing = facing && (XMVectorGetX(XMVector3Dot(faceNormal, vertexNormals)) > 0) == (XMVectorGetX(XMVector3Dot(sourceFace, sourceNormals)) > 0);
+		}
+	}
+
+	// The clusters, and the second run against the first
+	bool covered = true;
+	bool same = true;
+	for (int b = 0; b < 2; b++)
+	{
+		unsigned int next = 0;
+		for (size_t c = 0; c < batchClusters[0][b].size(); c++)
+		{
+			covered = covered && batchClusters[0][b][c].FirstIndex == next;
+			next = batchClusters[0][b][c].FirstIndex + batchClusters[0][b][c].IndexCount;
+		}
+		covered = covered && next == batchIndices[0][b].size();
+
+		same = same &&
+			batchVerts[0][b].size() == batchVerts[1][b].size() &&
+			batchIndices[0][b] == batchIndices[1][b] &&
+			batchClusters[0][b].size() == batchClusters[1][b].size() &&
+			memcmp(&batchVerts[0][b][0], &batchVerts[1][b][0], batchVerts[0][b].size() * sizeof(Vertex)) == 0 &&
+			memcmp(&batchClusters[0][b][0], &batchClusters[1][b][0], batchClusters[0][b].size() * sizeof(MeshCluster)) == 0;
+	}
+
+	printf("\nStatic batches (%u pieces, %u + %u verts, %u + %u clusters):",
+		(unsigned int)pieces.size(), (unsigned int)batchVerts[0][0].size(), (unsigned int)batchVerts[0][1].size(),
+		(unsigned int)batchClusters[0][0].size(), (unsigned int)batchClusters[0][1].size());
+	printf("\n  1 thread: %.3f ms, %u threads: %.3f ms, %s", seconds[0] * 1000.0, threads[1], seconds[1] * 1000.0,
+		!placed ? "FAILED (triangles moved wrong)" : !facing ? "FAILED (triangles flipped)" : !covered ? "FAILED (clusters don't cover the batch)" :
+		!same ? "FAILED (threads gave different batches)" : "ok");
+	return placed && facing && covered && same;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include "Mesh.h"
+#include "Material.h"
+#include "Components.h"
+#include "GeometryPool.h"
+#include <vector>
+
+// --------------------------------------------------------
+// Scenery that never moves, merged into one mesh per
+// material so it draws with one material setup
+//
+// - The vertices are already in world space, so the batch
+//    is drawn with an identity world matrix
+// - Each entity's part of the batch is split into its own
+//    clusters (in world space), so parts that are out of view
+//    or facing away are still culled, and the visible ranges
+//    are drawn from the one set of buffers
+// - Positions move outside the bounds of the meshes they came
+//    from, so batches always hold full vertices
+// - Only the finest level of detail is merged, since the
+//    whole batch can't switch level at once
+// --------------------------------------------------------
+class StaticBatch
+{
+public:
+	// Makes a batch from world space geometry, and the clusters that were built for it
+	StaticBatch(Material* material, std::vector<Vertex>& verts, std::vector<unsigned int>& indices, std::vector<MeshCluster>& clusters, unsigned int entityCount, GeometryPool* pool);
+	~StaticBatch();
+
+	// The material every part of the batch is drawn with, and the merged geometry
+	Material* GetMaterial() { return material; }
+	Mesh* GetMesh() { return mesh; }
+
+	// How many entities were merged into the batch
+	unsigned int GetEntityCount() { return entityCount; }
+
+	// Set up the material and shaders to draw the batch
+	void PrepareMaterial(XMFLOAT4X4 viewMatrix, XMFLOAT4X4 projMatrix);
+
+	// Culls the clusters the camera can't see, filling "visible" with the index ranges
+	// to draw (relative to the mesh's first index) and adding to "stats"
+	void CullClusters(XMFLOAT3 cameraPosition, XMFLOAT4X4 viewMatrix, XMFLOAT4X4 projMatrix, std::vector<IndexRange>& visible, ClusterCullStats& stats);
+
+private:
+	Material* material;
+	Mesh* mesh;
+	std::vector<MeshCluster> clusters;
+	unsigned int entityCount;
+
+	// Batches own their mesh, so they can't be copied
+	StaticBatch(const StaticBatch&) = delete;
+	StaticBatch& operator=(const StaticBatch&) = delete;
+};
+
+// Merges every entity with a StaticComponent into one batch per material,
+// transforming their vertices into world space across several threads (0 picks one per CPU core)
+// - The batches are added to "batches", and it's up to the caller to delete them
+// - Entities whose geometry can't be read back lose their StaticComponent, so they're still drawn on their own
+void BuildStaticBatches(EntityWorld* world, TransformStore* transforms, GeometryPool* pool, std::vector<StaticBatch*>& batches, unsigned int threadCount = 0);
+
+// Merges a made-up scene of static pieces on one thread and on several, checking the batches match
+// the pieces (moved into the world, and still facing the right way) and each other.  Returns false if not.
+bool CheckStaticBatches();
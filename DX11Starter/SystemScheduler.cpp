@@ -0,0 +1,337 @@
+#include "SystemScheduler.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+SystemScheduler::SystemScheduler(EntityWorld* world, unsigned int threadCount)
+{
+	this->world = world;
+	deterministic = false;
+	frameSeconds = 0;
+	frames = 0;
+	deltaTime = 0;
+	totalTime = 0;
+	remaining = 0;
+	stopping = false;
+
+	// The calling thread runs systems too, so it counts as one of the threads
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+	if (threadCount == 0) threadCount = 1;
+
+	workers.reserve(threadCount - 1);
+	for (unsigned int i = 0; i < threadCount - 1; i++)
+		workers.push_back(std::thread([this]() { WorkerLoop(); }));
+}
+
+SystemScheduler::~SystemScheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+unsigned int SystemScheduler::AddSystem(const char* name, ComponentMask reads, ComponentMask writes, std::function<void(float deltaTime, float totalTime)> update)
+{
+	System system;
+	system.Name = name;
+	system.Reads = reads;
+	system.Writes = writes;
+	system.Update = update;
+	system.Enabled = true;
+	system.Waiting = 0;
+	system.Seconds = 0;
+	system.Runs = 0;
+	systems.push_back(system);
+	return (unsigned int)systems.size() - 1;
+}
+
+void SystemScheduler::SetEnabled(unsigned int system, bool enabled)
+{
+	systems[system].Enabled = enabled;
+}
+
+// --------------------------------------------------------
+// Runs this frame's systems
+//
+// - The calling thread takes ready systems along with the
+//    workers, and returns once every one has finished
+// - Deterministic mode (or having no workers) skips the graph
+//    entirely, and just runs them in order
+// --------------------------------------------------------
+void SystemScheduler::Run(float deltaTime, float totalTime)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	if (deterministic || workers.empty())
+	{
+		this->deltaTime = deltaTime;
+		this->totalTime = totalTime;
+		for (unsigned int s = 0; s < systems.size(); s++)
+		{
+			if (systems[s].Enabled)
+				RunSystem(s);
+		}
+	}
+	else
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		this->deltaTime = deltaTime;
+		this->totalTime = totalTime;
+		BuildGraph();
+		wake.notify_all();
+
+		while (remaining > 0)
+		{
+			if (ready.empty())
+			{
+				wake.wait(lock);
+				continue;
+			}
+
+			unsigned int system = ready.front();
+			ready.erase(ready.begin());
+			lock.unlock();
+			RunSystem(system);
+			lock.lock();
+			Finish(system);
+		}
+	}
+
+	world->ApplyChanges();
+
+	frameSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	frames++;
+}
+
+SystemTiming SystemScheduler::GetTiming(unsigned int system)
+{
+	SystemTiming timing;
+	timing.Name = systems[system].Name.c_str();
+	timing.Runs = systems[system].Runs;
+	timing.AverageMilliseconds = timing.Runs > 0 ? systems[system].Seconds * 1000.0 / timing.Runs : 0.0;
+	return timing;
+}
+
+double SystemScheduler::GetAverageFrameMilliseconds()
+{
+	return frames > 0 ? frameSeconds * 1000.0 / frames : 0.0;
+}
+
+void SystemScheduler::ResetTimings()
+{
+	for (size_t s = 0; s < systems.size(); s++)
+	{
+		systems[s].Seconds = 0;
+		systems[s].Runs = 0;
+	}
+	frameSeconds = 0;
+	frames = 0;
+}
+
+void SystemScheduler::PrintTimings()
+{
+#if defined(DEBUG) || defined(_DEBUG)
+	// With the systems in parallel, the frame can take less than their total
+	double total = 0;
+	for (unsigned int s = 0; s < systems.size(); s++)
+		total += GetTiming(s).AverageMilliseconds;
+
+	if (deterministic || workers.empty())
+		printf("\nSystems (one at a time, average of %u frames): %.3f ms per frame", frames, GetAverageFrameMilliseconds());
+	else
+		printf("\nSystems (on %u threads, average of %u frames): %.3f ms per frame, %.3f ms of work", (unsigned int)workers.size() + 1, frames, GetAverageFrameMilliseconds(), total);
+
+	for (unsigned int s = 0; s < systems.size(); s++)
+	{
+		SystemTiming timing = GetTiming(s);
+		printf("\n  %s: %.3f ms%s", timing.Name, timing.AverageMilliseconds, systems[s].Enabled ? "" : " (off)");
+	}
+	ResetTimings();
+#endif
+}
+
+// --------------------------------------------------------
+// Works out which systems wait on which for this frame, and
+// which can start straight away
+//
+// - Every conflicting pair is linked, earlier to later, not
+//    just the nearest, which is more links than needed, but
+//    there are only ever a handful of systems
+// - Links only go forward, so there can't be a cycle
+// --------------------------------------------------------
+void SystemScheduler::BuildGraph()
+{
+	ready.clear();
+	remaining = 0;
+	for (size_t s = 0; s < systems.size(); s++)
+	{
+		systems[s].Dependents.clear();
+		systems[s].Waiting = 0;
+	}
+
+	for (unsigned int a = 0; a < systems.size(); a++)
+	{
+		if (!systems[a].Enabled)
+			continue;
+		remaining++;
+
+		for (unsigned int b = a + 1; b < systems.size(); b++)
+		{
+			if (!systems[b].Enabled)
+				continue;
+			if ((systems[a].Writes & (systems[b].Reads | systems[b].Writes)) || (systems[b].Writes & systems[a].Reads))
+			{
+				systems[a].Dependents.push_back(b);
+				systems[b].Waiting++;
+			}
+		}
+
+		if (systems[a].Waiting == 0)
+			ready.push_back(a);
+	}
+}
+
+void SystemScheduler::RunSystem(unsigned int system)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	systems[system].Update(deltaTime, totalTime);
+	systems[system].Seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	systems[system].Runs++;
+}
+
+void SystemScheduler::WorkerLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		wake.wait(lock, [this]() { return stopping || !ready.empty(); });
+		if (stopping)
+			return;
+
+		unsigned int system = ready.front();
+		ready.erase(ready.begin());
+		lock.unlock();
+		RunSystem(system);
+		lock.lock();
+		Finish(system);
+	}
+}
+
+// Lets the systems waiting on one that's finished start, once they aren't waiting on anything else
+// (called with the mutex held)
+void SystemScheduler::Finish(unsigned int system)
+{
+	for (size_t d = 0; d < systems[system].Dependents.size(); d++)
+	{
+		unsigned int dependent = systems[system].Dependents[d];
+		if (--systems[dependent].Waiting == 0)
+			ready.push_back(dependent);
+	}
+	remaining--;
+
+	// Wakes the workers for the new systems, and the calling thread if that was the last one
+	wake.notify_all();
+}
+
+// Components for the benchmark's systems to work on
+struct BenchPosition { float X, Y, Z; };
+struct BenchVelocity { float X, Y, Z; };
+struct BenchHealth { float Value; };
+struct BenchRegen { float Rate; };
+struct BenchDistance { float Value; };
+struct BenchGlow { float Value; };
+
+// --------------------------------------------------------
+// Runs the same four systems over the same entities, one at
+// a time and then in parallel
+//
+// - Two pairs of systems, which only wait on their own pair,
+//    so two can always run at once
+// - Every system only works with its own entity's components,
+//    so both ways have to give exactly the same numbers
+// --------------------------------------------------------
+void BenchmarkScheduler()
+{
+	const unsigned int count = 100000;
+	const int frames = 10;
+	const float step = 1.0f / 60.0f;
+
+	EntityWorld worlds[2];
+	double seconds[2] = { 1e30, 1e30 };
+	for (int w = 0; w < 2; w++)
+	{
+		EntityWorld& world = worlds[w];
+		for (unsigned int i = 0; i < count; i++)
+		{
+			Entity entity = world.Create();
+			BenchPosition position = { (float)(i % 100), 0.0f, (float)(i / 100 % 100) };
+			BenchVelocity velocity = { 1.0f, (float)(i % 7) * 0.1f, -1.0f };
+			BenchHealth health = { (float)(i % 50) };
+			BenchRegen regen = { (float)(i % 3) + 0.5f };
+			world.Add(entity, position);
+			world.Add(entity, velocity);
+			world.Add(entity, health);
+			world.Add(entity, regen);
+			world.Add(entity, BenchDistance());
+			world.Add(entity, BenchGlow());
+		}
+		world.ApplyChanges();
+
+		SystemScheduler scheduler(&world);
+		scheduler.SetDeterministic(w == 0);
+		scheduler.AddSystem("Move", MaskOf<BenchVelocity>(), MaskOf<BenchPosition>(), [&](float deltaTime, float totalTime)
+		{
+			world.ForEach<BenchPosition, BenchVelocity>([&](Entity entity, BenchPosition& position, BenchVelocity& velocity)
+			{
+				position.X += velocity.X * deltaTime;
+				position.Y += velocity.Y * sinf(totalTime) * deltaTime;
+				position.Z += velocity.Z * deltaTime;
+			});
+		});
+		scheduler.AddSystem("Regen", MaskOf<BenchRegen>(), MaskOf<BenchHealth>(), [&](float deltaTime, float totalTime)
+		{
+			world.ForEach<BenchHealth, BenchRegen>([&](Entity entity, BenchHealth& health, BenchRegen& regen)
+			{
+				health.Value = fminf(health.Value + regen.Rate * deltaTime, 100.0f);
+			});
+		});
+		scheduler.AddSystem("Distance", MaskOf<BenchPosition>(), MaskOf<BenchDistance>(), [&](float deltaTime, float totalTime)
+		{
+			world.ForEach<BenchPosition, BenchDistance>([&](Entity entity, BenchPosition& position, BenchDistance& distance)
+			{
+				distance.Value = sqrtf(position.X * position.X + position.Y * position.Y + position.Z * position.Z);
+			});
+		});
+		scheduler.AddSystem("Glow", MaskOf<BenchHealth>(), MaskOf<BenchGlow>(), [&](float deltaTime, float totalTime)
+		{
+			world.ForEach<BenchHealth, BenchGlow>([&](Entity entity, BenchHealth& health, BenchGlow& glow)
+			{
+				glow.Value = 0.5f + 0.5f * cosf(health.Value * 0.1f);
+			});
+		});
+
+		for (int f = 0; f < frames; f++)
+		{
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			scheduler.Run(step, f * step);
+			double frameSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			seconds[w] = frameSeconds < seconds[w] ? frameSeconds : seconds[w];
+		}
+	}
+
+	// Both worlds were made the same way, so their entities are in the same places
+	unsigned int different = 0;
+	worlds[0].ForEach<BenchDistance, BenchGlow>([&](Entity entity, BenchDistance& distance, BenchGlow& glow)
+	{
+		if (worlds[1].Get<BenchDistance>(entity)->Value != distance.Value || worlds[1].Get<BenchGlow>(entity)->Value != glow.Value)
+			different++;
+	});
+
+	printf("\nScheduler (%u entities, 4 systems, best of %d frames): %.3f ms one at a time, %.3f ms in parallel (%.1fx), %u entities different",
+		count, frames, seconds[0] * 1000.0, seconds[1] * 1000.0, seconds[1] > 0 ? seconds[0] / seconds[1] : 0.0, different);
+}
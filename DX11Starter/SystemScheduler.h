@@ -0,0 +1,123 @@
+#pragma once
+
+#include "EntityWorld.h"
+#include <vector>
+#include <string>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// What a system that creates or destroys entities, or adds or removes components, writes
+// (every component, so it never runs alongside anything else)
+const ComponentMask ALL_COMPONENTS = 0xFFFFFFFF;
+
+// How long a system has taken, on average, since the timings were last reset
+struct SystemTiming
+{
+	const char* Name;
+	unsigned int Runs;
+	double AverageMilliseconds;
+};
+
+// --------------------------------------------------------
+// Runs the game's systems every frame, as many at once as
+// can safely run together
+//
+// - Each system says which components it reads and which it
+//    writes. Two systems conflict if either writes something
+//    the other reads or writes, and then the one added first
+//    runs first, so the order they were added in is the order
+//    anything they share sees them in
+// - The systems that conflict make a graph, worked out again
+//    every frame (so systems can be switched on and off), and
+//    each system is started on a worker thread as soon as the
+//    ones it waits on have finished
+// - In deterministic mode every system runs on the calling
+//    thread, one at a time, in the order they were added,
+//    which is one of the orders the graph allows, so it gives
+//    the same results while being easy to step through
+// - Changes to entities (creating, destroying, adding and
+//    removing components) are applied once every system has
+//    run. A system that makes them should write ALL_COMPONENTS,
+//    since the world's list of changes isn't thread safe
+// - Each system is timed, and the average kept, along with the
+//    time of the whole frame, to compare against their total
+// --------------------------------------------------------
+class SystemScheduler
+{
+public:
+	// With no thread count, one worker is started per core, less the calling thread's
+	SystemScheduler(EntityWorld* world, unsigned int threadCount = 0);
+	~SystemScheduler();
+
+	// Adds a system, returning its index
+	unsigned int AddSystem(const char* name, ComponentMask reads, ComponentMask writes, std::function<void(float deltaTime, float totalTime)> update);
+
+	// Switches a system on or off (they all start on)
+	void SetEnabled(unsigned int system, bool enabled);
+
+	// Runs every system on the calling thread, in the order they were added, when set
+	void SetDeterministic(bool deterministic) { this->deterministic = deterministic; }
+	bool IsDeterministic() { return deterministic; }
+
+	// Runs every system that's switched on, then applies their changes to the world
+	void Run(float deltaTime, float totalTime);
+
+	// How long each system has taken, and the whole of Run(), on average since ResetTimings()
+	unsigned int GetSystemCount() { return (unsigned int)systems.size(); }
+	SystemTiming GetTiming(unsigned int system);
+	double GetAverageFrameMilliseconds();
+	void ResetTimings();
+
+	// Prints every system's average time, then resets them (debug builds only)
+	void PrintTimings();
+
+private:
+	// One system, and where it is in this frame's graph
+	struct System
+	{
+		std::string Name;
+		ComponentMask Reads;
+		ComponentMask Writes;
+		std::function<void(float, float)> Update;
+		bool Enabled;
+
+		// The systems that wait on this one, and how many it's still waiting on
+		std::vector<unsigned int> Dependents;
+		unsigned int Waiting;
+
+		double Seconds;
+		unsigned int Runs;
+	};
+
+	EntityWorld* world;
+	std::vector<System> systems;
+	bool deterministic;
+
+	// The time of every Run() since the timings were reset
+	double frameSeconds;
+	unsigned int frames;
+
+	// This frame's times, and the systems ready to start
+	float deltaTime;
+	float totalTime;
+	std::vector<unsigned int> ready;
+	unsigned int remaining;
+
+	// The workers, which sleep until there's a system ready or they're stopped
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping;
+
+	// Helper methods
+	void BuildGraph();
+	void RunSystem(unsigned int system);
+	void WorkerLoop();
+	void Finish(unsigned int system);
+};
+
+// Times a set of systems over 100k entities, one at a time and in parallel,
+// checks they give the same results, and prints them
+void BenchmarkScheduler();
@@ -0,0 +1,684 @@
+#include "TransformStore.h"
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <random>
+
+using namespace DirectX;
+
+TransformStore::TransformStore()
+{
+	count = 0;
+	hierarchyChanged = false;
+}
+
+// --------------------------------------------------------
+// Adds a transform, growing the arrays by a whole group at
+// a time
+//
+// - The spare slots at the end of the last group are left as
+//    identity transforms that are never dirty, so the kernel
+//    can always load and store whole groups
+// --------------------------------------------------------
+unsigned int TransformStore::Add()
+{
+	if (count % TRANSFORM_GROUP_SIZE == 0)
+	{
+		size_t size = count + TRANSFORM_GROUP_SIZE;
+		positionX.resize(size, 0.0f);
+		positionY.resize(size, 0.0f);
+		positionZ.resize(size, 0.0f);
+		rotationX.resize(size, 0.0f);
+		rotationY.resize(size, 0.0f);
+		rotationZ.resize(size, 0.0f);
+		scaleX.resize(size, 1.0f);
+		scaleY.resize(size, 1.0f);
+		scaleZ.resize(size, 1.0f);
+		dirty.resize(size, 0);
+		versions.resize(size, 1);
+		journaled.resize(size, 0);
+		parents.resize(size, TRANSFORM_NO_PARENT);
+		hierarchyIndices.resize(size, TRANSFORM_NO_PARENT);
+
+		XMFLOAT4X4 identity;
+		XMStoreFloat4x4(&identity, XMMatrixIdentity());
+		worldMatrices.resize(size, identity);
+	}
+	return count++;
+}
+
+void TransformStore::SetPosition(unsigned int transform, XMFLOAT3 position)
+{
+	positionX[transform] = position.x;
+	positionY[transform] = position.y;
+	positionZ[transform] = position.z;
+	MarkChanged(transform);
+}
+
+void TransformStore::SetRotation(unsigned int transform, XMFLOAT3 rotation)
+{
+	rotationX[transform] = rotation.x;
+	rotationY[transform] = rotation.y;
+	rotationZ[transform] = rotation.z;
+	MarkChanged(transform);
+}
+
+void TransformStore::SetScale(unsigned int transform, XMFLOAT3 scale)
+{
+	scaleX[transform] = scale.x;
+	scaleY[transform] = scale.y;
+	scaleZ[transform] = scale.z;
+	MarkChanged(transform);
+}
+
+void TransformStore::Move(unsigned int transform, float x, float y, float z)
+{
+	positionX[transform] += x;
+	positionY[transform] += y;
+	positionZ[transform] += z;
+	MarkChanged(transform);
+}
+
+void TransformStore::Rotate(unsigned int transform, float x, float y, float z)
+{
+	rotationX[transform] += x;
+	rotationY[transform] += y;
+	rotationZ[transform] += z;
+	MarkChanged(transform);
+}
+
+void TransformStore::Scale(unsigned int transform, float x, float y, float z)
+{
+	scaleX[transform] *= x;
+	scaleY[transform] *= y;
+	scaleZ[transform] *= z;
+	MarkChanged(transform);
+}
+
+bool TransformStore::SetParent(unsigned int transform, unsigned int parent)
+{
+	for (unsigned int ancestor = parent; ancestor != TRANSFORM_NO_PARENT; ancestor = parents[ancestor])
+	{
+		if (ancestor == transform)
+			return false;
+	}
+	if (parents[transform] == parent)
+		return true;
+
+	// The depth first order is rebuilt on the next update
+	parents[transform] = parent;
+	hierarchyChanged = true;
+	MarkChanged(transform);
+	return true;
+}
+
+void TransformStore::ClearChanges()
+{
+	unsigned int kept = 0;
+	for (size_t i = 0; i < journal.size(); i++)
+	{
+		unsigned int transform = journal[i];
+		if (dirty[transform])
+			journal[kept++] = transform;
+		else
+			journaled[transform] = 0;
+	}
+	journal.resize(kept);
+}
+
+// --------------------------------------------------------
+// Updates the dirty transforms' world matrices
+//
+// - When only a few transforms have changed, just the groups
+//    in the journal are updated, so a mostly still scene costs
+//    next to nothing, however big it is
+// - Otherwise every group's flags are checked, and the groups
+//    are split between threads, so each thread gets a run of
+//    neighbouring transforms (and none shares a cache line of
+//    matrices with another for more than one group)
+// - Everything under a changed transform in the hierarchy is
+//    marked changed first, and once the kernel's done, their
+//    matrices (which it makes relative to their parents) are
+//    multiplied down the tree
+// --------------------------------------------------------
+void TransformStore::UpdateWorldMatrices(unsigned int threadCount)
+{
+	if (hierarchyChanged)
+		BuildHierarchy();
+	MarkDirtySubtrees();
+
+	unsigned int groupCount = (count + TRANSFORM_GROUP_SIZE - 1) / TRANSFORM_GROUP_SIZE;
+	if (journal.size() * 4 < groupCount)
+	{
+		for (size_t i = 0; i < journal.size(); i++)
+			UpdateGroups(journal[i] / TRANSFORM_GROUP_SIZE, journal[i] / TRANSFORM_GROUP_SIZE + 1);
+		PropagateSubtrees(threadCount);
+		return;
+	}
+
+	unsigned int kernelThreads = threadCount == 0 ? std::thread::hardware_concurrency() : threadCount;
+	unsigned int maxThreads = count / TRANSFORM_MIN_PER_THREAD;
+	if (kernelThreads > maxThreads) kernelThreads = maxThreads;
+	if (kernelThreads <= 1)
+	{
+		UpdateGroups(0, groupCount);
+	}
+	else
+	{
+		std::vector<std::thread> workers;
+		workers.reserve(kernelThreads);
+		for (unsigned int i = 0; i < kernelThreads; i++)
+		{
+			workers.push_back(std::thread([&, i]()
+			{
+				UpdateGroups(groupCount * i / kernelThreads, groupCount * (i + 1) / kernelThreads);
+			}));
+		}
+		for (auto& worker : workers) worker.join();
+	}
+	PropagateSubtrees(threadCount);
+}
+
+void TransformStore::UpdateWorldMatrix(unsigned int transform)
+{
+	// The kernel would leave a transform in the hierarchy relative to its parent,
+	// so if this group has one, everything's updated properly instead
+	unsigned int first = transform / TRANSFORM_GROUP_SIZE * TRANSFORM_GROUP_SIZE;
+	bool inHierarchy = hierarchyChanged;
+	for (unsigned int t = first; t < first + TRANSFORM_GROUP_SIZE; t++)
+	{
+		if (hierarchyIndices[t] != TRANSFORM_NO_PARENT)
+			inHierarchy = true;
+	}
+
+	if (inHierarchy)
+		UpdateWorldMatrices();
+	else if (dirty[transform])
+		UpdateGroups(transform / TRANSFORM_GROUP_SIZE, transform / TRANSFORM_GROUP_SIZE + 1);
+}
+
+// --------------------------------------------------------
+// Lists every transform with a parent or children in depth
+// first order, so every subtree is one run of the list
+//
+// - Each transform's children are bucketed together first
+//    (with a prefix sum of how many each has), so the walk
+//    down from each root doesn't have to search for them
+// - Children always come after their parents, so a subtree
+//    ends where the last of its children's subtrees does
+// --------------------------------------------------------
+void TransformStore::BuildHierarchy()
+{
+	hierarchyChanged = false;
+	hierarchyTransforms.clear();
+	hierarchyParents.clear();
+	std::fill(hierarchyIndices.begin(), hierarchyIndices.end(), TRANSFORM_NO_PARENT);
+
+	std::vector<unsigned int> childStarts(count + 1, 0);
+	for (unsigned int t = 0; t < count; t++)
+	{
+		if (parents[t] != TRANSFORM_NO_PARENT)
+			childStarts[parents[t] + 1]++;
+	}
+	for (unsigned int t = 0; t < count; t++)
+		childStarts[t + 1] += childStarts[t];
+	std::vector<unsigned int> children(childStarts[count]);
+	std::vector<unsigned int> cursors(childStarts.begin(), childStarts.end() - 1);
+	for (unsigned int t = 0; t < count; t++)
+	{
+		if (parents[t] != TRANSFORM_NO_PARENT)
+			children[cursors[parents[t]]++] = t;
+	}
+
+	std::vector<unsigned int> stack;
+	for (unsigned int root = 0; root < count; root++)
+	{
+		if (parents[root] != TRANSFORM_NO_PARENT || childStarts[root] == childStarts[root + 1])
+			continue;
+
+		stack.push_back(root);
+		while (!stack.empty())
+		{
+			unsigned int transform = stack.back();
+			stack.pop_back();
+			hierarchyIndices[transform] = (unsigned int)hierarchyTransforms.size();
+			hierarchyTransforms.push_back(transform);
+			hierarchyParents.push_back(parents[transform] == TRANSFORM_NO_PARENT ? TRANSFORM_NO_PARENT : hierarchyIndices[parents[transform]]);
+
+			// Pushed backwards, so the first child comes off the stack first
+			for (unsigned int c = childStarts[transform + 1]; c > childStarts[transform]; c--)
+				stack.push_back(children[c - 1]);
+		}
+	}
+
+	unsigned int nodeCount = (unsigned int)hierarchyTransforms.size();
+	subtreeEnds.resize(nodeCount);
+	for (unsigned int k = 0; k < nodeCount; k++)
+		subtreeEnds[k] = k + 1;
+	for (unsigned int k = nodeCount; k-- > 0;)
+	{
+		unsigned int parent = hierarchyParents[k];
+		if (parent != TRANSFORM_NO_PARENT)
+			subtreeEnds[parent] = (std::max)(subtreeEnds[parent], subtreeEnds[k]);
+	}
+}
+
+// --------------------------------------------------------
+// Finds the subtrees that need their world matrices redone,
+// and marks everything in them changed
+//
+// - Only the journal is searched for dirty transforms, so a
+//    big hierarchy that's mostly still costs next to nothing
+// - Subtrees inside another dirty subtree are dropped, which
+//    leaves runs that don't overlap, and don't depend on each
+//    other (their tops' parents are all up to date already)
+// --------------------------------------------------------
+void TransformStore::MarkDirtySubtrees()
+{
+	dirtySubtrees.clear();
+	if (hierarchyTransforms.empty())
+		return;
+
+	for (size_t i = 0; i < journal.size(); i++)
+	{
+		unsigned int transform = journal[i];
+		if (dirty[transform] && hierarchyIndices[transform] != TRANSFORM_NO_PARENT)
+			dirtySubtrees.push_back(hierarchyIndices[transform]);
+	}
+	std::sort(dirtySubtrees.begin(), dirtySubtrees.end());
+
+	unsigned int kept = 0;
+	unsigned int coveredEnd = 0;
+	for (size_t i = 0; i < dirtySubtrees.size(); i++)
+	{
+		unsigned int first = dirtySubtrees[i];
+		if (first < coveredEnd)
+			continue;
+
+		dirtySubtrees[kept++] = first;
+		coveredEnd = subtreeEnds[first];
+		for (unsigned int k = first + 1; k < coveredEnd; k++)
+			MarkChanged(hierarchyTransforms[k]);
+	}
+	dirtySubtrees.resize(kept);
+}
+
+// --------------------------------------------------------
+// Multiplies the dirty subtrees' matrices by their parents',
+// across up to "threadCount" threads
+//
+// - Separate subtrees go to separate threads, and big ones are
+//    split into their children's subtrees (once their top is
+//    done, which is all they depend on) until there are enough
+//    pieces to keep every thread busy
+// - Pieces are dealt out biggest first, in turn, and a long
+//    chain with nothing to split off just runs on one thread
+// --------------------------------------------------------
+void TransformStore::PropagateSubtrees(unsigned int threadCount)
+{
+	unsigned int total = 0;
+	for (size_t i = 0; i < dirtySubtrees.size(); i++)
+		total += subtreeEnds[dirtySubtrees[i]] - dirtySubtrees[i];
+
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+	unsigned int maxThreads = total / TRANSFORM_MIN_PER_THREAD;
+	if (threadCount > maxThreads) threadCount = maxThreads;
+	if (threadCount <= 1)
+	{
+		for (size_t i = 0; i < dirtySubtrees.size(); i++)
+			PropagateRange(dirtySubtrees[i], subtreeEnds[dirtySubtrees[i]]);
+		return;
+	}
+
+	unsigned int pieceSize = total / (threadCount * 4);
+	std::vector<unsigned int> pending(dirtySubtrees);
+	std::vector<unsigned int> pieces;
+	while (!pending.empty())
+	{
+		unsigned int first = pending.back();
+		pending.pop_back();
+		if (subtreeEnds[first] - first <= pieceSize)
+		{
+			pieces.push_back(first);
+			continue;
+		}
+
+		PropagateRange(first, first + 1);
+		for (unsigned int child = first + 1; child < subtreeEnds[first]; child = subtreeEnds[child])
+			pending.push_back(child);
+	}
+	std::sort(pieces.begin(), pieces.end(), [&](unsigned int a, unsigned int b)
+	{
+		return subtreeEnds[a] - a > subtreeEnds[b] - b;
+	});
+
+	std::vector<std::thread> workers;
+	workers.reserve(threadCount);
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		workers.push_back(std::thread([&, i]()
+		{
+			for (size_t p = i; p < pieces.size(); p += threadCount)
+				PropagateRange(pieces[p], subtreeEnds[pieces[p]]);
+		}));
+	}
+	for (auto& worker : workers) worker.join();
+}
+
+void TransformStore::PropagateRange(unsigned int first, unsigned int end)
+{
+	// Parents always come first, so theirs are already done (and the matrices
+	// are transposed, so the parent's goes on the left)
+	for (unsigned int k = first; k < end; k++)
+	{
+		unsigned int parent = hierarchyParents[k];
+		if (parent == TRANSFORM_NO_PARENT)
+			continue;
+
+		XMFLOAT4X4& world = worldMatrices[hierarchyTransforms[k]];
+		XMStoreFloat4x4(&world, XMMatrixMultiply(XMLoadFloat4x4(&worldMatrices[hierarchyTransforms[parent]]), XMLoadFloat4x4(&world)));
+	}
+}
+
+// --------------------------------------------------------
+// Builds the world matrices of a range of groups
+//
+// - Each vector holds one value for each of the group's four
+//    transforms, so the whole matrix is worked out with four
+//    wide math, without building the translation, rotation
+//    and scale matrices separately:
+//     rotation   = roll (Z), then pitch (X), then yaw (Y)
+//     world      = rotation's rows, each column scaled
+//     last row   = position * rotation, scaled the same way
+// - Each column of the world matrix (a row once it's stored
+//    transposed) is then turned from four values of one
+//    element into four matrices' rows, with a 4x4 transpose
+// - Groups with nothing dirty are skipped
+// --------------------------------------------------------
+void TransformStore::UpdateGroups(unsigned int firstGroup, unsigned int endGroup)
+{
+	XMVECTOR lastRow = XMVectorSet(0, 0, 0, 1);
+	for (unsigned int g = firstGroup; g < endGroup; g++)
+	{
+		unsigned int first = g * TRANSFORM_GROUP_SIZE;
+		unsigned int flags;
+		memcpy(&flags, &dirty[first], sizeof(flags));
+		if (flags == 0)
+			continue;
+		memset(&dirty[first], 0, TRANSFORM_GROUP_SIZE);
+
+		XMVECTOR sinPitch, cosPitch, sinYaw, cosYaw, sinRoll, cosRoll;
+		XMVectorSinCos(&sinPitch, &cosPitch, XMLoadFloat4((const XMFLOAT4*)&rotationX[first]));
+		XMVectorSinCos(&sinYaw, &cosYaw, XMLoadFloat4((const XMFLOAT4*)&rotationY[first]));
+		XMVectorSinCos(&sinRoll, &cosRoll, XMLoadFloat4((const XMFLOAT4*)&rotationZ[first]));
+
+		// The rotation matrix, one element per vector
+		XMVECTOR sinRollSinPitch = XMVectorMultiply(sinRoll, sinPitch);
+		XMVECTOR cosRollSinPitch = XMVectorMultiply(cosRoll, sinPitch);
+		XMVECTOR r[3][3];
+		r[0][0] = XMVectorMultiplyAdd(cosRoll, cosYaw, XMVectorMultiply(sinRollSinPitch, sinYaw));
+		r[0][1] = XMVectorMultiply(sinRoll, cosPitch);
+		r[0][2] = XMVectorNegativeMultiplySubtract(cosRoll, sinYaw, XMVectorMultiply(sinRollSinPitch, cosYaw));
+		r[1][0] = XMVectorNegativeMultiplySubtract(sinRoll, cosYaw, XMVectorMultiply(cosRollSinPitch, sinYaw));
+		r[1][1] = XMVectorMultiply(cosRoll, cosPitch);
+		r[1][2] = XMVectorMultiplyAdd(sinRoll, sinYaw, XMVectorMultiply(cosRollSinPitch, cosYaw));
+		r[2][0] = XMVectorMultiply(cosPitch, sinYaw);
+		r[2][1] = XMVectorNegate(sinPitch);
+		r[2][2] = XMVectorMultiply(cosPitch, cosYaw);
+
+		XMVECTOR position[3] =
+		{
+			XMLoadFloat4((const XMFLOAT4*)&positionX[first]),
+			XMLoadFloat4((const XMFLOAT4*)&positionY[first]),
+			XMLoadFloat4((const XMFLOAT4*)&positionZ[first]),
+		};
+		XMVECTOR scale[3] =
+		{
+			XMLoadFloat4((const XMFLOAT4*)&scaleX[first]),
+			XMLoadFloat4((const XMFLOAT4*)&scaleY[first]),
+			XMLoadFloat4((const XMFLOAT4*)&scaleZ[first]),
+		};
+
+		for (int column = 0; column < 3; column++)
+		{
+			XMVECTOR translation = XMVectorMultiplyAdd(position[0], r[0][column],
+				XMVectorMultiplyAdd(position[1], r[1][column], XMVectorMultiply(position[2], r[2][column])));
+			XMMATRIX rows = XMMatrixTranspose(XMMATRIX(
+				XMVectorMultiply(r[0][column], scale[column]),
+				XMVectorMultiply(r[1][column], scale[column]),
+				XMVectorMultiply(r[2][column], scale[column]),
+				XMVectorMultiply(translation, scale[column])));
+			for (unsigned int t = 0; t < TRANSFORM_GROUP_SIZE; t++)
+				XMStoreFloat4((XMFLOAT4*)worldMatrices[first + t].m[column], rows.r[t]);
+		}
+		for (unsigned int t = 0; t < TRANSFORM_GROUP_SIZE; t++)
+			XMStoreFloat4((XMFLOAT4*)worldMatrices[first + t].m[3], lastRow);
+	}
+}
+
+// --------------------------------------------------------
+// One entity's transform, laid out the way GameEntity used
+// to keep it, for the benchmark to compare against
+// --------------------------------------------------------
+struct EntityTransform
+{
+	XMFLOAT4X4 WorldMatrix;
+	XMFLOAT3 Position;
+	XMFLOAT3 Rotation;
+	XMFLOAT3 Scale;
+	XMFLOAT3 LastPosition;
+	XMFLOAT3 LastRotation;
+	XMFLOAT3 LastScale;
+
+	// Stand-ins for the mesh handle, material list and flags in between
+	void* Other[6];
+};
+
+// The world matrix, the way GameEntity::CalculateWorldMatrix() used to build it
+static void CalculateEntityWorldMatrix(EntityTransform& entity)
+{
+	if (entity.LastPosition.x == entity.Position.x && entity.LastPosition.y == entity.Position.y && entity.LastPosition.z == entity.Position.z
+		&& entity.LastRotation.x == entity.Rotation.x && entity.LastRotation.y == entity.Rotation.y && entity.LastRotation.z == entity.Rotation.z
+		&& entity.LastScale.x == entity.Scale.x && entity.LastScale.y == entity.Scale.y && entity.LastScale.z == entity.Scale.z)
+		return;
+
+	XMMATRIX translationMat = XMMatrixTranslationFromVector(XMLoadFloat3(&entity.Position));
+	XMMATRIX rotationMat = XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&entity.Rotation));
+	XMMATRIX scaleMat = XMMatrixScalingFromVector(XMLoadFloat3(&entity.Scale));
+	XMMATRIX worldMat = XMMatrixIdentity() * translationMat * rotationMat * scaleMat;
+	XMStoreFloat4x4(&entity.WorldMatrix, XMMatrixTranspose(worldMat));
+
+	entity.LastPosition = entity.Position;
+	entity.LastRotation = entity.Rotation;
+	entity.LastScale = entity.Scale;
+}
+
+// --------------------------------------------------------
+// Moves every transform, then updates every world matrix,
+// both ways
+//
+// - Every transform starts somewhere random, and moves every
+//    frame, so every matrix is rebuilt every time (the worst
+//    case, and what a scene full of moving things looks like)
+// - The store is timed on one thread, so the kernel can be
+//    compared with the old way directly, and then on every
+//    core
+// - The matrices from both ways are checked against each other
+// --------------------------------------------------------
+void BenchmarkTransforms()
+{
+	const int frames = 5;
+	static const unsigned int counts[] = { 10000, 100000, 1000000 };
+
+	printf("\nWorld matrices (best of %d frames):", frames);
+	for (unsigned int c = 0; c < 3; c++)
+	{
+		unsigned int count = counts[c];
+		std::vector<EntityTransform> entities(count);
+		TransformStore store;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			EntityTransform& entity = entities[i];
+			memset(&entity, 0, sizeof(entity));
+			entity.Position = XMFLOAT3((float)(i % 100), (float)(i / 100 % 100), (float)(i / 10000));
+			entity.Rotation = XMFLOAT3(0.001f * i, 0.002f * i, 0.003f * i);
+			entity.Scale = XMFLOAT3(1.0f + 0.5f * sinf((float)i), 1.0f, 1.0f + 0.25f * cosf((float)i));
+
+			unsigned int transform = store.Add();
+			store.SetPosition(transform, entity.Position);
+			store.SetRotation(transform, entity.Rotation);
+			store.SetScale(transform, entity.Scale);
+		}
+
+		double entitySeconds = 1e30;
+		double storeSeconds = 1e30;
+		double threadedSeconds = 1e30;
+		for (int f = 0; f < frames; f++)
+		{
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			for (unsigned int i = 0; i < count; i++)
+			{
+				entities[i].Position.y += 0.01f;
+				CalculateEntityWorldMatrix(entities[i]);
+			}
+			double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			entitySeconds = seconds < entitySeconds ? seconds : entitySeconds;
+
+			start = std::chrono::high_resolution_clock::now();
+			for (unsigned int i = 0; i < count; i++)
+				store.Move(i, 0, 0.01f, 0);
+			store.UpdateWorldMatrices(1);
+			seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			storeSeconds = seconds < storeSeconds ? seconds : storeSeconds;
+		}
+		for (int f = 0; f < frames; f++)
+		{
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			for (unsigned int i = 0; i < count; i++)
+				store.Move(i, 0, 0.01f, 0);
+			store.UpdateWorldMatrices(0);
+			double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			threadedSeconds = seconds < threadedSeconds ? seconds : threadedSeconds;
+
+			// Keep the entities where the store is
+			for (unsigned int i = 0; i < count; i++)
+			{
+				entities[i].Position.y += 0.01f;
+				CalculateEntityWorldMatrix(entities[i]);
+			}
+		}
+
+		float maxError = 0.0f;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			const XMFLOAT4X4& a = entities[i].WorldMatrix;
+			const XMFLOAT4X4& b = store.GetWorldMatrix(i);
+			for (int e = 0; e < 16; e++)
+				maxError = fmaxf(maxError, fabsf((&a._11)[e] - (&b._11)[e]));
+		}
+
+		printf("\n  %u: one at a time %.3f ms, batched %.3f ms (%.1fx), batched on every core %.3f ms (%.1fx), max difference %g",
+			count, entitySeconds * 1000.0,
+			storeSeconds * 1000.0, storeSeconds > 0 ? entitySeconds / storeSeconds : 0.0,
+			threadedSeconds * 1000.0, threadedSeconds > 0 ? entitySeconds / threadedSeconds : 0.0,
+			maxError);
+	}
+}
+
+// --------------------------------------------------------
+// Hangs transforms in two shapes of hierarchy, and times
+// updating them when a few move, and when they all do
+//
+// - "Deep chains" hang each transform off the one before it,
+//    and "wide trees" hang them all straight off a few roots
+// - A sparse frame moves 1% of the transforms, picked at
+//    random, so only the subtrees under those are redone (which
+//    in a deep chain is still most of it)
+// - A sample of the world matrices are checked against
+//    multiplying out each one's own matrix and its ancestors'
+// --------------------------------------------------------
+void BenchmarkHierarchy()
+{
+	const int frames = 5;
+	const unsigned int count = 100000;
+	const unsigned int treeSize = 10000;
+	static const char* shapes[] = { "deep chains", "wide trees" };
+
+	printf("\nTransform hierarchy, %u transforms in trees of %u (best of %d frames):", count, treeSize, frames);
+	for (int shape = 0; shape < 2; shape++)
+	{
+		TransformStore store;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			unsigned int transform = store.Add();
+			store.SetPosition(transform, XMFLOAT3(0.01f * (i % 7), 0.1f, 0.0f));
+			store.SetRotation(transform, XMFLOAT3(0.001f, 0.002f * (i % 5), 0.0f));
+			if (i % treeSize != 0)
+				store.SetParent(transform, shape == 0 ? i - 1 : i - i % treeSize);
+		}
+		store.UpdateWorldMatrices();
+		store.ClearChanges();
+
+		std::mt19937 random(1234);
+		std::uniform_int_distribution<unsigned int> pick(0, count - 1);
+		double sparseSeconds = 1e30;
+		double allSeconds = 1e30;
+		double threadedSeconds = 1e30;
+		size_t sparseRedone = 0;
+		for (int f = 0; f < frames; f++)
+		{
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			for (unsigned int i = 0; i < count / 100; i++)
+				store.Move(pick(random), 0, 0.01f, 0);
+			store.UpdateWorldMatrices(1);
+			double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			sparseSeconds = seconds < sparseSeconds ? seconds : sparseSeconds;
+			sparseRedone = store.GetChanges().size();
+			store.ClearChanges();
+
+			start = std::chrono::high_resolution_clock::now();
+			for (unsigned int i = 0; i < count; i++)
+				store.Move(i, 0, 0.01f, 0);
+			store.UpdateWorldMatrices(1);
+			seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			allSeconds = seconds < allSeconds ? seconds : allSeconds;
+			store.ClearChanges();
+
+			start = std::chrono::high_resolution_clock::now();
+			for (unsigned int i = 0; i < count; i++)
+				store.Move(i, 0, 0.01f, 0);
+			store.UpdateWorldMatrices(0);
+			seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			threadedSeconds = seconds < threadedSeconds ? seconds : threadedSeconds;
+			store.ClearChanges();
+		}
+
+		// Relative to the size of each value, since positions a long way down a chain get big
+		// (and rounding builds up down a long chain either way, so expect more difference there)
+		float maxError = 0.0f;
+		for (unsigned int i = 0; i < count; i += 97)
+		{
+			XMMATRIX world = XMMatrixIdentity();
+			for (unsigned int t = i; t != TRANSFORM_NO_PARENT; t = store.GetParent(t))
+			{
+				XMFLOAT3 position = store.GetPosition(t);
+				XMFLOAT3 rotation = store.GetRotation(t);
+				XMFLOAT3 scale = store.GetScale(t);
+				world = world * XMMatrixTranslationFromVector(XMLoadFloat3(&position))
+					* XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&rotation))
+					* XMMatrixScalingFromVector(XMLoadFloat3(&scale));
+			}
+			XMFLOAT4X4 expected;
+			XMStoreFloat4x4(&expected, XMMatrixTranspose(world));
+			const XMFLOAT4X4& actual = store.GetWorldMatrix(i);
+			for (int e = 0; e < 16; e++)
+				maxError = fmaxf(maxError, fabsf((&expected._11)[e] - (&actual._11)[e]) / fmaxf(1.0f, fabsf((&expected._11)[e])));
+		}
+
+		printf("\n  %s: 1%% moved %.3f ms (%u redone), all moved %.3f ms, all moved on every core %.3f ms, max relative difference %g",
+			shapes[shape], sparseSeconds * 1000.0, (unsigned int)sparseRedone, allSeconds * 1000.0, threadedSeconds * 1000.0, maxError);
+	}
+}
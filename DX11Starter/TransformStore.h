@@ -0,0 +1,160 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+// How many transforms are worked on at once (one per vector lane)
+const unsigned int TRANSFORM_GROUP_SIZE = 4;
+
+// The fewest transforms worth giving a thread of their own when updating world matrices
+const unsigned int TRANSFORM_MIN_PER_THREAD = 16384;
+
+// Marks a transform with no parent (or one that isn't part of the hierarchy at all)
+const unsigned int TRANSFORM_NO_PARENT = 0xFFFFFFFF;
+
+// --------------------------------------------------------
+// The positions, rotations and scales of every entity, and
+// the world matrices made from them
+//
+// - Each component of each is in its own array, so the world
+//    matrix kernel loads four entities' worth of a component
+//    straight into one vector, and works out four matrices at
+//    once from them
+// - Transforms are identified by the handle Add() returns
+// - Changing a transform marks it dirty, and its matrix isn't
+//    updated until UpdateWorldMatrices() (or UpdateWorldMatrix())
+// - Changing a transform also bumps its version, so anything
+//    worked out from it can be kept until the version moves on,
+//    and lists it in the change journal, so work that has to
+//    follow every change can go through just the ones that did
+// - World matrices are stored transposed, ready for HLSL, and
+//    are built the way GameEntity always has: translation, then
+//    rotation (roll, pitch, yaw), then scale
+// - A transform can have a parent, which makes its position,
+//    rotation and scale relative to the parent's. Transforms
+//    with a parent or children are also listed in depth first
+//    order, so each subtree is one run of that list, and only
+//    the subtrees under something that changed are redone
+// --------------------------------------------------------
+class TransformStore
+{
+public:
+	TransformStore();
+
+	// Adds a transform with no translation or rotation, and a scale of 1
+	unsigned int Add();
+	unsigned int GetCount() { return count; }
+
+	// Get and set accessors for each part of a transform
+	DirectX::XMFLOAT3 GetPosition(unsigned int transform) { return DirectX::XMFLOAT3(positionX[transform], positionY[transform], positionZ[transform]); }
+	DirectX::XMFLOAT3 GetRotation(unsigned int transform) { return DirectX::XMFLOAT3(rotationX[transform], rotationY[transform], rotationZ[transform]); }
+	DirectX::XMFLOAT3 GetScale(unsigned int transform) { return DirectX::XMFLOAT3(scaleX[transform], scaleY[transform], scaleZ[transform]); }
+	void SetPosition(unsigned int transform, DirectX::XMFLOAT3 position);
+	void SetRotation(unsigned int transform, DirectX::XMFLOAT3 rotation);
+	void SetScale(unsigned int transform, DirectX::XMFLOAT3 scale);
+
+	// Adds to the position or rotation, or multiplies the scale
+	void Move(unsigned int transform, float x, float y, float z);
+	void Rotate(unsigned int transform, float x, float y, float z);
+	void Scale(unsigned int transform, float x, float y, float z);
+
+	// Attaches the transform to "parent" (or detaches it, with TRANSFORM_NO_PARENT), keeping its position,
+	// rotation and scale, which are from then on relative to the parent's
+	// Returns false, and changes nothing, if "parent" is the transform itself or one of its descendants
+	bool SetParent(unsigned int transform, unsigned int parent);
+	unsigned int GetParent(unsigned int transform) { return parents[transform]; }
+
+	// Whether the transform has changed since its world matrix was last updated
+	bool IsDirty(unsigned int transform) { return dirty[transform] != 0; }
+
+	// Goes up every time the transform changes, or its parent (or theirs, and so on) does (new transforms start at 1)
+	unsigned int GetVersion(unsigned int transform) { return versions[transform]; }
+
+	// Every transform that's changed since the last ClearChanges(), each listed once, in the order they first changed
+	const std::vector<unsigned int>& GetChanges() { return journal; }
+
+	// Starts a new journal, once everything that reads it is done (usually at the end of the frame)
+	// (transforms whose world matrices still haven't been updated stay in it)
+	void ClearChanges();
+
+	// The world matrix, as of the last update
+	const DirectX::XMFLOAT4X4& GetWorldMatrix(unsigned int transform) { return worldMatrices[transform]; }
+
+	// Updates the world matrix of every dirty transform, and everything under them, across up to
+	// "threadCount" threads (0 picks one per CPU core, though small stores always use just the one,
+	// and when only a few have changed, just the journal's groups are updated)
+	void UpdateWorldMatrices(unsigned int threadCount = 1);
+
+	// Updates just one transform's world matrix (along with the rest of its group, if they're dirty too)
+	// (transforms in the hierarchy, or grouped with one, update everything instead)
+	void UpdateWorldMatrix(unsigned int transform);
+
+private:
+	// Each component, with the arrays padded out to a whole number of groups
+	std::vector<float> positionX;
+	std::vector<float> positionY;
+	std::vector<float> positionZ;
+	std::vector<float> rotationX;
+	std::vector<float> rotationY;
+	std::vector<float> rotationZ;
+	std::vector<float> scaleX;
+	std::vector<float> scaleY;
+	std::vector<float> scaleZ;
+
+	// Whether each transform has changed (one byte each, so a group's flags can be checked at once)
+	std::vector<unsigned char> dirty;
+
+	// How many times each transform has changed
+	std::vector<unsigned int> versions;
+
+	// The transforms that have changed this frame, and whether each one is in there already
+	std::vector<unsigned int> journal;
+	std::vector<unsigned char> journaled;
+
+	std::vector<DirectX::XMFLOAT4X4> worldMatrices;
+	unsigned int count;
+
+	// Each transform's parent, and where it is in the hierarchy (TRANSFORM_NO_PARENT if it isn't)
+	std::vector<unsigned int> parents;
+	std::vector<unsigned int> hierarchyIndices;
+
+	// Every transform with a parent or children, in depth first order: the transform,
+	// where its parent is in the list, and the end of its subtree (which starts with it)
+	std::vector<unsigned int> hierarchyTransforms;
+	std::vector<unsigned int> hierarchyParents;
+	std::vector<unsigned int> subtreeEnds;
+	bool hierarchyChanged;
+
+	// Where each subtree that needs its world matrices redone starts, this update
+	std::vector<unsigned int> dirtySubtrees;
+
+	// Helper method that runs the kernel on the dirty groups in a range
+	void UpdateGroups(unsigned int firstGroup, unsigned int endGroup);
+
+	// Helper methods for the hierarchy: listing it in depth first order, marking everything under
+	// a changed transform changed too, and multiplying the world matrices down the dirty subtrees
+	void BuildHierarchy();
+	void MarkDirtySubtrees();
+	void PropagateSubtrees(unsigned int threadCount);
+	void PropagateRange(unsigned int first, unsigned int end);
+
+	// Helper method that marks a transform dirty, bumps its version and journals it
+	void MarkChanged(unsigned int transform)
+	{
+		dirty[transform] = 1;
+		versions[transform]++;
+		if (!journaled[transform])
+		{
+			journaled[transform] = 1;
+			journal.push_back(transform);
+		}
+	}
+};
+
+// Times updating the world matrices of 10k, 100k and 1M moving transforms in a TransformStore,
+// against doing it one entity at a time the way GameEntity used to, and prints the results
+void BenchmarkTransforms();
+
+// Times updating 100k transforms hung in deep chains and in wide trees, when 1% of them move and when they
+// all do, checking the results against multiplying out each one's ancestors, and prints the results
+void BenchmarkHierarchy();
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include <DirectXPackedVector.h>
 
 // --------------------------------------------------------
 // A custom vertex definition
@@ -12,4 +13,59 @@ struct Vertex
 	DirectX::XMFLOAT3 Position;	    // The position of the vertex
 	DirectX::XMFLOAT3 Normal;       // The normal of the vertex
 	DirectX::XMFLOAT2 UV;           // The uv of the vertex
-};
\ No newline at end of file
+};
+
+// --------------------------------------------------------
+// A compact, 16 byte version of Vertex
+//
+// - Position is stored as 16 bit fractions of the way across
+//    the mesh's bounding box (which the shader scales back up)
+// - Normal is octahedral encoded: the unit sphere is folded
+//    flat onto a square, so two numbers are enough
+// - UV is stored as half floats
+// --------------------------------------------------------
+struct PackedVertex
+{
+	unsigned short Position[4];				// XYZ (UNORM, relative to the bounds), W unused
+	short Normal[2];						// Octahedral normal (SNORM)
+	DirectX::PackedVector::HALF UV[2];		// Half float UV
+};
+
+// --------------------------------------------------------
+// The vertex layouts a Mesh can keep its vertices in
+// --------------------------------------------------------
+enum VertexFormat
+{
+	VERTEX_FORMAT_FULL,		// Vertex
+	VERTEX_FORMAT_PACKED	// PackedVertex
+};
+
+// The size of one vertex in the given format
+constexpr unsigned int GetVertexStride(VertexFormat format)
+{
+	return format == VERTEX_FORMAT_PACKED ? sizeof(PackedVertex) : sizeof(Vertex);
+}
+
+// --------------------------------------------------------
+// The separate vertex buffers (input slots) a vertex is
+// split across on the GPU
+//
+// - Position comes first in both formats, so each stream is
+//    just a run of bytes from the interleaved vertex
+// - A depth-only or shadow pass can bind the position stream
+//    by itself, without fetching normals and uvs it never uses
+// --------------------------------------------------------
+enum VertexStream
+{
+	VERTEX_STREAM_POSITION,		// Position only
+	VERTEX_STREAM_ATTRIBUTES,	// Normal and uv
+	VERTEX_STREAM_COUNT
+};
+
+// The size of one vertex's worth of the given stream
+constexpr unsigned int GetVertexStreamStride(VertexFormat format, VertexStream stream)
+{
+	return stream == VERTEX_STREAM_POSITION ?
+		(format == VERTEX_FORMAT_PACKED ? sizeof(PackedVertex::Position) : sizeof(Vertex::Position)) :
+		GetVertexStride(format) - (format == VERTEX_FORMAT_PACKED ? sizeof(PackedVertex::Position) : sizeof(Vertex::Position));
+}
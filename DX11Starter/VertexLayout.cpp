@@ -0,0 +1,6 @@
+#include "VertexLayout.h"
+
+// The attribute tables need a definition somewhere, for anything
+// that reads them at runtime rather than at compile time
+constexpr VertexAttribute VertexTraits<Vertex>::Attributes[];
+constexpr VertexAttribute VertexTraits<PackedVertex>::Attributes[];
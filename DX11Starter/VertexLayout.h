@@ -0,0 +1,198 @@
+#pragma once
+
+#include <d3d11.h>
+#include <cstddef>
+#include <array>
+#include <utility>
+#include "Vertex.h"
+#include "VertexStreams.h"
+
+// --------------------------------------------------------
+// One member of a vertex struct, as the input assembler
+// should read it
+// --------------------------------------------------------
+struct VertexAttribute
+{
+	const char* SemanticName;	// Must match the vertex shader's input
+	unsigned int SemanticIndex;
+	DXGI_FORMAT Format;			// How the member is stored
+	VertexStream Stream;		// Which vertex buffer it's split into
+	unsigned int Offset;		// offsetof() the member
+	unsigned int Size;			// sizeof() the member
+};
+
+// --------------------------------------------------------
+// Describes a vertex struct at compile time
+//
+// - Specialize this for each vertex type a Mesh can hold,
+//    giving its VertexFormat and an Attributes array with
+//    every member, in the order they're declared
+// - VertexLayout<> below turns that into the input layout
+//    and strides, and the static_asserts at the bottom of
+//    this file check it against the struct itself
+// --------------------------------------------------------
+template<typename VertexT> struct VertexTraits;
+
+template<> struct VertexTraits<Vertex>
+{
+	static constexpr VertexFormat Format = VERTEX_FORMAT_FULL;
+	static constexpr VertexAttribute Attributes[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, VERTEX_STREAM_POSITION, offsetof(Vertex, Position), sizeof(Vertex::Position) },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, VERTEX_STREAM_ATTRIBUTES, offsetof(Vertex, Normal), sizeof(Vertex::Normal) },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, VERTEX_STREAM_ATTRIBUTES, offsetof(Vertex, UV), sizeof(Vertex::UV) },
+	};
+};
+
+template<> struct VertexTraits<PackedVertex>
+{
+	static constexpr VertexFormat Format = VERTEX_FORMAT_PACKED;
+	static constexpr VertexAttribute Attributes[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, VERTEX_STREAM_POSITION, offsetof(PackedVertex, Position), sizeof(PackedVertex::Position) },
+		{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, VERTEX_STREAM_ATTRIBUTES, offsetof(PackedVertex, Normal), sizeof(PackedVertex::Normal) },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, VERTEX_STREAM_ATTRIBUTES, offsetof(PackedVertex, UV), sizeof(PackedVertex::UV) },
+	};
+};
+
+// How many attributes a vertex type has
+template<typename VertexT>
+constexpr unsigned int GetVertexAttributeCount()
+{
+	return sizeof(VertexTraits<VertexT>::Attributes) / sizeof(VertexAttribute);
+}
+
+// --------------------------------------------------------
+// Works out where an attribute starts within its stream
+//
+// - Each stream holds its attributes back to back, in the
+//    order they're listed (see SplitVertexStreams())
+// --------------------------------------------------------
+template<typename VertexT>
+constexpr unsigned int GetVertexAttributeStreamOffset(unsigned int attribute)
+{
+	unsigned int offset = 0;
+	for (unsigned int i = 0; i < attribute; i++)
+	{
+		if (VertexTraits<VertexT>::Attributes[i].Stream == VertexTraits<VertexT>::Attributes[attribute].Stream)
+			offset += VertexTraits<VertexT>::Attributes[i].Size;
+	}
+	return offset;
+}
+
+// The size of one vertex's worth of a stream
+template<typename VertexT>
+constexpr unsigned int GetVertexLayoutStreamStride(VertexStream stream)
+{
+	unsigned int stride = 0;
+	for (unsigned int i = 0; i < GetVertexAttributeCount<VertexT>(); i++)
+	{
+		if (VertexTraits<VertexT>::Attributes[i].Stream == stream)
+			stride += VertexTraits<VertexT>::Attributes[i].Size;
+	}
+	return stride;
+}
+
+// --------------------------------------------------------
+// Checks a vertex type's attributes against its struct
+//
+// - Every member is listed, in order, with nothing between
+//    them, so each stream is one run of bytes of the struct
+// - Each member is exactly as big as its DXGI format says
+// - The streams come in VertexStream order, and add up to
+//    the strides its VertexFormat is stored with
+// --------------------------------------------------------
+template<typename VertexT>
+constexpr bool CheckVertexLayout()
+{
+	const VertexAttribute* attributes = VertexTraits<VertexT>::Attributes;
+	unsigned int end = 0;
+	for (unsigned int i = 0; i < GetVertexAttributeCount<VertexT>(); i++)
+	{
+		if (attributes[i].Offset != end ||
+			attributes[i].Size != GetVertexElementBytes(attributes[i].Format) ||
+			(i > 0 && attributes[i].Stream < attributes[i - 1].Stream))
+			return false;
+		end += attributes[i].Size;
+	}
+
+	VertexFormat format = VertexTraits<VertexT>::Format;
+	if (end != sizeof(VertexT) || sizeof(VertexT) != GetVertexStride(format))
+		return false;
+	for (int s = 0; s < VERTEX_STREAM_COUNT; s++)
+	{
+		if (GetVertexLayoutStreamStride<VertexT>((VertexStream)s) != GetVertexStreamStride(format, (VertexStream)s))
+			return false;
+	}
+	return true;
+}
+
+// Finds a vertex type's POSITION attribute (returning the attribute count if it doesn't have one)
+template<typename VertexT>
+constexpr unsigned int FindVertexPositionAttribute()
+{
+	for (unsigned int i = 0; i < GetVertexAttributeCount<VertexT>(); i++)
+	{
+		const char* name = VertexTraits<VertexT>::Attributes[i].SemanticName;
+		const char* position = "POSITION";
+		while (*name && *name == *position) { name++; position++; }
+		if (*name == *position)
+			return i;
+	}
+	return GetVertexAttributeCount<VertexT>();
+}
+
+// Builds the input element for one attribute, in its stream's slot
+template<typename VertexT>
+constexpr D3D11_INPUT_ELEMENT_DESC MakeVertexInputElement(unsigned int attribute)
+{
+	return
+	{
+		VertexTraits<VertexT>::Attributes[attribute].SemanticName,
+		VertexTraits<VertexT>::Attributes[attribute].SemanticIndex,
+		VertexTraits<VertexT>::Attributes[attribute].Format,
+		(UINT)VertexTraits<VertexT>::Attributes[attribute].Stream,
+		GetVertexAttributeStreamOffset<VertexT>(attribute),
+		D3D11_INPUT_PER_VERTEX_DATA,
+		0
+	};
+}
+
+template<typename VertexT, size_t... Attribute>
+constexpr std::array<D3D11_INPUT_ELEMENT_DESC, sizeof...(Attribute)> MakeVertexInputElements(std::index_sequence<Attribute...>)
+{
+	return {{ MakeVertexInputElement<VertexT>(Attribute)... }};
+}
+
+// --------------------------------------------------------
+// Everything the GPU needs to know about a vertex type,
+// worked out at compile time
+//
+// - Elements is the input layout to create its vertex shaders
+//    with, already spread across the vertex streams, so the
+//    shader doesn't have to be reflected to build one
+// - Element offsets come from the struct, not the shader, so
+//    the shader's inputs can be declared in any order
+// --------------------------------------------------------
+template<typename VertexT>
+struct VertexLayout
+{
+	static constexpr VertexFormat Format = VertexTraits<VertexT>::Format;
+	static constexpr unsigned int Stride = sizeof(VertexT);
+	static constexpr unsigned int ElementCount = GetVertexAttributeCount<VertexT>();
+	static constexpr std::array<D3D11_INPUT_ELEMENT_DESC, GetVertexAttributeCount<VertexT>()> Elements =
+		MakeVertexInputElements<VertexT>(std::make_index_sequence<GetVertexAttributeCount<VertexT>()>());
+
+	// Where the position is in the struct, and how it's stored
+	static constexpr unsigned int PositionOffset = VertexTraits<VertexT>::Attributes[FindVertexPositionAttribute<VertexT>()].Offset;
+	static constexpr DXGI_FORMAT PositionFormat = VertexTraits<VertexT>::Attributes[FindVertexPositionAttribute<VertexT>()].Format;
+};
+
+template<typename VertexT>
+constexpr std::array<D3D11_INPUT_ELEMENT_DESC, GetVertexAttributeCount<VertexT>()> VertexLayout<VertexT>::Elements;
+
+// Every vertex type has to describe itself correctly (see CheckVertexLayout())
+static_assert(CheckVertexLayout<Vertex>(), "VertexTraits<Vertex> doesn't match the Vertex struct");
+static_assert(CheckVertexLayout<PackedVertex>(), "VertexTraits<PackedVertex> doesn't match the PackedVertex struct");
+static_assert(FindVertexPositionAttribute<Vertex>() < GetVertexAttributeCount<Vertex>(), "Vertex has no POSITION");
+static_assert(FindVertexPositionAttribute<PackedVertex>() < GetVertexAttributeCount<PackedVertex>(), "PackedVertex has no POSITION");
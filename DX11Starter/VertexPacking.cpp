@@ -0,0 +1,151 @@
+#include "VertexPacking.h"
+#include <cmath>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+// --------------------------------------------------------
+// Small helpers for converting to and from normalized integers
+// --------------------------------------------------------
+static unsigned short ToUnorm16(float value)
+{
+	if (value < 0) value = 0;
+	if (value > 1) value = 1;
+	return (unsigned short)(value * 65535.0f + 0.5f);
+}
+
+static short ToSnorm16(float value)
+{
+	if (value < -1) value = -1;
+	if (value > 1) value = 1;
+	return (short)(value * 32767.0f + (value >= 0 ? 0.5f : -0.5f));
+}
+
+static float FromSnorm16(short value)
+{
+	// Both -32768 and -32767 mean -1
+	float f = value / 32767.0f;
+	return f < -1 ? -1 : f;
+}
+
+// --------------------------------------------------------
+// Folds a unit normal onto the octahedron and flattens it
+// into the [-1, 1] square
+// --------------------------------------------------------
+static void EncodeOctahedral(XMFLOAT3 n, float& x, float& y)
+{
+	float sum = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+	if (sum == 0)
+	{
+		x = y = 0;
+		return;
+	}
+
+	x = n.x / sum;
+	y = n.y / sum;
+
+	// Fold the bottom half over onto the corners
+	if (n.z < 0)
+	{
+		float foldedX = (1.0f - fabsf(y)) * (x >= 0 ? 1.0f : -1.0f);
+		float foldedY = (1.0f - fabsf(x)) * (y >= 0 ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+}
+
+static XMFLOAT3 DecodeOctahedral(float x, float y)
+{
+	XMFLOAT3 n(x, y, 1.0f - fabsf(x) - fabsf(y));
+
+	// Unfold the corners back onto the bottom half
+	float t = n.z < 0 ? -n.z : 0;
+	n.x += n.x >= 0 ? -t : t;
+	n.y += n.y >= 0 ? -t : t;
+
+	XMStoreFloat3(&n, XMVector3Normalize(XMLoadFloat3(&n)));
+	return n;
+}
+
+// --------------------------------------------------------
+// Packs full vertices into the compact layout
+//
+// verts     - The full vertices
+// boundsMin - The smallest corner of the mesh's bounding box
+// boundsMax - The largest corner of the mesh's bounding box
+// packed    - Where to write the packed vertices (numVerts of them)
+// --------------------------------------------------------
+void PackVertices(const Vertex* verts, unsigned int numVerts, XMFLOAT3 boundsMin, XMFLOAT3 boundsMax, PackedVertex* packed)
+{
+	// Positions become fractions of the way across the box
+	// (a flat axis just packs to zero)
+	float extent[3] = { boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z };
+	float invExtent[3];
+	for (int a = 0; a < 3; a++)
+		invExtent[a] = extent[a] > 0 ? 1.0f / extent[a] : 0;
+
+	for (unsigned int i = 0; i < numVerts; i++)
+	{
+		const Vertex& v = verts[i];
+		PackedVertex& p = packed[i];
+
+		p.Position[0] = ToUnorm16((v.Position.x - boundsMin.x) * invExtent[0]);
+		p.Position[1] = ToUnorm16((v.Position.y - boundsMin.y) * invExtent[1]);
+		p.Position[2] = ToUnorm16((v.Position.z - boundsMin.z) * invExtent[2]);
+		p.Position[3] = 0;
+
+		float x, y;
+		EncodeOctahedral(v.Normal, x, y);
+		p.Normal[0] = ToSnorm16(x);
+		p.Normal[1] = ToSnorm16(y);
+
+		p.UV[0] = XMConvertFloatToHalf(v.UV.x);
+		p.UV[1] = XMConvertFloatToHalf(v.UV.y);
+	}
+}
+
+// --------------------------------------------------------
+// Unpacks a vertex on the CPU, mirroring the shader's decode
+// --------------------------------------------------------
+Vertex UnpackVertex(const PackedVertex& packed, XMFLOAT3 boundsMin, XMFLOAT3 boundsMax)
+{
+	Vertex v;
+	v.Position.x = boundsMin.x + packed.Position[0] / 65535.0f * (boundsMax.x - boundsMin.x);
+	v.Position.y = boundsMin.y + packed.Position[1] / 65535.0f * (boundsMax.y - boundsMin.y);
+	v.Position.z = boundsMin.z + packed.Position[2] / 65535.0f * (boundsMax.z - boundsMin.z);
+	v.Normal = DecodeOctahedral(FromSnorm16(packed.Normal[0]), FromSnorm16(packed.Normal[1]));
+	v.UV.x = XMConvertHalfToFloat(packed.UV[0]);
+	v.UV.y = XMConvertHalfToFloat(packed.UV[1]);
+	return v;
+}
+
+// --------------------------------------------------------
+// Round trips every vertex through the packed layout and
+// reports the largest errors
+// --------------------------------------------------------
+PackingError MeasurePackingError(const Vertex* verts, unsigned int numVerts, XMFLOAT3 boundsMin, XMFLOAT3 boundsMax)
+{
+	PackingError error = {};
+	for (unsigned int i = 0; i < numVerts; i++)
+	{
+		PackedVertex packed;
+		PackVertices(&verts[i], 1, boundsMin, boundsMax, &packed);
+		Vertex v = UnpackVertex(packed, boundsMin, boundsMax);
+
+		XMVECTOR posDiff = XMLoadFloat3(&v.Position) - XMLoadFloat3(&verts[i].Position);
+		error.MaxPositionError = fmaxf(error.MaxPositionError, XMVectorGetX(XMVector3Length(posDiff)));
+
+		// Only meaningful for normals that were unit length to begin with
+		XMVECTOR original = XMLoadFloat3(&verts[i].Normal);
+		if (XMVectorGetX(XMVector3LengthSq(original)) > 0)
+		{
+			float cosAngle = XMVectorGetX(XMVector3Dot(XMVector3Normalize(original), XMLoadFloat3(&v.Normal)));
+			cosAngle = fminf(1.0f, fmaxf(-1.0f, cosAngle));
+			error.MaxNormalErrorDegrees = fmaxf(error.MaxNormalErrorDegrees, acosf(cosAngle) * 180.0f / XM_PI);
+		}
+
+		error.MaxUVError = fmaxf(error.MaxUVError, fabsf(v.UV.x - verts[i].UV.x));
+		error.MaxUVError = fmaxf(error.MaxUVError, fabsf(v.UV.y - verts[i].UV.y));
+	}
+	return error;
+}
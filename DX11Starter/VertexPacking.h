@@ -0,0 +1,25 @@
+#pragma once
+
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// How far vertices move when they're packed and unpacked
+// --------------------------------------------------------
+struct PackingError
+{
+	float MaxPositionError;			// Largest distance from the original position (model units)
+	float MaxNormalErrorDegrees;	// Largest angle from the original normal
+	float MaxUVError;				// Largest difference in either UV component
+};
+
+// Packs full vertices into the compact layout, quantizing positions to the given bounds
+void PackVertices(const Vertex* verts, unsigned int numVerts, DirectX::XMFLOAT3 boundsMin, DirectX::XMFLOAT3 boundsMax, PackedVertex* packed);
+
+// Turns a packed vertex back into a full one, exactly as VertexShaderPacked.hlsl does
+Vertex UnpackVertex(const PackedVertex& packed, DirectX::XMFLOAT3 boundsMin, DirectX::XMFLOAT3 boundsMax);
+
+// Packs and unpacks every vertex, reporting the worst error introduced
+PackingError MeasurePackingError(const Vertex* verts, unsigned int numVerts, DirectX::XMFLOAT3 boundsMin, DirectX::XMFLOAT3 boundsMax);
+
@@ -10,6 +10,13 @@ cbuffer externalData : register(b0)
 	matrix world;
 	matrix view;
 	matrix projection;
+
+#ifdef PACKED_VERTICES
+	// Packed positions are fractions of the mesh's bounding box,
+	// so they need to know where that box is
+	float3 positionOffset;	// The corner of the box (its minimum)
+	float3 positionScale;	// The size of the box
+#endif
 };
 
 // Struct representing a single vertex worth of data
@@ -17,6 +24,10 @@ cbuffer externalData : register(b0)
 // - By "match", I mean the size, order and number of members
 // - The name of the struct itself is unimportant, but should be descriptive
 // - Each variable must have a semantic, which defines its usage
+// - PACKED_VERTICES switches to the PackedVertex layout, where the
+//    input assembler has already turned the 16 bit values into floats
+// - POSITION is read from its own vertex buffer (input slot 0), and
+//    everything after it from a second one (slot 1), in this order
 struct VertexShaderInput
 { 
 	// Data type
@@ -24,9 +35,15 @@ struct VertexShaderInput
 	//  |   Name          Semantic
 	//  |    |                |
 	//  v    v                v
+#ifdef PACKED_VERTICES
+	float4 position		: POSITION;     // XYZ position, 0-1 across the bounds
+	float2 normal		: NORMAL;       // Octahedral normal, -1 to 1
+	float2 uv		    : TEXCOORD;     // XY texture coordinates
+#else
 	float3 position		: POSITION;     // XYZ position
 	float3 normal		: NORMAL;       // XYZ normal
 	float2 uv		    : TEXCOORD;     // XY texture coordinates
+#endif
 };
 
 // Struct representing the data we're sending down the pipeline
@@ -46,6 +63,20 @@ struct VertexToPixel
 	float2 uv		    : TEXCOORD;	    // XY uv
 };
 
+#ifdef PACKED_VERTICES
+// --------------------------------------------------------
+// Unfolds an octahedral encoded normal back into a unit vector
+// (must match DecodeOctahedral() in VertexPacking.cpp)
+// --------------------------------------------------------
+float3 DecodeOctahedral(float2 encoded)
+{
+	float3 n = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	float t = saturate(-n.z);
+	n.xy += n.xy >= 0 ? -t : t;
+	return normalize(n);
+}
+#endif
+
 // --------------------------------------------------------
 // The entry point (main method) for our vertex shader
 // 
@@ -58,6 +89,15 @@ VertexToPixel main( VertexShaderInput input )
 	// Set up output struct
 	VertexToPixel output;
 
+#ifdef PACKED_VERTICES
+	// Unpack the position and normal
+	float3 position = positionOffset + input.position.xyz * positionScale;
+	float3 normal = DecodeOctahedral(input.normal);
+#else
+	float3 position = input.position;
+	float3 normal = input.normal;
+#endif
+
 	// Set the output uv to equal the input uv coordinate
 	output.uv = input.uv;
 
@@ -75,10 +115,10 @@ VertexToPixel main( VertexShaderInput input )
 	//
 	// The result is essentially the position (XY) of the vertex on our 2D 
 	// screen and the distance (Z) from the camera (the "depth" of the pixel)
-	output.position = mul(float4(input.position, 1.0f), worldViewProj);
+	output.position = mul(float4(position, 1.0f), worldViewProj);
 
 	// Transform the normal by the world matrix, ignoring transpose
-	output.normal = mul(input.normal, (float3x3)world);
+	output.normal = mul(normal, (float3x3)world);
 
 	// Whatever we return will make its way through the pipeline to the
 	// next programmable stage we're using (the pixel shader for now)
@@ -0,0 +1,4 @@
+// The same vertex shader, compiled for meshes that use the
+// compact PackedVertex layout (see Vertex.h)
+#define PACKED_VERTICES
+#include "VertexShader.hlsl"
@@ -0,0 +1,253 @@
+#include "VertexStreams.h"
+#include "VertexLayout.h"
+#include "VertexPacking.h"
+#include "MeshOptimizer.h"
+#include "ObjLoader.h"
+#include <cstring>
+#include <cstdio>
+#include <string>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Splits interleaved vertices into separate streams
+//
+// - Each stream is a run of bytes from every vertex, in
+//    VertexStream order, so this is just a copy per stream
+//
+// vertices - The interleaved vertices, in "format"
+// streams  - Filled with one array per VertexStream
+// --------------------------------------------------------
+void SplitVertexStreams(const void* vertices, VertexFormat format, unsigned int numVerts, std::vector<char> streams[VERTEX_STREAM_COUNT])
+{
+	const char* source = (const char*)vertices;
+	unsigned int vertexStride = GetVertexStride(format);
+
+	unsigned int offset = 0;
+	for (int s = 0; s < VERTEX_STREAM_COUNT; s++)
+	{
+		unsigned int stride = GetVertexStreamStride(format, (VertexStream)s);
+		streams[s].resize((size_t)numVerts * stride);
+		for (unsigned int i = 0; i < numVerts; i++)
+			memcpy(&streams[s][(size_t)i * stride], source + (size_t)i * vertexStride + offset, stride);
+		offset += stride;
+	}
+}
+
+// --------------------------------------------------------
+// Interleaves split streams back into whole vertices
+//
+// streams  - One array per VertexStream, each with at least
+//             numVerts elements
+// vertices - Room for numVerts vertices in "format"
+// --------------------------------------------------------
+void MergeVertexStreams(const std::vector<char> streams[VERTEX_STREAM_COUNT], VertexFormat format, unsigned int numVerts, void* vertices)
+{
+	char* dest = (char*)vertices;
+	unsigned int vertexStride = GetVertexStride(format);
+
+	unsigned int offset = 0;
+	for (int s = 0; s < VERTEX_STREAM_COUNT; s++)
+	{
+		unsigned int stride = GetVertexStreamStride(format, (VertexStream)s);
+		for (unsigned int i = 0; i < numVerts; i++)
+			memcpy(dest + (size_t)i * vertexStride + offset, &streams[s][(size_t)i * stride], stride);
+		offset += stride;
+	}
+}
+
+// --------------------------------------------------------
+// Picks the input slot for a per-vertex shader input
+//
+// - Only positions live in the position stream, everything
+//    else (normals, uvs and anything added later) comes from
+//    the attribute stream
+// --------------------------------------------------------
+unsigned int GetVertexStreamSlot(const char* semanticName)
+{
+	return _stricmp(semanticName, "POSITION") == 0 ? VERTEX_STREAM_POSITION : VERTEX_STREAM_ATTRIBUTES;
+}
+
+// --------------------------------------------------------
+// Spreads an input layout across the vertex streams
+//
+// - Per-vertex elements go to their stream's slot, and
+//    per-instance elements go to VERTEX_STREAM_INSTANCE_SLOT
+// - Offsets are counted separately in each slot, in the order
+//    the elements are listed, so the shader's inputs have to
+//    be in the same order as the data in each stream
+//
+// elements     - The layout, whose formats and semantics must
+//                 already be filled in
+// elementCount - How many elements there are
+// --------------------------------------------------------
+void AssignVertexStreams(D3D11_INPUT_ELEMENT_DESC* elements, unsigned int elementCount)
+{
+	unsigned int offsets[VERTEX_STREAM_INSTANCE_SLOT + 1] = {};
+	for (unsigned int i = 0; i < elementCount; i++)
+	{
+		unsigned int slot = elements[i].InputSlotClass == D3D11_INPUT_PER_INSTANCE_DATA ?
+			VERTEX_STREAM_INSTANCE_SLOT :
+			GetVertexStreamSlot(elements[i].SemanticName);
+
+		elements[i].InputSlot = slot;
+		elements[i].AlignedByteOffset = offsets[slot];
+		offsets[slot] += GetVertexElementBytes(elements[i].Format);
+	}
+}
+
+// --------------------------------------------------------
+// Measures how much splitting the streams saves on a mesh
+//
+// - Splitting doesn't change how many bytes a full pass needs,
+//    just how they're spread out, so its reads can come out a
+//    little higher than interleaved; the win is a depth-only
+//    pass reading the position stream instead of everything
+//
+// indices - The mesh's indices, in drawing order
+// format  - Which vertex format it's drawn with
+// --------------------------------------------------------
+VertexStreamBandwidth MeasureStreamBandwidth(const unsigned int* indices, size_t numIndices, size_t numVerts, VertexFormat format)
+{
+	VertexStreamBandwidth bandwidth = {};
+	bandwidth.InterleavedBytes = AnalyzeVertexFetch(indices, numIndices, numVerts, GetVertexStride(format)).BytesFetched;
+
+	for (int s = 0; s < VERTEX_STREAM_COUNT; s++)
+	{
+		unsigned int bytes = AnalyzeVertexFetch(indices, numIndices, numVerts, GetVertexStreamStride(format, (VertexStream)s)).BytesFetched;
+		if (s == VERTEX_STREAM_POSITION)
+			bandwidth.PositionBytes = bytes;
+		bandwidth.SplitBytes += bytes;
+	}
+	return bandwidth;
+}
+
+// --------------------------------------------------------
+// Runs a layout through AssignVertexStreams() and checks
+// each element ends up in the expected slot and offset,
+// printing the result as "name"
+// --------------------------------------------------------
+static bool CheckStreamAssignment(const char* name, D3D11_INPUT_ELEMENT_DESC* elements, unsigned int elementCount, const unsigned int* slots, const unsigned int* offsets)
+{
+	for (unsigned int i = 0; i < elementCount; i++)
+	{
+		elements[i].InputSlot = 0;
+		elements[i].AlignedByteOffset = 0;
+	}
+	AssignVertexStreams(elements, elementCount);
+
+	bool passed = true;
+	for (unsigned int i = 0; i < elementCount; i++)
+		passed = passed && elements[i].InputSlot == slots[i] && elements[i].AlignedByteOffset == offsets[i];
+	printf("\n  %s: %s", name, passed ? "ok" : "FAILED (wrong slots or offsets)");
+	return passed;
+}
+
+// Checks the layout AssignVertexStreams() makes for a vertex type matches the one VertexLayout<> works out
+template<typename VertexT>
+static bool CheckStreamAssignment(const char* name)
+{
+	std::array<D3D11_INPUT_ELEMENT_DESC, VertexLayout<VertexT>::ElementCount> elements = VertexLayout<VertexT>::Elements;
+	unsigned int slots[VertexLayout<VertexT>::ElementCount];
+	unsigned int offsets[VertexLayout<VertexT>::ElementCount];
+	for (unsigned int i = 0; i < VertexLayout<VertexT>::ElementCount; i++)
+	{
+		slots[i] = VertexLayout<VertexT>::Elements[i].InputSlot;
+		offsets[i] = VertexLayout<VertexT>::Elements[i].AlignedByteOffset;
+	}
+	return CheckStreamAssignment(name, &elements[0], VertexLayout<VertexT>::ElementCount, slots, offsets);
+}
+
+// --------------------------------------------------------
+// Checks the layouts the vertex streams are bound with, and
+// splitting and merging each model's vertices, and prints
+// how many bytes each model's passes fetch
+//
+// - The reflected layouts of both vertex formats have to
+//    match the ones VertexLayout<> works out at compile time
+// - A layout with its inputs out of order and per-instance
+//    data has to keep each slot's offsets in listed order,
+//    with the instance data in its own slot
+// - Each model is optimized as Mesh does, then split and
+//    merged back in both formats, which has to give back
+//    exactly the same bytes
+// - Returns false if any of that fails, or a model can't be
+//    read
+// --------------------------------------------------------
+bool CheckVertexStreams(const char* modelDirectory)
+{
+	bool passed = true;
+
+	printf("\nVertex stream layouts:");
+	passed = CheckStreamAssignment<Vertex>("Vertex") && passed;
+	passed = CheckStreamAssignment<PackedVertex>("PackedVertex") && passed;
+
+	D3D11_INPUT_ELEMENT_DESC instanced[] =
+	{
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "position", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "WORLD_PER_INSTANCE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD_PER_INSTANCE", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD_PER_INSTANCE", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD_PER_INSTANCE", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	};
+	const unsigned int instancedSlots[] = { 1, 0, 1, 2, 2, 2, 2 };
+	const unsigned int instancedOffsets[] = { 0, 0, 8, 0, 16, 32, 48 };
+	passed = CheckStreamAssignment("Out of order, instanced", instanced, 7, instancedSlots, instancedOffsets) && passed;
+
+	static const char* models[] = { "cube.obj", "sphere.obj", "cylinder.obj", "cone.obj", "torus.obj", "helix.obj" };
+	printf("\nVertex streams (bytes fetched, optimized):");
+	for (int m = 0; m < 6; m++)
+	{
+		std::string filename = std::string(modelDirectory) + "/" + models[m];
+		ObjData obj;
+		if (!LoadObj(filename.c_str(), obj, 1))
+		{
+			printf("\n  %s: couldn't be read", models[m]);
+			passed = false;
+			continue;
+		}
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+		BuildIndexedMesh(obj, verts, indices);
+		OptimizeMesh(verts, indices);
+		if (verts.empty() || indices.empty())
+		{
+			printf("\n  %s: no triangles", models[m]);
+			passed = false;
+			continue;
+		}
+
+		XMFLOAT3 boundsMin = verts[0].Position;
+		XMFLOAT3 boundsMax = verts[0].Position;
+		for (size_t v = 1; v < verts.size(); v++)
+		{
+			XMStoreFloat3(&boundsMin, XMVectorMin(XMLoadFloat3(&boundsMin), XMLoadFloat3(&verts[v].Position)));
+			XMStoreFloat3(&boundsMax, XMVectorMax(XMLoadFloat3(&boundsMax), XMLoadFloat3(&verts[v].Position)));
+		}
+		std::vector<PackedVertex> packedVerts(verts.size());
+		PackVertices(&verts[0], (unsigned int)verts.size(), boundsMin, boundsMax, &packedVerts[0]);
+
+		const void* formatVerts[2] = { &verts[0], &packedVerts[0] };
+		const char* formatNames[2] = { "full", "packed" };
+		for (int f = 0; f < 2; f++)
+		{
+			VertexFormat format = (VertexFormat)f;
+			unsigned int numVerts = (unsigned int)verts.size();
+
+			std::vector<char> streams[VERTEX_STREAM_COUNT];
+			std::vector<char> merged((size_t)numVerts * GetVertexStride(format));
+			SplitVertexStreams(formatVerts[f], format, numVerts, streams);
+			MergeVertexStreams(streams, format, numVerts, &merged[0]);
+			bool same = memcmp(&merged[0], formatVerts[f], merged.size()) == 0;
+
+			VertexStreamBandwidth bandwidth = MeasureStreamBandwidth(&indices[0], indices.size(), verts.size(), format);
+			printf("\n  %s, %s: depth pass %u bytes (interleaved %u), full pass %u bytes (interleaved %u), %s",
+				models[m], formatNames[f], bandwidth.PositionBytes, bandwidth.InterleavedBytes,
+				bandwidth.SplitBytes, bandwidth.InterleavedBytes, same ? "ok" : "FAILED (split and merge changed the vertices)");
+			passed = passed && same;
+		}
+	}
+	return passed;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <d3d11.h>
+#include "Vertex.h"
+#include <vector>
+
+// Per-instance data is read from the slot after the vertex streams
+const unsigned int VERTEX_STREAM_INSTANCE_SLOT = VERTEX_STREAM_COUNT;
+
+// --------------------------------------------------------
+// How many bytes the input assembler reads to draw a mesh,
+// with its vertices interleaved or split into streams
+// --------------------------------------------------------
+struct VertexStreamBandwidth
+{
+	unsigned int InterleavedBytes;	// One buffer holding whole vertices
+	unsigned int PositionBytes;		// The position stream alone (a depth-only pass)
+	unsigned int SplitBytes;		// Every stream (a full pass)
+};
+
+// Splits interleaved vertices into one array per VertexStream
+void SplitVertexStreams(const void* vertices, VertexFormat format, unsigned int numVerts, std::vector<char> streams[VERTEX_STREAM_COUNT]);
+
+// Puts split streams back together into interleaved vertices (the opposite of SplitVertexStreams())
+void MergeVertexStreams(const std::vector<char> streams[VERTEX_STREAM_COUNT], VertexFormat format, unsigned int numVerts, void* vertices);
+
+// Which input slot the vertex attribute with the given semantic comes from
+unsigned int GetVertexStreamSlot(const char* semanticName);
+
+// How many bytes one element in the given format takes up (0 if it isn't a vertex format)
+constexpr unsigned int GetVertexElementBytes(DXGI_FORMAT format)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+	case DXGI_FORMAT_R32G32B32A32_UINT:
+	case DXGI_FORMAT_R32G32B32A32_SINT:
+		return 16;
+	case DXGI_FORMAT_R32G32B32_FLOAT:
+	case DXGI_FORMAT_R32G32B32_UINT:
+	case DXGI_FORMAT_R32G32B32_SINT:
+		return 12;
+	case DXGI_FORMAT_R32G32_FLOAT:
+	case DXGI_FORMAT_R32G32_UINT:
+	case DXGI_FORMAT_R32G32_SINT:
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+	case DXGI_FORMAT_R16G16B16A16_SNORM:
+	case DXGI_FORMAT_R16G16B16A16_UINT:
+	case DXGI_FORMAT_R16G16B16A16_SINT:
+		return 8;
+	case DXGI_FORMAT_R32_FLOAT:
+	case DXGI_FORMAT_R32_UINT:
+	case DXGI_FORMAT_R32_SINT:
+	case DXGI_FORMAT_R16G16_FLOAT:
+	case DXGI_FORMAT_R16G16_UNORM:
+	case DXGI_FORMAT_R16G16_SNORM:
+	case DXGI_FORMAT_R16G16_UINT:
+	case DXGI_FORMAT_R16G16_SINT:
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_SNORM:
+	case DXGI_FORMAT_R8G8B8A8_UINT:
+	case DXGI_FORMAT_R10G10B10A2_UNORM:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+// Points each element of an input layout at its stream's slot, and works out its offset within that slot
+void AssignVertexStreams(D3D11_INPUT_ELEMENT_DESC* elements, unsigned int elementCount);
+
+// Simulates fetching a mesh's vertices from each arrangement of buffers
+VertexStreamBandwidth MeasureStreamBandwidth(const unsigned int* indices, size_t numIndices, size_t numVerts, VertexFormat format);
+
+// Checks the input layouts AssignVertexStreams() makes, and splitting and merging each model in "modelDirectory"
+// in both vertex formats, printing the bytes each model's depth and full passes fetch.  Returns false if any fail.
+bool CheckVertexStreams(const char* modelDirectory);